@@ -320,6 +320,10 @@ int vnet_pppoe_add_del_session
       pppoe_update_1 (&pem->session_table,
 		      a->client_mac, clib_host_to_net_u16 (a->session_id),
 		      &key, &bucket, &result);
+      if (pem->dispatch_add_del_session)
+	pem->dispatch_add_del_session (a->encap_if_index, a->client_mac,
+				       a->session_id, t - pem->sessions,
+				       1 /* is_add */ );
 
       vnet_hw_interface_t *hi;
       if (vec_len (pem->free_pppoe_session_hw_if_indices) > 0)
@@ -397,6 +401,9 @@ int vnet_pppoe_add_del_session
       pppoe_update_1 (&pem->session_table,
 		      a->client_mac, clib_host_to_net_u16 (a->session_id),
 		      &key, &bucket, &result);
+      if (pem->dispatch_add_del_session)
+	pem->dispatch_add_del_session (a->encap_if_index, a->client_mac,
+				       a->session_id, ~0, 0 /* is_add */ );
 
 
       /* delete reverse route for client ip */
@@ -712,6 +719,23 @@ pppoe_init (vlib_main_t * vm)
   BV (clib_bihash_init) (&pem->session_table, "pppoe session table",
 			 PPPOE_NUM_BUCKETS, PPPOE_MEMORY_SIZE);
 
+  /*
+   * When pppoeclient plugin is loaded it owns the PPPoE ethertypes and
+   * hands us our frames, otherwise take them directly.
+   */
+  void (*register_server) (vlib_main_t *, u32, u32) =
+    vlib_get_plugin_symbol ("pppoeclient_plugin.so",
+			    "pppoe_dispatch_register_server");
+  if (register_server)
+    {
+      pem->dispatch_add_del_session =
+	vlib_get_plugin_symbol ("pppoeclient_plugin.so",
+				"pppoe_dispatch_add_del_server_session");
+      register_server (vm, pppoe_tap_dispatch_node.index,
+		       pppoe_dispatched_input_node.index);
+      return 0;
+    }
+
   ethernet_register_input_type (vm, ETHERNET_TYPE_PPPOE_SESSION,
 				pppoe_input_node.index);
 
@@ -162,6 +162,14 @@ typedef struct
   /* used for pppoe cp path */
   u32 tap_if_index;
 
+  /*
+   * Mirrors sessions into pppoe-dispatch of pppoeclient plugin when
+   * both plugins are loaded, 0 otherwise.
+   */
+  void (*dispatch_add_del_session) (u32 sw_if_index, u8 * mac,
+				    u16 session_id, u32 session_index,
+				    int is_add);
+
   /* API message ID base */
   u16 msg_id_base;
 
@@ -174,6 +182,7 @@ typedef struct
 extern pppoe_main_t pppoe_main;
 
 extern vlib_node_registration_t pppoe_input_node;
+extern vlib_node_registration_t pppoe_dispatched_input_node;
 extern vlib_node_registration_t pppoe_tap_dispatch_node;
 
 typedef struct
@@ -46,10 +46,32 @@ static u8 * format_pppoe_rx_trace (u8 * s, va_list * args)
   return s;
 }
 
-static uword
-pppoe_input (vlib_main_t * vm,
-             vlib_node_runtime_t * node,
-             vlib_frame_t * from_frame)
+/*
+ * Behind pppoe-dispatch the session has already been looked up, its
+ * index comes in the buffer, ~0 when pppoe-dispatch found none.
+ */
+static_always_inline void
+pppoe_input_lookup (pppoe_main_t * pem, vlib_buffer_t * b0,
+		    pppoe_entry_key_t * cached_key,
+		    pppoe_entry_result_t * cached_result,
+		    u8 * mac0, u16 session_id0,
+		    pppoe_entry_key_t * key0, u32 * bucket0,
+		    pppoe_entry_result_t * result0, int is_dispatched)
+{
+  if (is_dispatched && vnet_buffer (b0)->pppox.session_index != ~0)
+    {
+      result0->fields.session_index = vnet_buffer (b0)->pppox.session_index;
+      return;
+    }
+
+  pppoe_lookup_1 (&pem->session_table, cached_key, cached_result,
+		  mac0, session_id0, key0, bucket0, result0);
+}
+
+static_always_inline uword
+pppoe_input_inline (vlib_main_t * vm,
+		    vlib_node_runtime_t * node,
+		    vlib_frame_t * from_frame, int is_dispatched)
 {
   u32 n_left_from, next_index, * from, * to_next;
   pppoe_main_t * pem = &pppoe_main;
@@ -140,9 +162,9 @@ pppoe_input (vlib_main_t * vm,
           vlib_buffer_reset(b0);
           h0 = vlib_buffer_get_current (b0);
 
-	  pppoe_lookup_1 (&pem->session_table, &cached_key, &cached_result,
-			  h0->src_address, pppoe0->session_id,
-			  &key0, &bucket0, &result0);
+	  pppoe_input_lookup (pem, b0, &cached_key, &cached_result,
+			      h0->src_address, pppoe0->session_id,
+			      &key0, &bucket0, &result0, is_dispatched);
           if (PREDICT_FALSE (result0.fields.session_index == ~0))
 	    {
 	      error0 = PPPOE_ERROR_NO_SUCH_SESSION;
@@ -210,9 +232,9 @@ pppoe_input (vlib_main_t * vm,
           vlib_buffer_reset(b1);
           h1 = vlib_buffer_get_current (b1);
 
-	  pppoe_lookup_1 (&pem->session_table, &cached_key, &cached_result,
-			  h1->src_address, pppoe1->session_id,
-			  &key1, &bucket1, &result1);
+	  pppoe_input_lookup (pem, b1, &cached_key, &cached_result,
+			      h1->src_address, pppoe1->session_id,
+			      &key1, &bucket1, &result1, is_dispatched);
           if (PREDICT_FALSE (result1.fields.session_index == ~0))
 	    {
 	      error1 = PPPOE_ERROR_NO_SUCH_SESSION;
@@ -312,9 +334,9 @@ pppoe_input (vlib_main_t * vm,
           vlib_buffer_reset(b0);
           h0 = vlib_buffer_get_current (b0);
 
-	  pppoe_lookup_1 (&pem->session_table, &cached_key, &cached_result,
-			  h0->src_address, pppoe0->session_id,
-			  &key0, &bucket0, &result0);
+	  pppoe_input_lookup (pem, b0, &cached_key, &cached_result,
+			      h0->src_address, pppoe0->session_id,
+			      &key0, &bucket0, &result0, is_dispatched);
           if (PREDICT_FALSE (result0.fields.session_index == ~0))
 	    {
 	      error0 = PPPOE_ERROR_NO_SUCH_SESSION;
@@ -375,7 +397,7 @@ pppoe_input (vlib_main_t * vm,
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
   /* Do we still need this now that session tx stats is kept? */
-  vlib_node_increment_counter (vm, pppoe_input_node.index,
+  vlib_node_increment_counter (vm, node->node_index,
                                PPPOE_ERROR_DECAPSULATED,
                                pkts_decapsulated);
 
@@ -398,6 +420,22 @@ static char * pppoe_error_strings[] = {
 #undef _
 };
 
+static uword
+pppoe_input (vlib_main_t * vm,
+             vlib_node_runtime_t * node,
+             vlib_frame_t * from_frame)
+{
+  return pppoe_input_inline (vm, node, from_frame, 0 /* is_dispatched */);
+}
+
+static uword
+pppoe_dispatched_input (vlib_main_t * vm,
+                        vlib_node_runtime_t * node,
+                        vlib_frame_t * from_frame)
+{
+  return pppoe_input_inline (vm, node, from_frame, 1 /* is_dispatched */);
+}
+
 VLIB_REGISTER_NODE (pppoe_input_node) = {
   .function = pppoe_input,
   .name = "pppoe-input",
@@ -419,4 +457,25 @@ VLIB_REGISTER_NODE (pppoe_input_node) = {
 
 VLIB_NODE_FUNCTION_MULTIARCH (pppoe_input_node, pppoe_input)
 
+VLIB_REGISTER_NODE (pppoe_dispatched_input_node) = {
+  .function = pppoe_dispatched_input,
+  .name = "pppoe-dispatched-input",
+  /* Takes a vector of packets. */
+  .vector_size = sizeof (u32),
+
+  .n_errors = PPPOE_N_ERROR,
+  .error_strings = pppoe_error_strings,
+
+  .n_next_nodes = PPPOE_INPUT_N_NEXT,
+  .next_nodes = {
+#define _(s,n) [PPPOE_INPUT_NEXT_##s] = n,
+    foreach_pppoe_input_next
+#undef _
+  },
+
+  .format_trace = format_pppoe_rx_trace,
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (pppoe_dispatched_input_node, pppoe_dispatched_input)
+
 
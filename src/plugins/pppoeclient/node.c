@@ -13,6 +13,21 @@ static char * pppoeclient_error_strings[] = {
 #undef _
 };
 
+typedef struct {
+  u32 thread_index;
+} pppoeclient_handoff_trace_t;
+
+static u8 * format_pppoeclient_handoff_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  pppoeclient_handoff_trace_t * t = va_arg (*args, pppoeclient_handoff_trace_t *);
+
+  s = format (s, "PPPoE control handoff from thread %d to main thread",
+              t->thread_index);
+  return s;
+}
+
 typedef struct {
   u32 sw_if_index;
   u32 host_uniq;
@@ -32,14 +47,62 @@ static u8 * format_pppoeclient_discovery_rx_trace (u8 * s, va_list * args)
   return s;
 }
 
+/*
+ * Client and pppd state is only touched by main thread, control frames
+ * received by a worker are queued to main thread as a whole frame.
+ */
+static_always_inline uword
+pppoeclient_handoff_to_main (vlib_main_t * vm,
+                             vlib_node_runtime_t * node,
+                             vlib_frame_t * from_frame,
+                             u32 frame_queue_index)
+{
+  pppoeclient_main_t * pem = &pppoeclient_main;
+  vlib_frame_queue_elt_t * hf;
+  u32 * from = vlib_frame_vector_args (from_frame);
+  u32 n_vectors = from_frame->n_vectors;
+  u32 i;
+
+  if (PREDICT_FALSE (node->flags & VLIB_NODE_FLAG_TRACE))
+    {
+      for (i = 0; i < n_vectors; i++)
+        {
+          vlib_buffer_t * b0 = vlib_get_buffer (vm, from[i]);
+          if (b0->flags & VLIB_BUFFER_IS_TRACED)
+            {
+              pppoeclient_handoff_trace_t *tr
+                = vlib_add_trace (vm, node, b0, sizeof (*tr));
+              tr->thread_index = vm->thread_index;
+            }
+        }
+    }
+
+  // a frame always fits in one queue element.
+  hf = vlib_get_frame_queue_elt (frame_queue_index, 0);
+  clib_memcpy (hf->buffer_index, from, n_vectors * sizeof (u32));
+  hf->n_vectors = n_vectors;
+  vlib_put_frame_queue_elt (hf);
+
+  pppoeclient_handoff_kick (pem);
+
+  vlib_node_increment_counter (vm, node->node_index,
+                               PPPOECLIENT_ERROR_HANDOFF_PKTS, n_vectors);
+  return n_vectors;
+}
+
 static uword
 pppoeclient_discovery_input (vlib_main_t * vm,
                              vlib_node_runtime_t * node,
                              vlib_frame_t * from_frame)
 {
+  pppoeclient_main_t * pem = &pppoeclient_main;
   u32 n_left_from, next_index, * from, * to_next;
   u32 discovery_pkts = 0;
 
+  if (PREDICT_FALSE (vm->thread_index != 0))
+    return pppoeclient_handoff_to_main (vm, node, from_frame,
+                                        pem->discovery_frame_queue_index);
+
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
 
@@ -134,47 +197,6 @@ VLIB_NODE_FUNCTION_MULTIARCH (pppoeclient_discovery_input_node, pppoeclient_disc
 
 /////// SESSION NODE /////
 
-// ethernet II MT(1500B) - pppoe overhead(8B) - IPv4(20B) - TCP(20B)
-// TODO: 可能要考虑使用支持MRU协商的数据
-#define PPPOE_DEFAULT_TCP_MSS 1452
-
-static void try_update_tcp_mss(vlib_buffer_t *b0)
-{
-  unsigned char * ppp0 = vlib_buffer_get_current (b0);
-  u16 ppp_protocol = clib_net_to_host_u16 (*(u16 *) ppp0);
-  if (PPP_PROTOCOL_ip4 == ppp_protocol)
-    {
-
-      ip4_header_t * ip0 = (ip4_header_t *)(ppp0 + 2); // skip ppp protocol.
-      if ((IP_PROTOCOL_TCP == ip0->protocol) && (clib_net_to_host_u16(ip0->length) < 66))
-	{
-	  tcp_header_t *tcp0 = ip4_next_header (ip0);
-	  if (tcp0->flags & TCP_FLAG_SYN)
-	    {
-	      u8 opts_len = (tcp_doff (tcp0) << 2) - sizeof (tcp_header_t);
-	      u8 *data = (u8 *) (tcp0 + 1);
-	      if (opts_len > 0 && TCP_OPTION_MSS == data[0])
-		{
-		  u16 mss = clib_net_to_host_u16 (*(u16 *) (data + 2));
-		  if (mss > PPPOE_DEFAULT_TCP_MSS)
-		    {
-		      *(u16 *) (data + 2) = clib_net_to_host_u16(PPPOE_DEFAULT_TCP_MSS);
-		      // update tcp checksum
-		      ip_csum_t sum0 = tcp0->checksum;
-		      sum0 = ip_csum_update (sum0, clib_net_to_host_u16(mss), *(u16 *) (data + 2),
-					     ip4_header_t,/* cheat */
-					     length /* changed member */);
-		      tcp0->checksum = ip_csum_fold(sum0);
-		    }
-		}
-	    }
-	}
-    }
-
-  // TODO: support ipv6 later.
-  return;
-}
-
 typedef struct {
   u32 sw_if_index;
   u16 session_id;
@@ -194,19 +216,91 @@ static u8 * format_pppoeclient_session_rx_trace (u8 * s, va_list * args)
   return s;
 }
 
+/*
+ * Answer an LCP Echo-Request by turning the received buffer around,
+ * pppd is not involved and learns about the reply when it next polls
+ * lcp_echo_replied. Anything unusual is left to pppd.
+ */
+static_always_inline int
+pppoeclient_lcp_echo_reply (pppoe_client_t * c0, vlib_buffer_t * b0,
+                            ethernet_header_t * h0, pppoe_header_t * pppoe0)
+{
+  u8 * lcp0 = (u8 *) (pppoe0 + 1) + sizeof (u16);
+  u16 len0;
+
+  // code, id, length and magic number must be there before any is read.
+  if (!c0->lcp_echo_reply ||
+      (u8 *) vlib_buffer_get_current (b0) + b0->current_length < lcp0 + 8)
+    return 0;
+
+  len0 = clib_net_to_host_u16 (*(u16 *) (lcp0 + 2));
+  if (lcp0[0] != PPPOE_CLIENT_LCP_ECHOREQ || len0 < 8 ||
+      len0 + sizeof (u16) > clib_net_to_host_u16 (pppoe0->length))
+    return 0;
+
+  // our own magic number, the link is looped back, pppd's lcp_rechoreq
+  // notices and does not answer.
+  if (PREDICT_FALSE (c0->lcp_magic &&
+                     clib_net_to_host_u32 (*(u32 *) (lcp0 + 4)) == c0->lcp_magic))
+    return 0;
+
+  lcp0[0] = PPPOE_CLIENT_LCP_ECHOREP;
+  *(u32 *) (lcp0 + 4) = clib_host_to_net_u32 (c0->lcp_magic);
+  // back to the AC, our rewrite has the addresses the right way round.
+  clib_memcpy (h0, c0->rewrite, 2 * sizeof (h0->dst_address));
+  vnet_buffer (b0)->sw_if_index[VLIB_TX] = c0->sw_if_index;
+  c0->lcp_echo_replied++;
+
+  return 1;
+}
+
+/*
+ * Data frames of a session count as rx of its pppox interface, frames
+ * of one session tend to arrive back to back so the combined counter is
+ * only touched when the interface changes and once at the end of frame.
+ */
+static_always_inline void
+pppoeclient_session_rx_count (vnet_interface_main_t * im, u32 thread_index,
+                              u32 sw_if_index0, u32 len0,
+                              u32 * stats_sw_if_index, u32 * stats_n_packets,
+                              u32 * stats_n_bytes)
+{
+  if (PREDICT_FALSE (sw_if_index0 != *stats_sw_if_index))
+    {
+      if (*stats_n_packets)
+        vlib_increment_combined_counter
+          (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX,
+           thread_index, *stats_sw_if_index, *stats_n_packets, *stats_n_bytes);
+      *stats_sw_if_index = sw_if_index0;
+      *stats_n_packets = *stats_n_bytes = 0;
+    }
+  *stats_n_packets += 1;
+  *stats_n_bytes += len0;
+}
+
 static uword
 pppoeclient_session_input (vlib_main_t * vm,
                            vlib_node_runtime_t * node,
                            vlib_frame_t * from_frame)
 {
   pppoeclient_main_t * pem = &pppoeclient_main;
+  vnet_interface_main_t * im = &pem->vnet_main->interface_main;
   u32 n_left_from, next_index, * from, * to_next;
   u32 session_pkts = 0;
+  u32 echo_replied = 0;
+  u32 thread_index = vm->thread_index;
+  u32 stats_sw_if_index, stats_n_packets, stats_n_bytes;
+  // ppp control frames are consumed by main thread only.
+  u32 ctrl_next = vm->thread_index ?
+    PPPOECLIENT_SESSION_INPUT_NEXT_CONTROL_HANDOFF :
+    PPPOECLIENT_SESSION_INPUT_NEXT_PPPOX_INPUT;
 
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
 
   next_index = node->cached_next_index;
+  stats_sw_if_index = node->runtime_data[0];
+  stats_n_packets = stats_n_bytes = 0;
 
   while (n_left_from > 0)
     {
@@ -267,9 +361,8 @@ pppoeclient_session_input (vlib_main_t * vm,
               goto trace0;
             }
 
-          pppoeclient_lookup_session_1 (&pem->session_table,
-					clib_net_to_host_u16(pppoe0->session_id),
-					&result0);
+          // pppoe-dispatch did the session table lookup.
+          result0.fields.client_index = vnet_buffer (b0)->pppox.session_index;
           if (PREDICT_FALSE (result0.fields.client_index == ~0))
             {
               error0 = PPPOECLIENT_ERROR_NO_SUCH_SESSION;
@@ -288,22 +381,49 @@ pppoeclient_session_input (vlib_main_t * vm,
           c0 = pool_elt_at_index (pem->clients,
                                   result0.fields.client_index);
 
-          /* Pop Eth and PPPPoE header */
-          vlib_buffer_reset(b0);
-          h0 = vlib_buffer_get_current (b0);
-          vlib_buffer_advance(b0, sizeof(*h0)+sizeof(*pppoe0));
+          /* Pop PPPoE header, ethernet and any VLAN tags are behind */
+          h0 = (ethernet_header_t *) (b0->data +
+                                      vnet_buffer (b0)->l2_hdr_offset);
+          vlib_buffer_advance(b0, sizeof(*pppoe0));
 
           // Update vlib rx to pppox virtual interface.
           vnet_buffer (b0)->sw_if_index[VLIB_RX] = c0->pppox_sw_if_index;
+          session_pkts++;
 
           if (ppp_proto0 == PPP_PROTOCOL_ip4)
             {
-	      // do before skip ppp protocol.
-	      try_update_tcp_mss(b0);
               // give only ip4 packet for ip4-input.
               vlib_buffer_advance(b0, sizeof (ppp_proto0));
+              c0->rx_packets++;
+              pppoeclient_session_rx_count (im, thread_index,
+                                            c0->pppox_sw_if_index,
+                                            b0->current_length,
+                                            &stats_sw_if_index,
+                                            &stats_n_packets, &stats_n_bytes);
 	      next0 = PPPOECLIENT_SESSION_INPUT_NEXT_IP4_INPUT;
             }
+          else if (ppp_proto0 == PPP_PROTOCOL_multilink)
+            {
+              // fragments of a multilink bundle, padding of short frames off.
+              b0->current_length = clib_min (b0->current_length,
+                                             clib_net_to_host_u16 (pppoe0->length));
+              vlib_buffer_advance (b0, sizeof (ppp_proto0));
+              c0->rx_packets++;
+              pppoeclient_session_rx_count (im, thread_index,
+                                            c0->pppox_sw_if_index,
+                                            b0->current_length,
+                                            &stats_sw_if_index,
+                                            &stats_n_packets, &stats_n_bytes);
+              next0 = PPPOECLIENT_SESSION_INPUT_NEXT_PPPOX_MP_INPUT;
+            }
+          else if (ppp_proto0 == PPP_PROTOCOL_lcp &&
+                   pppoeclient_lcp_echo_reply (c0, b0, h0, pppoe0))
+            {
+              vlib_buffer_advance (b0, vnet_buffer (b0)->l2_hdr_offset -
+                                   b0->current_data);
+              echo_replied++;
+              next0 = PPPOECLIENT_SESSION_INPUT_NEXT_INTERFACE_OUTPUT;
+            }
           else if ((ppp_proto0 == PPP_PROTOCOL_lcp) ||
                    (ppp_proto0 == PPP_PROTOCOL_pap) ||
                    (ppp_proto0 == PPP_PROTOCOL_ipcp) ||
@@ -311,7 +431,7 @@ pppoeclient_session_input (vlib_main_t * vm,
             {
 	      // Set ppp length in order to help parsing ctrl packet (adapt oss pppd).
 	      vnet_buffer (b0)->pppox.len = clib_net_to_host_u16(pppoe0->length);
-              next0 = PPPOECLIENT_SESSION_INPUT_NEXT_PPPOX_INPUT;
+              next0 = ctrl_next;
             }
           else {
 	    error0 = PPPOECLIENT_ERROR_UNSUPPORTED_PPP_PROTOCOL;
@@ -343,9 +463,8 @@ pppoeclient_session_input (vlib_main_t * vm,
               goto trace1;
             }
 
-          pppoeclient_lookup_session_1 (&pem->session_table,
-					clib_net_to_host_u16(pppoe1->session_id),
-					&result1);
+          // pppoe-dispatch did the session table lookup.
+          result1.fields.client_index = vnet_buffer (b1)->pppox.session_index;
           if (PREDICT_FALSE (result1.fields.client_index == ~0))
             {
               error1 = PPPOECLIENT_ERROR_NO_SUCH_SESSION;
@@ -364,22 +483,49 @@ pppoeclient_session_input (vlib_main_t * vm,
           c1 = pool_elt_at_index (pem->clients,
                                   result1.fields.client_index);
 
-          /* Pop Eth and PPPPoE header */
-          vlib_buffer_reset(b1);
-          h1 = vlib_buffer_get_current (b1);
-          vlib_buffer_advance(b1, sizeof(*h1)+sizeof(*pppoe1));
+          /* Pop PPPoE header, ethernet and any VLAN tags are behind */
+          h1 = (ethernet_header_t *) (b1->data +
+                                      vnet_buffer (b1)->l2_hdr_offset);
+          vlib_buffer_advance(b1, sizeof(*pppoe1));
 
           // Update vlib rx to pppox virtual interface.
           vnet_buffer (b1)->sw_if_index[VLIB_RX] = c1->pppox_sw_if_index;
+          session_pkts++;
 
           if (ppp_proto1 == PPP_PROTOCOL_ip4)
             {
-	      // do before skip ppp protocol.
-	      try_update_tcp_mss(b1);
 	      // give only ip4 packet for ip4-input.
               vlib_buffer_advance(b1, sizeof (ppp_proto1));
+              c1->rx_packets++;
+              pppoeclient_session_rx_count (im, thread_index,
+                                            c1->pppox_sw_if_index,
+                                            b1->current_length,
+                                            &stats_sw_if_index,
+                                            &stats_n_packets, &stats_n_bytes);
               next1 = PPPOECLIENT_SESSION_INPUT_NEXT_IP4_INPUT;
             }
+          else if (ppp_proto1 == PPP_PROTOCOL_multilink)
+            {
+              // fragments of a multilink bundle, padding of short frames off.
+              b1->current_length = clib_min (b1->current_length,
+                                             clib_net_to_host_u16 (pppoe1->length));
+              vlib_buffer_advance (b1, sizeof (ppp_proto1));
+              c1->rx_packets++;
+              pppoeclient_session_rx_count (im, thread_index,
+                                            c1->pppox_sw_if_index,
+                                            b1->current_length,
+                                            &stats_sw_if_index,
+                                            &stats_n_packets, &stats_n_bytes);
+              next1 = PPPOECLIENT_SESSION_INPUT_NEXT_PPPOX_MP_INPUT;
+            }
+          else if (ppp_proto1 == PPP_PROTOCOL_lcp &&
+                   pppoeclient_lcp_echo_reply (c1, b1, h1, pppoe1))
+            {
+              vlib_buffer_advance (b1, vnet_buffer (b1)->l2_hdr_offset -
+                                   b1->current_data);
+              echo_replied++;
+              next1 = PPPOECLIENT_SESSION_INPUT_NEXT_INTERFACE_OUTPUT;
+            }
           else if ((ppp_proto1 == PPP_PROTOCOL_lcp) ||
                    (ppp_proto1 == PPP_PROTOCOL_pap) ||
                    (ppp_proto1 == PPP_PROTOCOL_ipcp) ||
@@ -387,7 +533,7 @@ pppoeclient_session_input (vlib_main_t * vm,
             {
 	      // Set ppp length in order to help parsing ctrl packet (adapt oss pppd).
 	      vnet_buffer (b1)->pppox.len = clib_net_to_host_u16(pppoe1->length);
-              next1 = PPPOECLIENT_SESSION_INPUT_NEXT_PPPOX_INPUT;
+              next1 = ctrl_next;
             }
           else {
 	    error1 = PPPOECLIENT_ERROR_UNSUPPORTED_PPP_PROTOCOL;
@@ -449,9 +595,8 @@ pppoeclient_session_input (vlib_main_t * vm,
               goto trace00;
             }
 
-          pppoeclient_lookup_session_1 (&pem->session_table,
-					clib_net_to_host_u16(pppoe0->session_id),
-					&result0);
+          // pppoe-dispatch did the session table lookup.
+          result0.fields.client_index = vnet_buffer (b0)->pppox.session_index;
           if (PREDICT_FALSE (result0.fields.client_index == ~0))
             {
               error0 = PPPOECLIENT_ERROR_NO_SUCH_SESSION;
@@ -469,22 +614,49 @@ pppoeclient_session_input (vlib_main_t * vm,
           c0 = pool_elt_at_index (pem->clients,
                                   result0.fields.client_index);
 
-          /* Pop Eth and PPPPoE header */
-          vlib_buffer_reset(b0);
-          h0 = vlib_buffer_get_current (b0);
-          vlib_buffer_advance(b0, sizeof(*h0)+sizeof(*pppoe0));
+          /* Pop PPPoE header, ethernet and any VLAN tags are behind */
+          h0 = (ethernet_header_t *) (b0->data +
+                                      vnet_buffer (b0)->l2_hdr_offset);
+          vlib_buffer_advance(b0, sizeof(*pppoe0));
 
           // Update vlib rx to pppox virtual interface.
           vnet_buffer (b0)->sw_if_index[VLIB_RX] = c0->pppox_sw_if_index;
+          session_pkts++;
 
           if (ppp_proto0 == PPP_PROTOCOL_ip4)
             {
-	      // do before skip ppp protocol.
-	      try_update_tcp_mss(b0);
               // give only ip4 packet for ip4-input.
               vlib_buffer_advance(b0, sizeof (ppp_proto0));
+              c0->rx_packets++;
+              pppoeclient_session_rx_count (im, thread_index,
+                                            c0->pppox_sw_if_index,
+                                            b0->current_length,
+                                            &stats_sw_if_index,
+                                            &stats_n_packets, &stats_n_bytes);
               next0 = PPPOECLIENT_SESSION_INPUT_NEXT_IP4_INPUT;
             }
+          else if (ppp_proto0 == PPP_PROTOCOL_multilink)
+            {
+              // fragments of a multilink bundle, padding of short frames off.
+              b0->current_length = clib_min (b0->current_length,
+                                             clib_net_to_host_u16 (pppoe0->length));
+              vlib_buffer_advance (b0, sizeof (ppp_proto0));
+              c0->rx_packets++;
+              pppoeclient_session_rx_count (im, thread_index,
+                                            c0->pppox_sw_if_index,
+                                            b0->current_length,
+                                            &stats_sw_if_index,
+                                            &stats_n_packets, &stats_n_bytes);
+              next0 = PPPOECLIENT_SESSION_INPUT_NEXT_PPPOX_MP_INPUT;
+            }
+          else if (ppp_proto0 == PPP_PROTOCOL_lcp &&
+                   pppoeclient_lcp_echo_reply (c0, b0, h0, pppoe0))
+            {
+              vlib_buffer_advance (b0, vnet_buffer (b0)->l2_hdr_offset -
+                                   b0->current_data);
+              echo_replied++;
+              next0 = PPPOECLIENT_SESSION_INPUT_NEXT_INTERFACE_OUTPUT;
+            }
           else if ((ppp_proto0 == PPP_PROTOCOL_lcp) ||
                    (ppp_proto0 == PPP_PROTOCOL_pap) ||
 		   (ppp_proto0 == PPP_PROTOCOL_ipcp) ||
@@ -492,7 +664,7 @@ pppoeclient_session_input (vlib_main_t * vm,
             {
 	      // Set ppp length in order to help parsing ctrl packet (adapt oss pppd).
 	      vnet_buffer (b0)->pppox.len = clib_net_to_host_u16(pppoe0->length);
-              next0 = PPPOECLIENT_SESSION_INPUT_NEXT_PPPOX_INPUT;
+              next0 = ctrl_next;
             }
           else {
 	    error0 = PPPOECLIENT_ERROR_UNSUPPORTED_PPP_PROTOCOL;
@@ -521,9 +693,19 @@ pppoeclient_session_input (vlib_main_t * vm,
 
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
+  if (stats_n_packets)
+    {
+      vlib_increment_combined_counter
+        (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX,
+         thread_index, stats_sw_if_index, stats_n_packets, stats_n_bytes);
+      node->runtime_data[0] = stats_sw_if_index;
+    }
   vlib_node_increment_counter (vm, pppoeclient_session_input_node.index,
                                PPPOECLIENT_ERROR_SESSION_PKT_RCVED,
                                session_pkts);
+  vlib_node_increment_counter (vm, pppoeclient_session_input_node.index,
+                               PPPOECLIENT_ERROR_LCP_ECHO_REPLIED,
+                               echo_replied);
   return from_frame->n_vectors;
 }
 
@@ -548,38 +730,163 @@ VLIB_REGISTER_NODE (pppoeclient_session_input_node) = {
 
 VLIB_NODE_FUNCTION_MULTIARCH (pppoeclient_session_input_node, pppoeclient_session_input)
 
+/////// DISPATCH NODE /////
+
+/*
+ * pppoe-dispatch owns both PPPoE ethertypes, so this plugin and the
+ * pppoe server plugin can run in the same instance. Server sessions are
+ * mirrored into the client session table (see
+ * pppoe_dispatch_add_del_server_session), one probe per packet tells
+ * which side owns it, and the decap nodes take the index found here.
+ */
+
 typedef struct {
   u32 sw_if_index;
   u16 session_id;
-  u16 rsv;
-  u32 pppox_sw_if_index;
-  u32 error;
-} pppoeclient_session_tx_trace_t;
+  u8 code;
+  u8 owner;
+  u32 index;
+  u32 next_index;
+} pppoe_dispatch_trace_t;
 
-static u8 * format_pppoeclient_session_tx_trace (u8 * s, va_list * args)
+static u8 * format_pppoe_dispatch_trace (u8 * s, va_list * args)
 {
   CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
   CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
-  pppoeclient_session_tx_trace_t * t = va_arg (*args, pppoeclient_session_tx_trace_t *);
-
-  s = format (s, "PPPoE session sw_if_index %d session_id %d error %d",
-              t->sw_if_index, t->session_id, t->error);
+  pppoe_dispatch_trace_t * t = va_arg (*args, pppoe_dispatch_trace_t *);
+
+  s = format (s, "PPPoE dispatch sw_if_index %d session_id %d code 0x%x",
+              t->sw_if_index, t->session_id, t->code);
+  if (t->index == ~0)
+    s = format (s, " no session next %d", t->next_index);
+  else
+    s = format (s, " %s %d next %d",
+                t->owner == PPPOE_SESSION_OWNER_SERVER ? "server session" :
+                "client", t->index, t->next_index);
   return s;
 }
 
+/*
+ * Compute the session keys of a frame and their hashes up front and
+ * prefetch the hash buckets, so the lookups of the main loop don't
+ * stall on the session table.
+ */
+static_always_inline void
+pppoe_dispatch_hash (vlib_main_t * vm,
+                     clib_bihash_16_8_t * session_table,
+                     u32 * from, u32 n_left_from,
+                     clib_bihash_kv_16_8_t * kv, u64 * hash)
+{
+  while (n_left_from > 0)
+    {
+      vlib_buffer_t * b0;
+      ethernet_header_t * h0;
+      pppoe_header_t * pppoe0;
+
+      if (n_left_from > 4)
+        {
+          vlib_buffer_t * p4 = vlib_get_buffer (vm, from[4]);
+
+          vlib_prefetch_buffer_header (p4, LOAD);
+          CLIB_PREFETCH (p4->data, CLIB_CACHE_LINE_BYTES, LOAD);
+        }
+
+      b0 = vlib_get_buffer (vm, from[0]);
+      h0 = (ethernet_header_t *) (b0->data + vnet_buffer (b0)->l2_hdr_offset);
+      pppoe0 = vlib_buffer_get_current (b0);
+
+      pppoeclient_make_session_key (kv, vnet_buffer (b0)->sw_if_index[VLIB_RX],
+                                    h0->src_address,
+                                    clib_net_to_host_u16 (pppoe0->session_id));
+      hash[0] = clib_bihash_hash_16_8 (kv);
+      pppoeclient_session_prefetch_bucket (session_table, hash[0]);
+
+      from += 1;
+      kv += 1;
+      hash += 1;
+      n_left_from -= 1;
+    }
+}
+
+static_always_inline u32
+pppoe_dispatch_one (pppoeclient_main_t * pem, vlib_buffer_t * b0,
+                    clib_bihash_kv_16_8_t * kv0, u64 hash0,
+                    pppoe_client_result_t * result0, u32 * error0)
+{
+  pppoe_header_t * pppoe0 = vlib_buffer_get_current (b0);
+  u8 code0 = pppoe0->code;
+  u32 is_data0 = code0 == PPPOE_SESSION_DATA;
+
+  result0->raw = ~0ULL;
+
+  // PADO/PADS only ever answer a client, PADI/PADR only reach a server.
+  if (code0 == PPPOE_PADO || code0 == PPPOE_PADS)
+    return PPPOE_DISPATCH_NEXT_CLIENT_DISCOVERY;
+  if (code0 == PPPOE_PADI || code0 == PPPOE_PADR)
+    return pem->dispatch_server_discovery_next != ~0 ?
+      pem->dispatch_server_discovery_next :
+      PPPOE_DISPATCH_NEXT_CLIENT_DISCOVERY;
+
+  // session data and PADT belong to whoever owns the session.
+  pppoeclient_lookup_session_with_hash (&pem->session_table,
+                                        kv0, hash0, result0);
+  vnet_buffer (b0)->pppox.session_index = result0->fields.client_index;
+
+  if (PREDICT_TRUE (result0->fields.client_index != ~0))
+    {
+      if (result0->fields.owner == PPPOE_SESSION_OWNER_CLIENT)
+        return is_data0 ? PPPOE_DISPATCH_NEXT_CLIENT_SESSION :
+          PPPOE_DISPATCH_NEXT_CLIENT_DISCOVERY;
+      return is_data0 ? pem->dispatch_server_session_next :
+        pem->dispatch_server_discovery_next;
+    }
+
+  // a server learns sessions from its control plane only once ppp is
+  // up, so let it look at what nobody owns yet.
+  if (pem->dispatch_server_session_next != ~0)
+    return is_data0 ? pem->dispatch_server_session_next :
+      pem->dispatch_server_discovery_next;
+
+  if (is_data0)
+    {
+      *error0 = PPPOECLIENT_ERROR_NO_SUCH_SESSION;
+      return PPPOE_DISPATCH_NEXT_DROP;
+    }
+  return PPPOE_DISPATCH_NEXT_CLIENT_DISCOVERY;
+}
+
+static_always_inline void
+pppoe_dispatch_trace (vlib_main_t * vm, vlib_node_runtime_t * node,
+                      vlib_buffer_t * b0, pppoe_client_result_t * result0,
+                      u32 next0)
+{
+  pppoe_header_t * pppoe0 = vlib_buffer_get_current (b0);
+  pppoe_dispatch_trace_t * tr = vlib_add_trace (vm, node, b0, sizeof (*tr));
+
+  tr->sw_if_index = vnet_buffer (b0)->sw_if_index[VLIB_RX];
+  tr->session_id = clib_net_to_host_u16 (pppoe0->session_id);
+  tr->code = pppoe0->code;
+  tr->owner = result0->fields.owner;
+  tr->index = result0->fields.client_index;
+  tr->next_index = next0;
+}
+
 static uword
-pppoeclient_session_output (vlib_main_t * vm,
-			    vlib_node_runtime_t * node,
-			    vlib_frame_t * from_frame)
+pppoe_dispatch (vlib_main_t * vm,
+                vlib_node_runtime_t * node,
+                vlib_frame_t * from_frame)
 {
   pppoeclient_main_t * pem = &pppoeclient_main;
-  vnet_main_t * vnm = pem->vnet_main;
   u32 n_left_from, next_index, * from, * to_next;
-  u32 session_out_pkts = 0;
+  clib_bihash_kv_16_8_t kvs[VLIB_FRAME_SIZE], * kv = kvs;
+  u64 hashes[VLIB_FRAME_SIZE], * hash = hashes;
 
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
 
+  pppoe_dispatch_hash (vm, &pem->session_table,
+                       from, n_left_from, kvs, hashes);
+
   next_index = node->cached_next_index;
 
   while (n_left_from > 0)
@@ -592,27 +899,11 @@ pppoeclient_session_output (vlib_main_t * vm,
           u32 bi0, bi1;
           vlib_buffer_t * b0, * b1;
           u32 next0, next1;
-          ethernet_header_t * h0, * h1;
-          pppoe_header_t * pppoe0, * pppoe1;
-          vnet_hw_interface_t * hw0, * hw1;
-          vnet_sw_interface_t * sup_sw0, * sw0, * sup_sw1, * sw1;
-          pppoe_client_t * c0 = 0, * c1 = 0;
-          u32 error0, error1;
-          u32 pppox_sw_if_index0, pppox_sw_if_index1;
-
-          /* Prefetch next iteration. */
-          {
-            vlib_buffer_t * p2, * p3;
-
-            p2 = vlib_get_buffer (vm, from[2]);
-            p3 = vlib_get_buffer (vm, from[3]);
-
-            vlib_prefetch_buffer_header (p2, LOAD);
-            vlib_prefetch_buffer_header (p3, LOAD);
+          u32 error0 = 0, error1 = 0;
+          pppoe_client_result_t result0, result1;
 
-            CLIB_PREFETCH (p2->data, 2*CLIB_CACHE_LINE_BYTES, LOAD);
-            CLIB_PREFETCH (p3->data, 2*CLIB_CACHE_LINE_BYTES, LOAD);
-          }
+          pppoeclient_session_prefetch_data (&pem->session_table, hash[2]);
+          pppoeclient_session_prefetch_data (&pem->session_table, hash[3]);
 
           bi0 = from[0];
           bi1 = from[1];
@@ -625,159 +916,280 @@ pppoeclient_session_output (vlib_main_t * vm,
 
           b0 = vlib_get_buffer (vm, bi0);
           b1 = vlib_get_buffer (vm, bi1);
-	  pppox_sw_if_index0 = vnet_buffer(b0)->sw_if_index[VLIB_TX];
-          pppox_sw_if_index1 = vnet_buffer(b1)->sw_if_index[VLIB_TX];
-          error0 = 0;
-          error1 = 0;
 
-	  if (pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index0] == ~0)
-	    {
-	      error0 = PPPOECLIENT_ERROR_CLIENT_DELETED;
-	      next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-	      goto trace0;
-	    }
+          next0 = pppoe_dispatch_one (pem, b0, kv, hash[0], &result0, &error0);
+          next1 = pppoe_dispatch_one (pem, b1, kv + 1, hash[1], &result1,
+                                      &error1);
+          kv += 2;
+          hash += 2;
 
-          /* client may be freed by interface type change */
-          if (pool_is_free_index(pem->clients, pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index0]))
-            {
-              error0 = PPPOECLIENT_ERROR_CLIENT_DELETED;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace0;
-            }
+          b0->error = error0 ? node->errors[error0] : 0;
+          b1->error = error1 ? node->errors[error1] : 0;
 
-          c0 = pool_elt_at_index (pem->clients,
-                                  pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index0]);
+          if (PREDICT_FALSE(b0->flags & VLIB_BUFFER_IS_TRACED))
+            pppoe_dispatch_trace (vm, node, b0, &result0, next0);
+          if (PREDICT_FALSE(b1->flags & VLIB_BUFFER_IS_TRACED))
+            pppoe_dispatch_trace (vm, node, b1, &result1, next1);
 
-          hw0 = vnet_get_sup_hw_interface (vnm, c0->hw_if_index);
-          sup_sw0 = vnet_get_sup_sw_interface (vnm, c0->sw_if_index);
-          sw0 = vnet_get_sw_interface (vnm, c0->sw_if_index);
+          vlib_validate_buffer_enqueue_x2 (vm, node, next_index,
+                                           to_next, n_left_to_next,
+                                           bi0, bi1, next0, next1);
+        }
 
-          /* Interface(s) down? */
-          if ((hw0->flags & VNET_HW_INTERFACE_FLAG_LINK_UP) == 0)
-            {
-              error0 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace0;
-            }
-          if ((sup_sw0->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
-            {
-              error0 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace0;
-            }
-          if ((sw0->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
-            {
-              error0 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace0;
-            }
+      while (n_left_from > 0 && n_left_to_next > 0)
+        {
+          u32 bi0;
+          vlib_buffer_t * b0;
+          u32 next0;
+          u32 error0 = 0;
+          pppoe_client_result_t result0;
+
+          bi0 = from[0];
+          to_next[0] = bi0;
+          from += 1;
+          to_next += 1;
+          n_left_from -= 1;
+          n_left_to_next -= 1;
 
-	  try_update_tcp_mss(b0);
+          b0 = vlib_get_buffer (vm, bi0);
 
-          vlib_buffer_advance (b0, -sizeof (pppoe_header_t));
-          pppoe0 = vlib_buffer_get_current (b0);
-          pppoe0->ver_type = PPPOE_VER_TYPE;
-          pppoe0->code = PPPOE_SESSION_DATA;
-          pppoe0->session_id = clib_host_to_net_u16(c0->session_id);
-          pppoe0->length = clib_host_to_net_u16(b0->current_length);
-          vlib_buffer_advance (b0, -sizeof (ethernet_header_t));
-          h0 = vlib_buffer_get_current (b0);
-          h0->type = clib_host_to_net_u16 (ETHERNET_TYPE_PPPOE_SESSION);
-          clib_memcpy (h0->src_address, hw0->hw_address,
-                       sizeof (h0->src_address));
-          clib_memcpy (h0->dst_address, c0->ac_mac_address,
-                       sizeof (h0->dst_address));
-
-	  // buffer advance will have length adjusted, no need do again.
-          //b0->current_length += sizeof (pppoe_header_t) + sizeof (ethernet_header_t);
-
-          next0 = c0->hw_output_next_index;
-	  vnet_buffer(b0)->sw_if_index[VLIB_TX] = c0->sw_if_index;
-          session_out_pkts++;
+          next0 = pppoe_dispatch_one (pem, b0, kv, hash[0], &result0, &error0);
+          kv += 1;
+          hash += 1;
 
-        trace0:
           b0->error = error0 ? node->errors[error0] : 0;
 
           if (PREDICT_FALSE(b0->flags & VLIB_BUFFER_IS_TRACED))
-            {
-              // todo: add trace.
-            }
+            pppoe_dispatch_trace (vm, node, b0, &result0, next0);
 
-	  if (pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index1] == ~0)
-	    {
-	      error1 = PPPOECLIENT_ERROR_CLIENT_DELETED;
-	      next1 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-	      goto trace1;
-	    }
+          vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
+                                           to_next, n_left_to_next,
+                                           bi0, next0);
+        }
 
-          /* client may be freed by interface type change */
-          if (pool_is_free_index(pem->clients, pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index1]))
-            {
-              error1 = PPPOECLIENT_ERROR_CLIENT_DELETED;
-              next1 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace1;
-            }
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
 
-          c1 = pool_elt_at_index (pem->clients,
-                                  pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index1]);
-          hw1 = vnet_get_sup_hw_interface (vnm, c1->hw_if_index);
-          sup_sw1 = vnet_get_sup_sw_interface (vnm, c1->sw_if_index);
-          sw1 = vnet_get_sw_interface (vnm, c1->sw_if_index);
+  return from_frame->n_vectors;
+}
 
-          /* Interface(s) down? */
-          if ((hw1->flags & VNET_HW_INTERFACE_FLAG_LINK_UP) == 0)
-            {
-              error1 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next1 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace1;
-            }
-          if ((sup_sw1->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
-            {
-              error1 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next1 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace1;
-            }
-          if ((sw1->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
-            {
-              error1 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next1 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace1;
-            }
+VLIB_REGISTER_NODE (pppoe_dispatch_node) = {
+  .function = pppoe_dispatch,
+  .name = "pppoe-dispatch",
+  /* Takes a vector of packets. */
+  .vector_size = sizeof (u32),
 
-	  try_update_tcp_mss(b1);
+  .n_errors = PPPOECLIENT_N_ERROR,
+  .error_strings = pppoeclient_error_strings,
 
-          vlib_buffer_advance (b1, -sizeof (pppoe_header_t));
-          pppoe1 = vlib_buffer_get_current (b1);
-          pppoe1->ver_type = PPPOE_VER_TYPE;
-          pppoe1->code = PPPOE_SESSION_DATA;
-          pppoe1->session_id = clib_host_to_net_u16(c1->session_id);
-          pppoe1->length = clib_host_to_net_u16(b1->current_length);
-          vlib_buffer_advance (b1, -sizeof (ethernet_header_t));
-          h1 = vlib_buffer_get_current (b1);
-          h1->type = clib_host_to_net_u16 (ETHERNET_TYPE_PPPOE_SESSION);
-          clib_memcpy (h1->src_address, hw1->hw_address,
-                       sizeof (h1->src_address));
-          clib_memcpy (h1->dst_address, c1->ac_mac_address,
-                       sizeof (h1->dst_address));
-
-	  // buffer advance will have length adjusted, no need do again.
-	  //          b1->current_length += sizeof (pppoe_header_t) + sizeof (ethernet_header_t);
-
-          next1 = c1->hw_output_next_index;
-	  vnet_buffer(b1)->sw_if_index[VLIB_TX] = c1->sw_if_index;
-          session_out_pkts++;
+  .n_next_nodes = PPPOE_DISPATCH_N_NEXT,
+  .next_nodes = {
+#define _(s,n) [PPPOE_DISPATCH_NEXT_##s] = n,
+    foreach_pppoe_dispatch_next
+#undef _
+  },
 
-        trace1:
-          b1->error = error1 ? node->errors[error1] : 0;
+  .format_trace = format_pppoe_dispatch_trace,
+};
 
-          if (PREDICT_FALSE(b1->flags & VLIB_BUFFER_IS_TRACED))
-            {
-              // TODO: add trace.
-            }
+VLIB_NODE_FUNCTION_MULTIARCH (pppoe_dispatch_node, pppoe_dispatch)
 
-          vlib_validate_buffer_enqueue_x2 (vm, node, next_index,
+static uword
+pppoeclient_control_handoff (vlib_main_t * vm,
+                             vlib_node_runtime_t * node,
+                             vlib_frame_t * from_frame)
+{
+  pppoeclient_main_t * pem = &pppoeclient_main;
+
+  return pppoeclient_handoff_to_main (vm, node, from_frame,
+                                      pem->control_frame_queue_index);
+}
+
+VLIB_REGISTER_NODE (pppoeclient_control_handoff_node) = {
+  .function = pppoeclient_control_handoff,
+  .name = "pppoeclient-control-handoff",
+  /* Takes a vector of packets. */
+  .vector_size = sizeof (u32),
+
+  .n_errors = PPPOECLIENT_N_ERROR,
+  .error_strings = pppoeclient_error_strings,
+
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+
+  .format_trace = format_pppoeclient_handoff_trace,
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (pppoeclient_control_handoff_node, pppoeclient_control_handoff)
+
+typedef struct {
+  u32 sw_if_index;
+  u16 session_id;
+  u16 rsv;
+  u32 pppox_sw_if_index;
+  u32 error;
+} pppoeclient_session_tx_trace_t;
+
+static u8 * format_pppoeclient_session_tx_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  pppoeclient_session_tx_trace_t * t = va_arg (*args, pppoeclient_session_tx_trace_t *);
+
+  s = format (s, "PPPoE session sw_if_index %d session_id %d error %d",
+              t->sw_if_index, t->session_id, t->error);
+  return s;
+}
+
+/*
+ * Per packet work of session output, IP packets take the pppox midchain
+ * adjacency so mostly ppp control frames come here. The ethernet, VLAN
+ * and pppoe headers are copied from the rewrite cached in the client
+ * when the session came up, only the pppoe length differs between
+ * packets.
+ */
+static_always_inline u32
+pppoeclient_session_output_one (vlib_main_t * vm,
+                                vlib_node_runtime_t * node,
+                                pppoeclient_main_t * pem,
+                                vlib_buffer_t * b0, u32 * next0)
+{
+  pppoe_client_t * c0;
+  pppoe_header_t * pppoe0;
+  u8 * rw0;
+  u32 pppox_sw_if_index0, client_index0, rw_len0;
+  u32 error0 = 0;
+
+  pppox_sw_if_index0 = vnet_buffer(b0)->sw_if_index[VLIB_TX];
+  client_index0 = pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index0];
+
+  /* client may be freed by interface type change */
+  if (PREDICT_FALSE (client_index0 == ~0
+                     || pool_is_free_index (pem->clients, client_index0)))
+    {
+      error0 = PPPOECLIENT_ERROR_CLIENT_DELETED;
+      *next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
+      c0 = 0;
+      goto trace;
+    }
+
+  c0 = pool_elt_at_index (pem->clients, client_index0);
+
+  /* Interface(s) down? */
+  if (PREDICT_FALSE ((c0->flags & PPPOE_CLIENT_FLAG_UP) != PPPOE_CLIENT_FLAG_UP))
+    {
+      error0 = PPPOECLIENT_ERROR_LINK_DOWN;
+      *next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
+      goto trace;
+    }
+
+  /* 20 bytes untagged, up to 28 behind QinQ tags */
+  rw_len0 = c0->rewrite_len;
+  vlib_buffer_advance (b0, -(word) rw_len0);
+  rw0 = vlib_buffer_get_current (b0);
+  clib_memcpy (rw0, c0->rewrite, rw_len0);
+  pppoe0 = (pppoe_header_t *) (rw0 + rw_len0 - sizeof (*pppoe0));
+  pppoe0->length =
+    clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b0) - rw_len0);
+
+  *next0 = c0->hw_output_next_index;
+  vnet_buffer(b0)->sw_if_index[VLIB_TX] = c0->sw_if_index;
+
+ trace:
+  b0->error = error0 ? node->errors[error0] : 0;
+
+  if (PREDICT_FALSE(b0->flags & VLIB_BUFFER_IS_TRACED))
+    {
+      pppoeclient_session_tx_trace_t *tr
+        = vlib_add_trace (vm, node, b0, sizeof (*tr));
+      tr->sw_if_index = c0 ? c0->sw_if_index : ~0;
+      tr->session_id = c0 ? c0->session_id : 0;
+      tr->rsv = 0;
+      tr->pppox_sw_if_index = pppox_sw_if_index0;
+      tr->error = error0;
+    }
+
+  return error0;
+}
+
+static uword
+pppoeclient_session_output (vlib_main_t * vm,
+			    vlib_node_runtime_t * node,
+			    vlib_frame_t * from_frame)
+{
+  pppoeclient_main_t * pem = &pppoeclient_main;
+  u32 n_left_from, next_index, * from, * to_next;
+  u32 session_out_pkts = 0;
+
+  from = vlib_frame_vector_args (from_frame);
+  n_left_from = from_frame->n_vectors;
+
+  next_index = node->cached_next_index;
+
+  while (n_left_from > 0)
+    {
+      u32 n_left_to_next;
+      vlib_get_next_frame (vm, node, next_index,
+                           to_next, n_left_to_next);
+      while (n_left_from >= 8 && n_left_to_next >= 4)
+        {
+          u32 bi0, bi1, bi2, bi3;
+          vlib_buffer_t * b0, * b1, * b2, * b3;
+          u32 next0, next1, next2, next3;
+
+          /* Prefetch next iteration, the rewrite goes in front of data. */
+          {
+            vlib_buffer_t * p4, * p5, * p6, * p7;
+
+            p4 = vlib_get_buffer (vm, from[4]);
+            p5 = vlib_get_buffer (vm, from[5]);
+            p6 = vlib_get_buffer (vm, from[6]);
+            p7 = vlib_get_buffer (vm, from[7]);
+
+            vlib_prefetch_buffer_header (p4, LOAD);
+            vlib_prefetch_buffer_header (p5, LOAD);
+            vlib_prefetch_buffer_header (p6, LOAD);
+            vlib_prefetch_buffer_header (p7, LOAD);
+
+            CLIB_PREFETCH (p4->data - CLIB_CACHE_LINE_BYTES, 2*CLIB_CACHE_LINE_BYTES, STORE);
+            CLIB_PREFETCH (p5->data - CLIB_CACHE_LINE_BYTES, 2*CLIB_CACHE_LINE_BYTES, STORE);
+            CLIB_PREFETCH (p6->data - CLIB_CACHE_LINE_BYTES, 2*CLIB_CACHE_LINE_BYTES, STORE);
+            CLIB_PREFETCH (p7->data - CLIB_CACHE_LINE_BYTES, 2*CLIB_CACHE_LINE_BYTES, STORE);
+          }
+
+          bi0 = from[0];
+          bi1 = from[1];
+          bi2 = from[2];
+          bi3 = from[3];
+          to_next[0] = bi0;
+          to_next[1] = bi1;
+          to_next[2] = bi2;
+          to_next[3] = bi3;
+          from += 4;
+          to_next += 4;
+          n_left_to_next -= 4;
+          n_left_from -= 4;
+
+          b0 = vlib_get_buffer (vm, bi0);
+          b1 = vlib_get_buffer (vm, bi1);
+          b2 = vlib_get_buffer (vm, bi2);
+          b3 = vlib_get_buffer (vm, bi3);
+
+          session_out_pkts +=
+            (pppoeclient_session_output_one (vm, node, pem, b0, &next0) == 0);
+          session_out_pkts +=
+            (pppoeclient_session_output_one (vm, node, pem, b1, &next1) == 0);
+          session_out_pkts +=
+            (pppoeclient_session_output_one (vm, node, pem, b2, &next2) == 0);
+          session_out_pkts +=
+            (pppoeclient_session_output_one (vm, node, pem, b3, &next3) == 0);
+
+          vlib_validate_buffer_enqueue_x4 (vm, node, next_index,
                                            to_next, n_left_to_next,
-                                           bi0, bi1, next0, next1);
+                                           bi0, bi1, bi2, bi3,
+                                           next0, next1, next2, next3);
         }
 
       while (n_left_from > 0 && n_left_to_next > 0)
@@ -785,13 +1197,6 @@ pppoeclient_session_output (vlib_main_t * vm,
           u32 bi0;
           vlib_buffer_t * b0;
           u32 next0;
-          ethernet_header_t * h0;
-          pppoe_header_t * pppoe0;
-          vnet_hw_interface_t * hw0;
-          vnet_sw_interface_t * sup_sw0, * sw0;
-          pppoe_client_t * c0 = 0;
-          u32 error0;
-          u32 pppox_sw_if_index0;
 
           bi0 = from[0];
           to_next[0] = bi0;
@@ -801,81 +1206,10 @@ pppoeclient_session_output (vlib_main_t * vm,
           n_left_from -= 1;
 
           b0 = vlib_get_buffer (vm, bi0);
-	  pppox_sw_if_index0 = vnet_buffer(b0)->sw_if_index[VLIB_TX];
-          error0 = 0;
-
-	  if (pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index0] == ~0)
-	    {
-	      error0 = PPPOECLIENT_ERROR_CLIENT_DELETED;
-	      next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-	      goto trace00;
-	    }
-
-          /* client may be freed by interface type change */
-          if (pool_is_free_index(pem->clients, pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index0]))
-            {
-              error0 = PPPOECLIENT_ERROR_CLIENT_DELETED;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace00;
-            }
 
-          c0 = pool_elt_at_index (pem->clients,
-                                  pem->client_index_by_pppox_sw_if_index[pppox_sw_if_index0]);
+          session_out_pkts +=
+            (pppoeclient_session_output_one (vm, node, pem, b0, &next0) == 0);
 
-          hw0 = vnet_get_sup_hw_interface (vnm, c0->hw_if_index);
-          sup_sw0 = vnet_get_sup_sw_interface (vnm, c0->sw_if_index);
-          sw0 = vnet_get_sw_interface (vnm, c0->sw_if_index);
-
-          /* Interface(s) down? */
-          if ((hw0->flags & VNET_HW_INTERFACE_FLAG_LINK_UP) == 0)
-            {
-              error0 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace00;
-            }
-          if ((sup_sw0->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
-            {
-              error0 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace00;
-            }
-          if ((sw0->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
-            {
-              error0 = PPPOECLIENT_ERROR_LINK_DOWN;
-              next0 = PPPOECLIENT_SESSION_OUTPUT_NEXT_DROP;
-              goto trace00;
-            }
-
-	  try_update_tcp_mss(b0);
-
-          vlib_buffer_advance (b0, -sizeof (pppoe_header_t));
-          pppoe0 = vlib_buffer_get_current (b0);
-          pppoe0->ver_type = PPPOE_VER_TYPE;
-          pppoe0->code = PPPOE_SESSION_DATA;
-          pppoe0->session_id = clib_host_to_net_u16(c0->session_id);
-          pppoe0->length = clib_host_to_net_u16(b0->current_length);
-          vlib_buffer_advance (b0, -sizeof (ethernet_header_t));
-          h0 = vlib_buffer_get_current (b0);
-          h0->type = clib_host_to_net_u16 (ETHERNET_TYPE_PPPOE_SESSION);
-          clib_memcpy (h0->src_address, hw0->hw_address,
-                       sizeof (h0->src_address));
-          clib_memcpy (h0->dst_address, c0->ac_mac_address,
-                       sizeof (h0->dst_address));
-
-	  // buffer advance will have length adjusted, no need do again.
-	  //b0->current_length += sizeof (pppoe_header_t) + sizeof (ethernet_header_t);
-
-          next0 = c0->hw_output_next_index;
-	  vnet_buffer(b0)->sw_if_index[VLIB_TX] = c0->sw_if_index;
-          session_out_pkts++;
-
-        trace00:
-          b0->error = error0 ? node->errors[error0] : 0;
-
-          if (PREDICT_FALSE(b0->flags & VLIB_BUFFER_IS_TRACED))
-            {
-              // TODO: add trace
-            }
           vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
                                            to_next, n_left_to_next,
                                            bi0, next0);
@@ -8,6 +8,10 @@
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <inttypes.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <vlib/vlib.h>
 #include <vlib/unix/unix.h>
@@ -20,10 +24,196 @@
 #include <pppoeclient/pppoeclient.h>
 
 #include <vppinfra/hash.h>
+#include <vppinfra/random.h>
+#include <vppinfra/serialize.h>
+
+/* Instantiate both the client and the session table types */
+#include <vppinfra/bihash_8_8.h>
+#include <vppinfra/bihash_template.c>
+#include <vppinfra/bihash_16_8.h>
 #include <vppinfra/bihash_template.c>
 
 pppoeclient_main_t pppoeclient_main;
 static vlib_node_registration_t pppoe_client_process_node;
+static void pppoe_client_restore_pending (pppoeclient_main_t * pem);
+
+/*
+ * A sub-interface uplink must match exactly one VLAN encap for us to
+ * build its tags, same restriction as ethernet_build_rewrite.
+ */
+static int
+pppoe_client_uplink_supported (vnet_sw_interface_t * sw)
+{
+  if (sw->type != VNET_SW_INTERFACE_TYPE_SUB)
+    return 1;
+
+  return sw->sub.eth.flags.exact_match && !sw->sub.eth.flags.default_sub &&
+    !sw->sub.eth.flags.outer_vlan_id_any &&
+    !sw->sub.eth.flags.inner_vlan_id_any;
+}
+
+/*
+ * Write the ethernet header of a client's uplink at h, with the VLAN
+ * tags when it is a dot1q/dot1ad sub-interface. Returns the bytes
+ * written, at most PPPOE_CLIENT_MAX_REWRITE - sizeof (pppoe_header_t),
+ * or 0 for an unsupported uplink.
+ */
+static u32
+pppoe_client_build_l2_header (pppoeclient_main_t * pem, u32 sw_if_index,
+                              const u8 * dst_address, u16 type, u8 * h)
+{
+  vnet_sw_interface_t * sw = vnet_get_sw_interface (pem->vnet_main,
+                                                    sw_if_index);
+  vnet_hw_interface_t * hw = vnet_get_sup_hw_interface (pem->vnet_main,
+                                                        sw_if_index);
+  ethernet_header_t * e = (ethernet_header_t *) h;
+  ethernet_vlan_header_t * vlan = (ethernet_vlan_header_t *) (e + 1);
+  u16 * type_field = &e->type;
+
+  clib_memcpy (e->dst_address, dst_address, sizeof (e->dst_address));
+  clib_memcpy (e->src_address, hw->hw_address, sizeof (e->src_address));
+
+  if (!pppoe_client_uplink_supported (sw))
+    return 0;
+
+  if (sw->type == VNET_SW_INTERFACE_TYPE_SUB)
+    {
+      if (sw->sub.eth.flags.one_tag || sw->sub.eth.flags.two_tags)
+        {
+          *type_field = clib_host_to_net_u16 (sw->sub.eth.flags.dot1ad ?
+                                              ETHERNET_TYPE_DOT1AD :
+                                              ETHERNET_TYPE_VLAN);
+          vlan->priority_cfi_and_id =
+            clib_host_to_net_u16 (sw->sub.eth.outer_vlan_id);
+          type_field = &vlan->type;
+          vlan++;
+        }
+      if (sw->sub.eth.flags.two_tags)
+        {
+          *type_field = clib_host_to_net_u16 (ETHERNET_TYPE_VLAN);
+          vlan->priority_cfi_and_id =
+            clib_host_to_net_u16 (sw->sub.eth.inner_vlan_id);
+          type_field = &vlan->type;
+          vlan++;
+        }
+    }
+
+  *type_field = clib_host_to_net_u16 (type);
+  return (u8 *) vlan - h;
+}
+
+/*
+ * RFC 4638: ask for what the uplink fits when it is more than 1492,
+ * 0 means the PPP-Max-Payload tag is not sent.
+ */
+static u16
+pppoe_client_wanted_max_payload (pppoeclient_main_t * pem, pppoe_client_t * c)
+{
+  vnet_hw_interface_t * hw = vnet_get_sup_hw_interface (pem->vnet_main,
+                                                        c->sw_if_index);
+  u32 l3_mtu = hw->max_l3_packet_bytes[VLIB_TX];
+
+  if (l3_mtu > PPPOE_CLIENT_DEFAULT_MRU + PPPOE_CLIENT_OVERHEAD)
+    return clib_min (l3_mtu - PPPOE_CLIENT_OVERHEAD, 0xffff);
+  return 0;
+}
+
+/*
+ * Build the part of discovery packets which never changes for a client:
+ * ethernet (tagged for a sub-interface) and pppoe headers plus the
+ * ServiceName and Host-Uniq tags.
+ * send_pppoe_pkt copies it and patches code, session id, destination
+ * and length.
+ */
+static void
+pppoe_client_build_discovery_template (pppoeclient_main_t * pem,
+                                       pppoe_client_t * c)
+{
+  pppoe_client_cp_t * cp = pppoe_client_get_cp (pem, c);
+  u8 l2[PPPOE_CLIENT_MAX_REWRITE];
+  pppoe_header_t * pppoe;
+  pppoe_tag_header_t * pppoe_tag;
+  u8 * t = 0, * tag;
+
+  cp->max_payload = pppoe_client_wanted_max_payload (pem, c);
+
+  memset (l2, 0xff, sizeof (ethernet_header_t));
+  cp->l2_header_bytes =
+    pppoe_client_build_l2_header (pem, c->sw_if_index, l2,
+                                  ETHERNET_TYPE_PPPOE_DISCOVERY, l2);
+  vec_add (t, l2, cp->l2_header_bytes);
+  vec_validate (t, cp->l2_header_bytes + sizeof (pppoe_header_t)
+                + 2 * sizeof (pppoe_tag_header_t) + sizeof (cp->host_uniq) - 1);
+
+  pppoe = (pppoe_header_t *)(t + cp->l2_header_bytes);
+  pppoe->ver_type = PPPOE_VER_TYPE;
+
+  // add empty ServiceName tag.
+  pppoe_tag = (pppoe_tag_header_t *) (pppoe + 1);
+  pppoe_tag->type = clib_host_to_net_u16 (PPPOE_TAG_SERVICE_NAME);
+  // zero length means we accept any service as specified in RFC 2516.
+  pppoe_tag->length = 0;
+
+  // adding HOST-UNIQ tag.
+  pppoe_tag++;
+  pppoe_tag->type = clib_host_to_net_u16 (PPPOE_TAG_HOST_UNIQ);
+  // host_uniq is a arbitray binary data we choose.
+  pppoe_tag->length = clib_host_to_net_u16 (sizeof (cp->host_uniq));
+  clib_memcpy ((void *)pppoe_tag->value, (void *)&(cp->host_uniq),
+               sizeof (cp->host_uniq));
+
+  if (cp->max_payload)
+    {
+      u16 max_payload = clib_host_to_net_u16 (cp->max_payload);
+
+      vec_add2 (t, tag, sizeof (pppoe_tag_header_t) + sizeof (max_payload));
+      pppoe_tag = (pppoe_tag_header_t *) tag;
+      pppoe_tag->type = clib_host_to_net_u16 (PPPOE_TAG_PPP_MAX_PAYLOAD);
+      pppoe_tag->length = clib_host_to_net_u16 (sizeof (max_payload));
+      clib_memcpy ((void *) pppoe_tag->value, &max_payload,
+                   sizeof (max_payload));
+    }
+
+  vec_free (cp->discovery_template);
+  cp->discovery_template = t;
+}
+
+/*
+ * Discovery packets share the pppox transmit batch with pppd output,
+ * frames are sent when full or by pppoeclient_tx_flush.
+ */
+static u32
+pppoeclient_tx_buffer_get (void)
+{
+  static u32 (*pppox_tx_buffer_get_func) (void) = 0;
+
+  if (pppox_tx_buffer_get_func == 0)
+    pppox_tx_buffer_get_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_tx_buffer_get");
+  return (*pppox_tx_buffer_get_func) ();
+}
+
+static void
+pppoeclient_tx_enqueue (u32 node_index, u32 bi)
+{
+  static void (*pppox_tx_enqueue_func) (u32, u32) = 0;
+
+  if (pppox_tx_enqueue_func == 0)
+    pppox_tx_enqueue_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_tx_enqueue");
+  (*pppox_tx_enqueue_func) (node_index, bi);
+}
+
+static void
+pppoeclient_tx_flush (void)
+{
+  static void (*pppox_flush_output_func) (void) = 0;
+
+  if (pppox_flush_output_func == 0)
+    pppox_flush_output_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_flush_output");
+  (*pppox_flush_output_func) ();
+}
 
 static void
 send_pppoe_pkt (pppoeclient_main_t * pem, pppoe_client_t * c,
@@ -31,157 +221,248 @@ send_pppoe_pkt (pppoeclient_main_t * pem, pppoe_client_t * c,
 {
   vlib_main_t * vm = pem->vlib_main;
   vnet_main_t * vnm = pem->vnet_main;
-  vnet_hw_interface_t * hw = vnet_get_sup_hw_interface (vnm, c->sw_if_index);
-  vnet_sw_interface_t * sup_sw
-    = vnet_get_sup_sw_interface (vnm, c->sw_if_index);
-  vnet_sw_interface_t * sw = vnet_get_sw_interface (vnm, c->sw_if_index);
+  vnet_hw_interface_t * hw;
   vlib_buffer_t * b;
   u32 bi;
+  ethernet_header_t * e;
   pppoe_header_t * pppoe;
-  u32 * to_next;
-  vlib_frame_t * f;
+  u16 tags_len;
+  pppoe_client_cp_t * cp = pppoe_client_get_cp (pem, c);
+  u32 template_len = vec_len (cp->discovery_template);
 
   /* Interface(s) down? */
-  if ((hw->flags & VNET_HW_INTERFACE_FLAG_LINK_UP) == 0)
-    return;
-  if ((sup_sw->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
-    return;
-  if ((sw->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) == 0)
+  if ((c->flags & PPPOE_CLIENT_FLAG_UP) != PPPOE_CLIENT_FLAG_UP)
     return;
 
-  // TODO: should we should use packet template to prevent allocate buffer????
-  if (vlib_buffer_alloc (vm, &bi, 1) != 1) {
+  bi = pppoeclient_tx_buffer_get ();
+  if (bi == ~0) {
     clib_warning ("buffer allocation failure");
-    c->next_transmit = 0;
+    cp->next_transmit = 0;
     return;
   }
 
-  /* Build a PPPOE discovery pkt from whole cloth */
+  /* Build a PPPOE discovery pkt from the client template */
   b = vlib_get_buffer (vm, bi);
 
   ASSERT (b->current_data == 0);
 
-  f = vlib_get_frame_to_node (vm, hw->output_node_index);
-  vlib_buffer_advance (b, -sizeof (ethernet_header_t));
-  ethernet_header_t *e = vlib_buffer_get_current (b);
-  e->type = clib_host_to_net_u16 (ETHERNET_TYPE_PPPOE_DISCOVERY);
-  clib_memcpy (e->src_address, hw->hw_address, sizeof (e->src_address));
-  if (is_broadcast)
-    {
-      memset (e->dst_address, 0xff, sizeof (e->dst_address));
-    }
-  else
-    {
-      clib_memcpy (e->dst_address, c->ac_mac_address, sizeof (e->dst_address));
-    }
+  e = vlib_buffer_get_current (b);
+  clib_memcpy (e, cp->discovery_template, template_len);
+  if (!is_broadcast)
+    clib_memcpy (e->dst_address, cp->ac_mac_address, sizeof (e->dst_address));
 
-  pppoe = (pppoe_header_t *)(e+1);
-  pppoe->ver_type = PPPOE_VER_TYPE;
+  pppoe = (pppoe_header_t *)((u8 *) e + cp->l2_header_bytes);
   pppoe->code = packet_code;
   pppoe->session_id = clib_host_to_net_u16 (session_id);
-  // adding PPPOE tag.
-  // TODO: we should make this as helper functions.
-  {
-    unsigned char *cursor = (unsigned char *) (pppoe + 1);
-    u16 tags_len = 0;
 
-    // add empty ServiceName tag.
-    {
-      pppoe_tag_header_t * pppoe_tag = (pppoe_tag_header_t *) cursor;
-      pppoe_tag->type = clib_host_to_net_u16 (PPPOE_TAG_SERVICE_NAME);
-      // zero length means we accept any service as specified in RFC 2516.
-      pppoe_tag->length = 0;
+  tags_len = template_len - cp->l2_header_bytes - sizeof (pppoe_header_t);
+  // attach cookie for padr/pads.
+  if ((packet_code == PPPOE_PADR || packet_code == PPPOE_PADS) && cp->cookie.type) {
+    u16 cookie_len = clib_net_to_host_u16 (cp->cookie.length) + sizeof (pppoe_tag_header_t);
+    clib_memcpy ((u8 *) e + template_len, &cp->cookie, cookie_len);
+    tags_len += cookie_len;
+  }
 
-      tags_len += sizeof (pppoe_tag_header_t);
-      cursor += sizeof (pppoe_tag_header_t);
-    }
+  pppoe->length = clib_host_to_net_u16 (tags_len);
+  b->current_length = cp->l2_header_bytes + sizeof (pppoe_header_t) + tags_len;
+  vnet_buffer (b)->sw_if_index[VLIB_TX] = c->sw_if_index;
+
+  hw = vnet_get_sup_hw_interface (vnm, c->sw_if_index);
+  pppoeclient_tx_enqueue (hw->output_node_index, bi);
+}
+
+/* Random interval in the upper half of [0, interval] */
+static f64
+pppoeclient_jitter (pppoe_client_discovery_scheduler_t * ds, f64 interval)
+{
+  return interval * (0.5 + 0.5 * random_f64 (&ds->seed));
+}
+
+/*
+ * Whether the client may send a PADI now, otherwise next_transmit is
+ * pushed to when it may try again.
+ */
+static int
+pppoeclient_discovery_admit (pppoeclient_main_t * pem, pppoe_client_t * c,
+                             f64 now)
+{
+  pppoe_client_discovery_scheduler_t *ds = &pem->discovery;
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
+  pppoe_client_token_bucket_t *tb;
 
-    // adding HOST-UNIQ tag.
+  if (!cp->discovery_in_flight)
     {
-      pppoe_tag_header_t * pppoe_tag = (pppoe_tag_header_t *) cursor;
-      pppoe_tag->type = clib_host_to_net_u16 (PPPOE_TAG_HOST_UNIQ);
-      // host_uniq is a arbitray binary data we choose.
-      pppoe_tag->length = clib_host_to_net_u16 (sizeof (c->host_uniq));
-      clib_memcpy ((void *)pppoe_tag->value, (void *)&(c->host_uniq),
-		   sizeof (c->host_uniq));
+      if (ds->max_in_flight && ds->in_flight >= ds->max_in_flight)
+        {
+          ds->throttled_in_flight++;
+          cp->next_transmit = now + pppoeclient_jitter (ds, ds->backoff_min);
+          return 0;
+        }
+      cp->discovery_in_flight = 1;
+      ds->in_flight++;
+    }
+
+  if (ds->rate == 0)
+    return 1;
+
+  vec_validate (ds->buckets, c->sw_if_index);
+  tb = vec_elt_at_index (ds->buckets, c->sw_if_index);
+  if (tb->last_update == 0)
+    tb->tokens = ds->burst;
+  else
+    tb->tokens = clib_min (ds->burst,
+                           tb->tokens + (now - tb->last_update) * ds->rate);
+  tb->last_update = now;
 
-      tags_len += sizeof (pppoe_tag_header_t) + sizeof (c->host_uniq);
-      cursor += sizeof (pppoe_tag_header_t) + sizeof (c->host_uniq);
+  if (tb->tokens < 1.0)
+    {
+      ds->throttled_rate++;
+      // come back when a token is there, spread the waiting clients.
+      cp->next_transmit = now + (1.0 - tb->tokens) / ds->rate
+        + pppoeclient_jitter (ds, 1.0 / ds->rate);
+      return 0;
     }
 
-    // attach cookie for padr/pads.
-    if ((packet_code == PPPOE_PADR || packet_code == PPPOE_PADS) && c->cookie.type) {
-      clib_memcpy (cursor, &c->cookie, clib_net_to_host_u16 (c->cookie.length) + sizeof (pppoe_tag_header_t));
-      tags_len += clib_net_to_host_u16 (c->cookie.length) + sizeof (pppoe_tag_header_t);
+  tb->tokens -= 1.0;
+  return 1;
+}
+
+static void
+pppoeclient_discovery_release (pppoeclient_main_t * pem, pppoe_client_t * c)
+{
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
+
+  if (cp->discovery_in_flight)
+    {
+      cp->discovery_in_flight = 0;
+      pem->discovery.in_flight--;
     }
+}
 
-    pppoe->length = clib_host_to_net_u16 (tags_len);
-    b->current_length = sizeof (ethernet_header_t) +  sizeof (pppoe_header_t ) + tags_len;
-  }
+static void
+pppoeclient_discovery_done (pppoeclient_main_t * pem, pppoe_client_t * c,
+                            f64 now)
+{
+  pppoe_client_discovery_scheduler_t *ds = &pem->discovery;
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
+  u64 ms;
+  u32 bucket;
 
-  /* Enqueue the packet right now */
-  to_next = vlib_frame_vector_args (f);
-  to_next[0] = bi;
-  f->n_vectors = 1;
+  pppoeclient_discovery_release (pem, c);
 
-  vlib_put_frame_to_node (vm, hw->output_node_index, f);
+  if (cp->discovery_start == 0)
+    return;
+
+  ms = (now - cp->discovery_start) * 1e3;
+  bucket = ms ? min_log2 (ms) : 0;
+  bucket = clib_min (bucket, PPPOE_CLIENT_RECONNECT_N_BUCKETS - 1);
+  ds->reconnect_histogram[bucket]++;
+  cp->discovery_start = 0;
 }
 
 static int
 pppoeclient_discovery_state (pppoeclient_main_t * pem, pppoe_client_t * c, f64 now)
 {
+  pppoe_client_discovery_scheduler_t *ds = &pem->discovery;
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
+  f64 backoff;
+
   /*
-   * State machine "DISCOVERY" state. Send a PADI packet,
-   * eventually back off the retry rate.
+   * State machine "DISCOVERY" state. Send a PADI packet when the
+   * scheduler allows, backing off the retry rate exponentially.
    */
+  if (!pppoeclient_discovery_admit (pem, c, now))
+    return 0;
+
+  // the uplink mtu may have changed since the template was built.
+  if (pppoe_client_wanted_max_payload (pem, c) != cp->max_payload)
+    pppoe_client_build_discovery_template (pem, c);
+
   send_pppoe_pkt (pem, c, PPPOE_PADI, 0, 1 /* is_broadcast */);
+  ds->padi_sent++;
 
-  c->retry_count++;
-  if (c->retry_count > 10)
-    c->next_transmit = now + 5.0;
-  else
-    c->next_transmit = now + 1.0;
+  backoff = ds->backoff_min * (f64) (1ULL << clib_min (cp->retry_count, 16));
+  cp->retry_count++;
+  cp->next_transmit = now + pppoeclient_jitter (ds, clib_min (backoff,
+                                                             ds->backoff_max));
   return 0;
 }
 
 static int
 pppoeclient_request_state (pppoeclient_main_t * pem, pppoe_client_t * c, f64 now)
 {
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
+
   /*
    * State machine "REQUEST" state. Send a PADR packet,
    * eventually drop back to the discovery state.
    */
   send_pppoe_pkt (pem, c, PPPOE_PADR, 0, 0 /* is_broadcast */);
 
-  c->retry_count++;
-  if (c->retry_count > 7 /* lucky you */)
+  cp->retry_count++;
+  if (cp->retry_count > 7 /* lucky you */)
     {
-      c->state = PPPOE_CLIENT_DISCOVERY;
-      c->next_transmit = now;
-      c->retry_count = 0;
+      cp->state = PPPOE_CLIENT_DISCOVERY;
+      cp->next_transmit = now;
+      cp->retry_count = 0;
       return 1;
     }
-  c->next_transmit = now + 1.0;
+  cp->next_transmit = now + 1.0;
   return 0;
 }
 
-static f64 pppoe_client_sm (f64 now, f64 timeout, uword pool_index)
+
+/*
+ * Arm the transmit timer of a client at its next_transmit, the process
+ * only looks at clients whose timer expired. A session needs no timer.
+ */
+static void
+pppoe_client_schedule (pppoeclient_main_t * pem, pppoe_client_t * c)
+{
+  static u32 (*pppox_timer_start_func) (tw_timer_wheel_1t_3w_1024sl_ov_t *,
+                                        u32, f64) = 0;
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
+
+  if (cp->transmit_timer != ~0)
+    {
+      tw_timer_stop_1t_3w_1024sl_ov (&pem->transmit_wheel, cp->transmit_timer);
+      cp->transmit_timer = ~0;
+    }
+
+  if (cp->state == PPPOE_CLIENT_SESSION)
+    return;
+
+  if (pppox_timer_start_func == 0)
+    pppox_timer_start_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_timer_start");
+  cp->transmit_timer = (*pppox_timer_start_func) (&pem->transmit_wheel,
+                                                  c - pem->clients,
+                                                  cp->next_transmit);
+
+  if (cp->next_transmit < pem->next_wakeup)
+    vlib_process_signal_event (pem->vlib_main, pppoe_client_process_node.index,
+                               EVENT_PPPOE_CLIENT_TIMER_UPDATE, 0);
+}
+
+static void pppoe_client_sm (f64 now, uword pool_index)
 {
   pppoeclient_main_t * pem = &pppoeclient_main;
   pppoe_client_t * c;
+  pppoe_client_cp_t * cp;
 
   /* deleted, pooched, yadda yadda yadda */
   if (pool_is_free_index (pem->clients, pool_index))
-    return timeout;
+    return;
 
   c = pool_elt_at_index (pem->clients, pool_index);
+  cp = pppoe_client_get_cp (pem, c);
 
   /* Time for us to do something with this client? */
-  if (now < c->next_transmit)
-    return timeout;
+  if (now < cp->next_transmit)
+    goto done;
 
  again:
-  switch (c->state)
+  switch (cp->state)
     {
     case PPPOE_CLIENT_DISCOVERY:         /* send a discover */
       if (pppoeclient_discovery_state (pem, c, now))
@@ -194,19 +475,17 @@ static f64 pppoe_client_sm (f64 now, f64 timeout, uword pool_index)
       break;
 
     case PPPOE_CLIENT_SESSION:         /* session allocated */
-      // Nothing to be done here since we have set longest timeout.
+      // Nothing to be done here, no timer for a session.
       break;
 
     default:
       clib_warning ("pppoe client %d bogus state %d",
-                    c - pem->clients, c->state);
+                    c - pem->clients, cp->state);
       break;
     }
 
-  if (c->next_transmit < now + timeout)
-    return c->next_transmit - now;
-
-  return timeout;
+ done:
+  pppoe_client_schedule (pem, c);
 }
 
 static uword
@@ -214,40 +493,72 @@ pppoe_client_process (vlib_main_t * vm,
                       vlib_node_runtime_t * rt,
                       vlib_frame_t * f)
 {
-  f64 timeout = 100.0;
+  f64 timeout;
   f64 now;
   uword event_type;
   uword * event_data = 0;
   pppoeclient_main_t * pem = &pppoeclient_main;
-  pppoe_client_t * c;
-  int i;
+  u32 * i;
+  int j;
+  clib_error_t *error;
+  u32 *(*pppox_timer_expire_func) (tw_timer_wheel_1t_3w_1024sl_ov_t *, f64,
+                                   u32 *, f64 *);
+  f64 (*pppox_timer_timeleft_func) (tw_timer_wheel_1t_3w_1024sl_ov_t *, f64,
+                                    f64 *);
+
+  // the transmit wheel is run by the pppox helpers, as pppd timers are.
+  pppox_timer_expire_func =
+    vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_timer_expire");
+  pppox_timer_timeleft_func =
+    vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_timer_timeleft");
+
+  // sessions saved at exit come back before anything is sent.
+  if (pem->state_file && access ((char *) pem->state_file, R_OK) == 0)
+    {
+      error = pppoe_client_restore_state ((char *) pem->state_file);
+      if (error)
+        clib_error_report (error);
+      pppoeclient_tx_flush ();
+    }
 
   while (1)
     {
-      vlib_process_wait_for_event_or_clock (vm, timeout);
+      timeout = (*pppox_timer_timeleft_func) (&pem->transmit_wheel,
+                                              vlib_time_now (vm),
+                                              &pem->next_wakeup);
+      if (timeout < 0)
+        vlib_process_wait_for_event (vm);
+      else
+        vlib_process_wait_for_event_or_clock (vm, timeout);
 
       event_type = vlib_process_get_events (vm, &event_data);
 
       now = vlib_time_now (vm);
 
-      switch (event_type)
-        {
-        case EVENT_PPPOE_CLIENT_WAKEUP:
-          for (i = 0; i < vec_len (event_data); i++)
-            timeout = pppoe_client_sm (now, timeout, event_data[i]);
-          break;
+      if (event_type == EVENT_PPPOE_CLIENT_WAKEUP)
+        for (j = 0; j < vec_len (event_data); j++)
+          pppoe_client_sm (now, event_data[j]);
+      else if (event_type == EVENT_PPPOE_CLIENT_RESTORE)
+        pppoe_client_restore_pending (pem);
 
-        case ~0:
-          pool_foreach (c, pem->clients,
-          ({
-            timeout = pppoe_client_sm (now, timeout,
-                                       (uword)(c - pem->clients));
-          }));
-          if (pool_elts (pem->clients) == 0)
-            timeout = 100.0;
-          break;
+      pem->expired = (*pppox_timer_expire_func) (&pem->transmit_wheel, now,
+                                                 pem->expired,
+                                                 &pem->next_wakeup);
+
+      vec_foreach (i, pem->expired)
+        {
+          // stopped when the client is deleted, so it must be there.
+          vec_elt (pem->clients_cp, i[0]).transmit_timer = ~0;
+          pppoe_client_sm (now, i[0]);
         }
 
+      // send all discovery packets of this wakeup.
+      pppoeclient_tx_flush ();
+
+      // and the session events of this wakeup.
+      if (vec_len (pem->event_clients))
+        pppoe_client_send_events (pem);
+
       vec_reset_length (event_data);
     }
 
@@ -317,35 +628,97 @@ void parse_for_host_uniq (u16 type, u16 len, unsigned char * data, void *extra)
   }
 }
 
+// RFC 4638, only an AC echoing PPP-Max-Payload supports it.
+void parse_max_payload (u16 type, u16 len, unsigned char * data, void * extra)
+{
+  pppoe_client_cp_t *cp = (pppoe_client_cp_t *) extra;
+
+  if (type == PPPOE_TAG_PPP_MAX_PAYLOAD && len == sizeof(u16)) {
+    cp->ac_max_payload = (data[0] << 8) + data[1];
+  }
+}
+
 void parse_pado_tags (u16 type, u16 len, unsigned char * data, void * extra)
 {
-  pppoe_client_t *c = (pppoe_client_t *) extra;
+  pppoe_client_cp_t *cp = (pppoe_client_cp_t *) extra;
 
   switch (type) {
   case PPPOE_TAG_SERVICE_NAME:
   case PPPOE_TAG_AC_NAME:
   case PPPOE_TAG_RELAY_SESSION_ID:
-  case PPPOE_TAG_PPP_MAX_PAYLOAD:
   case PPPOE_TAG_SERVICE_NAME_ERROR:
   case PPPOE_TAG_AC_SYSTEM_ERROR:
   case PPPOE_TAG_GENERIC_ERROR:
     // nothing need to do currently.
     break;
+  case PPPOE_TAG_PPP_MAX_PAYLOAD:
+    parse_max_payload (type, len, data, extra);
+    break;
   case PPPOE_TAG_AC_COOKIE:
-    c->cookie.type = htons(type);
-    c->cookie.length = htons(len);
-    clib_memcpy (c->cookie.value, data, len);
+    cp->cookie.type = htons(type);
+    cp->cookie.length = htons(len);
+    clib_memcpy (cp->cookie.value, data, len);
     break;
   default:
     break;
   }
 }
 
+/*
+ * Build the ethernet, VLAN and pppoe headers of session packets once
+ * the session is allocated, tagged and untagged uplinks then take the
+ * same copy in session output and in the pppox adjacency.
+ */
+static void
+pppoe_client_build_rewrite (pppoeclient_main_t * pem, pppoe_client_t * c)
+{
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
+  pppoe_header_t *pppoe;
+  u32 l2_len;
+
+  l2_len = pppoe_client_build_l2_header (pem, c->sw_if_index,
+                                         cp->ac_mac_address,
+                                         ETHERNET_TYPE_PPPOE_SESSION,
+                                         c->rewrite);
+  pppoe = (pppoe_header_t *) (c->rewrite + l2_len);
+  pppoe->ver_type = PPPOE_VER_TYPE;
+  pppoe->code = PPPOE_SESSION_DATA;
+  pppoe->session_id = clib_host_to_net_u16 (c->session_id);
+  pppoe->length = 0;
+  c->rewrite_len = l2_len + sizeof (*pppoe);
+}
+
+/*
+ * Session encap changed, let pppox restack adjacencies of the client.
+ */
+static void
+pppoe_client_update_adjacencies (pppoe_client_t * c)
+{
+  static void (*pppox_update_adjacencies_func) (u32) = 0;
+  if (pppox_update_adjacencies_func == 0) {
+    pppox_update_adjacencies_func = vlib_get_plugin_symbol("pppox_plugin.so", "pppox_update_adjacencies");
+  }
+  (*pppox_update_adjacencies_func) (c->pppox_sw_if_index);
+}
+
+/*
+ * PPP MRU of the session: what we asked for and the AC granted, RFC
+ * 4638 says the smaller one, or plain 1492 of RFC 2516.
+ */
+u16
+pppoe_client_mru (pppoe_client_cp_t * cp)
+{
+  if (cp->max_payload && cp->ac_max_payload > PPPOE_CLIENT_DEFAULT_MRU)
+    return clib_min (cp->max_payload, cp->ac_max_payload);
+  return PPPOE_CLIENT_DEFAULT_MRU;
+}
+
 int consume_pppoe_discovery_pkt (u32 bi, vlib_buffer_t * b,
                                  pppoe_header_t * pppoe)
 {
   pppoeclient_main_t * pem = &pppoeclient_main;
   pppoe_client_t * c;
+  pppoe_client_cp_t * cp;
   f64 now = vlib_time_now (pem->vlib_main);
   u32 sw_if_index = ~0;
   u32 host_uniq = 0;
@@ -378,16 +751,23 @@ int consume_pppoe_discovery_pkt (u32 bi, vlib_buffer_t * b,
         }
 
       c = pool_elt_at_index (pem->clients, result.fields.client_index);
+      cp = pppoe_client_get_cp (pem, c);
       // if pado we need parse cookie.
       if (pppoe->code == PPPOE_PADO) {
-	parse_pppoe_packet (pppoe, parse_pado_tags, c);
+	cp->ac_max_payload = 0;
+	parse_pppoe_packet (pppoe, parse_pado_tags, cp);
       }
       break;
     case PPPOE_PADT:
+      eth_hdr = (ethernet_header_t *) (b->data +
+                                       vnet_buffer (b)->l2_hdr_offset);
       pppoeclient_lookup_session_1 (&pem->session_table,
+                                    vnet_buffer(b)->sw_if_index [VLIB_RX],
+                                    eth_hdr->src_address,
                                     clib_net_to_host_u16 (pppoe->session_id),
                                     &result);
-      if (result.fields.client_index == ~0)
+      if (result.fields.client_index == ~0 ||
+          result.fields.owner != PPPOE_SESSION_OWNER_CLIENT)
 	{
 	  return 1;
 	}
@@ -399,31 +779,32 @@ int consume_pppoe_discovery_pkt (u32 bi, vlib_buffer_t * b,
           }
 
       c = pool_elt_at_index (pem->clients, result.fields.client_index);
+      cp = pppoe_client_get_cp (pem, c);
       break;
     default:
       return 1;
     }
 
-  switch (c->state)
+  switch (cp->state)
     {
     case PPPOE_CLIENT_DISCOVERY:
       if (packet_code != PPPOE_PADO)
         {
-          c->next_transmit = now + 5.0;
+          cp->next_transmit = now + 5.0;
           break;
         }
 
-      vlib_buffer_reset(b);
-      eth_hdr = vlib_buffer_get_current (b);
+      eth_hdr = (ethernet_header_t *) (b->data +
+                                       vnet_buffer (b)->l2_hdr_offset);
 
       // record the AC mac address which send us pado.
       // XXX: we might also record ac-name if later needed for
       // debug reason.
-      clib_memcpy (c->ac_mac_address, eth_hdr->src_address, 6);
+      clib_memcpy (cp->ac_mac_address, eth_hdr->src_address, 6);
 
-      c->state = PPPOE_CLIENT_REQUEST;
-      c->retry_count = 0;
-      c->next_transmit = 0; // send immediately.
+      cp->state = PPPOE_CLIENT_REQUEST;
+      cp->retry_count = 0;
+      cp->next_transmit = 0; // send immediately.
       /* Poke the client process, which will send the request */
       client_id =  c - pem->clients;
       vl_api_rpc_call_main_thread (pppoe_client_proc_callback,
@@ -432,7 +813,7 @@ int consume_pppoe_discovery_pkt (u32 bi, vlib_buffer_t * b,
     case PPPOE_CLIENT_REQUEST:
       if (packet_code != PPPOE_PADS)
         {
-          c->next_transmit = now + 5.0;
+          cp->next_transmit = now + 5.0;
           break;
         }
 
@@ -443,43 +824,56 @@ int consume_pppoe_discovery_pkt (u32 bi, vlib_buffer_t * b,
           // session_id  0 which means that the client is
           // not accepted by AC, turn to retransmit to
           // hope the AC will accept us if we are lucky.
-          c->next_transmit = now + 5.0;
+          cp->next_transmit = now + 5.0;
           break;
         }
 
       pppoeclient_lookup_session_1 (&pem->session_table,
+                                    c->sw_if_index, cp->ac_mac_address,
                                     c->session_id,
                                     &result);
       if (PREDICT_FALSE (result.fields.client_index != ~0))
         {
-          // the session id is used by other client, turn to
+          // the AC gives us a session id of other client, turn to
           // request state to fetch a new session id.
           c->session_id = 0;
-          c->state = PPPOE_CLIENT_REQUEST;
-          c->retry_count = 0;
-          c->next_transmit = 0; // send immediately.
+          cp->state = PPPOE_CLIENT_REQUEST;
+          cp->retry_count = 0;
+          cp->next_transmit = 0; // send immediately.
           break;
         }
+      // the PADS has the last word on PPP-Max-Payload.
+      cp->ac_max_payload = 0;
+      parse_pppoe_packet (pppoe, parse_max_payload, cp);
+
       result.fields.client_index = c - pem->clients;
+      result.fields.owner = PPPOE_SESSION_OWNER_CLIENT;
       pppoeclient_update_session_1 (&pem->session_table,
+                                    c->sw_if_index, cp->ac_mac_address,
                                     c->session_id,
                                     &result);
-      c->state = PPPOE_CLIENT_SESSION;
-      c->retry_count = 0;
+      pppoe_client_build_rewrite (pem, c);
+      pppoeclient_discovery_done (pem, c, now);
+      cp->state = PPPOE_CLIENT_SESSION;
+      pppoe_client_update_adjacencies (c);
+      cp->retry_count = 0;
       // when shift to session stage, just give control to user
       // and ppp control plane.
-      c->next_transmit = now + 4294967295.0;
+      cp->next_transmit = now + 4294967295.0;
+      pppoe_client_notify (c - pem->clients, PPPOE_CLIENT_EVENT_SESSION_UP);
       // notify pppoe session up.
-      static void (*pppox_lower_up_func) (u32) = 0;
+      static void (*pppox_lower_up_func) (u32, u16) = 0;
       if (pppox_lower_up_func ==0 ) {
 	pppox_lower_up_func = vlib_get_plugin_symbol("pppox_plugin.so", "pppox_lower_up");
       }
-      (*pppox_lower_up_func) (c->pppox_sw_if_index);
+      (*pppox_lower_up_func) (c->pppox_sw_if_index,
+                              pppoe_client_mru (cp));
       break;
 
     case PPPOE_CLIENT_SESSION:
       if (pppoe->code == PPPOE_PADT)
 	{
+	pppoe_client_notify (c - pem->clients, PPPOE_CLIENT_EVENT_PADT);
 	// notify ppp the lower is down, then it will try to reconnect.
 	static void (*pppox_lower_down_func) (u32) = 0;
 	if (pppox_lower_down_func ==0 )
@@ -489,12 +883,16 @@ int consume_pppoe_discovery_pkt (u32 bi, vlib_buffer_t * b,
 	(*pppox_lower_down_func) (c->pppox_sw_if_index);
 	}
       // delete from session table and clear session_id.
-      pppoeclient_delete_session_1 (&pem->session_table, c->session_id);
+      pppoeclient_delete_session_1 (&pem->session_table,
+                                    c->sw_if_index, cp->ac_mac_address,
+                                    c->session_id);
       c->session_id = 0;
+      pppoe_client_update_adjacencies (c);
       // move state to discovery and transmit immediately.
-      c->next_transmit = 0;
-      c->retry_count = 0;
-      c->state = PPPOE_CLIENT_DISCOVERY;
+      cp->discovery_start = now;
+      cp->next_transmit = 0;
+      cp->retry_count = 0;
+      cp->state = PPPOE_CLIENT_DISCOVERY;
       /* Poke the client process, which will send the request */
       client_id =  c - pem->clients;
       vl_api_rpc_call_main_thread (pppoe_client_proc_callback,
@@ -504,6 +902,8 @@ int consume_pppoe_discovery_pkt (u32 bi, vlib_buffer_t * b,
       break;
     }
 
+  pppoe_client_schedule (pem, c);
+
   return 0;
 }
 
@@ -533,12 +933,16 @@ format_pppoe_client (u8 * s, va_list * args)
 {
   pppoe_client_t *c = va_arg (*args, pppoe_client_t *);
   pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, c);
 
   s = format (s, "[%d] sw-if-index %d host_uniq %d state %U session-id %d ac-mac-address %U",
-              c - pem->clients, c->sw_if_index, c->host_uniq,
-              format_pppoe_client_state, c->state,
+              c - pem->clients, c->sw_if_index, cp->host_uniq,
+              format_pppoe_client_state, cp->state,
               c->session_id,
-              format_ethernet_address, c->ac_mac_address);
+              format_ethernet_address, cp->ac_mac_address);
+  if (cp->max_payload)
+    s = format (s, " max-payload %d granted %d",
+                cp->max_payload, cp->ac_max_payload);
   return s;
 }
 
@@ -548,12 +952,16 @@ pppoe_client_open_session (u32 client_index)
   pppoeclient_main_t *pem = &pppoeclient_main;
   vlib_main_t *vm = pem->vlib_main;
   pppoe_client_t * c;
+  pppoe_client_cp_t * cp;
 
   c = pool_elt_at_index (pem->clients, client_index);
+  cp = pppoe_client_get_cp (pem, c);
 
-  c->state = PPPOE_CLIENT_DISCOVERY;
-  c->next_transmit = 0;
-  c->retry_count = 0;
+  cp->state = PPPOE_CLIENT_DISCOVERY;
+  if (cp->discovery_start == 0)
+    cp->discovery_start = vlib_time_now (vm);
+  cp->next_transmit = 0;
+  cp->retry_count = 0;
   vlib_process_signal_event (vm, pppoe_client_process_node.index,
 			     EVENT_PPPOE_CLIENT_WAKEUP, c - pem->clients);
 
@@ -565,20 +973,132 @@ pppoe_client_close_session (u32 client_index)
 {
   pppoeclient_main_t *pem = &pppoeclient_main;
   pppoe_client_t * c;
+  pppoe_client_cp_t * cp;
 
   c = pool_elt_at_index (pem->clients, client_index);
+  cp = pppoe_client_get_cp (pem, c);
 
   // Try to send a PADT to notify remote AC (note we can't ensure this
   // message is delivered.
   if (c->session_id)
     {
       send_pppoe_pkt (pem, c, PPPOE_PADT, c->session_id, 0 /* is_broadcast */);
+      pppoeclient_tx_flush ();
+      pppoeclient_delete_session_1 (&pem->session_table,
+                                    c->sw_if_index, cp->ac_mac_address,
+                                    c->session_id);
       c->session_id = 0;
+      pppoe_client_update_adjacencies (c);
     }
  
   return;
 }
 
+/*
+ * Lower encap of the pppox interface of a client, returns non-zero
+ * when the session is up and the rewrite can be used.
+ */
+int
+pppoe_client_get_encap (u32 client_index, u32 * sw_if_index, u8 ** rewrite)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_t * c;
+
+  if (pool_is_free_index (pem->clients, client_index))
+    {
+      vec_validate (*rewrite, sizeof (ethernet_header_t)
+                    + sizeof (pppoe_header_t) - 1);
+      return 0;
+    }
+
+  c = pool_elt_at_index (pem->clients, client_index);
+
+  *sw_if_index = c->sw_if_index;
+  vec_add (*rewrite, c->rewrite, c->rewrite_len);
+
+  return pppoe_client_get_cp (pem, c)->state == PPPOE_CLIENT_SESSION &&
+    c->session_id != 0;
+}
+
+void
+pppoe_client_set_lcp_echo (u32 client_index, u32 magic, int enable)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_t * c;
+
+  if (pool_is_free_index (pem->clients, client_index))
+    return;
+
+  c = pool_elt_at_index (pem->clients, client_index);
+  c->lcp_magic = magic;
+  c->lcp_echo_reply = enable;
+}
+
+u32
+pppoe_client_lcp_echo_replied (u32 client_index)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+
+  if (pool_is_free_index (pem->clients, client_index))
+    return 0;
+
+  return pool_elt_at_index (pem->clients, client_index)->lcp_echo_replied;
+}
+
+u32
+pppoe_client_rx_packets (u32 client_index)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+
+  if (pool_is_free_index (pem->clients, client_index))
+    return 0;
+
+  return pool_elt_at_index (pem->clients, client_index)->rx_packets;
+}
+
+/*
+ * Record events of a client for API subscribers. Events of a client
+ * are or'ed together until pppoe-client-process sends them at the end
+ * of its wakeup, one message per client carrying its state by then.
+ */
+void
+pppoe_client_notify (u32 client_index, u32 events)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_cp_t *cp;
+
+  if (pool_elts (pem->event_registrations) == 0 ||
+      pool_is_free_index (pem->clients, client_index))
+    return;
+
+  cp = vec_elt_at_index (pem->clients_cp, client_index);
+  if (cp->pending_events == 0)
+    {
+      if (vec_len (pem->event_clients) == 0)
+	vlib_process_signal_event (pem->vlib_main,
+				   pppoe_client_process_node.index,
+				   EVENT_PPPOE_CLIENT_NOTIFY, 0);
+      vec_add1 (pem->event_clients, client_index);
+    }
+  cp->pending_events |= events;
+}
+
+static void
+pppoe_client_update_flags (pppoeclient_main_t * pem, pppoe_client_t * c)
+{
+  vnet_main_t *vnm = pem->vnet_main;
+  vnet_hw_interface_t *hw = vnet_get_sup_hw_interface (vnm, c->sw_if_index);
+  vnet_sw_interface_t *sup_sw = vnet_get_sup_sw_interface (vnm, c->sw_if_index);
+  vnet_sw_interface_t *sw = vnet_get_sw_interface (vnm, c->sw_if_index);
+
+  c->flags &= ~PPPOE_CLIENT_FLAG_UP;
+  if (hw->flags & VNET_HW_INTERFACE_FLAG_LINK_UP)
+    c->flags |= PPPOE_CLIENT_FLAG_LINK_UP;
+  if ((sup_sw->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP)
+      && (sw->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP))
+    c->flags |= PPPOE_CLIENT_FLAG_ADMIN_UP;
+}
+
 #define foreach_copy_field                   \
 _(sw_if_index)                               \
 _(host_uniq)
@@ -589,6 +1109,7 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
 {
   pppoeclient_main_t *pem = &pppoeclient_main;
   pppoe_client_t *c = 0;
+  pppoe_client_cp_t *cp;
   vlib_main_t *vm = pem->vlib_main;
   vnet_main_t *vnm = pem->vnet_main;
   //u32 is_ip6 = a->is_ip6;
@@ -605,17 +1126,27 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
       if (result.fields.client_index != ~0)
         return VNET_API_ERROR_TUNNEL_EXIST;
 
+      if (!pppoe_client_uplink_supported (vnet_get_sw_interface
+                                          (vnm, a->sw_if_index)))
+        return VNET_API_ERROR_UNSUPPORTED;
+
       pool_get_aligned (pem->clients, c, CLIB_CACHE_LINE_BYTES);
       memset (c, 0, sizeof (*c));
+      vec_validate (pem->clients_cp, c - pem->clients);
+      cp = pppoe_client_get_cp (pem, c);
+      memset (cp, 0, sizeof (*cp));
+      cp->transmit_timer = ~0;
 
       /* copy from arg structure */
-#define _(x) c->x = a->x;
-      foreach_copy_field;
-#undef _
+      c->sw_if_index = a->sw_if_index;
+      cp->host_uniq = a->host_uniq;
 
       // TODO: assure interface is ethernet hardware interface.
       sw = vnet_get_sw_interface (vnm, a->sw_if_index);
-      c->hw_if_index = sw->hw_if_index;
+
+      cp->hw_if_index = sw->hw_if_index;
+      pppoe_client_update_flags (pem, c);
+      pppoe_client_build_discovery_template (pem, c);
 
       result.fields.client_index = c - pem->clients;
       pppoeclient_update_1 (&pem->client_table,
@@ -632,7 +1163,7 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
 	pppox_allocate_interface_func = vlib_get_plugin_symbol("pppox_plugin.so", "pppox_allocate_interface");
       }
       pppox_hw_if_index = (*pppox_allocate_interface_func)(result.fields.client_index);
-      c->pppox_hw_if_index = pppox_hw_if_index;
+      cp->pppox_hw_if_index = pppox_hw_if_index;
       vnet_hw_interface_t *hi = vnet_get_hw_interface (vnm, pppox_hw_if_index);
       c->pppox_sw_if_index = *pppox_sw_if_index = hi->sw_if_index;
       vec_validate_init_empty (pem->client_index_by_pppox_sw_if_index,
@@ -645,7 +1176,7 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
       // And since there will not much physical interface, once added, it will not
       // be removed.
       {
-	vnet_hw_interface_t *phy_hi = vnet_get_hw_interface (vnm, c->hw_if_index);
+	vnet_hw_interface_t *phy_hi = vnet_get_hw_interface (vnm, cp->hw_if_index);
 	u32 edge = vlib_node_get_next (vm,
 				       pppoeclient_session_output_node.index,
 				       phy_hi->output_node_index);
@@ -664,10 +1195,20 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
       }
 #if 0 // let pppox decide.
       // Fire the FSM.
-      c->state = PPPOE_CLIENT_DISCOVERY;
+      cp->state = PPPOE_CLIENT_DISCOVERY;
       vlib_process_signal_event (vm, pppoe_client_process_node.index,
                                  EVENT_PPPOE_CLIENT_WAKEUP, c - pem->clients);
 #endif
+
+      // credentials given along, configure them which starts discovery.
+      if (a->username)
+	{
+	  static int (*pppox_set_auth_func) (u32, u8 *, u8 *) = 0;
+	  if (pppox_set_auth_func == 0)
+	    pppox_set_auth_func = vlib_get_plugin_symbol("pppox_plugin.so", "pppox_set_auth");
+	  (*pppox_set_auth_func) (c->pppox_sw_if_index, a->username,
+				  a->password);
+	}
     }
   else
     {
@@ -676,6 +1217,7 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
         return VNET_API_ERROR_NO_SUCH_ENTRY;
 
       c = pool_elt_at_index (pem->clients, result.fields.client_index);
+      cp = pppoe_client_get_cp (pem, c);
 
       // free pppox interface first to let LCP have a chance to send
       // out lcp termination and also trigger us to send a PADT.
@@ -685,7 +1227,7 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
       if (pppox_free_interface_func ==0 ) {
 	pppox_free_interface_func = vlib_get_plugin_symbol("pppox_plugin.so", "pppox_free_interface");
       }
-      (*pppox_free_interface_func)(c->pppox_hw_if_index);
+      (*pppox_free_interface_func)(cp->pppox_hw_if_index);
       
 
       result.fields.client_index = ~0;
@@ -693,7 +1235,18 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
                             a->sw_if_index, a->host_uniq,
                             &result);
 
+      // data plane must not find a freed client by its session.
+      if (c->session_id)
+        pppoeclient_delete_session_1 (&pem->session_table,
+                                      c->sw_if_index, cp->ac_mac_address,
+                                      c->session_id);
+
       pem->client_index_by_pppox_sw_if_index[c->pppox_sw_if_index] = ~0;
+      vec_free (cp->discovery_template);
+      pppoeclient_discovery_release (pem, c);
+      if (cp->transmit_timer != ~0)
+        tw_timer_stop_1t_3w_1024sl_ov (&pem->transmit_wheel,
+                                       cp->transmit_timer);
 
       pool_put (pem->clients, c);
     }
@@ -701,6 +1254,50 @@ vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t * a,
   return 0;
 }
 
+/*
+ * Track the state of the uplink in the client, so that the data plane
+ * need not look at the interfaces for each packet.
+ */
+static clib_error_t *
+pppoe_client_link_up_down (vnet_main_t * vnm, u32 hw_if_index, u32 flags)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_t *c;
+
+  // the hw interface flags are updated after this callback returns.
+  pool_foreach (c, pem->clients, ({
+    if (pppoe_client_get_cp (pem, c)->hw_if_index != hw_if_index)
+      continue;
+    if (flags & VNET_HW_INTERFACE_FLAG_LINK_UP)
+      c->flags |= PPPOE_CLIENT_FLAG_LINK_UP;
+    else
+      c->flags &= ~PPPOE_CLIENT_FLAG_LINK_UP;
+  }));
+
+  return 0;
+}
+
+VNET_HW_INTERFACE_LINK_UP_DOWN_FUNCTION (pppoe_client_link_up_down);
+
+static clib_error_t *
+pppoe_client_admin_up_down (vnet_main_t * vnm, u32 sw_if_index, u32 flags)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_t *c;
+
+  // the sw interface flags are already updated when we are called.
+  pool_foreach (c, pem->clients, ({
+    if (c->sw_if_index == sw_if_index
+        || vnet_get_sup_sw_interface (vnm, c->sw_if_index)->sw_if_index
+           == sw_if_index)
+      pppoe_client_update_flags (pem, c);
+  }));
+
+  return 0;
+}
+
+VNET_SW_INTERFACE_ADMIN_UP_DOWN_FUNCTION (pppoe_client_admin_up_down);
+
 static clib_error_t *
 pppoe_add_del_client_command_fn (vlib_main_t * vm,
                                  unformat_input_t * input,
@@ -847,30 +1444,741 @@ VLIB_CLI_COMMAND (show_pppoe_client_command, static) = {
 };
 /* *INDENT-ON* */
 
-clib_error_t *
-pppoeclient_init (vlib_main_t * vm)
+int
+pppoe_client_set_discovery_params (f64 rate, f64 burst, u32 max_in_flight,
+                                   f64 backoff_min, f64 backoff_max)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_discovery_scheduler_t *ds = &pem->discovery;
+
+  if (rate < 0 || (rate > 0 && burst < 1.0))
+    return VNET_API_ERROR_INVALID_VALUE;
+  if (backoff_min <= 0 || backoff_max < backoff_min)
+    return VNET_API_ERROR_INVALID_VALUE_2;
+
+  ds->rate = rate;
+  ds->burst = burst;
+  ds->max_in_flight = max_in_flight;
+  ds->backoff_min = backoff_min;
+  ds->backoff_max = backoff_max;
+  // start over with full buckets.
+  vec_free (ds->buckets);
+
+  return 0;
+}
+
+static clib_error_t *
+set_pppoe_client_discovery_command_fn (vlib_main_t * vm,
+                                       unformat_input_t * input,
+                                       vlib_cli_command_t * cmd)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_discovery_scheduler_t *ds = &pem->discovery;
+  unformat_input_t _line_input, *line_input = &_line_input;
+  f64 rate = ds->rate, burst = ds->burst;
+  f64 backoff_min = ds->backoff_min, backoff_max = ds->backoff_max;
+  u32 max_in_flight = ds->max_in_flight;
+  clib_error_t *error = NULL;
+  int rv;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "rate %f", &rate))
+        ;
+      else if (unformat (line_input, "burst %f", &burst))
+        ;
+      else if (unformat (line_input, "max-in-flight %d", &max_in_flight))
+        ;
+      else if (unformat (line_input, "backoff-min %f", &backoff_min))
+        ;
+      else if (unformat (line_input, "backoff-max %f", &backoff_max))
+        ;
+      else
+        {
+          error = clib_error_return (0, "parse error: '%U'",
+                                     format_unformat_error, line_input);
+          goto done;
+        }
+    }
+
+  rv = pppoe_client_set_discovery_params (rate, burst, max_in_flight,
+                                          backoff_min, backoff_max);
+  switch (rv)
+    {
+    case 0:
+      break;
+
+    case VNET_API_ERROR_INVALID_VALUE:
+      error = clib_error_return (0, "burst must be at least 1 with a rate");
+      goto done;
+
+    case VNET_API_ERROR_INVALID_VALUE_2:
+      error = clib_error_return (0, "invalid backoff interval");
+      goto done;
+
+    default:
+      error = clib_error_return
+        (0, "pppoe_client_set_discovery_params returned %d", rv);
+      goto done;
+    }
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_pppoe_client_discovery_command, static) = {
+  .path = "set pppoe client discovery",
+  .short_help =
+  "set pppoe client discovery [rate <padi/s>] [burst <nn>] [max-in-flight <nn>]"
+  " [backoff-min <sec>] [backoff-max <sec>]",
+  .function = set_pppoe_client_discovery_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_pppoe_client_discovery_command_fn (vlib_main_t * vm,
+                                        unformat_input_t * input,
+                                        vlib_cli_command_t * cmd)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_discovery_scheduler_t *ds = &pem->discovery;
+  int i;
+
+  vlib_cli_output (vm, "rate %.2f burst %.2f max-in-flight %d "
+                   "backoff-min %.2f backoff-max %.2f",
+                   ds->rate, ds->burst, ds->max_in_flight,
+                   ds->backoff_min, ds->backoff_max);
+  vlib_cli_output (vm, "in-flight %d padi-sent %lld throttled-rate %lld "
+                   "throttled-in-flight %lld",
+                   ds->in_flight, ds->padi_sent, ds->throttled_rate,
+                   ds->throttled_in_flight);
+  vlib_cli_output (vm, "time to reconnect:");
+  for (i = 0; i < PPPOE_CLIENT_RECONNECT_N_BUCKETS; i++)
+    {
+      if (ds->reconnect_histogram[i] == 0)
+        continue;
+      vlib_cli_output (vm, "  %8lldms - %8lldms: %d", i ? 1ULL << i : 0,
+                       (1ULL << (i + 1)) - 1, ds->reconnect_histogram[i]);
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_pppoe_client_discovery_command, static) = {
+    .path = "show pppoe client discovery",
+    .short_help = "show pppoe client discovery",
+    .function = show_pppoe_client_discovery_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * Warm restart: clients are saved to a file with their pppoe session and
+ * pppd state, after restart an up session is taken over without PADI or
+ * LCP negotiation, see pppox_restore_session. Others discover again.
+ */
+static char pppoe_client_state_magic[] = "pppoeclient-state-2";
+
+static void
+serialize_pppoe_clients (serialize_main_t * m, va_list * va)
+{
+  pppoeclient_main_t *pem = va_arg (*va, pppoeclient_main_t *);
+  pppoe_client_t *c;
+  pppoe_client_cp_t *cp;
+  u8 *name = 0;
+  u8 is_up;
+
+  static int (*pppox_session_restorable_func) (u32) = 0;
+  static void (*pppox_serialize_session_func) (serialize_main_t *, u32,
+                                               int) = 0;
+  if (pppox_session_restorable_func == 0)
+    {
+      pppox_session_restorable_func =
+        vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_session_restorable");
+      pppox_serialize_session_func =
+        vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_serialize_session");
+    }
+
+  serialize_magic (m, pppoe_client_state_magic,
+                   sizeof (pppoe_client_state_magic) - 1);
+  serialize_likely_small_unsigned_integer (m, pool_elts (pem->clients));
+
+  /* *INDENT-OFF* */
+  pool_foreach (c, pem->clients,
+  ({
+    cp = pppoe_client_get_cp (pem, c);
+    vec_reset_length (name);
+    name = format (name, "%U%c", format_vnet_sw_if_index_name,
+                   pem->vnet_main, c->sw_if_index, 0);
+    serialize_cstring (m, (char *) name);
+    serialize_integer (m, cp->host_uniq, sizeof (u32));
+
+    is_up = cp->state == PPPOE_CLIENT_SESSION && c->session_id != 0 &&
+      (*pppox_session_restorable_func) (c->pppox_sw_if_index);
+    serialize_integer (m, is_up, sizeof (u8));
+    if (is_up)
+      {
+        u16 cookie_len = clib_net_to_host_u16 (cp->cookie.length);
+
+        cookie_len = clib_min (cookie_len, ETH_JUMBO_LEN);
+        serialize_integer (m, c->session_id, sizeof (u16));
+        clib_memcpy (serialize_get (m, sizeof (cp->ac_mac_address)),
+                     cp->ac_mac_address, sizeof (cp->ac_mac_address));
+        serialize_integer (m, clib_net_to_host_u16 (cp->cookie.type),
+                           sizeof (u16));
+        serialize_integer (m, cookie_len, sizeof (u16));
+        if (cookie_len)
+          clib_memcpy (serialize_get (m, cookie_len), cp->cookie.value,
+                       cookie_len);
+        serialize_integer (m, cp->max_payload, sizeof (u16));
+        serialize_integer (m, cp->ac_max_payload, sizeof (u16));
+      }
+
+    (*pppox_serialize_session_func) (m, c->pppox_sw_if_index, is_up);
+  }));
+  /* *INDENT-ON* */
+
+  vec_free (name);
+}
+
+/*
+ * Reads every client before any is applied, records read so far are
+ * left in *saved for the caller to free if the file turns out broken.
+ */
+static void
+unserialize_pppoe_clients (serialize_main_t * m, va_list * va)
+{
+  pppoe_client_saved_t **saved = va_arg (*va, pppoe_client_saved_t **);
+  pppoe_client_saved_t *s;
+  u32 n_clients, i;
+  u16 cookie_len;
+
+  static void *(*pppox_unserialize_session_func) (serialize_main_t *,
+                                                  int) = 0;
+  if (pppox_unserialize_session_func == 0)
+    pppox_unserialize_session_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_unserialize_session");
+
+  unserialize_check_magic (m, pppoe_client_state_magic,
+                           sizeof (pppoe_client_state_magic) - 1);
+  n_clients = unserialize_likely_small_unsigned_integer (m);
+
+  for (i = 0; i < n_clients; i++)
+    {
+      vec_add2 (*saved, s, 1);
+      memset (s, 0, sizeof (*s));
+
+      unserialize_cstring (m, (char **) &s->uplink);
+      unserialize_integer (m, &s->host_uniq, sizeof (u32));
+      unserialize_integer (m, &s->is_up, sizeof (u8));
+      if (s->is_up)
+        {
+          unserialize_integer (m, &s->session_id, sizeof (u16));
+          clib_memcpy (s->ac_mac_address,
+                       unserialize_get (m, sizeof (s->ac_mac_address)),
+                       sizeof (s->ac_mac_address));
+          unserialize_integer (m, &s->cookie.type, sizeof (u16));
+          unserialize_integer (m, &cookie_len, sizeof (u16));
+          if (cookie_len > ETH_JUMBO_LEN)
+            serialize_error_return (m, "bad cookie length %d", cookie_len);
+          if (cookie_len)
+            clib_memcpy (s->cookie.value, unserialize_get (m, cookie_len),
+                         cookie_len);
+          s->cookie.type = clib_host_to_net_u16 (s->cookie.type);
+          s->cookie.length = clib_host_to_net_u16 (cookie_len);
+          unserialize_integer (m, &s->max_payload, sizeof (u16));
+          unserialize_integer (m, &s->ac_max_payload, sizeof (u16));
+        }
+
+      s->pppox = (*pppox_unserialize_session_func) (m, s->is_up);
+    }
+}
+
+/*
+ * Create the client of a saved record and take its session over, the
+ * pppd part is consumed either way. Clients which exist already are
+ * left alone. Returns 0 and consumes nothing if the uplink does not
+ * exist yet.
+ */
+static int
+pppoe_client_restore_one (pppoeclient_main_t * pem, pppoe_client_saved_t * s)
+{
+  vnet_pppoe_add_del_client_args_t _a, *a = &_a;
+  pppoe_client_result_t result;
+  unformat_input_t input;
+  u32 sw_if_index = ~0, pppox_sw_if_index = ~0;
+  pppoe_client_t *c;
+  pppoe_client_cp_t *cp;
+  int ok, rv;
+
+  static void (*pppox_restore_session_func) (u32, u16, int, void *) = 0;
+  if (pppox_restore_session_func == 0)
+    pppox_restore_session_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_restore_session");
+
+  unformat_init_string (&input, (char *) s->uplink,
+                        s->uplink ? strlen ((char *) s->uplink) : 0);
+  ok = unformat_user (&input, unformat_vnet_sw_interface, pem->vnet_main,
+                      &sw_if_index);
+  unformat_free (&input);
+  if (!ok)
+    return 0;
+
+  memset (a, 0, sizeof (*a));
+  a->is_add = 1;
+  a->sw_if_index = sw_if_index;
+  a->host_uniq = s->host_uniq;
+  rv = vnet_pppoe_add_del_client (a, &pppox_sw_if_index);
+  if (rv)
+    {
+      clib_warning ("pppoe client %s/%d: not restored, add returned %d",
+                    s->uplink, s->host_uniq, rv);
+      goto skip;
+    }
+
+  c = pool_elt_at_index (pem->clients,
+                         pem->client_index_by_pppox_sw_if_index
+                         [pppox_sw_if_index]);
+  cp = pppoe_client_get_cp (pem, c);
+
+  if (s->is_up)
+    {
+      pppoeclient_lookup_session_1 (&pem->session_table, c->sw_if_index,
+                                    s->ac_mac_address, s->session_id,
+                                    &result);
+      // an other client has the session by now, discover a new one.
+      if (result.fields.client_index != ~0)
+        s->is_up = 0;
+    }
+
+  if (s->is_up)
+    {
+      c->session_id = s->session_id;
+      clib_memcpy (cp->ac_mac_address, s->ac_mac_address,
+                   sizeof (cp->ac_mac_address));
+      clib_memcpy (&cp->cookie, &s->cookie, sizeof (cp->cookie));
+      cp->max_payload = s->max_payload;
+      cp->ac_max_payload = s->ac_max_payload;
+
+      result.fields.client_index = c - pem->clients;
+      result.fields.owner = PPPOE_SESSION_OWNER_CLIENT;
+      pppoeclient_update_session_1 (&pem->session_table,
+                                    c->sw_if_index, cp->ac_mac_address,
+                                    c->session_id, &result);
+      pppoe_client_build_rewrite (pem, c);
+      cp->state = PPPOE_CLIENT_SESSION;
+      pppoe_client_update_adjacencies (c);
+      cp->next_transmit = vlib_time_now (pem->vlib_main) + 4294967295.0;
+      pppoe_client_notify (c - pem->clients, PPPOE_CLIENT_EVENT_SESSION_UP);
+    }
+
+  (*pppox_restore_session_func) (pppox_sw_if_index, pppoe_client_mru (cp),
+                                 s->is_up, s->pppox);
+  return 1;
+
+skip:
+  (*pppox_restore_session_func) (~0, 0, 0, s->pppox);
+  return 1;
+}
+
+/*
+ * Retry the clients whose uplink was missing, the startup exec script
+ * may create it after the state file has been read.
+ */
+static void
+pppoe_client_restore_pending (pppoeclient_main_t * pem)
+{
+  u32 i = 0;
+
+  while (i < vec_len (pem->restore_pending))
+    {
+      pppoe_client_saved_t *s = vec_elt_at_index (pem->restore_pending, i);
+
+      if (!pppoe_client_restore_one (pem, s))
+        {
+          i++;
+          continue;
+        }
+      vec_free (s->uplink);
+      vec_del1 (pem->restore_pending, i);
+    }
+  pppoeclient_tx_flush ();
+}
+
+static clib_error_t *
+pppoe_client_sw_interface_add_del (vnet_main_t * vnm, u32 sw_if_index,
+                                   u32 is_add)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+
+  if (is_add && vec_len (pem->restore_pending))
+    vlib_process_signal_event (pem->vlib_main,
+                               pppoe_client_process_node.index,
+                               EVENT_PPPOE_CLIENT_RESTORE, 0);
+
+  return 0;
+}
+
+VNET_SW_INTERFACE_ADD_DEL_FUNCTION (pppoe_client_sw_interface_add_del);
+
+clib_error_t *
+pppoe_client_save_state (char *file)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  serialize_main_t m;
+  clib_error_t *error;
+  int fd;
+
+  // pap/chap credentials are in there, for nobody else to read.
+  fd = open (file, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+  if (fd < 0)
+    return clib_error_return_unix (0, "open `%s'", file);
+  // an existing file keeps its mode.
+  if (fchmod (fd, 0600) < 0)
+    {
+      error = clib_error_return_unix (0, "chmod `%s'", file);
+      close (fd);
+      return error;
+    }
+
+  serialize_open_unix_file_descriptor (&m, fd);
+  error = serialize (&m, serialize_pppoe_clients, pem);
+  serialize_close (&m);
+  close (fd);
+
+  return error;
+}
+
+clib_error_t *
+pppoe_client_restore_state (char *file)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_saved_t *saved = 0, *s;
+  serialize_main_t m;
+  clib_error_t *error;
+
+  static void (*pppox_restore_session_func) (u32, u16, int, void *) = 0;
+  if (pppox_restore_session_func == 0)
+    pppox_restore_session_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_restore_session");
+
+  error = unserialize_open_unix_file (&m, file);
+  if (error)
+    return error;
+
+  error = unserialize (&m, unserialize_pppoe_clients, &saved);
+  unserialize_close (&m);
+
+  vec_foreach (s, saved)
+  {
+    if (error)
+      {
+        // a record cut short has no pppd part.
+        if (s->pppox)
+          (*pppox_restore_session_func) (~0, 0, 0, s->pppox);
+      }
+    else if (!pppoe_client_restore_one (pem, s))
+      {
+        clib_warning ("pppoe client %s/%d: uplink not found, restored "
+                      "once it is created", s->uplink, s->host_uniq);
+        vec_add1 (pem->restore_pending, s[0]);
+        continue;
+      }
+    vec_free (s->uplink);
+  }
+  vec_free (saved);
+
+  return error;
+}
+
+static clib_error_t *
+save_pppoe_client_state_command_fn (vlib_main_t * vm,
+                                    unformat_input_t * input,
+                                    vlib_cli_command_t * cmd)
+{
+  u8 *file = 0;
+  clib_error_t *error;
+
+  if (!unformat (input, "%s", &file))
+    return clib_error_return (0, "file name not specified");
+  vec_add1 (file, 0);
+
+  error = pppoe_client_save_state ((char *) file);
+  vec_free (file);
+
+  return error;
+}
+
+/*?
+ * Save the PPPoE clients, with the sessions they have up, to a file
+ * which a restarted vpp restores them from.
+ *
+ * @cliexpar
+ * @cliexcmd{save pppoe client state /tmp/pppoeclient.state}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (save_pppoe_client_state_command, static) = {
+  .path = "save pppoe client state",
+  .short_help = "save pppoe client state <file>",
+  .function = save_pppoe_client_state_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+restore_pppoe_client_state_command_fn (vlib_main_t * vm,
+                                       unformat_input_t * input,
+                                       vlib_cli_command_t * cmd)
+{
+  u8 *file = 0;
+  clib_error_t *error;
+
+  if (!unformat (input, "%s", &file))
+    return clib_error_return (0, "file name not specified");
+  vec_add1 (file, 0);
+
+  error = pppoe_client_restore_state ((char *) file);
+  vec_free (file);
+  pppoeclient_tx_flush ();
+
+  return error;
+}
+
+/*?
+ * Restore PPPoE clients saved by save pppoe client state. Up sessions
+ * are taken over and checked with LCP echoes, the others start over.
+ *
+ * @cliexpar
+ * @cliexcmd{restore pppoe client state /tmp/pppoeclient.state}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (restore_pppoe_client_state_command, static) = {
+  .path = "restore pppoe client state",
+  .short_help = "restore pppoe client state <file>",
+  .function = restore_pppoe_client_state_command_fn,
+};
+/* *INDENT-ON* */
+
+clib_error_t *
+pppoeclient_init (vlib_main_t * vm)
 {
   pppoeclient_main_t *pem = &pppoeclient_main;
 
   pem->vnet_main = vnet_get_main ();
   pem->vlib_main = vm;
 
+  pem->discovery_frame_queue_index = ~0;
+  pem->control_frame_queue_index = ~0;
+  pem->handoff_fd = -1;
+  pem->handoff_file_index = ~0;
+
+  pem->discovery.rate = PPPOE_CLIENT_DISCOVERY_DEFAULT_RATE;
+  pem->discovery.burst = PPPOE_CLIENT_DISCOVERY_DEFAULT_BURST;
+  pem->discovery.backoff_min = PPPOE_CLIENT_DISCOVERY_DEFAULT_BACKOFF_MIN;
+  pem->discovery.backoff_max = PPPOE_CLIENT_DISCOVERY_DEFAULT_BACKOFF_MAX;
+  pem->discovery.seed = (u32) clib_cpu_time_now ();
+
+  tw_timer_wheel_init_1t_3w_1024sl_ov (&pem->transmit_wheel,
+                                       0 /* no callback */,
+                                       PPPOE_CLIENT_TIMER_TICK, ~0);
+  pem->transmit_wheel.last_run_time = vlib_time_now (vm);
+  pem->next_wakeup = 1e70;
+
+  // frame queues must exist before workers start to poll them.
+  if (vlib_get_thread_main ()->n_vlib_mains > 1)
+    {
+      vlib_node_t *pppox_input;
+
+      pppox_input = vlib_get_node_by_name (vm, (u8 *) "pppox-input");
+      if (pppox_input == 0)
+        return clib_error_return (0, "pppox-input node not found");
+
+      pem->discovery_frame_queue_index =
+        vlib_frame_queue_main_init (pppoeclient_discovery_input_node.index, 0);
+      pem->control_frame_queue_index =
+        vlib_frame_queue_main_init (pppox_input->index, 0);
+    }
+
   /* Create the hash table  */
-  BV (clib_bihash_init) (&pem->client_table, "pppoe client table",
-                         PPPOE_CLIENT_NUM_BUCKETS, PPPOE_CLIENT_MEMORY_SIZE);
-  BV (clib_bihash_init) (&pem->session_table, "pppoe client_session table",
+  clib_bihash_init_8_8 (&pem->client_table, "pppoe client table",
+                        PPPOE_CLIENT_NUM_BUCKETS, PPPOE_CLIENT_MEMORY_SIZE);
+  clib_bihash_init_16_8 (&pem->session_table, "pppoe client_session table",
                          PPPOE_CLIENT_NUM_BUCKETS, PPPOE_CLIENT_MEMORY_SIZE);
 
+  // pppoe server plugin registers with pppoe-dispatch instead of
+  // taking the ethertypes over.
+  pem->dispatch_server_discovery_next = ~0;
+  pem->dispatch_server_session_next = ~0;
   ethernet_register_input_type (vm, ETHERNET_TYPE_PPPOE_DISCOVERY,
-                                pppoeclient_discovery_input_node.index);
+                                pppoe_dispatch_node.index);
   ethernet_register_input_type (vm, ETHERNET_TYPE_PPPOE_SESSION,
-                                pppoeclient_session_input_node.index);
+                                pppoe_dispatch_node.index);
 
   return 0;
 }
 
 VLIB_INIT_FUNCTION (pppoeclient_init);
 
+static clib_error_t *
+pppoeclient_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "state-file %s", &pem->state_file))
+        vec_add1 (pem->state_file, 0);
+      else
+        return clib_error_return (0, "unknown input '%U'",
+                                  format_unformat_error, input);
+    }
+
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (pppoeclient_config, "pppoeclient");
+
+/* sessions are left up on the AC at exit for the restarted vpp */
+static clib_error_t *
+pppoeclient_exit (vlib_main_t * vm)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+
+  if (pem->state_file)
+    return pppoe_client_save_state ((char *) pem->state_file);
+
+  return 0;
+}
+
+VLIB_MAIN_LOOP_EXIT_FUNCTION (pppoeclient_exit);
+
+void
+pppoe_dispatch_register_server (vlib_main_t * vm, u32 discovery_node_index,
+                                u32 session_node_index)
+{
+  pppoeclient_main_t * pem = &pppoeclient_main;
+
+  // may be called from pppoe_init before our own init ran.
+  vlib_call_init_function (vm, pppoeclient_init);
+
+  pem->dispatch_server_discovery_next =
+    vlib_node_add_next (vm, pppoe_dispatch_node.index, discovery_node_index);
+  pem->dispatch_server_session_next =
+    vlib_node_add_next (vm, pppoe_dispatch_node.index, session_node_index);
+}
+
+void
+pppoe_dispatch_add_del_server_session (u32 sw_if_index, u8 * mac,
+                                       u16 session_id, u32 session_index,
+                                       int is_add)
+{
+  pppoeclient_main_t * pem = &pppoeclient_main;
+  pppoe_client_result_t result;
+
+  pppoeclient_lookup_session_1 (&pem->session_table, sw_if_index, mac,
+                                session_id, &result);
+  // never take over a session of our own clients.
+  if (result.fields.client_index != ~0 &&
+      result.fields.owner != PPPOE_SESSION_OWNER_SERVER)
+    return;
+
+  if (!is_add)
+    {
+      if (result.fields.client_index != ~0)
+        pppoeclient_delete_session_1 (&pem->session_table, sw_if_index, mac,
+                                      session_id);
+      return;
+    }
+
+  result.fields.client_index = session_index;
+  result.fields.owner = PPPOE_SESSION_OWNER_SERVER;
+  pppoeclient_update_session_1 (&pem->session_table, sw_if_index, mac,
+                                session_id, &result);
+}
+
+void
+pppoeclient_handoff_kick (pppoeclient_main_t * pem)
+{
+  u64 one = 1;
+
+  if (write (pem->handoff_fd, &one, sizeof (one)) < 0 && errno != EAGAIN)
+    clib_unix_warning ("write handoff eventfd");
+}
+
+static_always_inline int
+pppoeclient_frame_queue_pending (u32 frame_queue_index)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm =
+    vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  vlib_frame_queue_t *fq = fqm->vlib_frame_queues[0];
+
+  return fq->head != fq->tail;
+}
+
+/*
+ * Main thread does not poll frame queues, drain ours when a worker
+ * kicks the eventfd.
+ */
+static clib_error_t *
+pppoeclient_handoff_read_ready (clib_file_t * uf)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  vlib_main_t *vm = pem->vlib_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u64 count;
+
+  if (read (uf->file_descriptor, &count, sizeof (count)) < 0
+      && errno != EAGAIN)
+    return clib_error_return_unix (0, "read handoff eventfd");
+
+  vlib_frame_queue_dequeue (vm, vec_elt_at_index (tm->frame_queue_mains,
+                                                  pem->discovery_frame_queue_index));
+  vlib_frame_queue_dequeue (vm, vec_elt_at_index (tm->frame_queue_mains,
+                                                  pem->control_frame_queue_index));
+
+  // dequeue stops at the vector threshold, come back for the rest.
+  if (pppoeclient_frame_queue_pending (pem->discovery_frame_queue_index)
+      || pppoeclient_frame_queue_pending (pem->control_frame_queue_index))
+    pppoeclient_handoff_kick (pem);
+
+  return 0;
+}
+
+/*
+ * Frame queues are created by pppoeclient_init, the eventfd is added
+ * once unix file polling is set up.
+ */
+static clib_error_t *
+pppoeclient_handoff_init (vlib_main_t * vm)
+{
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  clib_file_t template = { 0 };
+
+  // nothing to hand off without workers.
+  if (tm->n_vlib_mains == 1)
+    return 0;
+
+  pem->handoff_fd = eventfd (0, EFD_NONBLOCK);
+  if (pem->handoff_fd < 0)
+    return clib_error_return_unix (0, "eventfd");
+
+  template.read_function = pppoeclient_handoff_read_ready;
+  template.file_descriptor = pem->handoff_fd;
+  pem->handoff_file_index = clib_file_add (&file_main, &template);
+
+  return 0;
+}
+
+VLIB_MAIN_LOOP_ENTER_FUNCTION (pppoeclient_handoff_init);
+
 /* *INDENT-OFF* */
 VLIB_PLUGIN_REGISTER () = {
     .version = VPP_BUILD_VER,
@@ -21,6 +21,8 @@
 #include <vnet/fib/fib_table.h>
 #include <vlib/vlib.h>
 #include <vppinfra/bihash_8_8.h>
+#include <vppinfra/bihash_16_8.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 
 typedef struct
 {
@@ -38,6 +40,16 @@ typedef struct
   u8 value[0];
 } pppoe_tag_header_t;
 
+/*
+ * Room for the headers prepended to a session packet: ethernet, up to
+ * two VLAN tags of a sub-interface uplink and pppoe. The ppp protocol
+ * field is already in place (written by pppox adjacency rewrite or by
+ * pppd).
+ */
+#define PPPOE_CLIENT_MAX_REWRITE (sizeof (ethernet_header_t) +        \
+                                  2 * sizeof (ethernet_vlan_header_t) + \
+                                  sizeof (pppoe_header_t))
+
 
 #define ETH_JUMBO_LEN 1508
 typedef struct
@@ -56,6 +68,10 @@ typedef struct
 #define PPPOE_PADT 0xa7
 #define PPPOE_SESSION_DATA 0x0
 
+// LCP codes the session input node looks at.
+#define PPPOE_CLIENT_LCP_ECHOREQ 9
+#define PPPOE_CLIENT_LCP_ECHOREP 10
+
 typedef void parse_func(u16 type, u16 len, unsigned char *data, void *extra);
 
 // PPPoE Tags
@@ -71,6 +87,10 @@ typedef void parse_func(u16 type, u16 len, unsigned char *data, void *extra);
 #define PPPOE_TAG_AC_SYSTEM_ERROR    0x0202
 #define PPPOE_TAG_GENERIC_ERROR      0x0203
 
+// PPP payload of RFC 2516, and pppoe plus ppp header bytes.
+#define PPPOE_CLIENT_DEFAULT_MRU     1492
+#define PPPOE_CLIENT_OVERHEAD        8
+
 #define foreach_pppoe_client_state               \
 _(PPPOE_CLIENT_DISCOVERY)                        \
 _(PPPOE_CLIENT_REQUEST)                          \
@@ -82,30 +102,130 @@ typedef enum {
 #undef _
 } pppoe_client_state_t;
 
+/*
+ * Data plane part of a client, all pppoeclient-session-input/output look
+ * at, one cache line. The control plane part is a pppoe_client_cp_t at
+ * the same index in pppoeclient_main_t.clients_cp.
+ */
 typedef struct
 {
-  /* pppoe client is bounded to an ethernet interface, use it and the following tag as hash key */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* pppoe client is bounded to an ethernet interface */
   u32 sw_if_index;
-  u32 hw_if_index;
   u32 hw_output_next_index;
+
+  /* pppox intf index */
+  u32 pppox_sw_if_index;
+
+  /* LCP Echo-Requests are answered by pppoeclient-session-input with
+     our magic number while LCP is opened, see pppoe_client_set_lcp_echo */
+  u32 lcp_magic;
+  /* Echo-Requests answered and data packets received so far, pppd
+     polls them as signs of life */
+  u32 lcp_echo_replied;
+  u32 rx_packets;
+
+  u16 session_id;
+  /* PPPOE_CLIENT_FLAG_*, kept by interface up/down callbacks */
+  u8 flags;
+  u8 lcp_echo_reply;
+
+  /* built when the session comes up, the pppoe header is the last
+     rewrite_len bytes and its length is set per packet */
+  u8 rewrite[PPPOE_CLIENT_MAX_REWRITE];
+  u8 rewrite_len;
+} pppoe_client_t;
+
+STATIC_ASSERT (sizeof (pppoe_client_t) <= CLIB_CACHE_LINE_BYTES,
+	       "pppoe client data plane record must fit a cache line");
+
+/*
+ * Control plane part of a client: discovery, retries and timers.
+ */
+typedef struct
+{
+  u32 hw_if_index;
   /* we may support multiple pppoe session using 1 ethernet interface, the use pppoe rfc host-uniq
      tag to mix key */
   u32 host_uniq;
 
   pppoe_tag_t cookie; // we have to send this if we get it.
 
+  /* ethernet + pppoe discovery headers and our fixed tags, see
+     pppoe_client_build_discovery_template */
+  u8 *discovery_template;
+  /* ethernet header and VLAN tags of the uplink in front of pppoe */
+  u8 l2_header_bytes;
+
   pppoe_client_state_t state;
   /* State machine retry counter */
   u32 retry_count;
   /* Send next pkt at this time */
   f64 next_transmit;
+  /* transmit timer wheel handle, ~0 if none is armed */
+  u32 transmit_timer;
   u8 ac_mac_address[6];
-  u16 session_id;
+  /* RFC 4638 PPP-Max-Payload we ask for in PADI/PADR, 0 when the uplink
+     has no room beyond 1492 bytes, and what PADO/PADS granted */
+  u16 max_payload;
+  u16 ac_max_payload;
+
+  /* holds one of the discovery scheduler in-flight slots */
+  u8 discovery_in_flight;
+  /* when the client started to look for a session */
+  f64 discovery_start;
 
-  /* pppox intf index */
-  u32 pppox_sw_if_index;
   u32 pppox_hw_if_index;
-} pppoe_client_t;
+
+  /* PPPOE_CLIENT_EVENT_* not yet sent to API subscribers */
+  u32 pending_events;
+} pppoe_client_cp_t;
+
+/*
+ * A client read back from a state file by pppoe_client_restore_state,
+ * the session part is only there for clients that were up.
+ */
+typedef struct
+{
+  /* uplink by name, sw_if_index may differ after restart */
+  u8 *uplink;
+  u32 host_uniq;
+  u8 is_up;
+  u16 session_id;
+  u8 ac_mac_address[6];
+  pppoe_tag_t cookie;
+  u16 max_payload;
+  u16 ac_max_payload;
+  /* pppd state, see pppox_unserialize_session */
+  void *pppox;
+} pppoe_client_saved_t;
+
+/*
+ * Session events sent to want_pppoe_client_events subscribers, LCP and
+ * IP ones come from pppox as PPPOX_SESSION_EVENT_*.
+ */
+#define foreach_pppoe_client_event		\
+_(0, SESSION_UP)				\
+_(1, PADT)					\
+_(2, LCP_UP)					\
+_(3, LCP_DOWN)					\
+_(4, IP_UP)					\
+_(5, IP_DOWN)
+
+#define _(b,n) PPPOE_CLIENT_EVENT_##n = (1 << b),
+enum
+{
+  foreach_pppoe_client_event
+};
+#undef _
+
+/* uplink hw interface link is up */
+#define PPPOE_CLIENT_FLAG_LINK_UP	(1 << 0)
+/* uplink sw interface and its sup interface are admin up */
+#define PPPOE_CLIENT_FLAG_ADMIN_UP	(1 << 1)
+#define PPPOE_CLIENT_FLAG_UP \
+  (PPPOE_CLIENT_FLAG_LINK_UP | PPPOE_CLIENT_FLAG_ADMIN_UP)
 
 typedef enum
 {
@@ -128,7 +248,10 @@ typedef enum
 
 #define foreach_pppoeclient_session_input_next       \
 _(IP4_INPUT, "ip4-input") \
+_(INTERFACE_OUTPUT, "interface-output") \
 _(PPPOX_INPUT, "pppox-input")                   \
+_(CONTROL_HANDOFF, "pppoeclient-control-handoff") \
+_(PPPOX_MP_INPUT, "pppox-mp-input") \
 _(DROP, "error-drop")
 
 typedef enum
@@ -139,6 +262,19 @@ typedef enum
     PPPOECLIENT_SESSION_INPUT_N_NEXT,
 } pppoeclient_session_input_next_t;
 
+#define foreach_pppoe_dispatch_next       \
+_(DROP, "error-drop")                     \
+_(CLIENT_DISCOVERY, "pppoeclient-discovery-input") \
+_(CLIENT_SESSION, "pppoeclient-session-input")
+
+typedef enum
+{
+#define _(s,n) PPPOE_DISPATCH_NEXT_##s,
+  foreach_pppoe_dispatch_next
+#undef _
+    PPPOE_DISPATCH_N_NEXT,
+} pppoe_dispatch_next_t;
+
 #define foreach_pppoeclient_session_output_next       \
 _(DROP, "error-drop")
 
@@ -152,7 +288,6 @@ typedef enum
 
 #define MTU 1500
 #define MTU_BUFFERS ((MTU + VLIB_BUFFER_DATA_SIZE - 1) / VLIB_BUFFER_DATA_SIZE)
-#define NUM_BUFFERS_TO_ALLOC 32
 
 /*
  * The size of pppoe client table
@@ -185,7 +320,8 @@ typedef struct
 
 /* *INDENT-OFF* */
 /*
- * The PPPoE client results
+ * The PPPoE client results, the session table also holds sessions of
+ * pppoe server plugin, owner tells whose pool client_index points into.
  */
 typedef struct
 {
@@ -194,16 +330,21 @@ typedef struct
     struct
     {
       u32 client_index;
-      u32 rsved;
+      u32 owner;
     } fields;
     u64 raw;
   };
 }  pppoe_client_result_t;
 /* *INDENT-ON* */
 
+#define PPPOE_SESSION_OWNER_CLIENT	0
+#define PPPOE_SESSION_OWNER_SERVER	1
+
 /* *INDENT-OFF* */
 /*
- * The PPPoE client session key is the session id
+ * The PPPoE client session key is the rx sw if index, AC mac address
+ * and session id, since a session id is only unique to the AC which
+ * allocates it.
  */
 typedef struct
 {
@@ -211,29 +352,76 @@ typedef struct
   {
     struct
     {
-      u16 session_id;
-      u16 rsv0;
-      u32 rsv1;
+      u64 mac_session_id; /* see pppoeclient_make_session_key */
+      u32 sw_if_index;
+      u32 rsv;
     } fields;
-    struct
-    {
-      u32 w0;
-      u32 w1;
-    } words;
-    u64 raw;
+    u64 raw[2];
   };
 } pppoe_client_session_key_t;
 /* *INDENT-ON* */
 
+/* Time to reconnect histogram, bucket i counts [2^i, 2^(i+1)) ms */
+#define PPPOE_CLIENT_RECONNECT_N_BUCKETS 20
+
 typedef struct
 {
-  /* For DP: vector of clients, */
+  f64 tokens;
+  f64 last_update;
+} pppoe_client_token_bucket_t;
+
+/*
+ * Paces PADI of all clients, so that clients losing their sessions at
+ * the same time do not all hit the AC at once.
+ */
+typedef struct
+{
+  /* PADI per second and burst allowed on an uplink, rate 0 is unlimited */
+  f64 rate;
+  f64 burst;
+  /* clients allowed in discovery at the same time, 0 is unlimited */
+  u32 max_in_flight;
+  /* retry interval doubles from backoff_min up to backoff_max, each
+     interval is picked randomly in its upper half */
+  f64 backoff_min;
+  f64 backoff_max;
+
+  /* token buckets indexed by uplink sw_if_index */
+  pppoe_client_token_bucket_t *buckets;
+
+  u32 in_flight;
+  u32 seed;
+
+  /* counters */
+  u64 padi_sent;
+  u64 throttled_rate;
+  u64 throttled_in_flight;
+  u32 reconnect_histogram[PPPOE_CLIENT_RECONNECT_N_BUCKETS];
+} pppoe_client_discovery_scheduler_t;
+
+#define PPPOE_CLIENT_DISCOVERY_DEFAULT_RATE		100.0
+#define PPPOE_CLIENT_DISCOVERY_DEFAULT_BURST		100.0
+#define PPPOE_CLIENT_DISCOVERY_DEFAULT_BACKOFF_MIN	1.0
+#define PPPOE_CLIENT_DISCOVERY_DEFAULT_BACKOFF_MAX	32.0
+
+/* A want_pppoe_client_events subscriber */
+typedef struct
+{
+  u32 client_index;
+  u32 client_pid;
+} pppoe_client_event_registration_t;
+
+typedef struct
+{
+  /* For DP: pool of clients, */
   pppoe_client_t *clients;
+  /* and their control plane parts, indexed by client index */
+  pppoe_client_cp_t *clients_cp;
 
   /* For CP:  vector of CP path */
-  BVT (clib_bihash) client_table;
+  clib_bihash_8_8_t client_table;
   // Session hash table share same lookup result structure.
-  BVT (clib_bihash) session_table;
+  clib_bihash_16_8_t session_table;
 
   /* Mapping from pppox sw_if_index to client index */
   u32 *client_index_by_pppox_sw_if_index;
@@ -241,6 +429,42 @@ typedef struct
   /* API message ID base */
   u16 msg_id_base;
 
+  pppoe_client_discovery_scheduler_t discovery;
+
+  /*
+   * Control frames received by workers are handed off to main thread
+   * through these frame queues, the eventfd wakes main thread up.
+   */
+  u32 discovery_frame_queue_index;
+  u32 control_frame_queue_index;
+  int handoff_fd;
+  u32 handoff_file_index;
+
+  /*
+   * Next nodes of pppoe-dispatch towards pppoe server plugin, ~0 until
+   * it registers.
+   */
+  u32 dispatch_server_discovery_next;
+  u32 dispatch_server_session_next;
+
+  /* clients waiting to transmit, keyed by next_transmit */
+  tw_timer_wheel_1t_3w_1024sl_ov_t transmit_wheel;
+  u32 *expired;
+  /* time pppoe-client-process will next expire timers */
+  f64 next_wakeup;
+
+  /* want_pppoe_client_events subscribers, keyed by api client index */
+  pppoe_client_event_registration_t *event_registrations;
+  uword *event_registration_hash;
+  /* clients with pending_events */
+  u32 *event_clients;
+
+  /* startup config state-file, saved at exit and restored at start */
+  u8 *state_file;
+  /* state file clients whose uplink does not exist yet, restored as
+     interfaces get created */
+  pppoe_client_saved_t *restore_pending;
+
   /* convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -248,24 +472,62 @@ typedef struct
 } pppoeclient_main_t;
 
 #define EVENT_PPPOE_CLIENT_WAKEUP	1
+#define EVENT_PPPOE_CLIENT_TIMER_UPDATE	2
+#define EVENT_PPPOE_CLIENT_NOTIFY	3
+#define EVENT_PPPOE_CLIENT_RESTORE	4
+
+#define PPPOE_CLIENT_TIMER_TICK 0.01	/* seconds, 10ms */
 
 extern pppoeclient_main_t pppoeclient_main;
 
+static_always_inline pppoe_client_cp_t *
+pppoe_client_get_cp (pppoeclient_main_t * pem, pppoe_client_t * c)
+{
+  return vec_elt_at_index (pem->clients_cp, c - pem->clients);
+}
+
 extern vlib_node_registration_t pppoeclient_discovery_input_node;
 extern vlib_node_registration_t pppoeclient_session_input_node;
 extern vlib_node_registration_t pppoeclient_session_output_node;
+extern vlib_node_registration_t pppoe_dispatch_node;
 
 typedef struct
 {
   u8 is_add;
   u32 sw_if_index;
   u32 host_uniq;
+  /* NUL terminated ppp credentials, when set the client is started */
+  u8 *username;
+  u8 *password;
 } vnet_pppoe_add_del_client_args_t;
 
 int vnet_pppoe_add_del_client (vnet_pppoe_add_del_client_args_t *, u32 *);
 
+int pppoe_client_set_discovery_params (f64 rate, f64 burst, u32 max_in_flight,
+                                       f64 backoff_min, f64 backoff_max);
+
 int consume_pppoe_discovery_pkt (u32, vlib_buffer_t *, pppoe_header_t *);
 
+u16 pppoe_client_mru (pppoe_client_cp_t *);
+
+void pppoe_client_notify (u32, u32);
+
+void pppoe_client_send_events (pppoeclient_main_t *);
+
+clib_error_t *pppoe_client_save_state (char *);
+
+clib_error_t *pppoe_client_restore_state (char *);
+
+void pppoeclient_handoff_kick (pppoeclient_main_t *);
+
+/* Used by pppoe server plugin through vlib_get_plugin_symbol */
+void pppoe_dispatch_register_server (vlib_main_t * vm,
+                                     u32 discovery_node_index,
+                                     u32 session_node_index);
+void pppoe_dispatch_add_del_server_session (u32 sw_if_index, u8 * mac,
+                                            u16 session_id,
+                                            u32 session_index, int is_add);
+
 always_inline u64
 pppoeclient_make_key (u32 sw_if_index, u32 host_uniq)
 {
@@ -277,7 +539,7 @@ pppoeclient_make_key (u32 sw_if_index, u32 host_uniq)
 }
 
 static_always_inline void
-pppoeclient_lookup_1 (BVT (clib_bihash) * client_table,
+pppoeclient_lookup_1 (clib_bihash_8_8_t * client_table,
                       u32 sw_if_index,
                       u32 host_uniq,
                       pppoe_client_result_t * result0)
@@ -287,16 +549,16 @@ pppoeclient_lookup_1 (BVT (clib_bihash) * client_table,
   key0.raw = pppoeclient_make_key (sw_if_index, host_uniq);
 
   /* Do a regular client table lookup */
-  BVT (clib_bihash_kv) kv;
+  clib_bihash_kv_8_8_t kv;
 
   kv.key = key0.raw;
   kv.value = ~0ULL;
-  BV (clib_bihash_search_inline) (client_table, &kv);
+  clib_bihash_search_inline_8_8 (client_table, &kv);
   result0->raw = kv.value;
 }
 
 static_always_inline void
-pppoeclient_update_1 (BVT (clib_bihash) * client_table,
+pppoeclient_update_1 (clib_bihash_8_8_t * client_table,
                       u32 sw_if_index,
                       u32 host_uniq,
                       pppoe_client_result_t * result0)
@@ -306,74 +568,144 @@ pppoeclient_update_1 (BVT (clib_bihash) * client_table,
   key0.raw = pppoeclient_make_key (sw_if_index, host_uniq);
 
   /* Update the entry */
-  BVT (clib_bihash_kv) kv;
+  clib_bihash_kv_8_8_t kv;
 
   kv.key = key0.raw;
   kv.value = result0->raw;
-  BV (clib_bihash_add_del) (client_table, &kv, 1 /* is_add */ );
+  clib_bihash_add_del_8_8 (client_table, &kv, 1 /* is_add */ );
 
 }
 
-always_inline u64
-pppoeclient_make_session_key (u16 session_id)
+always_inline void
+pppoeclient_make_session_key (clib_bihash_kv_16_8_t * kv, u32 sw_if_index,
+                              u8 * ac_mac_address, u16 session_id)
 {
+  pppoe_client_session_key_t *key0 = (pppoe_client_session_key_t *) kv->key;
   u64 temp;
 
-  temp = ((u64)0) << 48 | session_id;
-
-  return temp;
+  /* Same layout as pppoe_make_key of pppoe plugin */
+#if CLIB_ARCH_IS_LITTLE_ENDIAN
+  temp = *((u64 *) (ac_mac_address)) << 16;
+  temp = (temp & ~0xffff) | (u64) (session_id);
+#else
+  temp = *((u64 *) (ac_mac_address)) >> 16;
+  temp = temp | (((u64) session_id) << 48);
+#endif
+
+  key0->fields.mac_session_id = temp;
+  key0->fields.sw_if_index = sw_if_index;
+  key0->fields.rsv = 0;
 }
 
 static_always_inline void
-pppoeclient_lookup_session_1 (BVT (clib_bihash) * session_table,
+pppoeclient_lookup_session_1 (clib_bihash_16_8_t * session_table,
+                              u32 sw_if_index,
+                              u8 * ac_mac_address,
                               u16 session_id,
                               pppoe_client_result_t * result0)
 {
-  pppoe_client_session_key_t key0;
-  /* set up key */
-  key0.raw = pppoeclient_make_session_key (session_id);
-
-  /* Do a regular client table lookup */
-  BVT (clib_bihash_kv) kv;
+  clib_bihash_kv_16_8_t kv;
 
-  kv.key = key0.raw;
+  /* Do a regular session table lookup */
+  pppoeclient_make_session_key (&kv, sw_if_index, ac_mac_address, session_id);
   kv.value = ~0ULL;
-  BV (clib_bihash_search_inline) (session_table, &kv);
+  clib_bihash_search_inline_16_8 (session_table, &kv);
   result0->raw = kv.value;
 }
 
 static_always_inline void
-pppoeclient_update_session_1 (BVT (clib_bihash) * session_table,
+pppoeclient_update_session_1 (clib_bihash_16_8_t * session_table,
+                              u32 sw_if_index,
+                              u8 * ac_mac_address,
                               u16 session_id,
                               pppoe_client_result_t * result0)
 {
-  pppoe_client_session_key_t key0;
-  /* set up key */
-  key0.raw = pppoeclient_make_session_key (session_id);
+  clib_bihash_kv_16_8_t kv;
 
   /* Update the entry */
-  BVT (clib_bihash_kv) kv;
-
-  kv.key = key0.raw;
+  pppoeclient_make_session_key (&kv, sw_if_index, ac_mac_address, session_id);
   kv.value = result0->raw;
-  BV (clib_bihash_add_del) (session_table, &kv, 1 /* is_add */ );
-
+  clib_bihash_add_del_16_8 (session_table, &kv, 1 /* is_add */ );
 }
 
 static_always_inline void
-pppoeclient_delete_session_1 (BVT (clib_bihash) * session_table,
+pppoeclient_delete_session_1 (clib_bihash_16_8_t * session_table,
+                              u32 sw_if_index,
+                              u8 * ac_mac_address,
                               u16 session_id)
 {
-  pppoe_client_session_key_t key0;
-  /* set up key */
-  key0.raw = pppoeclient_make_session_key (session_id);
+  clib_bihash_kv_16_8_t kv;
 
-  /* Update the entry */
-  BVT (clib_bihash_kv) kv;
+  /* Delete the entry */
+  pppoeclient_make_session_key (&kv, sw_if_index, ac_mac_address, session_id);
+  clib_bihash_add_del_16_8 (session_table, &kv, 0 /* is_add */ );
+}
 
-  kv.key = key0.raw;
-  BV (clib_bihash_add_del) (session_table, &kv, 0 /* is_add */ );
+/*
+ * Split session table lookup for the data plane: the hash of the key
+ * is computed and its bucket prefetched first, then the value page is
+ * prefetched, a few packets later the lookup finds everything in cache.
+ */
+static_always_inline void
+pppoeclient_session_prefetch_bucket (clib_bihash_16_8_t * session_table,
+                                     u64 hash)
+{
+  clib_bihash_bucket_16_8_t *b;
+
+  b = &session_table->buckets[hash & (session_table->nbuckets - 1)];
+  CLIB_PREFETCH (b, CLIB_CACHE_LINE_BYTES, LOAD);
+}
 
+static_always_inline void
+pppoeclient_session_prefetch_data (clib_bihash_16_8_t * session_table,
+                                   u64 hash)
+{
+  clib_bihash_bucket_16_8_t *b;
+  clib_bihash_value_16_8_t *v;
+
+  b = &session_table->buckets[hash & (session_table->nbuckets - 1)];
+  if (PREDICT_FALSE (b->offset == 0))
+    return;
+
+  hash >>= session_table->log2_nbuckets;
+  v = clib_bihash_get_value_16_8 (session_table, b->offset);
+  v += (b->linear_search == 0) ? hash & ((1 << b->log2_pages) - 1) : 0;
+  CLIB_PREFETCH (v, CLIB_CACHE_LINE_BYTES, LOAD);
+}
+
+static_always_inline void
+pppoeclient_lookup_session_with_hash (clib_bihash_16_8_t * session_table,
+                                      clib_bihash_kv_16_8_t * kv,
+                                      u64 hash,
+                                      pppoe_client_result_t * result0)
+{
+  clib_bihash_bucket_16_8_t *b;
+  clib_bihash_value_16_8_t *v;
+  int i, limit;
+
+  result0->raw = ~0ULL;
+
+  b = &session_table->buckets[hash & (session_table->nbuckets - 1)];
+  if (PREDICT_FALSE (b->offset == 0))
+    return;
+
+  hash >>= session_table->log2_nbuckets;
+  v = clib_bihash_get_value_16_8 (session_table, b->offset);
+
+  /* If the bucket has unresolvable collisions, use linear search */
+  limit = ARRAY_LEN (v->kvp);
+  v += (b->linear_search == 0) ? hash & ((1 << b->log2_pages) - 1) : 0;
+  if (PREDICT_FALSE (b->linear_search))
+    limit <<= b->log2_pages;
+
+  for (i = 0; i < limit; i++)
+    {
+      if (clib_bihash_key_compare_16_8 (v->kvp[i].key, kv->key))
+        {
+          result0->raw = v->kvp[i].value;
+          return;
+        }
+    }
 }
 
 #endif /* _PPPOE_H */
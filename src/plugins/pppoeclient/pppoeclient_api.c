@@ -66,7 +66,11 @@ setup_message_id_table (pppoeclient_main_t * pem, api_main_t * am)
 
 #define foreach_pppoeclient_plugin_api_msg                             \
 _(PPPOE_ADD_DEL_CLIENT, pppoe_add_del_client)                           \
-_(PPPOE_CLIENT_DUMP, pppoe_client_dump)
+_(PPPOE_ADD_DEL_CLIENTS, pppoe_add_del_clients)                         \
+_(PPPOE_CLIENT_DUMP, pppoe_client_dump)                                 \
+_(PPPOE_CLIENT_SET_DISCOVERY_PARAMS, pppoe_client_set_discovery_params) \
+_(PPPOE_CLIENT_DISCOVERY_STATS, pppoe_client_discovery_stats)           \
+_(WANT_PPPOE_CLIENT_EVENTS, want_pppoe_client_events)
 
 static void vl_api_pppoe_add_del_client_t_handler
   (vl_api_pppoe_add_del_client_t * mp)
@@ -92,33 +96,131 @@ static void vl_api_pppoe_add_del_client_t_handler
   /* *INDENT-ON* */
 }
 
+/* NUL terminated vector of a fixed size api string, 0 if empty */
+static u8 *
+pppoe_client_api_string (u8 * s, u32 size)
+{
+  u32 len = strnlen ((char *) s, size);
+  u8 *v = 0;
+
+  if (len == 0)
+    return 0;
+  vec_add (v, s, len);
+  vec_add1 (v, 0);
+  return v;
+}
+
+/*
+ * Clients are done in order under the one barrier the handler runs
+ * in, the first failure stops the batch and the reply tells how many
+ * got done.
+ */
+static void vl_api_pppoe_add_del_clients_t_handler
+  (vl_api_pppoe_add_del_clients_t * mp)
+{
+  vl_api_pppoe_add_del_clients_reply_t *rmp;
+  int rv = 0;
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  vl_api_pppoe_client_config_t *cfg;
+  u32 *pppox_sw_if_indices = 0;
+  u32 count = ntohl (mp->count);
+  u32 i;
+
+  /* clients must all be within the message */
+  if (sizeof (*mp) + (u64) count * sizeof (mp->clients[0]) >
+      vl_msg_api_get_msg_length (mp))
+    {
+      rv = VNET_API_ERROR_INVALID_VALUE;
+      count = 0;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      u32 pppox_sw_if_index = ~0;
+
+      cfg = &mp->clients[i];
+      vnet_pppoe_add_del_client_args_t a = {
+	.is_add = mp->is_add,
+	.sw_if_index = ntohl (cfg->sw_if_index),
+	.host_uniq = ntohl (cfg->host_uniq),
+      };
+      if (mp->is_add)
+	{
+	  a.username = pppoe_client_api_string (cfg->username,
+						sizeof (cfg->username));
+	  if (a.username)
+	    a.password = pppoe_client_api_string (cfg->password,
+						  sizeof (cfg->password));
+	  if (a.username && !a.password)
+	    vec_add1 (a.password, 0);
+	}
+
+      rv = vnet_pppoe_add_del_client (&a, &pppox_sw_if_index);
+      vec_free (a.username);
+      vec_free (a.password);
+      if (rv)
+	break;
+      vec_add1 (pppox_sw_if_indices, pppox_sw_if_index);
+    }
+
+  /* *INDENT-OFF* */
+  REPLY_MACRO3(VL_API_PPPOE_ADD_DEL_CLIENTS_REPLY,
+	       vec_len (pppox_sw_if_indices) * sizeof (u32),
+  ({
+    rmp->count = htonl (vec_len (pppox_sw_if_indices));
+    for (i = 0; i < vec_len (pppox_sw_if_indices); i++)
+      rmp->pppox_sw_if_index[i] = htonl (pppox_sw_if_indices[i]);
+  }));
+  /* *INDENT-ON* */
+
+  vec_free (pppox_sw_if_indices);
+}
+
 static void send_pppoe_client_details
   (pppoe_client_t * t, unix_shared_memory_queue_t * q, u32 context)
 {
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  vnet_interface_main_t *im = &pem->vnet_main->interface_main;
+  pppoe_client_cp_t *cp = pppoe_client_get_cp (pem, t);
   vl_api_pppoe_client_details_t *rmp;
-  /* ip4_main_t *im4 = &ip4_main; */
-  /* ip6_main_t *im6 = &ip6_main; */
+  vlib_counter_t rx, tx;
+  u32 our_addr = 0, his_addr = 0;
+  u16 mtu = 0;
+
+  static int (*pppox_get_session_info_func) (u32, u32 *, u32 *, u16 *) = 0;
+  if (pppox_get_session_info_func == 0)
+    pppox_get_session_info_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_get_session_info");
+  (*pppox_get_session_info_func) (t->pppox_sw_if_index, &our_addr,
+				  &his_addr, &mtu);
+
+  vlib_get_combined_counter
+    (&im->combined_sw_if_counters[VNET_INTERFACE_COUNTER_RX],
+     t->pppox_sw_if_index, &rx);
+  vlib_get_combined_counter
+    (&im->combined_sw_if_counters[VNET_INTERFACE_COUNTER_TX],
+     t->pppox_sw_if_index, &tx);
 
   rmp = vl_msg_api_alloc (sizeof (*rmp));
   memset (rmp, 0, sizeof (*rmp));
-  rmp->_vl_msg_id = ntohs (VL_API_PPPOE_CLIENT_DETAILS);
-  /* if (is_ipv6) */
-  /*   { */
-  /*     memcpy (rmp->client_ip, t->client_ip.ip6.as_u8, 16); */
-  /*     rmp->decap_vrf_id = htonl (im6->fibs[t->decap_fib_index].ft_table_id); */
-  /*   } */
-  /* else */
-  /*   { */
-  /*     memcpy (rmp->client_ip, t->client_ip.ip4.as_u8, 4); */
-  /*     rmp->decap_vrf_id = htonl (im4->fibs[t->decap_fib_index].ft_table_id); */
-  /*   } */
-  /* rmp->session_id = htons (t->session_id); */
-  /* rmp->encap_if_index = htonl (t->encap_if_index); */
-  /* clib_memcpy (rmp->local_mac, t->local_mac, 6); */
-  /* clib_memcpy (rmp->client_mac, t->client_mac, 6); */
-  /* rmp->sw_if_index = htonl (t->sw_if_index); */
-  /* rmp->is_ipv6 = is_ipv6; */
-  /* rmp->context = context; */
+  rmp->_vl_msg_id = ntohs (VL_API_PPPOE_CLIENT_DETAILS + pem->msg_id_base);
+  rmp->context = context;
+  rmp->sw_if_index = htonl (t->sw_if_index);
+  rmp->host_uniq = htonl (cp->host_uniq);
+  rmp->pppox_sw_if_index = htonl (t->pppox_sw_if_index);
+  rmp->state = cp->state;
+  rmp->session_id = htons (t->session_id);
+  clib_memcpy (rmp->ac_mac_address, cp->ac_mac_address, 6);
+  /* pppd keeps the addresses in network order */
+  clib_memcpy (rmp->local_ip, &our_addr, 4);
+  clib_memcpy (rmp->remote_ip, &his_addr, 4);
+  rmp->mru = htons (pppoe_client_mru (cp));
+  rmp->mtu = htons (mtu);
+  rmp->lcp_echo_replied = htonl (t->lcp_echo_replied);
+  rmp->rx_packets = clib_host_to_net_u64 (rx.packets);
+  rmp->rx_bytes = clib_host_to_net_u64 (rx.bytes);
+  rmp->tx_packets = clib_host_to_net_u64 (tx.packets);
+  rmp->tx_bytes = clib_host_to_net_u64 (tx.bytes);
 
   vl_msg_api_send_shmem (q, (u8 *) & rmp);
 }
@@ -129,7 +231,7 @@ vl_api_pppoe_client_dump_t_handler (vl_api_pppoe_client_dump_t * mp)
   unix_shared_memory_queue_t *q;
   pppoeclient_main_t *pem = &pppoeclient_main;
   pppoe_client_t *t;
-  //u32 sw_if_index;
+  u32 sw_if_index;
 
   q = vl_api_client_index_to_input_queue (mp->client_index);
   if (q == 0)
@@ -137,13 +239,173 @@ vl_api_pppoe_client_dump_t_handler (vl_api_pppoe_client_dump_t * mp)
       return;
     }
 
-  // TODO: use query para. sw_if_index = ntohl (mp->sw_if_index);
+  sw_if_index = ntohl (mp->sw_if_index);
+  /* *INDENT-OFF* */
   pool_foreach (t, pem->clients,
-		({
-		  send_pppoe_client_details(t, q, mp->context);
-		}));
+  ({
+    if (sw_if_index == ~0 || t->sw_if_index == sw_if_index)
+      send_pppoe_client_details (t, q, mp->context);
+  }));
+  /* *INDENT-ON* */
 }
 
+static void vl_api_pppoe_client_set_discovery_params_t_handler
+  (vl_api_pppoe_client_set_discovery_params_t * mp)
+{
+  vl_api_pppoe_client_set_discovery_params_reply_t *rmp;
+  int rv = 0;
+  pppoeclient_main_t *pem = &pppoeclient_main;
+
+  rv = pppoe_client_set_discovery_params
+    ((f64) ntohl (mp->rate), (f64) ntohl (mp->burst),
+     ntohl (mp->max_in_flight),
+     ntohl (mp->backoff_min_ms) * 1e-3, ntohl (mp->backoff_max_ms) * 1e-3);
+
+  REPLY_MACRO (VL_API_PPPOE_CLIENT_SET_DISCOVERY_PARAMS_REPLY);
+}
+
+static void vl_api_pppoe_client_discovery_stats_t_handler
+  (vl_api_pppoe_client_discovery_stats_t * mp)
+{
+  vl_api_pppoe_client_discovery_stats_reply_t *rmp;
+  int rv = 0;
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_discovery_scheduler_t *ds = &pem->discovery;
+
+  /* *INDENT-OFF* */
+  REPLY_MACRO2(VL_API_PPPOE_CLIENT_DISCOVERY_STATS_REPLY,
+  ({
+    int i;
+
+    rmp->in_flight = htonl (ds->in_flight);
+    rmp->padi_sent = clib_host_to_net_u64 (ds->padi_sent);
+    rmp->throttled_rate = clib_host_to_net_u64 (ds->throttled_rate);
+    rmp->throttled_in_flight = clib_host_to_net_u64 (ds->throttled_in_flight);
+    for (i = 0; i < PPPOE_CLIENT_RECONNECT_N_BUCKETS; i++)
+      rmp->reconnect_histogram[i] = htonl (ds->reconnect_histogram[i]);
+  }));
+  /* *INDENT-ON* */
+}
+
+static void vl_api_want_pppoe_client_events_t_handler
+  (vl_api_want_pppoe_client_events_t * mp)
+{
+  vl_api_want_pppoe_client_events_reply_t *rmp;
+  int rv = 0;
+  pppoeclient_main_t *pem = &pppoeclient_main;
+  pppoe_client_event_registration_t *rp;
+  uword *p;
+
+  p = hash_get (pem->event_registration_hash, mp->client_index);
+  if (mp->enable_disable)
+    {
+      if (p)
+	{
+	  rv = VNET_API_ERROR_INVALID_REGISTRATION;
+	  goto reply;
+	}
+      pool_get (pem->event_registrations, rp);
+      rp->client_index = mp->client_index;
+      rp->client_pid = ntohl (mp->pid);
+      hash_set (pem->event_registration_hash, rp->client_index,
+		rp - pem->event_registrations);
+    }
+  else
+    {
+      if (!p)
+	{
+	  rv = VNET_API_ERROR_INVALID_REGISTRATION;
+	  goto reply;
+	}
+      pool_put_index (pem->event_registrations, p[0]);
+      hash_unset (pem->event_registration_hash, mp->client_index);
+    }
+
+reply:
+  REPLY_MACRO (VL_API_WANT_PPPOE_CLIENT_EVENTS_REPLY);
+}
+
+/*
+ * Send the events recorded by pppoe_client_notify, called by
+ * pppoe-client-process at the end of a wakeup. A subscriber whose
+ * queue is full misses the events, one which went away is dropped.
+ */
+void
+pppoe_client_send_events (pppoeclient_main_t * pem)
+{
+  pppoe_client_event_registration_t *rp;
+  vl_api_pppoe_client_event_t *mp, template;
+  unix_shared_memory_queue_t *q;
+  u32 *dead = 0, *i, *ci;
+  pppoe_client_t *c;
+  pppoe_client_cp_t *cp;
+  u32 our_addr, his_addr;
+  u16 mtu;
+
+  static int (*pppox_get_session_info_func) (u32, u32 *, u32 *, u16 *) = 0;
+  if (pppox_get_session_info_func == 0)
+    pppox_get_session_info_func =
+      vlib_get_plugin_symbol ("pppox_plugin.so", "pppox_get_session_info");
+
+  vec_foreach (ci, pem->event_clients)
+  {
+    if (pool_is_free_index (pem->clients, ci[0]))
+      continue;
+    c = pool_elt_at_index (pem->clients, ci[0]);
+    cp = pppoe_client_get_cp (pem, c);
+    /* slot reused by a client added since */
+    if (cp->pending_events == 0)
+      continue;
+
+    our_addr = his_addr = 0;
+    (*pppox_get_session_info_func) (c->pppox_sw_if_index, &our_addr,
+				    &his_addr, &mtu);
+
+    memset (&template, 0, sizeof (template));
+    template._vl_msg_id = htons (VL_API_PPPOE_CLIENT_EVENT
+				 + pem->msg_id_base);
+    template.sw_if_index = htonl (c->sw_if_index);
+    template.host_uniq = htonl (cp->host_uniq);
+    template.pppox_sw_if_index = htonl (c->pppox_sw_if_index);
+    template.events = htonl (cp->pending_events);
+    template.state = cp->state;
+    template.session_id = htons (c->session_id);
+    clib_memcpy (template.ac_mac_address, cp->ac_mac_address, 6);
+    clib_memcpy (template.local_ip, &our_addr, 4);
+    clib_memcpy (template.remote_ip, &his_addr, 4);
+    cp->pending_events = 0;
+
+    /* *INDENT-OFF* */
+    pool_foreach (rp, pem->event_registrations,
+    ({
+      q = vl_api_client_index_to_input_queue (rp->client_index);
+      if (!q)
+	{
+	  vec_add1 (dead, rp - pem->event_registrations);
+	  continue;
+	}
+      if (q->cursize >= q->maxsize)
+	continue;
+      mp = vl_msg_api_alloc (sizeof (*mp));
+      clib_memcpy (mp, &template, sizeof (*mp));
+      mp->client_index = rp->client_index;
+      mp->pid = htonl (rp->client_pid);
+      vl_msg_api_send_shmem (q, (u8 *) & mp);
+    }));
+    /* *INDENT-ON* */
+
+    vec_foreach (i, dead)
+    {
+      rp = pool_elt_at_index (pem->event_registrations, i[0]);
+      hash_unset (pem->event_registration_hash, rp->client_index);
+      pool_put (pem->event_registrations, rp);
+    }
+    vec_reset_length (dead);
+  }
+
+  vec_reset_length (pem->event_clients);
+  vec_free (dead);
+}
 
 static clib_error_t *
 pppoeclient_api_hookup (vlib_main_t * vm)
@@ -0,0 +1,696 @@
+/*
+ * bundle.c - flows of one interface spread over pppox interfaces.
+ *
+ * Copyright (c) 2017 RaydoNetworks.
+ */
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vnet/ppp/packet.h>
+
+#include <pppox/pppox.h>
+#include <pppox/pppd/pppd.h>
+#include <pppox/pppd/magic.h>
+#include <pppox/pppd/unit.h>
+
+/*
+ * A bundle is a p2p interface of its own, routes point to it as to any
+ * pppox interface. Its adjacencies only prepend the ppp protocol, the
+ * bundle output node then hashes the flow to a bucket and puts the
+ * pppoe encap of the member owning it, see node.c.
+ */
+
+static u8 *
+format_pppox_bundle_name (u8 * s, va_list * args)
+{
+  u32 dev_instance = va_arg (*args, u32);
+  return format (s, "pppox-bundle%d", dev_instance);
+}
+
+static uword
+dummy_bundle_tx (vlib_main_t * vm,
+                 vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  clib_warning ("you shouldn't be here, leaking buffers...");
+  return frame->n_vectors;
+}
+
+static clib_error_t *
+pppox_bundle_admin_up_down (vnet_main_t * vnm, u32 hw_if_index, u32 flags)
+{
+  u32 hw_flags = (flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) ?
+    VNET_HW_INTERFACE_FLAG_LINK_UP : 0;
+  vnet_hw_interface_set_flags (vnm, hw_if_index, hw_flags);
+
+  return /* no error */ 0;
+}
+
+static u8 *
+pppox_bundle_build_rewrite (vnet_main_t * vnm,
+                            u32 sw_if_index,
+                            vnet_link_t link_type, const void *dst_address)
+{
+  u8 *rw = 0;
+
+  vec_validate (rw, 1);
+
+  switch (link_type)
+    {
+    case VNET_LINK_IP4:
+      *((u16 *) rw) = clib_host_to_net_u16(PPP_PROTOCOL_ip4);
+      break;
+    case VNET_LINK_IP6:
+      *((u16 *) rw) = clib_host_to_net_u16(PPP_PROTOCOL_ip6);
+      break;
+    default:
+      break;
+    }
+
+  return rw;
+}
+
+/* *INDENT-OFF* */
+VNET_DEVICE_CLASS (pppox_bundle_device_class,static) = {
+  .name = "PPPOX bundle",
+  .format_device_name = format_pppox_bundle_name,
+  .tx_function = dummy_bundle_tx,
+  .admin_up_down_function = pppox_bundle_admin_up_down,
+};
+/* *INDENT-ON* */
+
+VNET_HW_INTERFACE_CLASS (pppox_bundle_hw_class,static) = {
+  .name = "PPPOX bundle",
+  .build_rewrite = pppox_bundle_build_rewrite,
+  .flags = VNET_HW_INTERFACE_CLASS_FLAG_P2P,
+};
+
+static pppox_bundle_t *
+pppox_bundle_get (u32 sw_if_index)
+{
+  pppox_main_t *pom = &pppox_main;
+
+  if (sw_if_index >= vec_len (pom->bundle_index_by_sw_if_index)
+      || pom->bundle_index_by_sw_if_index[sw_if_index] == ~0)
+    return 0;
+
+  return pool_elt_at_index (pom->bundles,
+                            pom->bundle_index_by_sw_if_index[sw_if_index]);
+}
+
+/*
+ * Hand out the buckets to the up members following their weights.
+ * Buckets of a member keep their owner as long as it stays up and is
+ * not over its share, so adding or pulling out a member only moves the
+ * flows it gains or loses. Called under the barrier.
+ */
+static void
+pppox_bundle_rebuild (pppox_bundle_t * b)
+{
+  pppox_bundle_member_t *m;
+  u32 *target = 0, *count = 0;
+  u32 total = 0, given = 0, n_up = 0, mi, i;
+  u16 mtu = 0xffff;
+
+  /* *INDENT-OFF* */
+  pool_foreach (m, b->members,
+  ({
+    if (m->is_up)
+      {
+        total += m->weight;
+        n_up++;
+        mtu = clib_min (mtu, m->mtu);
+      }
+  }));
+  /* *INDENT-ON* */
+  b->n_up = n_up;
+  if (n_up == 0)
+    mtu = PPPOX_PPPOE_MAX_MRU;
+  // fragments fit the smallest member, packets up to the mrru.
+  b->fragment_max = mtu - PPPOX_MP_HDR_LEN;
+  b->mtu = (b->mrru && n_up) ? b->mrru : mtu;
+
+  if (n_up == 0 || total == 0)
+    {
+      vec_reset_length (b->buckets);
+      return;
+    }
+
+  vec_validate_init_empty (target, vec_len (b->members) - 1, 0);
+  vec_validate_init_empty (count, vec_len (b->members) - 1, 0);
+
+  /* *INDENT-OFF* */
+  pool_foreach (m, b->members,
+  ({
+    if (m->is_up)
+      {
+        mi = m - b->members;
+        target[mi] = (u64) PPPOX_BUNDLE_N_BUCKETS * m->weight / total;
+        given += target[mi];
+      }
+  }));
+  /* rounding leftovers go one each to the first up members */
+  pool_foreach (m, b->members,
+  ({
+    if (m->is_up && given < PPPOX_BUNDLE_N_BUCKETS)
+      {
+        target[m - b->members]++;
+        given++;
+      }
+  }));
+  /* *INDENT-ON* */
+
+  if (vec_len (b->buckets) != PPPOX_BUNDLE_N_BUCKETS)
+    vec_validate_init_empty (b->buckets, PPPOX_BUNDLE_N_BUCKETS - 1, ~0);
+  // multilink picks buckets by sequence number, no flow to keep, and
+  // handing all out again interleaves the members.
+  if (b->mrru)
+    memset (b->buckets, 0xff, PPPOX_BUNDLE_N_BUCKETS * sizeof (u32));
+
+  /* keep what still belongs to its owner */
+  for (i = 0; i < PPPOX_BUNDLE_N_BUCKETS; i++)
+    {
+      mi = b->buckets[i];
+      if (mi < vec_len (target) && count[mi] < target[mi])
+        count[mi]++;
+      else
+        b->buckets[i] = ~0;
+    }
+
+  /* hand out the rest round robin, so a share is spread evenly */
+  mi = 0;
+  for (i = 0; i < PPPOX_BUNDLE_N_BUCKETS; i++)
+    {
+      if (b->buckets[i] != ~0)
+        continue;
+      while (count[mi] >= target[mi])
+        mi = (mi + 1) % vec_len (target);
+      b->buckets[i] = mi;
+      count[mi]++;
+      mi = (mi + 1) % vec_len (target);
+    }
+
+  vec_free (target);
+  vec_free (count);
+}
+
+/*
+ * Drop the fragments waiting for reassembly of the bundle on all
+ * threads and start over, or free the reassembly when the bundle goes
+ * away. Called under the barrier.
+ */
+static void
+pppox_bundle_mp_reset (pppox_bundle_t * b, int is_free)
+{
+  pppox_main_t *pom = &pppox_main;
+  vlib_main_t *vm = pom->vlib_main;
+  u32 bundle_index = b - pom->bundles;
+  pppox_per_thread_t *ptd;
+  pppox_mp_reasm_t *r;
+  u32 i;
+
+  vec_foreach (ptd, pom->per_thread)
+  {
+    if (bundle_index >= vec_len (ptd->reasm) || !ptd->reasm[bundle_index])
+      continue;
+    r = ptd->reasm[bundle_index];
+    for (i = 0; i < PPPOX_MP_WINDOW; i++)
+      if (r->bi[i] != ~0)
+        {
+          vlib_buffer_free_one (vm, r->bi[i]);
+          r->bi[i] = ~0;
+        }
+    r->is_synced = 0;
+    vec_reset_length (r->member_seq);
+    if (is_free)
+      {
+        vec_free (r->member_seq);
+        clib_mem_free (r);
+        ptd->reasm[bundle_index] = 0;
+      }
+  }
+}
+
+/*
+ * Take the encap of the member session, or drop it, and redistribute
+ * the buckets. Main thread only.
+ */
+static void
+pppox_bundle_member_update (pppox_bundle_t * b, pppox_bundle_member_t * m,
+                            u8 is_up)
+{
+  pppox_main_t *pom = &pppox_main;
+  vlib_main_t *vm = pom->vlib_main;
+  vnet_main_t *vnm = pom->vnet_main;
+  pppox_virtual_interface_t *t;
+  u32 encap_sw_if_index = ~0, next_index = ~0;
+  u8 *rewrite = 0;
+
+  t = pool_elt_at_index (pom->virtual_interfaces,
+                         pom->virtual_interface_index_by_sw_if_index[m->sw_if_index]);
+
+  if (is_up)
+    {
+      static int (*pppoe_client_get_encap_func) (u32, u32 *, u8 **) = 0;
+      if (pppoe_client_get_encap_func == 0) {
+        pppoe_client_get_encap_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_get_encap");
+      }
+      is_up = (*pppoe_client_get_encap_func) (t->pppoe_client_index,
+                                              &encap_sw_if_index, &rewrite);
+    }
+  if (is_up)
+    {
+      vnet_hw_interface_t *hi =
+        vnet_get_sup_hw_interface (vnm, encap_sw_if_index);
+      // adding a next takes the barrier by itself.
+      next_index = vlib_node_add_next (vm, pppox_bundle_output_node.index,
+                                       hi->output_node_index);
+    }
+
+  vlib_worker_thread_barrier_sync (vm);
+  vec_free (m->rewrite);
+  m->is_up = is_up;
+  m->rewrite = rewrite;
+  m->encap_sw_if_index = encap_sw_if_index;
+  m->encap_next_index = next_index;
+  m->mtu = t->mtu;
+  pppox_bundle_rebuild (b);
+  vlib_worker_thread_barrier_release (vm);
+}
+
+typedef struct
+{
+  u32 sw_if_index;
+  u8 is_up;
+} bundle_member_arg_t;
+
+static void *
+pppox_bundle_member_up_down_callback (void *arg)
+{
+  pppox_main_t *pom = &pppox_main;
+  bundle_member_arg_t *a = arg;
+  pppox_virtual_interface_t *t;
+  pppox_bundle_member_t *m;
+  pppox_bundle_t *b;
+  u32 unit;
+
+  if (a->sw_if_index >= vec_len (pom->virtual_interface_index_by_sw_if_index))
+    return 0;
+  unit = pom->virtual_interface_index_by_sw_if_index[a->sw_if_index];
+  if (unit == ~0)
+    return 0;
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  if (t->bundle_index == ~0)
+    return 0;
+  b = pool_elt_at_index (pom->bundles, t->bundle_index);
+
+  /* *INDENT-OFF* */
+  pool_foreach (m, b->members,
+  ({
+    if (m->sw_if_index == a->sw_if_index && m->is_up != a->is_up)
+      pppox_bundle_member_update (b, m, a->is_up);
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+void vl_api_rpc_call_main_thread (void *fp, u8 * data, u32 data_length);
+
+// Called when IPCP of a pppox interface is up, and when it goes down
+// with LCP. Might be called in worker thread, so use rpc.
+void
+pppox_bundle_member_up_down (u32 sw_if_index, u8 is_up)
+{
+  bundle_member_arg_t a;
+
+  a.sw_if_index = sw_if_index;
+  a.is_up = is_up;
+  vl_api_rpc_call_main_thread (pppox_bundle_member_up_down_callback,
+                               (u8 *) & a, sizeof (a));
+}
+
+/*
+ * Multilink settings of a member, its LCP asks for them on the next
+ * negotiation. b is 0 when the member leaves the bundle.
+ */
+static void
+pppox_bundle_member_set_multilink (pppox_bundle_t * b,
+                                   pppox_virtual_interface_t * t)
+{
+  t->ppp->multilink = b && b->mrru;
+  t->ppp->mrru = b ? b->mrru : 0;
+  t->ppp->endpoint_magic = b ? b->endpoint_magic : 0;
+}
+
+int
+pppox_bundle_add_del_member (u32 bundle_sw_if_index, u32 sw_if_index,
+                             u32 weight, u8 is_add)
+{
+  pppox_main_t *pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  pppox_bundle_member_t *m;
+  pppox_bundle_t *b;
+  u32 unit;
+
+  b = pppox_bundle_get (bundle_sw_if_index);
+  if (b == 0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  if (sw_if_index >= vec_len (pom->virtual_interface_index_by_sw_if_index))
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX_2;
+  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  if (unit == ~0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX_2;
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+
+  if (is_add)
+    {
+      if (weight == 0 || weight > PPPOX_BUNDLE_N_BUCKETS)
+        return VNET_API_ERROR_INVALID_VALUE;
+      if (t->bundle_index != ~0 && t->bundle_index != b - pom->bundles)
+        return VNET_API_ERROR_VALUE_EXIST;
+
+      /* *INDENT-OFF* */
+      pool_foreach (m, b->members,
+      ({
+        if (m->sw_if_index == sw_if_index)
+          {
+            /* a new weight for a member */
+            m->weight = weight;
+            vlib_worker_thread_barrier_sync (pom->vlib_main);
+            pppox_bundle_rebuild (b);
+            vlib_worker_thread_barrier_release (pom->vlib_main);
+            return 0;
+          }
+      }));
+      /* *INDENT-ON* */
+
+      vlib_worker_thread_barrier_sync (pom->vlib_main);
+      pool_get (b->members, m);
+      vlib_worker_thread_barrier_release (pom->vlib_main);
+      memset (m, 0, sizeof (*m));
+      m->sw_if_index = sw_if_index;
+      m->weight = weight;
+      m->encap_sw_if_index = ~0;
+      t->bundle_index = b - pom->bundles;
+      t->bundle_member_index = m - b->members;
+      pppox_bundle_member_set_multilink (b, t);
+
+      // a member with IPCP up already joins right away, a multilink
+      // one has to renegotiate LCP first.
+      if (t->our_addr && !b->mrru)
+        pppox_bundle_member_update (b, m, 1);
+      return 0;
+    }
+
+  if (t->bundle_index != b - pom->bundles)
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+  /* *INDENT-OFF* */
+  pool_foreach (m, b->members,
+  ({
+    if (m->sw_if_index == sw_if_index)
+      {
+        if (m->mp_joined && b->ncp_sw_if_index == sw_if_index)
+          b->ncp_sw_if_index = ~0;
+        vlib_worker_thread_barrier_sync (pom->vlib_main);
+        vec_free (m->rewrite);
+        pool_put (b->members, m);
+        pppox_bundle_rebuild (b);
+        pppox_bundle_mp_reset (b, 0);
+        t->bundle_index = ~0;
+        t->bundle_member_index = ~0;
+        vlib_worker_thread_barrier_release (pom->vlib_main);
+        pppox_bundle_member_set_multilink (0, t);
+        return 0;
+      }
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+int
+pppox_bundle_set_multilink (u32 sw_if_index, u16 mrru, u16 fragment_min)
+{
+  pppox_main_t *pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  pppox_bundle_member_t *m;
+  pppox_bundle_t *b;
+
+  b = pppox_bundle_get (sw_if_index);
+  if (b == 0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+  // an mrru below the minimum of RFC 1661 makes no sense.
+  if (mrru && mrru < 128)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  vlib_worker_thread_barrier_sync (pom->vlib_main);
+  b->mrru = mrru;
+  b->fragment_min = fragment_min ? fragment_min : PPPOX_MP_FRAGMENT_MIN;
+  pppox_bundle_mp_reset (b, 0);
+  pppox_bundle_rebuild (b);
+  vlib_worker_thread_barrier_release (pom->vlib_main);
+
+  /* *INDENT-OFF* */
+  pool_foreach (m, b->members,
+  ({
+    t = pool_elt_at_index (pom->virtual_interfaces,
+                           pom->virtual_interface_index_by_sw_if_index[m->sw_if_index]);
+    pppox_bundle_member_set_multilink (b, t);
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+/*
+ * A multilink member is authenticated, it starts to carry fragments.
+ * The first one to join runs the NCPs and gets control packets that
+ * come reassembled. Returns whether another member joined before.
+ * Main thread only, it is called by pppd.
+ */
+int
+pppox_bundle_mp_join (u32 sw_if_index)
+{
+  pppox_main_t *pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  pppox_bundle_member_t *m, *m0;
+  pppox_bundle_t *b;
+  int joined = 0;
+
+  t = pool_elt_at_index (pom->virtual_interfaces,
+                         pom->virtual_interface_index_by_sw_if_index[sw_if_index]);
+  if (t->bundle_index == ~0)
+    return 0;
+  b = pool_elt_at_index (pom->bundles, t->bundle_index);
+  m0 = pool_elt_at_index (b->members, t->bundle_member_index);
+
+  /* *INDENT-OFF* */
+  pool_foreach (m, b->members,
+  ({
+    if (m != m0 && m->mp_joined)
+      joined = 1;
+  }));
+  /* *INDENT-ON* */
+
+  m0->mp_joined = 1;
+  if (!joined)
+    b->ncp_sw_if_index = sw_if_index;
+  pppox_bundle_member_up_down (sw_if_index, 1);
+
+  return joined;
+}
+
+void
+pppox_bundle_mp_leave (u32 sw_if_index)
+{
+  pppox_main_t *pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  pppox_bundle_member_t *m;
+  pppox_bundle_t *b;
+
+  t = pool_elt_at_index (pom->virtual_interfaces,
+                         pom->virtual_interface_index_by_sw_if_index[sw_if_index]);
+  if (t->bundle_index == ~0)
+    return;
+  b = pool_elt_at_index (pom->bundles, t->bundle_index);
+  m = pool_elt_at_index (b->members, t->bundle_member_index);
+
+  if (!m->mp_joined)
+    return;
+  m->mp_joined = 0;
+  if (b->ncp_sw_if_index == sw_if_index)
+    b->ncp_sw_if_index = ~0;
+  pppox_bundle_member_up_down (sw_if_index, 0);
+}
+
+int
+pppox_bundle_add_del (u32 sw_if_index, u8 is_add, u32 * sw_if_indexp)
+{
+  pppox_main_t *pom = &pppox_main;
+  vnet_main_t *vnm = pom->vnet_main;
+  pppox_bundle_member_t *m;
+  vnet_hw_interface_t *hi;
+  vnet_sw_interface_t *si;
+  pppox_bundle_t *b;
+  u32 hw_if_index, n_workers;
+
+  if (!is_add)
+    {
+      u32 *members = 0, *mp;
+
+      b = pppox_bundle_get (sw_if_index);
+      if (b == 0)
+        return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+      /* *INDENT-OFF* */
+      pool_foreach (m, b->members,
+      ({
+        vec_add1 (members, m->sw_if_index);
+      }));
+      /* *INDENT-ON* */
+      vec_foreach (mp, members)
+        pppox_bundle_add_del_member (sw_if_index, *mp, 0, 0);
+      vec_free (members);
+
+      vnet_sw_interface_set_flags (vnm, sw_if_index, 0 /* down */ );
+      pppox_mss_clamp_enable_disable (sw_if_index, 0);
+      ip4_sw_interface_enable_disable (sw_if_index, 0);
+      ip6_sw_interface_enable_disable (sw_if_index, 0);
+      si = vnet_get_sw_interface (vnm, sw_if_index);
+      si->flags |= VNET_SW_INTERFACE_FLAG_HIDDEN;
+      vec_add1 (pom->free_bundle_hw_if_indices, b->hw_if_index);
+      pom->bundle_index_by_sw_if_index[sw_if_index] = ~0;
+
+      vlib_worker_thread_barrier_sync (pom->vlib_main);
+      pppox_bundle_mp_reset (b, 1);
+      pool_free (b->members);
+      vec_free (b->buckets);
+      pool_put (pom->bundles, b);
+      vlib_worker_thread_barrier_release (pom->vlib_main);
+      return 0;
+    }
+
+  // the bundle output node reads the pool from workers.
+  vlib_worker_thread_barrier_sync (pom->vlib_main);
+  pool_get_aligned (pom->bundles, b, CLIB_CACHE_LINE_BYTES);
+  vlib_worker_thread_barrier_release (pom->vlib_main);
+  memset (b, 0, sizeof (*b));
+  b->mtu = PPPOX_PPPOE_MAX_MRU;
+  b->fragment_min = PPPOX_MP_FRAGMENT_MIN;
+  b->endpoint_magic = magic ();
+  b->ncp_sw_if_index = ~0;
+  // workers only, main thread does not poll the frame queues.
+  n_workers = vlib_get_thread_main ()->n_vlib_mains - 1;
+  b->thread_index = n_workers ? 1 + (b - pom->bundles) % n_workers : 0;
+
+  if (vec_len (pom->free_bundle_hw_if_indices) > 0)
+    {
+      vnet_interface_main_t *im = &vnm->interface_main;
+      hw_if_index = pom->free_bundle_hw_if_indices
+        [vec_len (pom->free_bundle_hw_if_indices) - 1];
+      _vec_len (pom->free_bundle_hw_if_indices) -= 1;
+
+      hi = vnet_get_hw_interface (vnm, hw_if_index);
+      hi->dev_instance = b - pom->bundles;
+      hi->hw_instance = hi->dev_instance;
+
+      /* clear old stats of freed bundle before reuse */
+      vnet_interface_counter_lock (im);
+      vlib_zero_combined_counter
+        (&im->combined_sw_if_counters[VNET_INTERFACE_COUNTER_TX],
+         hi->sw_if_index);
+      vlib_zero_combined_counter
+        (&im->combined_sw_if_counters[VNET_INTERFACE_COUNTER_RX],
+         hi->sw_if_index);
+      vlib_zero_simple_counter
+        (&im->sw_if_counters[VNET_INTERFACE_COUNTER_DROP], hi->sw_if_index);
+      vnet_interface_counter_unlock (im);
+    }
+  else
+    {
+      hw_if_index = vnet_register_interface
+        (vnm, pppox_bundle_device_class.index, b - pom->bundles,
+         pppox_bundle_hw_class.index, b - pom->bundles);
+      hi = vnet_get_hw_interface (vnm, hw_if_index);
+      hi->output_node_index = pppox_bundle_output_node.index;
+    }
+
+  b->hw_if_index = hw_if_index;
+  b->sw_if_index = hi->sw_if_index;
+
+  vlib_worker_thread_barrier_sync (pom->vlib_main);
+  vec_validate_init_empty (pom->bundle_index_by_sw_if_index,
+                           b->sw_if_index, ~0);
+  vlib_worker_thread_barrier_release (pom->vlib_main);
+  pom->bundle_index_by_sw_if_index[b->sw_if_index] = b - pom->bundles;
+
+  si = vnet_get_sw_interface (vnm, b->sw_if_index);
+  si->flags &= ~VNET_SW_INTERFACE_FLAG_HIDDEN;
+  vnet_sw_interface_set_flags (vnm, b->sw_if_index,
+                               VNET_SW_INTERFACE_FLAG_ADMIN_UP);
+  pppox_mss_clamp_enable_disable (b->sw_if_index, 1);
+  // multilink packets come reassembled on the bundle itself.
+  ip4_sw_interface_enable_disable (b->sw_if_index, 1);
+  ip6_sw_interface_enable_disable (b->sw_if_index, 1);
+
+  if (sw_if_indexp)
+    *sw_if_indexp = b->sw_if_index;
+
+  return 0;
+}
+
+u8 *
+format_pppox_bundle (u8 * s, va_list * args)
+{
+  pppox_bundle_t *b = va_arg (*args, pppox_bundle_t *);
+  vnet_main_t *vnm = pppox_main.vnet_main;
+  pppox_bundle_member_t *m;
+  u32 *owned = 0, *mi;
+
+  vec_validate_init_empty (owned, vec_len (b->members), 0);
+  vec_foreach (mi, b->buckets)
+    owned[*mi]++;
+
+  s = format (s, "%U mtu %d",
+              format_vnet_sw_if_index_name, vnm, b->sw_if_index, b->mtu);
+  if (b->mrru)
+    {
+      pppox_per_thread_t *ptd;
+      u64 reassembled = 0, lost = 0, late = 0;
+      u32 bundle_index = b - pppox_main.bundles;
+
+      vec_foreach (ptd, pppox_main.per_thread)
+      {
+        if (bundle_index >= vec_len (ptd->reasm) || !ptd->reasm[bundle_index])
+          continue;
+        reassembled += ptd->reasm[bundle_index]->reassembled;
+        lost += ptd->reasm[bundle_index]->lost;
+        late += ptd->reasm[bundle_index]->late;
+      }
+      s = format (s, " multilink mrru %d fragment-min %d"
+                  "\n  reassembled %lld lost %lld late %lld on thread %d",
+                  b->mrru, b->fragment_min, reassembled, lost, late,
+                  b->thread_index);
+    }
+  /* *INDENT-OFF* */
+  pool_foreach (m, b->members,
+  ({
+    s = format (s, "\n  %U weight %d %s buckets %d",
+                format_vnet_sw_if_index_name, vnm, m->sw_if_index,
+                m->weight, m->is_up ? "up" : "down",
+                owned[m - b->members]);
+  }));
+  /* *INDENT-ON* */
+
+  vec_free (owned);
+  return s;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -15,6 +15,8 @@
 #include <vnet/ppp/packet.h>
 #include <pppox/pppox.h>
 #include <pppox/pppd/pppd.h>
+#include <pppox/pppd/fsm.h>
+#include <pppox/pppd/lcp.h>
 
 static clib_error_t *
 pppox_set_auth_command_fn (vlib_main_t * vm, unformat_input_t * input,
@@ -69,3 +71,416 @@ VLIB_CLI_COMMAND (pppox_set_auth_command, static) = {
   .function = pppox_set_auth_command_fn,
 };
 /* *INDENT-ON* */
+
+static clib_error_t *
+pppox_set_lcp_echo_command_fn (vlib_main_t * vm, unformat_input_t * input,
+                               vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0;
+  u32 interval = lcp_echo_interval * 1000;
+  u32 max_interval = 0;
+  u32 failures = lcp_echo_fails;
+  int r;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "sw-if-index %d", &sw_if_index))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+                         vnm, &sw_if_index))
+	;
+      else if (unformat (line_input, "interval %d", &interval))
+	;
+      else if (unformat (line_input, "max-interval %d", &max_interval))
+	;
+      else if (unformat (line_input, "failures %d", &failures))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+  unformat_free (line_input);
+
+  r = pppox_set_lcp_echo (sw_if_index, interval, max_interval, failures);
+
+  if (r == VNET_API_ERROR_INVALID_SW_IF_INDEX)
+    return clib_error_return (0, "Invalid pppox interface");
+  if (r == VNET_API_ERROR_INVALID_VALUE)
+    return clib_error_return (0, "Interval out of range");
+
+  return 0;
+}
+
+/*?
+ * Set LCP echo keepalive of a pppox interface, intervals are in
+ * milliseconds. With a max-interval the echo is adaptive: data received
+ * from the peer counts as an echo reply, and while it keeps coming the
+ * check interval doubles up to max-interval. The link is closed after
+ * failures echo requests in a row go unanswered.
+ *
+ * @cliexpar
+ * Example of how to detect a dead AC within a second on a busy link:
+ * @cliexcmd{pppox set lcp-echo pppox0 interval 200 max-interval 1600 failures 3}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (pppox_set_lcp_echo_command, static) = {
+  .path = "pppox set lcp-echo",
+  .short_help =
+  "pppox set lcp-echo <interface> | sw-if-index <nn> [interval <ms>] "
+  "[max-interval <ms>] [failures <n>]",
+  .function = pppox_set_lcp_echo_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+pppox_set_vrf_command_fn (vlib_main_t * vm, unformat_input_t * input,
+                          vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0;
+  u32 table_id = 0;
+  u32 distance = 0;
+  u8 default_route = 0;
+  int r;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "sw-if-index %d", &sw_if_index))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+                         vnm, &sw_if_index))
+	;
+      else if (unformat (line_input, "vrf %d", &table_id))
+	;
+      else if (unformat (line_input, "default-route"))
+	default_route = 1;
+      else if (unformat (line_input, "distance %d", &distance))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+  unformat_free (line_input);
+
+  if (distance > 255)
+    return clib_error_return (0, "Distance out of range");
+
+  r = pppox_set_vrf (sw_if_index, table_id, default_route, distance);
+
+  if (r == VNET_API_ERROR_INVALID_SW_IF_INDEX)
+    return clib_error_return (0, "Invalid pppox interface");
+  if (r == VNET_API_ERROR_NO_SUCH_FIB)
+    return clib_error_return (0, "No such vrf %d", table_id);
+
+  return 0;
+}
+
+/*?
+ * Put the addresses and routes of a pppox session in a VRF, optionally
+ * with a default route through the session there. When several
+ * sessions of a VRF have one, the lowest distance up is used and the
+ * others back it up. Takes effect the next time IPCP comes up.
+ *
+ * @cliexpar
+ * Example of a tenant uplink with a backup session:
+ * @cliexcmd{pppox set vrf pppox0 vrf 10 default-route}
+ * @cliexcmd{pppox set vrf pppox1 vrf 10 default-route distance 10}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (pppox_set_vrf_command, static) = {
+  .path = "pppox set vrf",
+  .short_help =
+  "pppox set vrf <interface> | sw-if-index <nn> [vrf <id>] "
+  "[default-route [distance <n>]]",
+  .function = pppox_set_vrf_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+pppox_bundle_add_del_command_fn (vlib_main_t * vm, unformat_input_t * input,
+                                 vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0;
+  u8 is_add = 1;
+  int r;
+
+  /* Get a line of input. */
+  if (unformat_user (input, unformat_line_input, line_input))
+    {
+      while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+        {
+          if (unformat (line_input, "del %U", unformat_vnet_sw_interface,
+                        vnm, &sw_if_index))
+            is_add = 0;
+          else
+            return clib_error_return (0, "unknown input `%U'",
+                                      format_unformat_error, input);
+        }
+      unformat_free (line_input);
+    }
+
+  r = pppox_bundle_add_del (sw_if_index, is_add, &sw_if_index);
+
+  if (r == VNET_API_ERROR_INVALID_SW_IF_INDEX)
+    return clib_error_return (0, "Invalid pppox bundle");
+
+  if (is_add)
+    vlib_cli_output (vm, "%U\n", format_vnet_sw_if_index_name, vnm,
+                     sw_if_index);
+
+  return 0;
+}
+
+/*?
+ * Create a pppox bundle interface, or delete one. Flows routed to the
+ * bundle are spread over its member pppox interfaces.
+ *
+ * @cliexpar
+ * Example of how to create a bundle:
+ * @cliexcmd{create pppox bundle}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (pppox_bundle_add_del_command, static) = {
+  .path = "create pppox bundle",
+  .short_help = "create pppox bundle [del <interface>]",
+  .function = pppox_bundle_add_del_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+pppox_bundle_member_command_fn (vlib_main_t * vm, unformat_input_t * input,
+                                vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 bundle_sw_if_index = ~0, sw_if_index = ~0;
+  u32 weight = 1;
+  u8 is_add = 1;
+  int r;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "weight %d", &weight))
+	;
+      else if (unformat (line_input, "del"))
+	is_add = 0;
+      else if (bundle_sw_if_index == ~0 &&
+               unformat (line_input, "%U", unformat_vnet_sw_interface,
+                         vnm, &bundle_sw_if_index))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+                         vnm, &sw_if_index))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+  unformat_free (line_input);
+
+  r = pppox_bundle_add_del_member (bundle_sw_if_index, sw_if_index, weight,
+                                   is_add);
+
+  if (r == VNET_API_ERROR_INVALID_SW_IF_INDEX)
+    return clib_error_return (0, "Invalid pppox bundle");
+  if (r == VNET_API_ERROR_INVALID_SW_IF_INDEX_2)
+    return clib_error_return (0, "Invalid pppox interface");
+  if (r == VNET_API_ERROR_INVALID_VALUE)
+    return clib_error_return (0, "Weight out of range");
+  if (r == VNET_API_ERROR_VALUE_EXIST)
+    return clib_error_return (0, "Member of another bundle");
+  if (r == VNET_API_ERROR_NO_SUCH_ENTRY)
+    return clib_error_return (0, "Not a member of the bundle");
+
+  return 0;
+}
+
+/*?
+ * Add a pppox interface to a bundle, or delete it. A member carries its
+ * weight of the bundle buckets while IPCP is up, its flows move to the
+ * other members when LCP goes down.
+ *
+ * @cliexpar
+ * Example of how to give pppox1 twice the flows of pppox0:
+ * @cliexcmd{pppox bundle member pppox-bundle0 pppox0 weight 1}
+ * @cliexcmd{pppox bundle member pppox-bundle0 pppox1 weight 2}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (pppox_bundle_member_command, static) = {
+  .path = "pppox bundle member",
+  .short_help =
+  "pppox bundle member <bundle> <interface> [weight <n>] [del]",
+  .function = pppox_bundle_member_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+pppox_bundle_multilink_command_fn (vlib_main_t * vm, unformat_input_t * input,
+                                   vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0;
+  u32 mrru = ~0, fragment_min = 0;
+  int r;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "mrru %d", &mrru))
+	;
+      else if (unformat (line_input, "off"))
+	mrru = 0;
+      else if (unformat (line_input, "fragment-min %d", &fragment_min))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+                         vnm, &sw_if_index))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+  unformat_free (line_input);
+
+  if (mrru == ~0)
+    return clib_error_return (0, "mrru or off required");
+  if (mrru > 0xffff || fragment_min > 0xffff)
+    return clib_error_return (0, "Value out of range");
+
+  r = pppox_bundle_set_multilink (sw_if_index, mrru, fragment_min);
+
+  if (r == VNET_API_ERROR_INVALID_SW_IF_INDEX)
+    return clib_error_return (0, "Invalid pppox bundle");
+  if (r == VNET_API_ERROR_INVALID_VALUE)
+    return clib_error_return (0, "mrru out of range");
+
+  return 0;
+}
+
+/*?
+ * Turn multilink on for a bundle: its members ask for the MRRU and one
+ * endpoint discriminator when LCP comes up next. Packets are then cut
+ * in fragments of at least fragment-min bytes spread over the members,
+ * and reassembled on receive. NCPs run on the first member only.
+ *
+ * @cliexpar
+ * @cliexcmd{pppox bundle multilink pppox-bundle0 mrru 1600}
+ * @cliexcmd{pppox bundle multilink pppox-bundle0 off}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (pppox_bundle_multilink_command, static) = {
+  .path = "pppox bundle multilink",
+  .short_help =
+  "pppox bundle multilink <bundle> {mrru <n> [fragment-min <n>] | off}",
+  .function = pppox_bundle_multilink_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_pppox_bundle_command_fn (vlib_main_t * vm, unformat_input_t * input,
+                              vlib_cli_command_t * cmd)
+{
+  pppox_main_t *pom = &pppox_main;
+  pppox_bundle_t *b;
+
+  if (pool_elts (pom->bundles) == 0)
+    vlib_cli_output (vm, "No pppox bundles configured...");
+
+  /* *INDENT-OFF* */
+  pool_foreach (b, pom->bundles,
+  ({
+    vlib_cli_output (vm, "%U", format_pppox_bundle, b);
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+/*?
+ * Display the pppox bundles, with the state, weight and buckets of
+ * each member.
+ *
+ * @cliexpar
+ * @cliexstart{show pppox bundle}
+ * pppox-bundle0 mtu 1492
+ *   pppox0 weight 1 up buckets 342
+ *   pppox1 weight 2 up buckets 682
+ * pppox-bundle1 mtu 1600 multilink mrru 1600 fragment-min 256
+ *   reassembled 1200 lost 2 late 1
+ *   pppox2 weight 1 up buckets 512
+ *   pppox3 weight 1 up buckets 512
+ * @cliexend
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_pppox_bundle_command, static) = {
+  .path = "show pppox bundle",
+  .short_help = "show pppox bundle",
+  .function = show_pppox_bundle_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_pppox_ifaddr_command_fn (vlib_main_t * vm, unformat_input_t * input,
+                              vlib_cli_command_t * cmd)
+{
+  pppox_main_t *pom = &pppox_main;
+  pppox_ifaddr_batch_t *ib = &pom->ifaddr;
+  int i;
+
+  vlib_cli_output (vm, "pending %d batches %lld changes %lld",
+                   vec_len (ib->pending), ib->batches, ib->ops);
+  vlib_cli_output (vm, "barrier hold avg %.2fus max %.2fus",
+                   ib->batches ? ib->hold_total * 1e6 / ib->batches : 0.0,
+                   ib->hold_max * 1e6);
+  vlib_cli_output (vm, "batch size:");
+  for (i = 0; i < PPPOX_IFADDR_N_BUCKETS; i++)
+    {
+      if (ib->batch_histogram[i] == 0)
+        continue;
+      vlib_cli_output (vm, "  %4d - %4d: %d", 1 << i, (1 << (i + 1)) - 1,
+                       ib->batch_histogram[i]);
+    }
+
+  return 0;
+}
+
+/*?
+ * Display how IPCP address and route changes were applied, each batch
+ * is applied under one worker barrier.
+ *
+ * @cliexpar
+ * @cliexstart{show pppox ifaddr}
+ * pending 0 batches 12 changes 2000
+ * barrier hold avg 1520.33us max 2810.02us
+ * batch size:
+ *      1 -    1: 3
+ *    128 -  255: 1
+ *    256 -  511: 7
+ * @cliexend
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_pppox_ifaddr_command, static) = {
+  .path = "show pppox ifaddr",
+  .short_help = "show pppox ifaddr",
+  .function = show_pppox_ifaddr_command_fn,
+};
+/* *INDENT-ON* */
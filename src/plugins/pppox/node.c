@@ -13,6 +13,8 @@
 #include <vnet/plugin/plugin.h>
 #include <vpp/app/version.h>
 #include <vnet/ppp/packet.h>
+#include <vnet/tcp/tcp_packet.h>
+#include <vnet/feature/feature.h>
 #include <pppox/pppox.h>
 #include <pppox/pppd/pppd.h>
 
@@ -95,6 +97,9 @@ pppox_input (vlib_main_t * vm,
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
 
+  // send replies of the whole frame at once.
+  pppox_flush_output ();
+
   vlib_node_increment_counter (vm, pppox_input_node.index,
                                PPPOX_ERROR_TOTAL_RX_CTRL_PKTS,
                                pppox_pkts);
@@ -231,7 +236,7 @@ pppox_output (vlib_main_t * vm,
 
       pkts_encapsulated += 2;
       len0 = vlib_buffer_length_in_chain (vm, b0);
-      len1 = vlib_buffer_length_in_chain (vm, b0);
+      len1 = vlib_buffer_length_in_chain (vm, b1);
       stats_n_packets += 2;
       stats_n_bytes += len0 + len1;
 
@@ -371,6 +376,1217 @@ VLIB_REGISTER_NODE (pppox_output_node) = {
   },
 };
 
+/// FOR PPPOX bundle tx/////
+/*
+ * Packets routed to a bundle come here behind the ppp protocol of the
+ * bundle adjacency. The flow picks a bucket, the bucket a member, and
+ * the pppoe encap the member session had when it came up goes in front
+ * straight to the uplink: one lookup, the member itself is not visited.
+ */
+typedef struct {
+  u32 sw_if_index;
+  u32 hash;
+  u32 member_sw_if_index;
+} pppox_bundle_tx_trace_t;
+
+static u8 * format_pppox_bundle_tx_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  pppox_bundle_tx_trace_t * t = va_arg (*args, pppox_bundle_tx_trace_t *);
+
+  s = format (s, "PPPoX bundle sw_if_index %d hash 0x%08x member %d",
+              t->sw_if_index, t->hash, t->member_sw_if_index);
+  return s;
+}
+
+#if __SSE4_2__ && !defined (__i386__)
+static_always_inline u32
+pppox_bundle_hash_hash (u64 k0, u64 k1, u64 k2, u64 k3, u64 k4)
+{
+  u64 val = 0;
+  val = _mm_crc32_u64 (val, k0);
+  val = _mm_crc32_u64 (val, k1);
+  val = _mm_crc32_u64 (val, k2);
+  val = _mm_crc32_u64 (val, k3);
+  val = _mm_crc32_u64 (val, k4);
+  return (u32) val;
+}
+#else
+static_always_inline u32
+pppox_bundle_hash_hash (u64 k0, u64 k1, u64 k2, u64 k3, u64 k4)
+{
+  u64 tmp = k0 ^ k1 ^ k2 ^ k3 ^ k4;
+  return (u32) clib_xxhash (tmp);
+}
+#endif
+
+/*
+ * Flow hash of the packet behind the ppp protocol, as lb_node_get_hash
+ * does it. Ports only count for the first fragment and whole packets,
+ * other fragments would land on another member than their head.
+ */
+static_always_inline u32
+pppox_bundle_get_hash (vlib_buffer_t * b)
+{
+  u8 * p = vlib_buffer_get_current (b);
+  u16 proto = clib_net_to_host_u16 (*(u16 *) p);
+  u64 ports = 0;
+
+  if (PREDICT_TRUE (proto == PPP_PROTOCOL_ip4))
+    {
+      ip4_header_t * ip40 = (ip4_header_t *) (p + 2);
+
+      if (PREDICT_TRUE ((ip40->protocol == IP_PROTOCOL_TCP ||
+                         ip40->protocol == IP_PROTOCOL_UDP) &&
+                        !ip4_is_fragment (ip40)))
+        ports = ((u64) ((udp_header_t *) ip4_next_header (ip40))->src_port << 16) |
+          ((u64) ((udp_header_t *) ip4_next_header (ip40))->dst_port);
+
+      return pppox_bundle_hash_hash (*((u64 *) & ip40->address_pair), ports,
+                                     0, 0, 0);
+    }
+  else if (proto == PPP_PROTOCOL_ip6)
+    {
+      ip6_header_t * ip60 = (ip6_header_t *) (p + 2);
+
+      if (PREDICT_TRUE (ip60->protocol == IP_PROTOCOL_TCP ||
+                        ip60->protocol == IP_PROTOCOL_UDP))
+        ports = ((u64) ((udp_header_t *) (ip60 + 1))->src_port << 16) |
+          ((u64) ((udp_header_t *) (ip60 + 1))->dst_port);
+
+      return pppox_bundle_hash_hash (ip60->src_address.as_u64[0],
+                                     ip60->src_address.as_u64[1],
+                                     ip60->dst_address.as_u64[0],
+                                     ip60->dst_address.as_u64[1],
+                                     ports);
+    }
+
+  return 0;
+}
+
+/*
+ * Multilink: cut the packet in up to one fragment per up member, none
+ * smaller than fragment_min unless the member mtu asks for more, and
+ * send each over the member its sequence number picks. The first
+ * fragment stays in b0, the others are copied out in new buffers and
+ * left in the per thread vectors for the end of the frame. A chained
+ * buffer goes whole, as ip_frag does not cut them either.
+ * Returns the number of fragments, 0 if out of buffers.
+ */
+static_always_inline u32
+pppox_bundle_mp_fragment (vlib_main_t * vm, pppox_bundle_t * bundle,
+                          vlib_buffer_t * b0, u32 len0,
+                          pppox_per_thread_t * ptd, u32 * seq0)
+{
+  u32 n_frags = 1, frag_len = len0, first_len = len0;
+  u32 bis[PPPOX_MP_WINDOW];
+  u32 i, offset;
+
+  if (PREDICT_TRUE (!(b0->flags & VLIB_BUFFER_NEXT_PRESENT)))
+    {
+      n_frags = clib_min (len0 / bundle->fragment_min, bundle->n_up);
+      n_frags = clib_max (n_frags, (len0 + bundle->fragment_max - 1)
+                          / bundle->fragment_max);
+      n_frags = clib_max (n_frags, 1);
+      n_frags = clib_min (n_frags, PPPOX_MP_WINDOW);
+      frag_len = (len0 + n_frags - 1) / n_frags;
+      first_len = frag_len;
+      n_frags = (len0 + frag_len - 1) / frag_len;
+    }
+
+  if (n_frags > 1 && vlib_buffer_alloc (vm, bis, n_frags - 1) != n_frags - 1)
+    {
+      // vlib_buffer_alloc gives back what it got on failure.
+      return 0;
+    }
+
+  *seq0 = __sync_fetch_and_add (&bundle->tx_seq, n_frags);
+
+  offset = first_len;
+  for (i = 1; i < n_frags; i++)
+    {
+      vlib_buffer_t * f = vlib_get_buffer (vm, bis[i - 1]);
+      u32 len = clib_min (frag_len, len0 - offset);
+
+      pppox_buffer_init (f);
+      vnet_buffer (f)->sw_if_index[VLIB_RX] = vnet_buffer (b0)->sw_if_index[VLIB_RX];
+      f->current_length = len;
+      clib_memcpy (vlib_buffer_get_current (f),
+                   vlib_buffer_get_current (b0) + offset, len);
+      offset += len;
+
+      vec_add1 (ptd->to_bis, bis[i - 1]);
+    }
+  b0->current_length = first_len;
+
+  return n_frags;
+}
+
+/*
+ * Put the member encap in front of a packet or a multilink fragment of
+ * sequence seq, and account it to the member.
+ */
+static_always_inline u32
+pppox_bundle_encap (vlib_main_t * vm, vlib_buffer_t * b,
+                    pppox_bundle_member_t * m,
+                    int is_mp, u32 seq, u8 flags, u32 thread_index,
+                    vnet_interface_main_t * im)
+{
+  u32 rw_len = vec_len (m->rewrite);
+  u32 len = vlib_buffer_length_in_chain (vm, b);
+  u8 * rw;
+
+  if (is_mp)
+    {
+      u8 * mp;
+
+      vlib_buffer_advance (b, -(2 + PPPOX_MP_HDR_LEN));
+      mp = vlib_buffer_get_current (b);
+      *(u16 *) mp = clib_host_to_net_u16 (PPP_PROTOCOL_multilink);
+      *(u32 *) (mp + 2) =
+        clib_host_to_net_u32 (((u32) flags << 24) | (seq & PPPOX_MP_SEQ_MASK));
+      len += 2 + PPPOX_MP_HDR_LEN;
+    }
+
+  vlib_buffer_advance (b, -(word) rw_len);
+  rw = vlib_buffer_get_current (b);
+  clib_memcpy (rw, m->rewrite, rw_len);
+  // pppoe length ends the encap and counts the ppp protocol on.
+  *(u16 *) (rw + rw_len - 2) = clib_host_to_net_u16 (len);
+
+  vnet_buffer(b)->sw_if_index[VLIB_TX] = m->encap_sw_if_index;
+
+  vlib_increment_combined_counter (
+      im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
+      thread_index, m->sw_if_index, 1, len);
+
+  return m->encap_next_index;
+}
+
+/*
+ * Enqueue the buffers left in the per thread vectors, a frame for each
+ * run of the same next.
+ */
+static_always_inline void
+pppox_enqueue_to_next (vlib_main_t * vm, vlib_node_runtime_t * node,
+                       u32 * bis, u16 * nexts)
+{
+  u32 n_left = vec_len (bis);
+  u32 next_index, n_left_to_next, * to_next;
+
+  while (n_left > 0)
+    {
+      next_index = nexts[0];
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+      while (n_left > 0 && n_left_to_next > 0 && nexts[0] == next_index)
+        {
+          to_next[0] = bis[0];
+          to_next += 1;
+          bis += 1;
+          nexts += 1;
+          n_left -= 1;
+          n_left_to_next -= 1;
+        }
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+}
+
+static uword
+pppox_bundle_output (vlib_main_t * vm,
+                     vlib_node_runtime_t * node,
+                     vlib_frame_t * from_frame)
+{
+  pppox_main_t * pom = &pppox_main;
+  vnet_main_t * vnm = pom->vnet_main;
+  vnet_interface_main_t * im = &vnm->interface_main;
+  u32 n_left_from, next_index, *from, *to_next;
+  u32 thread_index = vlib_get_thread_index ();
+  pppox_per_thread_t * ptd = vec_elt_at_index (pom->per_thread, thread_index);
+  u32 stats_sw_if_index, stats_n_packets, stats_n_bytes;
+  pppox_bundle_t * bundle = 0;
+  u32 bundle_sw_if_index = ~0;
+  u32 nexthash0 = 0;
+  u32 n_fragmented = 0;
+
+  from = vlib_frame_vector_args (from_frame);
+  n_left_from = from_frame->n_vectors;
+
+  next_index = node->cached_next_index;
+  stats_sw_if_index = node->runtime_data[0];
+  stats_n_packets = stats_n_bytes = 0;
+  vec_reset_length (ptd->to_bis);
+  vec_reset_length (ptd->to_nexts);
+
+  if (PREDICT_TRUE (n_left_from > 0))
+    nexthash0 = pppox_bundle_get_hash (vlib_get_buffer (vm, from[0]));
+
+  while (n_left_from > 0)
+    {
+      u32 n_left_to_next;
+
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left_from > 0 && n_left_to_next > 0)
+        {
+          u32 bi0;
+          vlib_buffer_t * b0;
+          u32 next0 = PPPOX_BUNDLE_OUTPUT_NEXT_DROP;
+          u32 sw_if_index0, len0;
+          u32 hash0 = nexthash0;
+          pppox_bundle_member_t * m0 = 0;
+
+          if (PREDICT_TRUE (n_left_from > 1))
+            {
+              vlib_buffer_t * p1 = vlib_get_buffer (vm, from[1]);
+              // next flow hash, the packet was read by ip rewrite already.
+              nexthash0 = pppox_bundle_get_hash (p1);
+              if (PREDICT_TRUE (bundle && vec_len (bundle->buckets)))
+                CLIB_PREFETCH (&bundle->buckets[nexthash0 & (PPPOX_BUNDLE_N_BUCKETS - 1)],
+                               sizeof (u32), LOAD);
+            }
+
+          bi0 = from[0];
+          to_next[0] = bi0;
+          from += 1;
+          to_next += 1;
+          n_left_from -= 1;
+          n_left_to_next -= 1;
+
+          b0 = vlib_get_buffer (vm, bi0);
+          sw_if_index0 = vnet_buffer(b0)->sw_if_index[VLIB_TX];
+          len0 = vlib_buffer_length_in_chain (vm, b0);
+
+          /* 1-wide cache */
+          if (PREDICT_FALSE (sw_if_index0 != bundle_sw_if_index))
+            {
+              bundle_sw_if_index = sw_if_index0;
+              bundle = pool_elt_at_index (pom->bundles,
+                                          pom->bundle_index_by_sw_if_index[sw_if_index0]);
+            }
+
+          if (PREDICT_FALSE (vec_len (bundle->buckets) == 0))
+            {
+              b0->error = node->errors[PPPOX_ERROR_BUNDLE_NO_MEMBER];
+              goto trace;
+            }
+
+          if (PREDICT_FALSE (bundle->mrru != 0))
+            {
+              u32 n_frags0, seq0 = 0, i, first0 = vec_len (ptd->to_bis);
+
+              n_frags0 = pppox_bundle_mp_fragment (vm, bundle, b0, len0,
+                                                   ptd, &seq0);
+              if (PREDICT_FALSE (n_frags0 == 0))
+                {
+                  b0->error = node->errors[PPPOX_ERROR_MP_NO_BUFFER];
+                  goto trace;
+                }
+              n_fragmented += n_frags0 > 1;
+
+              // fragments spread over members as their weights do.
+              m0 = pool_elt_at_index (bundle->members,
+                                      bundle->buckets[seq0 & (PPPOX_BUNDLE_N_BUCKETS - 1)]);
+              next0 = pppox_bundle_encap (vm, b0, m0, 1, seq0,
+                                          PPPOX_MP_FLAG_B |
+                                          (n_frags0 == 1 ? PPPOX_MP_FLAG_E : 0),
+                                          thread_index, im);
+              for (i = 1; i < n_frags0; i++)
+                {
+                  vlib_buffer_t * f = vlib_get_buffer (vm, ptd->to_bis[first0 + i - 1]);
+                  pppox_bundle_member_t * m =
+                    pool_elt_at_index (bundle->members,
+                                       bundle->buckets[(seq0 + i) & (PPPOX_BUNDLE_N_BUCKETS - 1)]);
+
+                  vec_add1 (ptd->to_nexts,
+                            pppox_bundle_encap (vm, f, m, 1, seq0 + i,
+                                                i == n_frags0 - 1 ?
+                                                PPPOX_MP_FLAG_E : 0,
+                                                thread_index, im));
+                }
+            }
+          else
+            {
+              m0 = pool_elt_at_index (bundle->members,
+                                      bundle->buckets[hash0 & (PPPOX_BUNDLE_N_BUCKETS - 1)]);
+              next0 = pppox_bundle_encap (vm, b0, m0, 0, 0, 0, thread_index, im);
+            }
+
+          stats_n_packets += 1;
+          stats_n_bytes += len0;
+          if (PREDICT_FALSE (sw_if_index0 != stats_sw_if_index))
+            {
+              stats_n_packets -= 1;
+              stats_n_bytes -= len0;
+              if (stats_n_packets)
+                vlib_increment_combined_counter (
+                    im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
+                    thread_index, stats_sw_if_index, stats_n_packets, stats_n_bytes);
+              stats_n_packets = 1;
+              stats_n_bytes = len0;
+              stats_sw_if_index = sw_if_index0;
+            }
+
+        trace:
+          if (PREDICT_FALSE(b0->flags & VLIB_BUFFER_IS_TRACED))
+            {
+              pppox_bundle_tx_trace_t *tr
+                = vlib_add_trace (vm, node, b0, sizeof (*tr));
+              tr->sw_if_index = sw_if_index0;
+              tr->hash = hash0;
+              tr->member_sw_if_index = m0 ? m0->sw_if_index : ~0;
+            }
+          vlib_validate_buffer_enqueue_x1(vm, node, next_index, to_next,
+                                          n_left_to_next, bi0, next0);
+        }
+
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  /* fragments after the first of each packet */
+  if (PREDICT_FALSE (vec_len (ptd->to_bis) > 0))
+    pppox_enqueue_to_next (vm, node, ptd->to_bis, ptd->to_nexts);
+
+  vlib_node_increment_counter (vm, pppox_bundle_output_node.index,
+                               PPPOX_ERROR_MP_FRAGMENTED, n_fragmented);
+
+  /* Increment any remaining batch stats */
+  if (stats_n_packets)
+    {
+      vlib_increment_combined_counter (
+          im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX, thread_index,
+          stats_sw_if_index, stats_n_packets, stats_n_bytes);
+      node->runtime_data[0] = stats_sw_if_index;
+    }
+
+  return from_frame->n_vectors;
+}
+
+VLIB_REGISTER_NODE (pppox_bundle_output_node) = {
+  .function = pppox_bundle_output,
+  .name = "pppox-bundle-output",
+  .vector_size = sizeof (u32),
+  .format_trace = format_pppox_bundle_tx_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_errors = ARRAY_LEN(pppox_error_strings),
+  .error_strings = pppox_error_strings,
+
+  .n_next_nodes = PPPOX_BUNDLE_OUTPUT_N_NEXT,
+
+  .next_nodes = {
+#define _(s,n) [PPPOX_BUNDLE_OUTPUT_NEXT_##s] = n,
+    foreach_pppox_bundle_output_next
+#undef _
+  },
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (pppox_bundle_output_node, pppox_bundle_output)
+
+/// FOR PPPOX multilink rx/////
+/*
+ * Multilink fragments come from pppoeclient-session-input behind their
+ * multilink header, with the rx interface of the member. They wait in
+ * the reorder window of the bundle until a packet is complete, which
+ * then goes on as received by the bundle itself.
+ */
+typedef struct {
+  u32 sw_if_index;
+  u32 seq;
+  u8 flags;
+  u32 next_seq;
+} pppox_mp_rx_trace_t;
+
+static u8 * format_pppox_mp_rx_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  pppox_mp_rx_trace_t * t = va_arg (*args, pppox_mp_rx_trace_t *);
+
+  s = format (s, "PPPoX multilink sw_if_index %d seq %d%s%s next seq %d",
+              t->sw_if_index, t->seq,
+              (t->flags & PPPOX_MP_FLAG_B) ? " B" : "",
+              (t->flags & PPPOX_MP_FLAG_E) ? " E" : "",
+              t->next_seq);
+  return s;
+}
+
+/* distance from a to b in the 24 bit sequence space */
+static_always_inline i32
+pppox_mp_seq_diff (u32 b, u32 a)
+{
+  return ((i32) ((b - a) << 8)) >> 8;
+}
+
+static_always_inline void
+pppox_mp_trace (vlib_main_t * vm, vlib_node_runtime_t * node,
+                vlib_buffer_t * b, u32 seq, u8 flags, pppox_mp_reasm_t * r)
+{
+  if (PREDICT_FALSE (b->flags & VLIB_BUFFER_IS_TRACED))
+    {
+      pppox_mp_rx_trace_t *tr = vlib_add_trace (vm, node, b, sizeof (*tr));
+      tr->sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_RX];
+      tr->seq = seq;
+      tr->flags = flags;
+      tr->next_seq = r ? r->next_seq : ~0;
+    }
+}
+
+static_always_inline pppox_mp_reasm_t *
+pppox_mp_reasm_get (pppox_per_thread_t * ptd, u32 bundle_index)
+{
+  pppox_mp_reasm_t * r;
+
+  vec_validate (ptd->reasm, bundle_index);
+  r = ptd->reasm[bundle_index];
+  if (PREDICT_FALSE (r == 0))
+    {
+      r = clib_mem_alloc_aligned (sizeof (*r), CLIB_CACHE_LINE_BYTES);
+      memset (r, 0, sizeof (*r));
+      memset (r->bi, 0xff, sizeof (r->bi));
+      ptd->reasm[bundle_index] = r;
+    }
+  return r;
+}
+
+/* free the fragment of slot i, if it is there */
+static_always_inline u32
+pppox_mp_discard (vlib_main_t * vm, pppox_mp_reasm_t * r, u32 i)
+{
+  if (r->bi[i] == ~0)
+    return 0;
+  vlib_buffer_free_one (vm, r->bi[i]);
+  r->bi[i] = ~0;
+  return 1;
+}
+
+/*
+ * Move the window start to seq. Fragments passed over can not complete
+ * any more and are discarded, holes passed over are lost.
+ */
+static_always_inline u32
+pppox_mp_slide (vlib_main_t * vm, pppox_mp_reasm_t * r, u32 seq)
+{
+  u32 n = pppox_mp_seq_diff (seq, r->next_seq);
+  u32 i, n_discarded = 0;
+
+  if (n >= PPPOX_MP_WINDOW)
+    {
+      for (i = 0; i < PPPOX_MP_WINDOW; i++)
+        n_discarded += pppox_mp_discard (vm, r, i);
+    }
+  else
+    {
+      for (i = 0; i < n; i++)
+        n_discarded +=
+          pppox_mp_discard (vm, r, (r->next_seq + i) & (PPPOX_MP_WINDOW - 1));
+    }
+  r->lost += n - n_discarded;
+  r->next_seq = seq & PPPOX_MP_SEQ_MASK;
+
+  return n_discarded;
+}
+
+/*
+ * Sequence number every up member went past, RFC 1990 section 4.1: a
+ * hole before it will never be filled.
+ */
+static_always_inline u32
+pppox_mp_min_seq (pppox_bundle_t * bundle, pppox_mp_reasm_t * r, u32 seq)
+{
+  u32 i;
+
+  for (i = 0; i < vec_len (r->member_seq); i++)
+    {
+      if (r->member_seq[i] == ~0 || pool_is_free_index (bundle->members, i)
+          || !bundle->members[i].is_up)
+        continue;
+      if (pppox_mp_seq_diff (r->member_seq[i], seq) < 0)
+        seq = r->member_seq[i];
+    }
+  return seq;
+}
+
+/*
+ * Chain the fragments from the window start to slot of seq end into
+ * one packet and give it back, the window start moves past it.
+ */
+static_always_inline u32
+pppox_mp_chain (vlib_main_t * vm, pppox_mp_reasm_t * r, u32 n)
+{
+  u32 i, bi, first_bi = ~0;
+  vlib_buffer_t * first = 0, * last = 0, * b;
+
+  for (i = 0; i < n; i++)
+    {
+      u32 slot = (r->next_seq + i) & (PPPOX_MP_WINDOW - 1);
+
+      bi = r->bi[slot];
+      r->bi[slot] = ~0;
+      b = vlib_get_buffer (vm, bi);
+      vlib_buffer_advance (b, PPPOX_MP_HDR_LEN);
+
+      if (first == 0)
+        {
+          first = b;
+          first_bi = bi;
+          first->total_length_not_including_first_buffer = 0;
+        }
+      else
+        {
+          last->next_buffer = bi;
+          last->flags |= VLIB_BUFFER_NEXT_PRESENT;
+          first->total_length_not_including_first_buffer += b->current_length;
+        }
+      last = b;
+    }
+  last->flags &= ~VLIB_BUFFER_NEXT_PRESENT;
+  first->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+  r->next_seq = (r->next_seq + n) & PPPOX_MP_SEQ_MASK;
+  r->reassembled++;
+
+  return first_bi;
+}
+
+/*
+ * Take the packets complete from the window start on, and push the
+ * start past whatever can not complete any more. Packets are left in
+ * the per thread vector.
+ */
+static_always_inline u32
+pppox_mp_reassemble (vlib_main_t * vm, pppox_mp_reasm_t * r, u32 min_seq,
+                     pppox_per_thread_t * ptd)
+{
+  u32 i, slot, n_discarded = 0;
+  int complete;
+
+  while (1)
+    {
+      slot = r->next_seq & (PPPOX_MP_WINDOW - 1);
+
+      if (r->bi[slot] == ~0)
+        {
+          // a hole every member went past is lost.
+          if (pppox_mp_seq_diff (min_seq, r->next_seq) <= 0)
+            break;
+          n_discarded += pppox_mp_slide (vm, r, r->next_seq + 1);
+          continue;
+        }
+
+      // a tail whose head got lost.
+      if (!(r->flags[slot] & PPPOX_MP_FLAG_B))
+        {
+          n_discarded += pppox_mp_slide (vm, r, r->next_seq + 1);
+          continue;
+        }
+
+      complete = 0;
+      for (i = 0; i < PPPOX_MP_WINDOW; i++)
+        {
+          slot = (r->next_seq + i) & (PPPOX_MP_WINDOW - 1);
+          if (r->bi[slot] == ~0 || (i && (r->flags[slot] & PPPOX_MP_FLAG_B)))
+            break;
+          if (r->flags[slot] & PPPOX_MP_FLAG_E)
+            {
+              complete = 1;
+              break;
+            }
+        }
+
+      if (complete)
+        {
+          vec_add1 (ptd->to_bis, pppox_mp_chain (vm, r, i + 1));
+          continue;
+        }
+
+      // the hole may still be filled.
+      if (i < PPPOX_MP_WINDOW && r->bi[slot] == ~0
+          && pppox_mp_seq_diff (min_seq, r->next_seq + i) <= 0)
+        break;
+
+      // no end in the window, another head, or a hole never filled.
+      n_discarded += pppox_mp_slide (vm, r, r->next_seq + i);
+    }
+
+  return n_discarded;
+}
+
+static uword
+pppox_mp_input (vlib_main_t * vm,
+                vlib_node_runtime_t * node,
+                vlib_frame_t * from_frame)
+{
+  pppox_main_t * pom = &pppox_main;
+  vnet_interface_main_t * im = &pom->vnet_main->interface_main;
+  u32 thread_index = vlib_get_thread_index ();
+  pppox_per_thread_t * ptd = vec_elt_at_index (pom->per_thread, thread_index);
+  u32 n_left_from, * from, ti;
+  u32 n_discarded = 0, n_reassembled = 0, n_handoff = 0;
+  // ppp control frames are consumed by main thread only.
+  u16 ctrl_next = thread_index ?
+    PPPOX_MP_INPUT_NEXT_CONTROL_HANDOFF : PPPOX_MP_INPUT_NEXT_PPPOX_INPUT;
+
+  from = vlib_frame_vector_args (from_frame);
+  n_left_from = from_frame->n_vectors;
+  vec_reset_length (ptd->to_bis);
+  vec_reset_length (ptd->to_nexts);
+
+  while (n_left_from > 0)
+    {
+      u32 bi0, sw_if_index0, seq0 = 0, unit0, first0, i;
+      vlib_buffer_t * b0;
+      pppox_virtual_interface_t * t0;
+      pppox_bundle_t * bundle0 = 0;
+      pppox_mp_reasm_t * r0 = 0;
+      u32 error0 = 0;
+      u8 flags0 = 0, * mp0;
+
+      if (PREDICT_TRUE (n_left_from > 1))
+        {
+          vlib_buffer_t * p1 = vlib_get_buffer (vm, from[1]);
+          vlib_prefetch_buffer_header (p1, LOAD);
+          CLIB_PREFETCH (p1->data + p1->current_data, CLIB_CACHE_LINE_BYTES, LOAD);
+        }
+
+      bi0 = from[0];
+      from += 1;
+      n_left_from -= 1;
+
+      b0 = vlib_get_buffer (vm, bi0);
+      sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_RX];
+      unit0 = pom->virtual_interface_index_by_sw_if_index[sw_if_index0];
+      t0 = pool_elt_at_index (pom->virtual_interfaces, unit0);
+
+      if (PREDICT_FALSE (t0->bundle_index == ~0
+                         || b0->current_length < PPPOX_MP_HDR_LEN))
+        {
+          error0 = PPPOX_ERROR_MP_DISCARDED;
+          goto drop;
+        }
+      bundle0 = pool_elt_at_index (pom->bundles, t0->bundle_index);
+      if (PREDICT_FALSE (bundle0->mrru == 0))
+        {
+          error0 = PPPOX_ERROR_MP_DISCARDED;
+          goto drop;
+        }
+
+      mp0 = vlib_buffer_get_current (b0);
+      flags0 = mp0[0] & (PPPOX_MP_FLAG_B | PPPOX_MP_FLAG_E);
+      seq0 = clib_net_to_host_u32 (*(u32 *) mp0) & PPPOX_MP_SEQ_MASK;
+
+      // members may be received on other threads, the window is only
+      // kept by the bundle thread.
+      if (PREDICT_FALSE (bundle0->thread_index != thread_index))
+        {
+          pppox_mp_trace (vm, node, b0, seq0, flags0, 0);
+          vec_validate (ptd->handoff_bis, bundle0->thread_index);
+          vec_add1 (ptd->handoff_bis[bundle0->thread_index], bi0);
+          continue;
+        }
+
+      r0 = pppox_mp_reasm_get (ptd, t0->bundle_index);
+      vec_validate_init_empty (r0->member_seq, t0->bundle_member_index, ~0);
+      r0->member_seq[t0->bundle_member_index] = seq0;
+
+      if (PREDICT_FALSE (!r0->is_synced))
+        {
+          r0->next_seq = seq0;
+          r0->is_synced = 1;
+        }
+
+      if (PREDICT_FALSE (pppox_mp_seq_diff (seq0, r0->next_seq) < 0))
+        {
+          r0->late++;
+          error0 = PPPOX_ERROR_MP_LATE;
+          goto drop;
+        }
+      // too far ahead, the window follows it.
+      if (PREDICT_FALSE (pppox_mp_seq_diff (seq0, r0->next_seq) >= PPPOX_MP_WINDOW))
+        n_discarded += pppox_mp_slide (vm, r0, seq0 - PPPOX_MP_WINDOW + 1);
+
+      i = seq0 & (PPPOX_MP_WINDOW - 1);
+      if (PREDICT_FALSE (r0->bi[i] != ~0))
+        {
+          error0 = PPPOX_ERROR_MP_DISCARDED;
+          goto drop;
+        }
+      // traced now, the buffer may be gone once in the window.
+      pppox_mp_trace (vm, node, b0, seq0, flags0, r0);
+      r0->bi[i] = bi0;
+      r0->flags[i] = flags0;
+
+      first0 = vec_len (ptd->to_bis);
+      n_discarded += pppox_mp_reassemble
+        (vm, r0, pppox_mp_min_seq (bundle0, r0, seq0), ptd);
+
+      for (i = first0; i < vec_len (ptd->to_bis); i++)
+        {
+          vlib_buffer_t * p = vlib_get_buffer (vm, ptd->to_bis[i]);
+          u16 proto = clib_net_to_host_u16 (*(u16 *) vlib_buffer_get_current (p));
+          u16 next = PPPOX_MP_INPUT_NEXT_DROP;
+
+          n_reassembled++;
+          if (PREDICT_TRUE (proto == PPP_PROTOCOL_ip4 || proto == PPP_PROTOCOL_ip6))
+            {
+              vlib_buffer_advance (p, sizeof (proto));
+              vnet_buffer (p)->sw_if_index[VLIB_RX] = bundle0->sw_if_index;
+              next = proto == PPP_PROTOCOL_ip4 ?
+                PPPOX_MP_INPUT_NEXT_IP4_INPUT : PPPOX_MP_INPUT_NEXT_IP6_INPUT;
+              vlib_increment_combined_counter (
+                  im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX,
+                  thread_index, bundle0->sw_if_index, 1,
+                  vlib_buffer_length_in_chain (vm, p));
+            }
+          else if ((proto == PPP_PROTOCOL_pap || proto == PPP_PROTOCOL_ipcp ||
+                    proto == PPP_PROTOCOL_chap) &&
+                   bundle0->ncp_sw_if_index != ~0 &&
+                   !(p->flags & VLIB_BUFFER_NEXT_PRESENT))
+            {
+              // NCPs of the bundle run on the member that joined first.
+              vnet_buffer (p)->sw_if_index[VLIB_RX] = bundle0->ncp_sw_if_index;
+              vnet_buffer (p)->pppox.len = p->current_length;
+              next = ctrl_next;
+            }
+          else
+            p->error = node->errors[PPPOX_ERROR_MP_UNKNOWN_PROTOCOL];
+          vec_add1 (ptd->to_nexts, next);
+        }
+      continue;
+
+    drop:
+      pppox_mp_trace (vm, node, b0, seq0, flags0, r0);
+      b0->error = node->errors[error0];
+      vec_add1 (ptd->to_bis, bi0);
+      vec_add1 (ptd->to_nexts, PPPOX_MP_INPUT_NEXT_DROP);
+    }
+
+  pppox_enqueue_to_next (vm, node, ptd->to_bis, ptd->to_nexts);
+
+  // a frame always fits in one queue element.
+  for (ti = 0; ti < vec_len (ptd->handoff_bis); ti++)
+    {
+      u32 n = vec_len (ptd->handoff_bis[ti]);
+      vlib_frame_queue_elt_t * hf;
+
+      if (n == 0)
+        continue;
+      hf = vlib_get_frame_queue_elt (pom->mp_frame_queue_index, ti);
+      clib_memcpy (hf->buffer_index, ptd->handoff_bis[ti], n * sizeof (u32));
+      hf->n_vectors = n;
+      vlib_put_frame_queue_elt (hf);
+      vec_reset_length (ptd->handoff_bis[ti]);
+      n_handoff += n;
+    }
+
+  vlib_node_increment_counter (vm, pppox_mp_input_node.index,
+                               PPPOX_ERROR_MP_HANDOFF, n_handoff);
+  vlib_node_increment_counter (vm, pppox_mp_input_node.index,
+                               PPPOX_ERROR_MP_DISCARDED, n_discarded);
+  vlib_node_increment_counter (vm, pppox_mp_input_node.index,
+                               PPPOX_ERROR_MP_REASSEMBLED, n_reassembled);
+
+  return from_frame->n_vectors;
+}
+
+VLIB_REGISTER_NODE (pppox_mp_input_node) = {
+  .function = pppox_mp_input,
+  .name = "pppox-mp-input",
+  .vector_size = sizeof (u32),
+  .format_trace = format_pppox_mp_rx_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_errors = ARRAY_LEN(pppox_error_strings),
+  .error_strings = pppox_error_strings,
+
+  .n_next_nodes = PPPOX_MP_INPUT_N_NEXT,
+
+  .next_nodes = {
+#define _(s,n) [PPPOX_MP_INPUT_NEXT_##s] = n,
+    foreach_pppox_mp_input_next
+#undef _
+  },
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (pppox_mp_input_node, pppox_mp_input)
+
+/// FOR PPPOX tcp mss clamp/////
+/*
+ * SYNs crossing a pppox interface get their MSS option lowered to fit
+ * the MTU that LCP settled on, in both directions: on the ip unicast
+ * arcs for SYNs received on pppox, on the ip output arcs for SYNs sent
+ * to it. Other packets only pass a cheap SYN test, four at a time.
+ */
+typedef struct {
+  u32 sw_if_index;
+  u16 mss;
+  u16 clamped;
+} pppox_mss_clamp_trace_t;
+
+static u8 * format_pppox_mss_clamp_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  pppox_mss_clamp_trace_t * t = va_arg (*args, pppox_mss_clamp_trace_t *);
+
+  s = format (s, "PPPoX sw_if_index %d mss %d%s",
+              t->sw_if_index, t->mss, t->clamped ? " clamped" : "");
+  return s;
+}
+
+static_always_inline void *
+pppox_mss_clamp_l3 (vlib_buffer_t * b, int is_output)
+{
+  // output features see the packet behind the midchain rewrite.
+  return (u8 *) vlib_buffer_get_current (b)
+    + (is_output ? vnet_buffer (b)->ip.save_rewrite_length : 0);
+}
+
+static_always_inline tcp_header_t *
+pppox_mss_clamp_tcp (void * l3, int is_ip6)
+{
+  if (is_ip6)
+    return (tcp_header_t *) ((ip6_header_t *) l3 + 1);
+  return ip4_next_header (l3);
+}
+
+/*
+ * Non zero for a TCP SYN, without branches. TCP behind IPv6
+ * extension headers and non-first IPv4 fragments are left alone.
+ */
+static_always_inline u32
+pppox_mss_clamp_is_syn (void * l3, int is_ip6)
+{
+  tcp_header_t * tcp = pppox_mss_clamp_tcp (l3, is_ip6);
+  u32 is_tcp;
+
+  if (is_ip6)
+    is_tcp = ((ip6_header_t *) l3)->protocol == IP_PROTOCOL_TCP;
+  else
+    is_tcp = (((ip4_header_t *) l3)->protocol == IP_PROTOCOL_TCP)
+      & (ip4_get_fragment_offset (l3) == 0);
+
+  return is_tcp & ((tcp->flags & TCP_FLAG_SYN) != 0);
+}
+
+static_always_inline u16
+pppox_mss_clamp_mss (pppox_main_t * pom, u32 sw_if_index, int is_ip6)
+{
+  pppox_virtual_interface_t * t;
+  u32 unit = sw_if_index < vec_len (pom->virtual_interface_index_by_sw_if_index) ?
+    pom->virtual_interface_index_by_sw_if_index[sw_if_index] : ~0;
+
+  if (PREDICT_FALSE (unit == ~0))
+    {
+      pppox_bundle_t * b;
+
+      // a bundle clamps to its smallest member.
+      if (sw_if_index >= vec_len (pom->bundle_index_by_sw_if_index)
+          || pom->bundle_index_by_sw_if_index[sw_if_index] == ~0)
+        return 0xffff;
+      b = pool_elt_at_index (pom->bundles,
+                             pom->bundle_index_by_sw_if_index[sw_if_index]);
+      return b->mtu - sizeof (tcp_header_t)
+        - (is_ip6 ? sizeof (ip6_header_t) : sizeof (ip4_header_t));
+    }
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  return t->mtu - sizeof (tcp_header_t)
+    - (is_ip6 ? sizeof (ip6_header_t) : sizeof (ip4_header_t));
+}
+
+/*
+ * Walk the whole option list of a SYN and lower its MSS to mss,
+ * returns whether the option was rewritten.
+ */
+static_always_inline u32
+pppox_mss_clamp_one (vlib_buffer_t * b, void * l3, int is_ip6, u16 mss)
+{
+  tcp_header_t * tcp = pppox_mss_clamp_tcp (l3, is_ip6);
+  u8 * opt = (u8 *) (tcp + 1);
+  u8 * end = (u8 *) tcp + (tcp_doff (tcp) << 2);
+  u8 * tail = (u8 *) vlib_buffer_get_current (b) + b->current_length;
+  u16 old, new;
+  ip_csum_t sum;
+
+  // don't trust the header beyond what the buffer holds.
+  if (end > tail)
+    end = tail;
+
+  while (opt < end)
+    {
+      if (opt[0] == TCP_OPTION_EOL)
+        break;
+      if (opt[0] == TCP_OPTION_NOOP)
+        {
+          opt++;
+          continue;
+        }
+      if (opt + 2 > end || opt[1] < 2 || opt + opt[1] > end)
+        break;
+      if (opt[0] == TCP_OPTION_MSS && opt[1] == TCP_OPTION_LEN_MSS)
+        {
+          old = clib_mem_unaligned (opt + 2, u16);
+          if (clib_net_to_host_u16 (old) <= mss)
+            return 0;
+          new = clib_host_to_net_u16 (mss);
+          clib_mem_unaligned (opt + 2, u16) = new;
+
+          // a value at an odd offset adds into the checksum byte swapped.
+          if ((opt + 2 - (u8 *) tcp) & 1)
+            {
+              old = clib_byte_swap_u16 (old);
+              new = clib_byte_swap_u16 (new);
+            }
+          sum = ip_csum_sub_even (tcp->checksum, old);
+          sum = ip_csum_add_even (sum, new);
+          tcp->checksum = ip_csum_fold (sum);
+          return 1;
+        }
+      opt += opt[1];
+    }
+
+  return 0;
+}
+
+static_always_inline u32
+pppox_mss_clamp_buffer (vlib_main_t * vm, vlib_node_runtime_t * node,
+                        pppox_main_t * pom, vlib_buffer_t * b, void * l3,
+                        u32 sw_if_index, int is_ip6)
+{
+  u16 mss = pppox_mss_clamp_mss (pom, sw_if_index, is_ip6);
+  u32 clamped = pppox_mss_clamp_one (b, l3, is_ip6, mss);
+
+  if (PREDICT_FALSE (b->flags & VLIB_BUFFER_IS_TRACED))
+    {
+      pppox_mss_clamp_trace_t *tr = vlib_add_trace (vm, node, b, sizeof (*tr));
+      tr->sw_if_index = sw_if_index;
+      tr->mss = mss;
+      tr->clamped = clamped;
+    }
+  return clamped;
+}
+
+static_always_inline uword
+pppox_mss_clamp_inline (vlib_main_t * vm,
+                        vlib_node_runtime_t * node,
+                        vlib_frame_t * from_frame,
+                        int is_ip6, int is_output)
+{
+  pppox_main_t * pom = &pppox_main;
+  u32 n_left_from, next_index, *from, *to_next;
+  u32 dir = is_output ? VLIB_TX : VLIB_RX;
+  u32 pkts_clamped = 0;
+
+  from = vlib_frame_vector_args (from_frame);
+  n_left_from = from_frame->n_vectors;
+  next_index = node->cached_next_index;
+
+  while (n_left_from > 0)
+    {
+      u32 n_left_to_next;
+
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left_from >= 8 && n_left_to_next >= 4)
+        {
+          u32 bi0, bi1, bi2, bi3;
+          vlib_buffer_t * b0, * b1, * b2, * b3;
+          u32 next0, next1, next2, next3;
+          u32 sw_if_index0, sw_if_index1, sw_if_index2, sw_if_index3;
+          void * l30, * l31, * l32, * l33;
+          u32 syn;
+
+          /* Prefetch next iteration. */
+          {
+            vlib_buffer_t * p4, * p5, * p6, * p7;
+
+            p4 = vlib_get_buffer (vm, from[4]);
+            p5 = vlib_get_buffer (vm, from[5]);
+            p6 = vlib_get_buffer (vm, from[6]);
+            p7 = vlib_get_buffer (vm, from[7]);
+
+            vlib_prefetch_buffer_header (p4, LOAD);
+            vlib_prefetch_buffer_header (p5, LOAD);
+            vlib_prefetch_buffer_header (p6, LOAD);
+            vlib_prefetch_buffer_header (p7, LOAD);
+
+            CLIB_PREFETCH (p4->data, 2 * CLIB_CACHE_LINE_BYTES, LOAD);
+            CLIB_PREFETCH (p5->data, 2 * CLIB_CACHE_LINE_BYTES, LOAD);
+            CLIB_PREFETCH (p6->data, 2 * CLIB_CACHE_LINE_BYTES, LOAD);
+            CLIB_PREFETCH (p7->data, 2 * CLIB_CACHE_LINE_BYTES, LOAD);
+          }
+
+          bi0 = to_next[0] = from[0];
+          bi1 = to_next[1] = from[1];
+          bi2 = to_next[2] = from[2];
+          bi3 = to_next[3] = from[3];
+          from += 4;
+          to_next += 4;
+          n_left_from -= 4;
+          n_left_to_next -= 4;
+
+          b0 = vlib_get_buffer (vm, bi0);
+          b1 = vlib_get_buffer (vm, bi1);
+          b2 = vlib_get_buffer (vm, bi2);
+          b3 = vlib_get_buffer (vm, bi3);
+
+          l30 = pppox_mss_clamp_l3 (b0, is_output);
+          l31 = pppox_mss_clamp_l3 (b1, is_output);
+          l32 = pppox_mss_clamp_l3 (b2, is_output);
+          l33 = pppox_mss_clamp_l3 (b3, is_output);
+
+          sw_if_index0 = vnet_buffer (b0)->sw_if_index[dir];
+          sw_if_index1 = vnet_buffer (b1)->sw_if_index[dir];
+          sw_if_index2 = vnet_buffer (b2)->sw_if_index[dir];
+          sw_if_index3 = vnet_buffer (b3)->sw_if_index[dir];
+
+          // one branch for the four packets, taken only when a SYN is there.
+          syn = pppox_mss_clamp_is_syn (l30, is_ip6)
+            | (pppox_mss_clamp_is_syn (l31, is_ip6) << 1)
+            | (pppox_mss_clamp_is_syn (l32, is_ip6) << 2)
+            | (pppox_mss_clamp_is_syn (l33, is_ip6) << 3);
+
+          if (PREDICT_FALSE (syn))
+            {
+              if (syn & 1)
+                pkts_clamped += pppox_mss_clamp_buffer (vm, node, pom, b0, l30,
+                                                        sw_if_index0, is_ip6);
+              if (syn & 2)
+                pkts_clamped += pppox_mss_clamp_buffer (vm, node, pom, b1, l31,
+                                                        sw_if_index1, is_ip6);
+              if (syn & 4)
+                pkts_clamped += pppox_mss_clamp_buffer (vm, node, pom, b2, l32,
+                                                        sw_if_index2, is_ip6);
+              if (syn & 8)
+                pkts_clamped += pppox_mss_clamp_buffer (vm, node, pom, b3, l33,
+                                                        sw_if_index3, is_ip6);
+            }
+
+          vnet_feature_next (sw_if_index0, &next0, b0);
+          vnet_feature_next (sw_if_index1, &next1, b1);
+          vnet_feature_next (sw_if_index2, &next2, b2);
+          vnet_feature_next (sw_if_index3, &next3, b3);
+
+          vlib_validate_buffer_enqueue_x4 (vm, node, next_index,
+                                           to_next, n_left_to_next,
+                                           bi0, bi1, bi2, bi3,
+                                           next0, next1, next2, next3);
+        }
+
+      while (n_left_from > 0 && n_left_to_next > 0)
+        {
+          u32 bi0;
+          vlib_buffer_t * b0;
+          u32 next0;
+          u32 sw_if_index0;
+          void * l30;
+
+          bi0 = to_next[0] = from[0];
+          from += 1;
+          to_next += 1;
+          n_left_from -= 1;
+          n_left_to_next -= 1;
+
+          b0 = vlib_get_buffer (vm, bi0);
+          l30 = pppox_mss_clamp_l3 (b0, is_output);
+          sw_if_index0 = vnet_buffer (b0)->sw_if_index[dir];
+
+          if (PREDICT_FALSE (pppox_mss_clamp_is_syn (l30, is_ip6)))
+            pkts_clamped += pppox_mss_clamp_buffer (vm, node, pom, b0, l30,
+                                                    sw_if_index0, is_ip6);
+
+          vnet_feature_next (sw_if_index0, &next0, b0);
+
+          vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
+                                           to_next, n_left_to_next,
+                                           bi0, next0);
+        }
+
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  vlib_node_increment_counter (vm, node->node_index,
+                               PPPOX_ERROR_TCP_MSS_CLAMPED, pkts_clamped);
+  return from_frame->n_vectors;
+}
+
+static uword
+pppox_mss_clamp_ip4_in (vlib_main_t * vm, vlib_node_runtime_t * node,
+                        vlib_frame_t * from_frame)
+{
+  return pppox_mss_clamp_inline (vm, node, from_frame, 0, 0);
+}
+
+static uword
+pppox_mss_clamp_ip4_out (vlib_main_t * vm, vlib_node_runtime_t * node,
+                         vlib_frame_t * from_frame)
+{
+  return pppox_mss_clamp_inline (vm, node, from_frame, 0, 1);
+}
+
+static uword
+pppox_mss_clamp_ip6_in (vlib_main_t * vm, vlib_node_runtime_t * node,
+                        vlib_frame_t * from_frame)
+{
+  return pppox_mss_clamp_inline (vm, node, from_frame, 1, 0);
+}
+
+static uword
+pppox_mss_clamp_ip6_out (vlib_main_t * vm, vlib_node_runtime_t * node,
+                         vlib_frame_t * from_frame)
+{
+  return pppox_mss_clamp_inline (vm, node, from_frame, 1, 1);
+}
+
+#define foreach_pppox_mss_clamp_node            \
+_(ip4_in, "pppox-mss-clamp-ip4-in")             \
+_(ip4_out, "pppox-mss-clamp-ip4-out")           \
+_(ip6_in, "pppox-mss-clamp-ip6-in")             \
+_(ip6_out, "pppox-mss-clamp-ip6-out")
+
+#define _(f,n)                                                  \
+VLIB_REGISTER_NODE (pppox_mss_clamp_##f##_node, static) = {    \
+  .function = pppox_mss_clamp_##f,                              \
+  .name = n,                                                    \
+  .vector_size = sizeof (u32),                                  \
+  .format_trace = format_pppox_mss_clamp_trace,                 \
+  .type = VLIB_NODE_TYPE_INTERNAL,                              \
+  .n_errors = ARRAY_LEN(pppox_error_strings),                   \
+  .error_strings = pppox_error_strings,                         \
+  .n_next_nodes = 1,                                            \
+  .next_nodes = {                                               \
+    [0] = "error-drop",                                         \
+  },                                                            \
+};                                                              \
+VLIB_NODE_FUNCTION_MULTIARCH (pppox_mss_clamp_##f##_node,       \
+                              pppox_mss_clamp_##f)
+foreach_pppox_mss_clamp_node
+#undef _
+
+VNET_FEATURE_INIT (pppox_mss_clamp_ip4_in_feat, static) = {
+  .arc_name = "ip4-unicast",
+  .node_name = "pppox-mss-clamp-ip4-in",
+  .runs_before = VNET_FEATURES ("ip4-lookup"),
+};
+
+VNET_FEATURE_INIT (pppox_mss_clamp_ip6_in_feat, static) = {
+  .arc_name = "ip6-unicast",
+  .node_name = "pppox-mss-clamp-ip6-in",
+  .runs_before = VNET_FEATURES ("ip6-lookup"),
+};
+
+// before the midchain hands the packet to the uplink.
+VNET_FEATURE_INIT (pppox_mss_clamp_ip4_out_feat, static) = {
+  .arc_name = "ip4-output",
+  .node_name = "pppox-mss-clamp-ip4-out",
+  .runs_before = VNET_FEATURES ("adj-midchain-tx", "adj-midchain-tx-no-count"),
+};
+
+VNET_FEATURE_INIT (pppox_mss_clamp_ip6_out_feat, static) = {
+  .arc_name = "ip6-output",
+  .node_name = "pppox-mss-clamp-ip6-out",
+  .runs_before = VNET_FEATURES ("adj-midchain-tx", "adj-midchain-tx-no-count"),
+};
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -110,6 +110,7 @@
 #include "chap-new.h"
 #include "eap.h"
 #include "pathnames.h"
+#include "unit.h"
 
 //static const char rcsid[] = RCSID;
 
@@ -118,21 +119,9 @@
 /* The name by which the peer authenticated itself to us. */
 char peer_authname[MAXNAMELEN];
 
-/* Records which authentication operations haven't completed yet. */
-static int auth_pending[NUM_PPP];
-
-/* Records which authentication operations have been completed. */
-int auth_done[NUM_PPP];
-
 /* Remote telephone number, if available */
 char remote_number[MAXNAMELEN];
 
-/* Number of network protocols which we have opened. */
-static int num_np_open[NUM_PPP];
-
-/* Number of network protocols which have come up. */
-static int num_np_up[NUM_PPP];
-
 /* Set if we got the contents of passwd[] from the pap-secrets file. */
 static int passwd_from_file;
 
@@ -202,17 +191,16 @@ extern char *crypt __P((const char *, const char *));
 
 static void network_phase __P((int));
 
-// ZDY: add an auth context to store unit to support multiple instances.
-typedef struct auth_context {
-    int unit;			/* Interface unit number */
-} auth_context;
-
-static auth_context auth_contexts[NUM_PPP];
-
+// ZDY: auth state now lives in the unit context, reset it on each lower up.
 void
 init_auth_context(int unit)
 {
-  auth_contexts[unit].unit = unit;
+  ppp_unit_t *ppp = ppp_unit (unit);
+
+  ppp->auth_pending = 0;
+  ppp->auth_done = 0;
+  ppp->num_np_open = 0;
+  ppp->num_np_up = 0;
 }
 
 /*
@@ -246,7 +234,7 @@ void
 link_terminated(unit)
     int unit;
 {
-    if (phase[unit] == PHASE_DEAD || phase[unit] == PHASE_MASTER)
+    if (ppp_unit (unit)->phase == PHASE_DEAD || ppp_unit (unit)->phase == PHASE_MASTER)
 	return;
     new_phase(unit, PHASE_DISCONNECT);
 
@@ -274,7 +262,7 @@ link_down(unit)
 {
     if (!doing_multilink) {
 	upper_layers_down(unit);
-	if (phase[unit] != PHASE_DEAD && phase[unit] != PHASE_MASTER)
+	if (ppp_unit (unit)->phase != PHASE_DEAD && ppp_unit (unit)->phase != PHASE_MASTER)
 	  new_phase(unit, PHASE_ESTABLISH);
     }
     /* XXX if doing_multilink, should do something to stop
@@ -295,8 +283,8 @@ void upper_layers_down(int unit)
         if (protp->protocol < 0xC000 && protp->close != NULL)
 	    (*protp->close)(unit, "LCP down");
     }
-    num_np_open[unit] = 0;
-    num_np_up[unit] = 0;
+    ppp_unit (unit)->num_np_open = 0;
+    ppp_unit (unit)->num_np_up = 0;
 }
 
 /*
@@ -308,8 +296,8 @@ link_established(unit)
     int unit;
 {
     int auth;
-    lcp_options *go = &lcp_gotoptions[unit];
-    lcp_options *ho = &lcp_hisoptions[unit];
+    lcp_options *go = &ppp_unit (unit)->lcp_gotoptions;
+    lcp_options *ho = &ppp_unit (unit)->lcp_hisoptions;
     int i;
     struct protent *protp;
 
@@ -323,6 +311,14 @@ link_established(unit)
 		(*protp->lowerup)(unit);
     }
 
+    // ZDY: a session restored after restart was authenticated before,
+    // its NCP comes back opened without negotiating.
+    if (ppp_unit (unit)->restoring) {
+	new_phase(unit, PHASE_NETWORK);
+	ipcp_restore(unit);
+	return;
+    }
+
     new_phase(unit, PHASE_AUTHENTICATE);
     auth = 0;
     if (go->neg_eap) {
@@ -346,8 +342,8 @@ link_established(unit)
         upap_authwithpeer(unit);
 	auth |= PAP_WITHPEER;
     }
-    auth_pending[unit] = auth;
-    auth_done[unit] = 0;
+    ppp_unit (unit)->auth_pending = auth;
+    ppp_unit (unit)->auth_done = 0;
 
     if (!auth)
 	network_phase(unit);
@@ -360,7 +356,7 @@ static void
 network_phase(unit)
     int unit;
 {
-    lcp_options *go = &lcp_gotoptions[unit];
+    lcp_options *go = &ppp_unit (unit)->lcp_gotoptions;
 
     /* Log calling number. */
     if (*remote_number)
@@ -397,6 +393,13 @@ start_networks(unit)
 
     new_phase(unit, PHASE_NETWORK);
 
+    // ZDY: a link with multilink negotiated joins its bundle. NCPs run on
+    // the first link of the bundle only, the others just carry fragments.
+    if (ppp_unit (unit)->lcp_gotoptions.neg_mrru
+	&& ppp_unit (unit)->lcp_hisoptions.neg_mrru
+	&& sifmpjoin(unit))
+	return;
+
 #ifdef HAVE_MULTILINK
     if (multilink) {
 	if (mp_join_bundle()) {
@@ -422,8 +425,8 @@ start_networks(unit)
     /*
      * Bring up other network protocols iff encryption is not required.
      */
-    ecp_required = ecp_gotoptions[unit].required;
-    mppe_required = ccp_gotoptions[unit].mppe;
+    ecp_required = ppp_unit (unit)->ecp_gotoptions.required;
+    mppe_required = ppp_unit (unit)->ccp_gotoptions.mppe;
     if (!ecp_required && !mppe_required)
 	continue_networks(unit);
 }
@@ -443,10 +446,10 @@ continue_networks(unit)
 	    && protp->protocol != PPP_CCP && protp->protocol != PPP_ECP
 	    && protp->enabled_flag && protp->open != NULL) {
 	    (*protp->open)(unit);
-	    ++num_np_open[unit];
+	    ++ppp_unit (unit)->num_np_open;
 	}
 
-    if (num_np_open[unit] == 0)
+    if (ppp_unit (unit)->num_np_open == 0)
 	/* nothing to do */
 	lcp_close(unit, "No network protocols running");
 }
@@ -514,13 +517,13 @@ auth_peer_success(unit, protocol, prot_flavor, name, namelen)
     script_setenv("PEERNAME", peer_authname, 0);
 
     /* Save the authentication method for later. */
-    auth_done[unit] |= bit;
+    ppp_unit (unit)->auth_done |= bit;
 
     /*
      * If there is no more authentication still to be done,
      * proceed to the network (or callback) phase.
      */
-    if ((auth_pending[unit] &= ~bit) == 0)
+    if ((ppp_unit (unit)->auth_pending &= ~bit) == 0)
         network_phase(unit);
 }
 
@@ -589,13 +592,13 @@ auth_withpeer_success(unit, protocol, prot_flavor)
     notice("[%d], %s authentication succeeded", unit, prot);
 
     /* Save the authentication method for later. */
-    auth_done[unit] |= bit;
+    ppp_unit (unit)->auth_done |= bit;
 
     /*
      * If there is no more authentication still being done,
      * proceed to the network (or callback) phase.
      */
-    if ((auth_pending[unit] &= ~bit) == 0)
+    if ((ppp_unit (unit)->auth_pending &= ~bit) == 0)
 	network_phase(unit);
 }
 
@@ -607,7 +610,7 @@ void
 np_up(unit, proto)
     int unit, proto;
 {
-    if (num_np_up[unit] == 0) {
+    if (ppp_unit (unit)->num_np_up == 0) {
 	/*
 	 * At this point we consider that the link has come up successfully.
 	 */
@@ -621,7 +624,7 @@ np_up(unit, proto)
 	if (updetach && !nodetach)
 	    detach();
     }
-    ++num_np_up[unit];
+    ++ppp_unit (unit)->num_np_up;
 }
 
 /*
@@ -631,7 +634,7 @@ void
 np_down(unit, proto)
     int unit, proto;
 {
-    if (--num_np_up[unit] == 0) {
+    if (--ppp_unit (unit)->num_np_up == 0) {
 	new_phase(unit, PHASE_NETWORK);
     }
 }
@@ -643,7 +646,7 @@ void
 np_finished(unit, proto)
     int unit, proto;
 {
-    if (--num_np_open[unit] <= 0) {
+    if (--ppp_unit (unit)->num_np_open <= 0) {
 	/* no further use for the link: shut up shop. */
 	lcp_close(unit, "No network protocols running");
     }
@@ -658,8 +661,8 @@ void
 auth_reset(unit)
     int unit;
 {
-  //lcp_options *go = &lcp_gotoptions[unit];
-    lcp_options *ao = &lcp_allowoptions[unit];
+  //lcp_options *go = &ppp_unit (unit)->lcp_gotoptions;
+    lcp_options *ao = &ppp_unit (unit)->lcp_allowoptions;
     //int hadchap;
 
     //hadchap = -1;
@@ -704,7 +707,7 @@ get_secret(unit, client, server, secret, secret_len, am_server)
       // ZDY: we do not leverage file storage, only support client one-way auth which
       // mean we auth with AC.
       if (!am_server) {
-	memcpy(secbuf, chap_client[unit].us_passwd, chap_client[unit].us_passwdlen);
+	memcpy(secbuf, ppp_unit (unit)->chap_client.us_passwd, ppp_unit (unit)->chap_client.us_passwdlen);
       } else {
 	xerror("[%d], We do not support auth AC currently", unit);
 	return 0;
@@ -37,6 +37,7 @@
 #include "fsm.h"
 #include "ccp.h"
 #include "ppp-comp.h"
+#include "unit.h"
 
 #ifdef MPPE
 #include "chap_ms.h"	/* mppe_xxxx_key, mppe_keys_set */
@@ -89,12 +90,6 @@ struct protent ccp_protent = {
     NULL
 };
 
-fsm ccp_fsm[NUM_PPP];
-ccp_options ccp_wantoptions[NUM_PPP];	/* what to request the peer to use */
-ccp_options ccp_gotoptions[NUM_PPP];	/* what the peer agreed to do */
-ccp_options ccp_allowoptions[NUM_PPP];	/* what we'll agree to do */
-ccp_options ccp_hisoptions[NUM_PPP];	/* what we agreed to do */
-
 /*
  * Callbacks for fsm code.
  */
@@ -137,16 +132,14 @@ static fsm_callbacks ccp_callbacks = {
 				 || (opt).mppe)
 
 /*
- * Local state (mainly for handling reset-reqs and reset-acks).
+ * Local state (mainly for handling reset-reqs and reset-acks),
+ * kept per unit in ccp_localstate.
  */
-static int ccp_localstate[NUM_PPP];
 #define RACK_PENDING	1	/* waiting for reset-ack */
 #define RREQ_REPEAT	2	/* send another reset-req if no reset-ack */
 
 #define RACKTIMEOUT	1	/* second */
 
-static int all_rejected[NUM_PPP];	/* we rejected all peer's options */
-
 /*
  * ccp_init - initialize CCP.
  */
@@ -154,33 +147,33 @@ static void
 ccp_init(unit)
     int unit;
 {
-    fsm *f = &ccp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->ccp_fsm;
 
     f->unit = unit;
     f->protocol = PPP_CCP;
     f->callbacks = &ccp_callbacks;
     fsm_init(f);
 
-    memset(&ccp_wantoptions[unit],  0, sizeof(ccp_options));
-    memset(&ccp_gotoptions[unit],   0, sizeof(ccp_options));
-    memset(&ccp_allowoptions[unit], 0, sizeof(ccp_options));
-    memset(&ccp_hisoptions[unit],   0, sizeof(ccp_options));
-
-    ccp_wantoptions[0].deflate = 1;
-    ccp_wantoptions[0].deflate_size = DEFLATE_MAX_SIZE;
-    ccp_wantoptions[0].deflate_correct = 1;
-    ccp_wantoptions[0].deflate_draft = 1;
-    ccp_allowoptions[0].deflate = 1;
-    ccp_allowoptions[0].deflate_size = DEFLATE_MAX_SIZE;
-    ccp_allowoptions[0].deflate_correct = 1;
-    ccp_allowoptions[0].deflate_draft = 1;
-
-    ccp_wantoptions[0].bsd_compress = 1;
-    ccp_wantoptions[0].bsd_bits = BSD_MAX_BITS;
-    ccp_allowoptions[0].bsd_compress = 1;
-    ccp_allowoptions[0].bsd_bits = BSD_MAX_BITS;
-
-    ccp_allowoptions[0].predictor_1 = 1;
+    memset(&ppp_unit (unit)->ccp_wantoptions,  0, sizeof(ccp_options));
+    memset(&ppp_unit (unit)->ccp_gotoptions,   0, sizeof(ccp_options));
+    memset(&ppp_unit (unit)->ccp_allowoptions, 0, sizeof(ccp_options));
+    memset(&ppp_unit (unit)->ccp_hisoptions,   0, sizeof(ccp_options));
+
+    ppp_unit (unit)->ccp_wantoptions.deflate = 1;
+    ppp_unit (unit)->ccp_wantoptions.deflate_size = DEFLATE_MAX_SIZE;
+    ppp_unit (unit)->ccp_wantoptions.deflate_correct = 1;
+    ppp_unit (unit)->ccp_wantoptions.deflate_draft = 1;
+    ppp_unit (unit)->ccp_allowoptions.deflate = 1;
+    ppp_unit (unit)->ccp_allowoptions.deflate_size = DEFLATE_MAX_SIZE;
+    ppp_unit (unit)->ccp_allowoptions.deflate_correct = 1;
+    ppp_unit (unit)->ccp_allowoptions.deflate_draft = 1;
+
+    ppp_unit (unit)->ccp_wantoptions.bsd_compress = 1;
+    ppp_unit (unit)->ccp_wantoptions.bsd_bits = BSD_MAX_BITS;
+    ppp_unit (unit)->ccp_allowoptions.bsd_compress = 1;
+    ppp_unit (unit)->ccp_allowoptions.bsd_bits = BSD_MAX_BITS;
+
+    ppp_unit (unit)->ccp_allowoptions.predictor_1 = 1;
 }
 
 /*
@@ -190,7 +183,7 @@ static void
 ccp_open(unit)
     int unit;
 {
-    fsm *f = &ccp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->ccp_fsm;
 
     if (f->state != OPENED)
 	ccp_flags_set(unit, 1, 0);
@@ -200,7 +193,7 @@ ccp_open(unit)
      * deciding whether to open in silent mode.
      */
     ccp_resetci(f);
-    if (!ANY_COMPRESS(ccp_gotoptions[unit]))
+    if (!ANY_COMPRESS(ppp_unit (unit)->ccp_gotoptions))
 	f->flags |= OPT_SILENT;
 
     fsm_open(f);
@@ -215,7 +208,7 @@ ccp_close(unit, reason)
     char *reason;
 {
     ccp_flags_set(unit, 0, 0);
-    fsm_close(&ccp_fsm[unit], reason);
+    fsm_close(&ppp_unit (unit)->ccp_fsm, reason);
 }
 
 /*
@@ -225,7 +218,7 @@ static void
 ccp_lowerup(unit)
     int unit;
 {
-    fsm_lowerup(&ccp_fsm[unit]);
+    fsm_lowerup(&ppp_unit (unit)->ccp_fsm);
 }
 
 /*
@@ -235,7 +228,7 @@ static void
 ccp_lowerdown(unit)
     int unit;
 {
-    fsm_lowerdown(&ccp_fsm[unit]);
+    fsm_lowerdown(&ppp_unit (unit)->ccp_fsm);
 }
 
 /*
@@ -247,7 +240,7 @@ ccp_input(unit, p, len)
     u_char *p;
     int len;
 {
-    fsm *f = &ccp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->ccp_fsm;
     int oldstate;
 
     /*
@@ -258,7 +251,7 @@ ccp_input(unit, p, len)
     if (oldstate == OPENED && p[0] == TERMREQ && f->state != OPENED) {
 	notice("Compression disabled by peer.");
 #ifdef MPPE
-	if (ccp_gotoptions[unit].mppe) {
+	if (ppp_unit (unit)->ccp_gotoptions.mppe) {
 	    error("MPPE disabled, closing LCP");
 	    lcp_close(unit, "MPPE disabled by peer");
 	}
@@ -270,7 +263,7 @@ ccp_input(unit, p, len)
      * close CCP.
      */
     if (oldstate == REQSENT && p[0] == TERMACK
-	&& !ANY_COMPRESS(ccp_gotoptions[unit]))
+	&& !ANY_COMPRESS(ppp_unit (unit)->ccp_gotoptions))
 	ccp_close(unit, "No compression negotiated");
 }
 
@@ -294,8 +287,8 @@ ccp_extcode(f, code, id, p, len)
 	break;
 
     case CCP_RESETACK:
-	if (ccp_localstate[f->unit] & RACK_PENDING && id == f->reqid) {
-	    ccp_localstate[f->unit] &= ~(RACK_PENDING | RREQ_REPEAT);
+	if (ppp_unit (f->unit)->ccp_localstate & RACK_PENDING && id == f->reqid) {
+	    ppp_unit (f->unit)->ccp_localstate &= ~(RACK_PENDING | RREQ_REPEAT);
 	    UNTIMEOUT(ccp_rack_timeout, f);
 	}
 	break;
@@ -315,10 +308,10 @@ ccp_protrej(unit)
     int unit;
 {
     ccp_flags_set(unit, 0, 0);
-    fsm_lowerdown(&ccp_fsm[unit]);
+    fsm_lowerdown(&ppp_unit (unit)->ccp_fsm);
 
 #ifdef MPPE
-    if (ccp_gotoptions[unit].mppe) {
+    if (ppp_unit (unit)->ccp_gotoptions.mppe) {
 	xerror("MPPE required but peer negotiation failed");
 	lcp_close(unit, "MPPE required but peer negotiation failed");
     }
@@ -333,16 +326,16 @@ static void
 ccp_resetci(f)
     fsm *f;
 {
-    ccp_options *go = &ccp_gotoptions[f->unit];
+    ccp_options *go = &ppp_unit (f->unit)->ccp_gotoptions;
     u_char opt_buf[CCP_MAX_OPTION_LENGTH];
 
-    *go = ccp_wantoptions[f->unit];
-    all_rejected[f->unit] = 0;
+    *go = ppp_unit (f->unit)->ccp_wantoptions;
+    ppp_unit (f->unit)->all_rejected = 0;
 
 #ifdef MPPE
     if (go->mppe) {
-	ccp_options *ao = &ccp_allowoptions[f->unit];
-	int auth_mschap_bits = auth_done[f->unit];
+	ccp_options *ao = &ppp_unit (f->unit)->ccp_allowoptions;
+	int auth_mschap_bits = ppp_unit (f->unit)->auth_done;
 	int numbits;
 
 	/*
@@ -385,12 +378,12 @@ ccp_resetci(f)
 	}
 
 	/* LM auth not supported for MPPE */
-	if (auth_done[f->unit] & (CHAP_MS_WITHPEER | CHAP_MS_PEER)) {
+	if (ppp_unit (f->unit)->auth_done & (CHAP_MS_WITHPEER | CHAP_MS_PEER)) {
 	    /* This might be noise */
 	    if (go->mppe & MPPE_OPT_40) {
 		notice("Disabling 40-bit MPPE; MS-CHAP LM not supported");
 		go->mppe &= ~MPPE_OPT_40;
-		ccp_wantoptions[f->unit].mppe &= ~MPPE_OPT_40;
+		ppp_unit (f->unit)->ccp_wantoptions.mppe &= ~MPPE_OPT_40;
 	    }
 	}
 
@@ -476,7 +469,7 @@ static int
 ccp_cilen(f)
     fsm *f;
 {
-    ccp_options *go = &ccp_gotoptions[f->unit];
+    ccp_options *go = &ppp_unit (f->unit)->ccp_gotoptions;
 
     return (go->bsd_compress? CILEN_BSD_COMPRESS: 0)
 	+ (go->deflate? CILEN_DEFLATE: 0)
@@ -495,7 +488,7 @@ ccp_addci(f, p, lenp)
     int *lenp;
 {
     int res;
-    ccp_options *go = &ccp_gotoptions[f->unit];
+    ccp_options *go = &ppp_unit (f->unit)->ccp_gotoptions;
     u_char *p0 = p;
 
     /*
@@ -613,7 +606,7 @@ ccp_ackci(f, p, len)
     u_char *p;
     int len;
 {
-    ccp_options *go = &ccp_gotoptions[f->unit];
+    ccp_options *go = &ppp_unit (f->unit)->ccp_gotoptions;
     u_char *p0 = p;
 
 #ifdef MPPE
@@ -703,7 +696,7 @@ ccp_nakci(f, p, len, treat_as_reject)
     int len;
     int treat_as_reject;
 {
-    ccp_options *go = &ccp_gotoptions[f->unit];
+    ccp_options *go = &ppp_unit (f->unit)->ccp_gotoptions;
     ccp_options no;		/* options we've seen already */
     ccp_options try;		/* options to ask for next time */
 
@@ -792,7 +785,7 @@ ccp_rejci(f, p, len)
     u_char *p;
     int len;
 {
-    ccp_options *go = &ccp_gotoptions[f->unit];
+    ccp_options *go = &ppp_unit (f->unit)->ccp_gotoptions;
     ccp_options try;		/* options to request next time */
 
     try = *go;
@@ -801,7 +794,7 @@ ccp_rejci(f, p, len)
      * Cope with empty configure-rejects by ceasing to send
      * configure-requests.
      */
-    if (len == 0 && all_rejected[f->unit])
+    if (len == 0 && ppp_unit (f->unit)->all_rejected)
 	return -1;
 
 #ifdef MPPE
@@ -878,8 +871,8 @@ ccp_reqci(f, p, lenp, dont_nak)
     int ret, newret, res;
     u_char *p0, *retp;
     int len, clen, type, nb;
-    ccp_options *ho = &ccp_hisoptions[f->unit];
-    ccp_options *ao = &ccp_allowoptions[f->unit];
+    ccp_options *ho = &ppp_unit (f->unit)->ccp_hisoptions;
+    ccp_options *ao = &ppp_unit (f->unit)->ccp_allowoptions;
 #ifdef MPPE
     bool rej_for_ci_mppe = 1;	/* Are we rejecting based on a bad/missing */
 				/* CI_MPPE, or due to other options?       */
@@ -1143,7 +1136,7 @@ ccp_reqci(f, p, lenp, dont_nak)
 
     if (ret != CONFACK) {
 	if (ret == CONFREJ && *lenp == retp - p0)
-	    all_rejected[f->unit] = 1;
+	    ppp_unit (f->unit)->all_rejected = 1;
 	else
 	    *lenp = retp - p0;
     }
@@ -1228,8 +1221,8 @@ static void
 ccp_up(f)
     fsm *f;
 {
-    ccp_options *go = &ccp_gotoptions[f->unit];
-    ccp_options *ho = &ccp_hisoptions[f->unit];
+    ccp_options *go = &ppp_unit (f->unit)->ccp_gotoptions;
+    ccp_options *ho = &ppp_unit (f->unit)->ccp_hisoptions;
     char method1[64];
 
     ccp_flags_set(f->unit, 1, 1);
@@ -1262,14 +1255,14 @@ static void
 ccp_down(f)
     fsm *f;
 {
-    if (ccp_localstate[f->unit] & RACK_PENDING)
+    if (ppp_unit (f->unit)->ccp_localstate & RACK_PENDING)
 	UNTIMEOUT(ccp_rack_timeout, f);
-    ccp_localstate[f->unit] = 0;
+    ppp_unit (f->unit)->ccp_localstate = 0;
     ccp_flags_set(f->unit, 1, 0);
 #ifdef MPPE
-    if (ccp_gotoptions[f->unit].mppe) {
-	ccp_gotoptions[f->unit].mppe = 0;
-	if (lcp_fsm[f->unit].state == OPENED) {
+    if (ppp_unit (f->unit)->ccp_gotoptions.mppe) {
+	ppp_unit (f->unit)->ccp_gotoptions.mppe = 0;
+	if (ppp_unit (f->unit)->lcp_fsm.state == OPENED) {
 	    /* If LCP is not already going down, make sure it does. */
 	    xerror("MPPE disabled");
 	    lcp_close(f->unit, "MPPE disabled");
@@ -1429,7 +1422,7 @@ ccp_datainput(unit, pkt, len)
 {
     fsm *f;
 
-    f = &ccp_fsm[unit];
+    f = &ppp_unit (unit)->ccp_fsm;
     if (f->state == OPENED) {
 	if (ccp_fatal_error(unit)) {
 	    /*
@@ -1441,7 +1434,7 @@ ccp_datainput(unit, pkt, len)
 	    /*
 	     * If we were doing MPPE, we must also take the link down.
 	     */
-	    if (ccp_gotoptions[unit].mppe) {
+	    if (ppp_unit (unit)->ccp_gotoptions.mppe) {
 		xerror("Too many MPPE errors, closing LCP");
 		lcp_close(unit, "Too many MPPE errors");
 	    }
@@ -1452,12 +1445,12 @@ ccp_datainput(unit, pkt, len)
 	     * We don't do that if we are still waiting for an
 	     * acknowledgement to a previous reset-request.
 	     */
-	    if (!(ccp_localstate[f->unit] & RACK_PENDING)) {
+	    if (!(ppp_unit (f->unit)->ccp_localstate & RACK_PENDING)) {
 		fsm_sdata(f, CCP_RESETREQ, f->reqid = ++f->id, NULL, 0);
 		TIMEOUT(ccp_rack_timeout, f, RACKTIMEOUT);
-		ccp_localstate[f->unit] |= RACK_PENDING;
+		ppp_unit (f->unit)->ccp_localstate |= RACK_PENDING;
 	    } else
-		ccp_localstate[f->unit] |= RREQ_REPEAT;
+		ppp_unit (f->unit)->ccp_localstate |= RREQ_REPEAT;
 	}
     }
 }
@@ -1471,10 +1464,10 @@ ccp_rack_timeout(arg)
 {
     fsm *f = arg;
 
-    if (f->state == OPENED && ccp_localstate[f->unit] & RREQ_REPEAT) {
+    if (f->state == OPENED && ppp_unit (f->unit)->ccp_localstate & RREQ_REPEAT) {
 	fsm_sdata(f, CCP_RESETREQ, f->reqid, NULL, 0);
 	TIMEOUT(ccp_rack_timeout, f, RACKTIMEOUT);
-	ccp_localstate[f->unit] &= ~RREQ_REPEAT;
+	ppp_unit (f->unit)->ccp_localstate &= ~RREQ_REPEAT;
     } else
-	ccp_localstate[f->unit] &= ~RACK_PENDING;
+	ppp_unit (f->unit)->ccp_localstate &= ~RACK_PENDING;
 }
@@ -30,6 +30,9 @@
  * $Id: ccp.h,v 1.12 2004/11/04 10:02:26 paulus Exp $
  */
 
+#ifndef __CCP_H__
+#define __CCP_H__
+
 typedef struct ccp_options {
     bool bsd_compress;		/* do BSD Compress? */
     bool deflate;		/* do Deflate? */
@@ -43,10 +46,7 @@ typedef struct ccp_options {
     short method;		/* code for chosen compression method */
 } ccp_options;
 
-extern fsm ccp_fsm[];
-extern ccp_options ccp_wantoptions[];
-extern ccp_options ccp_gotoptions[];
-extern ccp_options ccp_allowoptions[];
-extern ccp_options ccp_hisoptions[];
 
 extern struct protent ccp_protent;
+
+#endif /* __CCP_H__ */
@@ -37,6 +37,7 @@
 #include "pppd.h"
 #include "chap-new.h"
 #include "chap-md5.h"
+#include "unit.h"
 
 #ifdef CHAPMS
 #include "chap_ms.h"
@@ -74,10 +75,6 @@ static option_t chap_option_list[] = {
 };
 
 
-// ZDY: make global state for support multiple ppp connection.
-struct chap_client_state chap_client[NUM_PPP];
-struct chap_server_state chap_server[NUM_PPP];
-
 /* Values for flags in chap_client_state and chap_server_state */
 #define LOWERUP			1
 #define AUTH_STARTED		2
@@ -122,13 +119,15 @@ chap_init(int unit)
     // clean when init because lcp maybe restart.
     // wo we reset each non crendential bits of chap_client.
 #if 0
-        memset(&chap_client[unit], 0, sizeof(chap_client));
+        memset(&ppp_unit (unit)->chap_client, 0, sizeof(ppp_unit (unit)->chap_client));
 #endif
-	chap_client[unit].flags = 0;
-	chap_client[unit].name = NULL;
-	chap_client[unit].digest = NULL;
-	memset(&chap_client[unit].priv, 0, sizeof(chap_client[unit].priv));
-	memset(&chap_server[unit], 0, sizeof(chap_server));
+	ppp_unit (unit)->chap_client.flags = 0;
+	ppp_unit (unit)->chap_client.name = NULL;
+	ppp_unit (unit)->chap_client.digest = NULL;
+	memset(&ppp_unit (unit)->chap_client.priv, 0, sizeof(ppp_unit (unit)->chap_client.priv));
+	ppp_unit (unit)->chap_client.unit = unit;
+	memset(&ppp_unit (unit)->chap_server, 0, sizeof(ppp_unit (unit)->chap_server));
+	ppp_unit (unit)->chap_server.unit = unit;
 
 
 	chap_md5_init();
@@ -153,8 +152,8 @@ chap_register_digest(struct chap_digest_type *dp)
 static void
 chap_lowerup(int unit)
 {
-	struct chap_client_state *cs = &chap_client[unit];
-	struct chap_server_state *ss = &chap_server[unit];
+	struct chap_client_state *cs = &ppp_unit (unit)->chap_client;
+	struct chap_server_state *ss = &ppp_unit (unit)->chap_server;
 
 	cs->flags |= LOWERUP;
 	ss->flags |= LOWERUP;
@@ -165,8 +164,8 @@ chap_lowerup(int unit)
 static void
 chap_lowerdown(int unit)
 {
-	struct chap_client_state *cs = &chap_client[unit];
-	struct chap_server_state *ss = &chap_server[unit];
+	struct chap_client_state *cs = &ppp_unit (unit)->chap_client;
+	struct chap_server_state *ss = &ppp_unit (unit)->chap_server;
 
 	cs->flags = 0;
 	if (ss->flags & TIMEOUT_PENDING)
@@ -182,7 +181,7 @@ chap_lowerdown(int unit)
 void
 chap_auth_peer(int unit, char *our_name, int digest_code)
 {
-	struct chap_server_state *ss = &chap_server[unit];
+	struct chap_server_state *ss = &ppp_unit (unit)->chap_server;
 	struct chap_digest_type *dp;
 
 	if (ss->flags & AUTH_STARTED) {
@@ -212,7 +211,7 @@ chap_auth_peer(int unit, char *our_name, int digest_code)
 void
 chap_auth_with_peer(int unit, char *our_name, int digest_code)
 {
-	struct chap_client_state *cs = &chap_client[unit];
+	struct chap_client_state *cs = &ppp_unit (unit)->chap_client;
 	struct chap_digest_type *dp;
 
 	if (cs->flags & AUTH_STARTED) {
@@ -242,7 +241,7 @@ static void
 chap_timeout(void *arg)
 {
 	struct chap_server_state *ss = arg;
-	int unit = ss - &chap_server[0];
+	int unit = ss->unit;
 
 	ss->flags &= ~TIMEOUT_PENDING;
 	if ((ss->flags & CHALLENGE_VALID) == 0) {
@@ -303,7 +302,7 @@ chap_handle_response(struct chap_server_state *ss, int id,
 	int (*verifier)(int, char *, char *, int, struct chap_digest_type *,
 		unsigned char *, unsigned char *, char *, int);
 	char rname[MAXNAMELEN+1];
-	int unit = ss - &chap_server[0];
+	int unit = ss->unit;
 
 	if ((ss->flags & LOWERUP) == 0)
 		return;
@@ -417,7 +416,7 @@ chap_respond(struct chap_client_state *cs, int id,
 	unsigned char response[RESP_MAX_PKTLEN];
 	char rname[MAXNAMELEN+1];
 	char secret[MAXSECRETLEN+1];
-	int unit = cs - &chap_client[0];
+	int unit = cs->unit;
 
 	if ((cs->flags & (LOWERUP | AUTH_STARTED)) != (LOWERUP | AUTH_STARTED))
 		return;		/* not ready */
@@ -470,7 +469,7 @@ chap_handle_status(struct chap_client_state *cs, int code, int id,
 		   unsigned char *pkt, int len)
 {
 	const char *msg = NULL;
-	int unit = cs - &chap_client[0];
+	int unit = cs->unit;
 
 	if ((cs->flags & (AUTH_DONE|AUTH_STARTED|LOWERUP))
 	    != (AUTH_STARTED|LOWERUP))
@@ -508,8 +507,8 @@ chap_handle_status(struct chap_client_state *cs, int code, int id,
 static void
 chap_input(int unit, unsigned char *pkt, int pktlen)
 {
-	struct chap_client_state *cs = &chap_client[unit];
-	struct chap_server_state *ss = &chap_server[unit];
+	struct chap_client_state *cs = &ppp_unit (unit)->chap_client;
+	struct chap_server_state *ss = &ppp_unit (unit)->chap_server;
 	unsigned char code, id;
 	int len;
 
@@ -539,8 +538,8 @@ chap_input(int unit, unsigned char *pkt, int pktlen)
 static void
 chap_protrej(int unit)
 {
-	struct chap_client_state *cs = &chap_client[unit];
-	struct chap_server_state *ss = &chap_server[unit];
+	struct chap_client_state *cs = &ppp_unit (unit)->chap_client;
+	struct chap_server_state *ss = &ppp_unit (unit)->chap_server;
 
 	if (ss->flags & TIMEOUT_PENDING) {
 		ss->flags &= ~TIMEOUT_PENDING;
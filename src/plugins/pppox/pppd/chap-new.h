@@ -28,6 +28,9 @@
  * OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifndef __CHAP_NEW_H__
+#define __CHAP_NEW_H__
+
 /*
  * CHAP packets begin with a standard header with code, id, len (2 bytes).
  */
@@ -89,6 +92,7 @@ extern int chap_mdtype_all;
 
 // ZDY: moved out c/s state.
 struct chap_client_state {
+  int unit;			/* Interface unit number */
   int flags;
   char *name;
   char *us_user;		/* User */
@@ -99,7 +103,6 @@ struct chap_client_state {
   unsigned char priv[64];		/* private area for digest's use */
 };
 
-extern struct chap_client_state chap_client[NUM_PPP];
 
 /*
  * These limits apply to challenge and response packets we send.
@@ -109,6 +112,7 @@ extern struct chap_client_state chap_client[NUM_PPP];
 #define RESP_MAX_PKTLEN	(PPP_HDRLEN + CHAP_HDRLEN + 4 + MAX_RESPONSE_LEN + MAXNAMELEN)
 
 struct chap_server_state {
+  int unit;			/* Interface unit number */
   int flags;
   int id;
   char *name;
@@ -119,7 +123,6 @@ struct chap_server_state {
   char message[256];
 };
 
-extern struct chap_server_state chap_server[NUM_PPP];
 
 /*
  * The code for each digest type has to supply one of these.
@@ -162,3 +165,5 @@ extern void chap_auth_with_peer(int unit, char *our_name, int digest_code);
 
 /* Represents the CHAP protocol to the main pppd code */
 extern struct protent chap_protent;
+
+#endif /* __CHAP_NEW_H__ */
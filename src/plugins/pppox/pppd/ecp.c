@@ -66,6 +66,7 @@
 #include "pppd.h"
 #include "fsm.h"
 #include "ecp.h"
+#include "unit.h"
 
 static option_t ecp_option_list[] = {
     { "noecp", o_bool, &ecp_protent.enabled_flag,
@@ -115,12 +116,6 @@ struct protent ecp_protent = {
     NULL
 };
 
-fsm ecp_fsm[NUM_PPP];
-ecp_options ecp_wantoptions[NUM_PPP];	/* what to request the peer to use */
-ecp_options ecp_gotoptions[NUM_PPP];	/* what the peer agreed to do */
-ecp_options ecp_allowoptions[NUM_PPP];	/* what we'll agree to do */
-ecp_options ecp_hisoptions[NUM_PPP];	/* what we agreed to do */
-
 static fsm_callbacks ecp_callbacks = {
     NULL, /* ecp_resetci, */
     NULL, /* ecp_cilen, */
@@ -146,17 +141,17 @@ static void
 ecp_init(unit)
     int unit;
 {
-    fsm *f = &ecp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->ecp_fsm;
 
     f->unit = unit;
     f->protocol = PPP_ECP;
     f->callbacks = &ecp_callbacks;
     fsm_init(f);
 
-    memset(&ecp_wantoptions[unit],  0, sizeof(ecp_options));
-    memset(&ecp_gotoptions[unit],   0, sizeof(ecp_options));
-    memset(&ecp_allowoptions[unit], 0, sizeof(ecp_options));
-    memset(&ecp_hisoptions[unit],   0, sizeof(ecp_options));
+    memset(&ppp_unit (unit)->ecp_wantoptions,  0, sizeof(ecp_options));
+    memset(&ppp_unit (unit)->ecp_gotoptions,   0, sizeof(ecp_options));
+    memset(&ppp_unit (unit)->ecp_allowoptions, 0, sizeof(ecp_options));
+    memset(&ppp_unit (unit)->ecp_hisoptions,   0, sizeof(ecp_options));
 
 }
 
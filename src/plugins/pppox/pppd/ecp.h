@@ -31,15 +31,15 @@
  * $Id: ecp.h,v 1.2 2003/01/10 07:12:36 fcusack Exp $
  */
 
+#ifndef __ECP_H__
+#define __ECP_H__
+
 typedef struct ecp_options {
     bool required;		/* Is ECP required? */
     unsigned enctype;		/* Encryption type */
 } ecp_options;
 
-extern fsm ecp_fsm[];
-extern ecp_options ecp_wantoptions[];
-extern ecp_options ecp_gotoptions[];
-extern ecp_options ecp_allowoptions[];
-extern ecp_options ecp_hisoptions[];
 
 extern struct protent ecp_protent;
+
+#endif /* __ECP_H__ */
@@ -54,6 +54,7 @@
 
 #include "pppd.h"
 #include "fsm.h"
+#include "unit.h"
 
 //static const char rcsid[] = RCSID;
 
@@ -68,8 +69,6 @@ static void fsm_sconfreq __P((fsm *, int));
 
 #define PROTO_NAME(f)	((f)->callbacks->proto_name)
 
-int peer_mru[NUM_PPP];
-
 
 /*
  * fsm_init - Initialize fsm.
@@ -783,8 +782,8 @@ fsm_sconfreq(f, retransmit)
     outp = outpacket_buf + PPP_HDRLEN + HEADERLEN;
     if( f->callbacks->cilen && f->callbacks->addci ){
 	cilen = (*f->callbacks->cilen)(f);
-	if( cilen > peer_mru[f->unit] - HEADERLEN )
-	    cilen = peer_mru[f->unit] - HEADERLEN;
+	if( cilen > ppp_unit (f->unit)->peer_mru - HEADERLEN )
+	    cilen = ppp_unit (f->unit)->peer_mru - HEADERLEN;
 	if (f->callbacks->addci)
 	    (*f->callbacks->addci)(f, outp, &cilen);
     } else
@@ -816,8 +815,8 @@ fsm_sdata(f, code, id, data, datalen)
 
     /* Adjust length to be smaller than MTU */
     outp = outpacket_buf;
-    if (datalen > peer_mru[f->unit] - HEADERLEN)
-	datalen = peer_mru[f->unit] - HEADERLEN;
+    if (datalen > ppp_unit (f->unit)->peer_mru - HEADERLEN)
+	datalen = ppp_unit (f->unit)->peer_mru - HEADERLEN;
     if (datalen && data != outp + PPP_HDRLEN + HEADERLEN)
 	BCOPY(data, outp + PPP_HDRLEN + HEADERLEN, datalen);
     outlen = datalen + HEADERLEN;
@@ -42,6 +42,9 @@
  * $Id: fsm.h,v 1.10 2004/11/13 02:28:15 paulus Exp $
  */
 
+#ifndef __FSM_H__
+#define __FSM_H__
+
 /*
  * Packet header = Code, id, length.
  */
@@ -167,4 +170,5 @@ void fsm_sdata __P((fsm *, int, int, u_char *, int));
 /*
  * Variables
  */
-extern int peer_mru[];		/* currently negotiated peer MRU (per unit) */
+
+#endif /* __FSM_H__ */
@@ -60,15 +60,11 @@
 #include "fsm.h"
 #include "ipcp.h"
 #include "pathnames.h"
+#include "unit.h"
 
 //static const char rcsid[] = RCSID;
 
 /* global vars */
-ipcp_options ipcp_wantoptions[NUM_PPP];	/* Options that we want to request */
-ipcp_options ipcp_gotoptions[NUM_PPP];	/* Options that peer ack'd */
-ipcp_options ipcp_allowoptions[NUM_PPP]; /* Options we allow peer to request */
-ipcp_options ipcp_hisoptions[NUM_PPP];	/* Options that we ack'd */
-
 u_int32_t netmask = 0;		/* IP netmask to set on interface */
 
 bool	disable_defaultip = 0;	/* Don't use hostname for default IP adrs */
@@ -87,14 +83,6 @@ void (*ip_choose_hook) __P((u_int32_t *)) = NULL;
 struct notifier *ip_up_notifier = NULL;
 struct notifier *ip_down_notifier = NULL;
 
-/* local vars */
-static int default_route_set[NUM_PPP];	/* Have set up a default route */
-static int proxy_arp_set[NUM_PPP];	/* Have created proxy arp entry */
-static bool usepeerdns[NUM_PPP];			/* Ask peer for DNS addrs */
-static int ipcp_is_up[NUM_PPP];			/* have called np_up() */
-static int ipcp_is_open[NUM_PPP];		/* haven't called np_finished() */
-static bool ask_for_local[NUM_PPP];		/* request our address from peer */
-
 /*
  * Callbacks for fsm code.  (CI = Configuration Information)
  */
@@ -109,8 +97,6 @@ static void ipcp_up __P((fsm *));		/* We're UP */
 static void ipcp_down __P((fsm *));		/* We're DOWN */
 static void ipcp_finished __P((fsm *));	/* Don't need lower layer */
 
-fsm ipcp_fsm[NUM_PPP];		/* IPCP fsm structure */
-
 static fsm_callbacks ipcp_callbacks = { /* IPCP callback routines */
     ipcp_resetci,		/* Reset our Configuration Information */
     ipcp_cilen,			/* Length of our Configuration Information */
@@ -167,7 +153,9 @@ struct protent ipcp_protent = {
 
 static void ipcp_clear_addrs __P((int, u_int32_t, u_int32_t));
 static void ipcp_script __P((char *, int));	/* Run an up/down script */
+#if 0 // ZDY: scripts are not run on vpp, see ipcp_script.
 static void ipcp_script_done __P((void *));
+#endif
 
 /*
  * Lengths of configuration options.
@@ -212,14 +200,14 @@ static void
 ipcp_init(unit)
     int unit;
 {
-    fsm *f = &ipcp_fsm[unit];
-    ipcp_options *wo = &ipcp_wantoptions[unit];
-    ipcp_options *ao = &ipcp_allowoptions[unit];
+    fsm *f = &ppp_unit (unit)->ipcp_fsm;
+    ipcp_options *wo = &ppp_unit (unit)->ipcp_wantoptions;
+    ipcp_options *ao = &ppp_unit (unit)->ipcp_allowoptions;
 
     f->unit = unit;
     f->protocol = PPP_IPCP;
     f->callbacks = &ipcp_callbacks;
-    fsm_init(&ipcp_fsm[unit]);
+    fsm_init(&ppp_unit (unit)->ipcp_fsm);
 
     /*
      * Some 3G modems use repeated IPCP NAKs as a way of stalling
@@ -256,7 +244,7 @@ ipcp_init(unit)
     ao->default_route = 1;
 
     // ZDY: reset state might be used.
-    memset (&ipcp_gotoptions[unit], 0, sizeof (ipcp_gotoptions[unit]));
+    memset (&ppp_unit (unit)->ipcp_gotoptions, 0, sizeof (ppp_unit (unit)->ipcp_gotoptions));
 }
 
 
@@ -267,8 +255,25 @@ static void
 ipcp_open(unit)
     int unit;
 {
-    fsm_open(&ipcp_fsm[unit]);
-    ipcp_is_open[unit] = 1;
+    fsm_open(&ppp_unit (unit)->ipcp_fsm);
+    ppp_unit (unit)->ipcp_is_open = 1;
+}
+
+
+/*
+ * ZDY: ipcp_restore - IPCP of a unit restored after restart is opened
+ * again with the addresses already in gotoptions and hisoptions.
+ */
+void
+ipcp_restore(unit)
+    int unit;
+{
+    fsm *f = &ppp_unit (unit)->ipcp_fsm;
+
+    ppp_unit (unit)->ipcp_is_open = 1;
+    ++ppp_unit (unit)->num_np_open;
+    f->state = OPENED;
+    ipcp_up(f);
 }
 
 
@@ -280,7 +285,7 @@ ipcp_close(unit, reason)
     int unit;
     char *reason;
 {
-    fsm_close(&ipcp_fsm[unit], reason);
+    fsm_close(&ppp_unit (unit)->ipcp_fsm, reason);
 }
 
 
@@ -291,7 +296,7 @@ static void
 ipcp_lowerup(unit)
     int unit;
 {
-    fsm_lowerup(&ipcp_fsm[unit]);
+    fsm_lowerup(&ppp_unit (unit)->ipcp_fsm);
 }
 
 
@@ -302,7 +307,7 @@ static void
 ipcp_lowerdown(unit)
     int unit;
 {
-    fsm_lowerdown(&ipcp_fsm[unit]);
+    fsm_lowerdown(&ppp_unit (unit)->ipcp_fsm);
 }
 
 
@@ -315,7 +320,7 @@ ipcp_input(unit, p, len)
     u_char *p;
     int len;
 {
-    fsm_input(&ipcp_fsm[unit], p, len);
+    fsm_input(&ppp_unit (unit)->ipcp_fsm, p, len);
 }
 
 
@@ -328,7 +333,7 @@ static void
 ipcp_protrej(unit)
     int unit;
 {
-    fsm_lowerdown(&ipcp_fsm[unit]);
+    fsm_lowerdown(&ppp_unit (unit)->ipcp_fsm);
 }
 
 
@@ -340,9 +345,9 @@ static void
 ipcp_resetci(f)
     fsm *f;
 {
-    ipcp_options *wo = &ipcp_wantoptions[f->unit];
-    ipcp_options *go = &ipcp_gotoptions[f->unit];
-    ipcp_options *ao = &ipcp_allowoptions[f->unit];
+    ipcp_options *wo = &ppp_unit (f->unit)->ipcp_wantoptions;
+    ipcp_options *go = &ppp_unit (f->unit)->ipcp_gotoptions;
+    ipcp_options *ao = &ppp_unit (f->unit)->ipcp_allowoptions;
 
     wo->req_addr = (wo->neg_addr || wo->old_addrs) &&
 	(ao->neg_addr || ao->old_addrs);
@@ -350,10 +355,10 @@ ipcp_resetci(f)
 	wo->accept_local = 1;
     if (wo->hisaddr == 0)
 	wo->accept_remote = 1;
-    wo->req_dns1 = usepeerdns[f->unit];	/* Request DNS addresses from the peer */
-    wo->req_dns2 = usepeerdns[f->unit];
+    wo->req_dns1 = ppp_unit (f->unit)->usepeerdns;	/* Request DNS addresses from the peer */
+    wo->req_dns2 = ppp_unit (f->unit)->usepeerdns;
     *go = *wo;
-    if (!ask_for_local[f->unit])
+    if (!ppp_unit (f->unit)->ask_for_local)
 	go->ouraddr = 0;
     if (ip_choose_hook) {
 	ip_choose_hook(&wo->hisaddr);
@@ -361,7 +366,7 @@ ipcp_resetci(f)
 	    wo->accept_remote = 0;
 	}
     }
-    BZERO(&ipcp_hisoptions[f->unit], sizeof(ipcp_options));
+    BZERO(&ppp_unit (f->unit)->ipcp_hisoptions, sizeof(ipcp_options));
 }
 
 
@@ -373,9 +378,9 @@ static int
 ipcp_cilen(f)
     fsm *f;
 {
-    ipcp_options *go = &ipcp_gotoptions[f->unit];
-    ipcp_options *wo = &ipcp_wantoptions[f->unit];
-    ipcp_options *ho = &ipcp_hisoptions[f->unit];
+    ipcp_options *go = &ppp_unit (f->unit)->ipcp_gotoptions;
+    ipcp_options *wo = &ppp_unit (f->unit)->ipcp_wantoptions;
+    ipcp_options *ho = &ppp_unit (f->unit)->ipcp_hisoptions;
 
 #define LENCIADDRS(neg)		(neg ? CILEN_ADDRS : 0)
 #define LENCIVJ(neg, old)	(neg ? (old? CILEN_COMPRESS : CILEN_VJ) : 0)
@@ -419,7 +424,7 @@ ipcp_addci(f, ucp, lenp)
     u_char *ucp;
     int *lenp;
 {
-    ipcp_options *go = &ipcp_gotoptions[f->unit];
+    ipcp_options *go = &ppp_unit (f->unit)->ipcp_gotoptions;
     int len = *lenp;
 
 #define ADDCIADDRS(opt, neg, val1, val2) \
@@ -526,7 +531,7 @@ ipcp_ackci(f, p, len)
     u_char *p;
     int len;
 {
-    ipcp_options *go = &ipcp_gotoptions[f->unit];
+    ipcp_options *go = &ppp_unit (f->unit)->ipcp_gotoptions;
     u_short cilen, citype, cishort;
     u_int32_t cilong;
     u_char cimaxslotindex, cicflag;
@@ -671,7 +676,7 @@ ipcp_nakci(f, p, len, treat_as_reject)
     int len;
     int treat_as_reject;
 {
-    ipcp_options *go = &ipcp_gotoptions[f->unit];
+    ipcp_options *go = &ppp_unit (f->unit)->ipcp_gotoptions;
     u_char cimaxslotindex, cicflag;
     u_char citype, cilen, *next;
     u_short cishort;
@@ -919,7 +924,7 @@ ipcp_rejci(f, p, len)
     u_char *p;
     int len;
 {
-    ipcp_options *go = &ipcp_gotoptions[f->unit];
+    ipcp_options *go = &ppp_unit (f->unit)->ipcp_gotoptions;
     u_char cimaxslotindex, ciflag, cilen;
     u_short cishort;
     u_int32_t cilong;
@@ -1071,9 +1076,9 @@ ipcp_reqci(f, inp, len, reject_if_disagree)
     int *len;			/* Length of requested CIs */
     int reject_if_disagree;
 {
-    ipcp_options *wo = &ipcp_wantoptions[f->unit];
-    ipcp_options *ho = &ipcp_hisoptions[f->unit];
-    ipcp_options *ao = &ipcp_allowoptions[f->unit];
+    ipcp_options *wo = &ppp_unit (f->unit)->ipcp_wantoptions;
+    ipcp_options *ho = &ppp_unit (f->unit)->ipcp_hisoptions;
+    ipcp_options *ao = &ppp_unit (f->unit)->ipcp_allowoptions;
     u_char *cip, *next;		/* Pointer to current and next CIs */
     u_short cilen, citype;	/* Parsed len, type */
     u_short cishort;		/* Parsed short value */
@@ -1357,7 +1362,7 @@ static int
 ip_demand_conf(u)
     int u;
 {
-    ipcp_options *wo = &ipcp_wantoptions[u];
+    ipcp_options *wo = &ppp_unit (u)->ipcp_wantoptions;
 
     if (wo->hisaddr == 0 && !noremoteip) {
 	/* make up an arbitrary address for the peer */
@@ -1368,7 +1373,7 @@ ip_demand_conf(u)
 	/* make up an arbitrary address for us */
 	wo->ouraddr = htonl(0x0a404040 + u);
 	wo->accept_local = 1;
-	ask_for_local[u] = 0;	/* don't tell the peer this address */
+	ppp_unit (u)->ask_for_local = 0;	/* don't tell the peer this address */
     }
     if (!sifaddr(u, wo->ouraddr, wo->hisaddr, GetMask(wo->ouraddr)))
 	return 0;
@@ -1379,10 +1384,10 @@ ip_demand_conf(u)
 	return 0;
     if (wo->default_route)
 	if (sifdefaultroute(u, wo->ouraddr, wo->hisaddr))
-	    default_route_set[u] = 1;
+	    ppp_unit (u)->default_route_set = 1;
     if (wo->proxy_arp)
 	if (sifproxyarp(u, wo->hisaddr))
-	    proxy_arp_set[u] = 1;
+	    ppp_unit (u)->proxy_arp_set = 1;
 
     notice("[%d], local  IP address %I", u, wo->ouraddr);
     if (wo->hisaddr)
@@ -1402,9 +1407,9 @@ ipcp_up(f)
     fsm *f;
 {
     u_int32_t mask;
-    ipcp_options *ho = &ipcp_hisoptions[f->unit];
-    ipcp_options *go = &ipcp_gotoptions[f->unit];
-    ipcp_options *wo = &ipcp_wantoptions[f->unit];
+    ipcp_options *ho = &ppp_unit (f->unit)->ipcp_hisoptions;
+    ipcp_options *go = &ppp_unit (f->unit)->ipcp_gotoptions;
+    ipcp_options *wo = &ppp_unit (f->unit)->ipcp_wantoptions;
 
     IPCPDEBUG(("[%d], ipcp: up", f->unit));
     /*
@@ -1441,7 +1446,7 @@ ipcp_up(f)
 	script_setenv("DNS1", ip_ntoa(go->dnsaddr[0]), 0);
     if (go->dnsaddr[1])
 	script_setenv("DNS2", ip_ntoa(go->dnsaddr[1]), 0);
-    if (usepeerdns[f->unit] && (go->dnsaddr[0] || go->dnsaddr[1])) {
+    if (ppp_unit (f->unit)->usepeerdns && (go->dnsaddr[0] || go->dnsaddr[1])) {
 	script_setenv("USEPEERDNS", "1", 0);
 	create_resolv(go->dnsaddr[0], go->dnsaddr[1]);
     }
@@ -1480,14 +1485,14 @@ ipcp_up(f)
 	    }
 
 	    /* assign a default route through the interface if required */
-	    if (ipcp_wantoptions[f->unit].default_route)
+	    if (ppp_unit (f->unit)->ipcp_wantoptions.default_route)
 		if (sifdefaultroute(f->unit, go->ouraddr, ho->hisaddr))
-		    default_route_set[f->unit] = 1;
+		    ppp_unit (f->unit)->default_route_set = 1;
 
 	    /* Make a proxy ARP entry if requested. */
-	    if (ho->hisaddr != 0 && ipcp_wantoptions[f->unit].proxy_arp)
+	    if (ho->hisaddr != 0 && ppp_unit (f->unit)->ipcp_wantoptions.proxy_arp)
 		if (sifproxyarp(f->unit, ho->hisaddr))
-		    proxy_arp_set[f->unit] = 1;
+		    ppp_unit (f->unit)->proxy_arp_set = 1;
 
 	}
 	demand_rexmit(PPP_IP);
@@ -1530,16 +1535,16 @@ ipcp_up(f)
 	sifnpmode(f->unit, PPP_IP, NPMODE_PASS);
 
 	/* assign a default route through the interface if required */
-	if (ipcp_wantoptions[f->unit].default_route)
+	if (ppp_unit (f->unit)->ipcp_wantoptions.default_route)
 	    if (sifdefaultroute(f->unit, go->ouraddr, ho->hisaddr))
-		default_route_set[f->unit] = 1;
+		ppp_unit (f->unit)->default_route_set = 1;
 
 	/* Make a proxy ARP entry if requested. */
-	if (ho->hisaddr != 0 && ipcp_wantoptions[f->unit].proxy_arp)
+	if (ho->hisaddr != 0 && ppp_unit (f->unit)->ipcp_wantoptions.proxy_arp)
 	    if (sifproxyarp(f->unit, ho->hisaddr))
-		proxy_arp_set[f->unit] = 1;
+		ppp_unit (f->unit)->proxy_arp_set = 1;
 
-	ipcp_wantoptions[0].ouraddr = go->ouraddr;
+	ppp_unit (f->unit)->ipcp_wantoptions.ouraddr = go->ouraddr;
 
 	notice("[%d], local  IP address %I", f->unit, go->ouraddr);
 	if (ho->hisaddr != 0)
@@ -1553,7 +1558,7 @@ ipcp_up(f)
     reset_link_stats(f->unit);
 
     np_up(f->unit, PPP_IP);
-    ipcp_is_up[f->unit] = 1;
+    ppp_unit (f->unit)->ipcp_is_up = 1;
     notify(ip_up_notifier, 0);
     if (ip_up_hook)
 	ip_up_hook();
@@ -1584,12 +1589,13 @@ ipcp_down(f)
      * before the interface is marked down. */
     /* XXX more correct: we must get the stats before running the notifiers,
      * at least for the radius plugin */
-    //ZDY: removed. update_link_stats(f->unit);
+    // ZDY: counters are read from the pppox interface.
+    update_link_stats(f->unit);
     notify(ip_down_notifier, 0);
     if (ip_down_hook)
 	ip_down_hook();
-    if (ipcp_is_up[f->unit]) {
-	ipcp_is_up[f->unit] = 0;
+    if (ppp_unit (f->unit)->ipcp_is_up) {
+	ppp_unit (f->unit)->ipcp_is_up = 0;
 	np_down(f->unit, PPP_IP);
     }
     sifvjcomp(f->unit, 0, 0, 0);
@@ -1607,8 +1613,8 @@ ipcp_down(f)
     } else {
 	sifnpmode(f->unit, PPP_IP, NPMODE_DROP);
 	sifdown(f->unit);
-	ipcp_clear_addrs(f->unit, ipcp_gotoptions[f->unit].ouraddr,
-			 ipcp_hisoptions[f->unit].hisaddr);
+	ipcp_clear_addrs(f->unit, ppp_unit (f->unit)->ipcp_gotoptions.ouraddr,
+			 ppp_unit (f->unit)->ipcp_hisoptions.hisaddr);
     }
 
     /* Execute the ip-down script */
@@ -1629,13 +1635,13 @@ ipcp_clear_addrs(unit, ouraddr, hisaddr)
     u_int32_t ouraddr;  /* local address */
     u_int32_t hisaddr;  /* remote address */
 {
-    if (proxy_arp_set[unit]) {
+    if (ppp_unit (unit)->proxy_arp_set) {
 	cifproxyarp(unit, hisaddr);
-	proxy_arp_set[unit] = 0;
+	ppp_unit (unit)->proxy_arp_set = 0;
     }
-    if (default_route_set[unit]) {
+    if (ppp_unit (unit)->default_route_set) {
 	cifdefaultroute(unit, ouraddr, hisaddr);
-	default_route_set[unit] = 0;
+	ppp_unit (unit)->default_route_set = 0;
     }
     cifaddr(unit, ouraddr, hisaddr);
 }
@@ -1648,13 +1654,14 @@ static void
 ipcp_finished(f)
     fsm *f;
 {
-	if (ipcp_is_open[f->unit]) {
-		ipcp_is_open[f->unit] = 0;
+	if (ppp_unit (f->unit)->ipcp_is_open) {
+		ppp_unit (f->unit)->ipcp_is_open = 0;
 		np_finished(f->unit, PPP_IP);
 	}
 }
 
 
+#if 0 // ZDY: scripts are not run on vpp, see ipcp_script.
 /*
  * ipcp_script_done - called when the ip-up or ip-down script
  * has finished.
@@ -1679,6 +1686,7 @@ ipcp_script_done(arg)
 	break;
     }
 }
+#endif
 
 
 /*
@@ -1692,7 +1700,10 @@ ipcp_script(script, wait)
 {
   // ZDY:
   // TODO: hook to vpp.
-  ipcp_script_done(0);
+  // No script is really run, so there is no child to reap and
+  // nothing to be done.
+  script = script;
+  wait = wait;
 }
 
 /*
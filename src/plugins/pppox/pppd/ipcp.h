@@ -42,6 +42,9 @@
  * $Id: ipcp.h,v 1.14 2002/12/04 23:03:32 paulus Exp $
  */
 
+#ifndef __IPCP_H__
+#define __IPCP_H__
+
 /*
  * Options.
  */
@@ -85,12 +88,10 @@ typedef struct ipcp_options {
     u_int32_t winsaddr[2];	/* Primary and secondary MS WINS entries */
 } ipcp_options;
 
-extern fsm ipcp_fsm[];
-extern ipcp_options ipcp_wantoptions[];
-extern ipcp_options ipcp_gotoptions[];
-extern ipcp_options ipcp_allowoptions[];
-extern ipcp_options ipcp_hisoptions[];
 
 char *ip_ntoa __P((u_int32_t));
+void ipcp_restore __P((int)); // ZDY: opened again after warm restart
 
 extern struct protent ipcp_protent;
+
+#endif /* __IPCP_H__ */
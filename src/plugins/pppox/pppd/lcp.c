@@ -55,6 +55,7 @@
 #include "lcp.h"
 #include "chap-new.h"
 #include "magic.h"
+#include "unit.h"
 
 //static const char rcsid[] = RCSID;
 
@@ -75,26 +76,18 @@ static void lcp_delayed_up __P((void *));
 // do not got the term req because the issues like wire broken.
 // values choosen from:
 // https://supportforums.cisco.com/t5/wan-routing-and-switching/ppp-keepalive-lcp-echo-request-data-length/td-p/2520383
-// There parameter shared by all ppp instances, if later we add the capability to
-// customize value of each instances, we should make them per instances.
+// These are the defaults of new units, each unit can be set its own
+// with lcp_echo_config.
 int	lcp_echo_interval = 10; /* Interval between LCP echo-requests */
 int	lcp_echo_fails = 5;	/* Tolerance to unanswered echo-requests */
 bool	lax_recv = 0;		/* accept control chars in asyncmap */
 bool	noendpoint = 0;		/* don't send/accept endpoint discriminator */
 
 /* global vars */
-fsm lcp_fsm[NUM_PPP];			/* LCP fsm structure (global)*/
-lcp_options lcp_wantoptions[NUM_PPP];	/* Options that we want to request */
-lcp_options lcp_gotoptions[NUM_PPP];	/* Options that peer ack'd */
-lcp_options lcp_allowoptions[NUM_PPP];	/* Options we allow peer to request */
-lcp_options lcp_hisoptions[NUM_PPP];	/* Options that we ack'd */
-
-// ZDY: turn to array to support multiple instances.
-static int lcp_echos_pending[NUM_PPP] = {0};	/* Number of outstanding echo msgs */
-static int lcp_echo_number[NUM_PPP] = {0};	/* ID number of next echo frame */
-static int lcp_echo_timer_running[NUM_PPP] = {0};  /* set if a timer is running */
-
-static u_char nak_buffer[NUM_PPP][PPP_MRU];	/* where we construct a nak packet */
+// ZDY: per-unit state lives in ppp_unit_t (unit.h), nak buffer is only
+// used within lcp_reqci so one copy is shared by all units.
+static u_char nak_buffer[PPP_MRU];	/* where we construct a nak packet */
+
 /*
  * Callbacks for fsm code.  (CI = Configuration Information)
  */
@@ -123,6 +116,13 @@ static void lcp_received_echo_reply __P((fsm *, int, u_char *, int));
 static void LcpSendEchoRequest __P((fsm *));
 static void LcpLinkFailure __P((fsm *));
 static void LcpEchoCheck __P((fsm *));
+static void LcpEchoArm __P((fsm *));
+static int LcpPeerAlive __P((fsm *));
+static void LcpRestoreProbe __P((void *));
+
+/* ZDY: echoes, a second apart, a restored session gets to prove the
+   peer kept it */
+#define LCP_RESTORE_PROBES	3
 
 static fsm_callbacks lcp_callbacks = {	/* LCP callback routines */
     lcp_resetci,		/* Reset our Configuration Information */
@@ -196,9 +196,9 @@ static void
 lcp_init(unit)
     int unit;
 {
-    fsm *f = &lcp_fsm[unit];
-    lcp_options *wo = &lcp_wantoptions[unit];
-    lcp_options *ao = &lcp_allowoptions[unit];
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
+    lcp_options *wo = &ppp_unit (unit)->lcp_wantoptions;
+    lcp_options *ao = &ppp_unit (unit)->lcp_allowoptions;
 
     f->unit = unit;
     f->protocol = PPP_LCP;
@@ -232,8 +232,8 @@ lcp_init(unit)
     ao->neg_endpoint = 0;
 
     // ZDY: clear state might be used.
-    memset (&lcp_gotoptions[unit], 0, sizeof (lcp_gotoptions[unit]));
-    memset (&lcp_hisoptions[unit], 0, sizeof (lcp_hisoptions[unit]));
+    memset (&ppp_unit (unit)->lcp_gotoptions, 0, sizeof (ppp_unit (unit)->lcp_gotoptions));
+    memset (&ppp_unit (unit)->lcp_hisoptions, 0, sizeof (ppp_unit (unit)->lcp_hisoptions));
 }
 
 /*
@@ -243,8 +243,8 @@ void
 lcp_open(unit)
     int unit;
 {
-    fsm *f = &lcp_fsm[unit];
-    lcp_options *wo = &lcp_wantoptions[unit];
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
+    lcp_options *wo = &ppp_unit (unit)->lcp_wantoptions;
 
     f->flags &= ~(OPT_PASSIVE | OPT_SILENT);
     if (wo->passive)
@@ -263,10 +263,10 @@ lcp_close(unit, reason)
     int unit;
     char *reason;
 {
-    fsm *f = &lcp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
     int oldstate;
 
-    if (phase[unit] != PHASE_DEAD && phase[unit] != PHASE_MASTER)
+    if (ppp_unit (unit)->phase != PHASE_DEAD && ppp_unit (unit)->phase != PHASE_MASTER)
       new_phase(unit, PHASE_TERMINATE);
 
     if (f->flags & DELAYED_UP) {
@@ -297,8 +297,8 @@ void
 lcp_lowerup(unit)
     int unit;
 {
-    lcp_options *wo = &lcp_wantoptions[unit];
-    fsm *f = &lcp_fsm[unit];
+    lcp_options *wo = &ppp_unit (unit)->lcp_wantoptions;
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
 
     /*
      * Don't use A/C or protocol compression on transmission,
@@ -309,7 +309,7 @@ lcp_lowerup(unit)
 	|| ppp_recv_config(unit, PPP_MRU, (lax_recv? 0: 0xffffffff),
 			   wo->neg_pcompression, wo->neg_accompression) < 0)
 	    return;
-    peer_mru[unit] = PPP_MRU;
+    ppp_unit (unit)->peer_mru = PPP_MRU;
 
     if (listen_time != 0) {
 	f->flags |= DELAYED_UP;
@@ -326,13 +326,13 @@ void
 lcp_lowerdown(unit)
     int unit;
 {
-    fsm *f = &lcp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
 
     if (f->flags & DELAYED_UP) {
 	f->flags &= ~DELAYED_UP;
 	untimeout(lcp_delayed_up, f);
     } else
-	fsm_lowerdown(&lcp_fsm[unit]);
+	fsm_lowerdown(&ppp_unit (unit)->lcp_fsm);
 }
 
 
@@ -361,7 +361,7 @@ lcp_input(unit, p, len)
     u_char *p;
     int len;
 {
-    fsm *f = &lcp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
 
     if (f->flags & DELAYED_UP) {
 	f->flags &= ~DELAYED_UP;
@@ -391,8 +391,19 @@ lcp_extcode(f, code, id, inp, len)
     case ECHOREQ:
 	if (f->state != OPENED)
 	    break;
+	// ZDY: our own magic number, the link is looped back, don't answer.
+	if (len >= 4 && ppp_unit (f->unit)->lcp_gotoptions.neg_magicnumber) {
+	    u_int32_t magic;
+	    magp = inp;
+	    GETLONG(magic, magp);
+	    if (magic == ppp_unit (f->unit)->lcp_gotoptions.magicnumber) {
+		xwarn("[%d], appear to have received our own echo-request!",
+		      f->unit);
+		break;
+	    }
+	}
 	magp = inp;
-	PUTLONG(lcp_gotoptions[f->unit].magicnumber, magp);
+	PUTLONG(ppp_unit (f->unit)->lcp_gotoptions.magicnumber, magp);
 	fsm_sdata(f, ECHOREP, id, inp, len);
 	break;
 
@@ -480,7 +491,7 @@ lcp_protrej(unit)
      * Can't reject LCP!
      */
     xerror("Received Protocol-Reject for LCP!");
-    fsm_protreject(&lcp_fsm[unit]);
+    fsm_protreject(&ppp_unit (unit)->lcp_fsm);
 }
 
 
@@ -500,7 +511,7 @@ lcp_sprotrej(unit, p, len)
     p += 2;
     len -= 2;
 
-    fsm_sdata(&lcp_fsm[unit], PROTREJ, ++lcp_fsm[unit].id,
+    fsm_sdata(&ppp_unit (unit)->lcp_fsm, PROTREJ, ++ppp_unit (unit)->lcp_fsm.id,
 	      p, len);
 }
 
@@ -512,21 +523,22 @@ static void
 lcp_resetci(f)
     fsm *f;
 {
-    lcp_options *wo = &lcp_wantoptions[f->unit];
-    lcp_options *go = &lcp_gotoptions[f->unit];
-    lcp_options *ao = &lcp_allowoptions[f->unit];
+    lcp_options *wo = &ppp_unit (f->unit)->lcp_wantoptions;
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
+    lcp_options *ao = &ppp_unit (f->unit)->lcp_allowoptions;
 
     wo->magicnumber = magic();
     wo->numloops = 0;
     *go = *wo;
-    if (!multilink) {
+    // ZDY: multilink is per unit, set for members of a multilink bundle.
+    if (!ppp_unit (f->unit)->multilink) {
 	go->neg_mrru = 0;
 	go->neg_ssnhf = 0;
 	go->neg_endpoint = 0;
     }
     if (noendpoint)
 	ao->neg_endpoint = 0;
-    peer_mru[f->unit] = PPP_MRU;
+    ppp_unit (f->unit)->peer_mru = PPP_MRU;
     auth_reset(f->unit);
 }
 
@@ -538,7 +550,7 @@ static int
 lcp_cilen(f)
     fsm *f;
 {
-    lcp_options *go = &lcp_gotoptions[f->unit];
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
 
 #define LENCIVOID(neg)	((neg) ? CILEN_VOID : 0)
 #define LENCICHAP(neg)	((neg) ? CILEN_CHAP : 0)
@@ -576,7 +588,7 @@ lcp_addci(f, ucp, lenp)
     u_char *ucp;
     int *lenp;
 {
-    lcp_options *go = &lcp_gotoptions[f->unit];
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
     u_char *start_ucp = ucp;
 
 #define ADDCIVOID(opt, neg) \
@@ -664,7 +676,7 @@ lcp_ackci(f, p, len)
     u_char *p;
     int len;
 {
-    lcp_options *go = &lcp_gotoptions[f->unit];
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
     u_char cilen, citype, cichar;
     u_short cishort;
     u_int32_t cilong;
@@ -820,8 +832,8 @@ lcp_nakci(f, p, len, treat_as_reject)
     int len;
     int treat_as_reject;
 {
-    lcp_options *go = &lcp_gotoptions[f->unit];
-    lcp_options *wo = &lcp_wantoptions[f->unit];
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
+    lcp_options *wo = &ppp_unit (f->unit)->lcp_wantoptions;
     u_char citype, cichar, *next;
     u_short cishort;
     u_int32_t cilong;
@@ -1213,7 +1225,7 @@ lcp_rejci(f, p, len)
     u_char *p;
     int len;
 {
-    lcp_options *go = &lcp_gotoptions[f->unit];
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
     u_char cichar;
     u_short cishort;
     u_int32_t cilong;
@@ -1373,9 +1385,9 @@ lcp_reqci(f, inp, lenp, reject_if_disagree)
     int *lenp;			/* Length of requested CIs */
     int reject_if_disagree;
 {
-    lcp_options *go = &lcp_gotoptions[f->unit];
-    lcp_options *ho = &lcp_hisoptions[f->unit];
-    lcp_options *ao = &lcp_allowoptions[f->unit];
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
+    lcp_options *ho = &ppp_unit (f->unit)->lcp_hisoptions;
+    lcp_options *ao = &ppp_unit (f->unit)->lcp_allowoptions;
     u_char *cip, *next;		/* Pointer to current and next CIs */
     int cilen, citype, cichar;	/* Parsed len, type, char value */
     u_short cishort;		/* Parsed short value */
@@ -1396,7 +1408,7 @@ lcp_reqci(f, inp, lenp, reject_if_disagree)
      * Process all his options.
      */
     next = inp;
-    nakp = nak_buffer[f->unit];
+    nakp = nak_buffer;
     rejp = inp;
     while (l) {
 	orc = CONFACK;			/* Assume success */
@@ -1660,7 +1672,7 @@ lcp_reqci(f, inp, lenp, reject_if_disagree)
 	    break;
 
 	case CI_MRRU:
-	    if (!ao->neg_mrru || !multilink ||
+	    if (!ao->neg_mrru || !ppp_unit (f->unit)->multilink ||
 		cilen != CILEN_SHORT) {
 		orc = CONFREJ;
 		break;
@@ -1673,7 +1685,7 @@ lcp_reqci(f, inp, lenp, reject_if_disagree)
 	    break;
 
 	case CI_SSNHF:
-	    if (!ao->neg_ssnhf || !multilink ||
+	    if (!ao->neg_ssnhf || !ppp_unit (f->unit)->multilink ||
 		cilen != CILEN_VOID) {
 		orc = CONFREJ;
 		break;
@@ -1741,8 +1753,8 @@ endswitch:
 	/*
 	 * Copy the Nak'd options from the nak_buffer to the caller's buffer.
 	 */
-	*lenp = nakp - nak_buffer[f->unit];
-	BCOPY(nak_buffer[f->unit], inp, *lenp);
+	*lenp = nakp - nak_buffer;
+	BCOPY(nak_buffer, inp, *lenp);
 	break;
     case CONFREJ:
 	*lenp = rejp - inp;
@@ -1761,10 +1773,10 @@ static void
 lcp_up(f)
     fsm *f;
 {
-    lcp_options *wo = &lcp_wantoptions[f->unit];
-    lcp_options *ho = &lcp_hisoptions[f->unit];
-    lcp_options *go = &lcp_gotoptions[f->unit];
-    lcp_options *ao = &lcp_allowoptions[f->unit];
+    lcp_options *wo = &ppp_unit (f->unit)->lcp_wantoptions;
+    lcp_options *ho = &ppp_unit (f->unit)->lcp_hisoptions;
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
+    lcp_options *ao = &ppp_unit (f->unit)->lcp_allowoptions;
     int mtu, mru;
 
     if (!go->neg_magicnumber)
@@ -1795,9 +1807,11 @@ lcp_up(f)
 		    go->neg_pcompression, go->neg_accompression);
 
     if (ho->neg_mru)
-	peer_mru[f->unit] = ho->mru;
+	ppp_unit (f->unit)->peer_mru = ho->mru;
 
     lcp_echo_lowerup(f->unit);  /* Enable echo messages */
+    // ZDY: report LCP up to session event subscribers.
+    siflcpupdown(f->unit, 1);
 
     link_established(f->unit);
 }
@@ -1812,9 +1826,15 @@ static void
 lcp_down(f)
     fsm *f;
 {
-    lcp_options *go = &lcp_gotoptions[f->unit];
+    lcp_options *go = &ppp_unit (f->unit)->lcp_gotoptions;
 
     lcp_echo_lowerdown(f->unit);
+    // ZDY: report LCP down to session event subscribers.
+    siflcpupdown(f->unit, 0);
+
+    // ZDY: the link stops to carry fragments of its multilink bundle.
+    if (ppp_unit (f->unit)->multilink)
+	sifmpleave(f->unit);
 
     link_down(f->unit);
 
@@ -1822,7 +1842,7 @@ lcp_down(f)
     ppp_recv_config(f->unit, PPP_MRU,
 		    (go->neg_asyncmap? go->asyncmap: 0xffffffff),
 		    go->neg_pcompression, go->neg_accompression);
-    peer_mru[f->unit] = PPP_MRU;
+    ppp_unit (f->unit)->peer_mru = PPP_MRU;
 }
 
 
@@ -2106,13 +2126,33 @@ void LcpLinkFailure (f)
     fsm *f;
 {
     if (f->state == OPENED) {
-        info("[%d], No response to %d echo-requests", f->unit, lcp_echos_pending[f->unit]);
+        info("[%d], No response to %d echo-requests", f->unit, ppp_unit (f->unit)->lcp_echos_pending);
         notice("[%d], Serial link appears to be disconnected.", f->unit);
 	status = EXIT_PEER_DEAD;
 	lcp_close(f->unit, "Peer not responding");
     }
 }
 
+/*
+ * ZDY: LcpPeerAlive - Has the data plane seen the peer since last time,
+ * by answering its Echo-Requests or receiving data.
+ */
+
+static int
+LcpPeerAlive (f)
+    fsm *f;
+{
+    ppp_unit_t *ppp = ppp_unit (f->unit);
+    u_int32_t replied = get_echo_replied (f->unit);
+    u_int32_t rx = get_rx_packets (f->unit);
+    int alive;
+
+    alive = replied != ppp->lcp_echo_replied || rx != ppp->lcp_rx_packets;
+    ppp->lcp_echo_replied = replied;
+    ppp->lcp_rx_packets = rx;
+    return alive;
+}
+
 /*
  * Timer expired for the LCP echo requests from this process.
  */
@@ -2121,17 +2161,48 @@ static void
 LcpEchoCheck (f)
     fsm *f;
 {
-    LcpSendEchoRequest (f);
+    ppp_unit_t *ppp = ppp_unit (f->unit);
+    int alive = LcpPeerAlive (f);
+
+    if (alive)
+	ppp->lcp_echos_pending = 0;
+
+    // ZDY: adaptive, a peer seen alive needs no echo, and checking on a
+    // busy link backs off up to the max interval. Once it goes quiet
+    // echoes start over at the base interval.
+    if (alive && ppp->lcp_echo_max_interval) {
+	ppp->lcp_echo_cur_interval *= 2;
+	if (ppp->lcp_echo_cur_interval > ppp->lcp_echo_max_interval)
+	    ppp->lcp_echo_cur_interval = ppp->lcp_echo_max_interval;
+	if (ppp->lcp_echo_cur_interval < ppp->lcp_echo_interval)
+	    ppp->lcp_echo_cur_interval = ppp->lcp_echo_interval;
+    } else {
+	ppp->lcp_echo_cur_interval = ppp->lcp_echo_interval;
+	LcpSendEchoRequest (f);
+    }
     if (f->state != OPENED)
 	return;
 
     /*
      * Start the timer for the next interval.
      */
-    if (lcp_echo_timer_running[f->unit])
+    if (ppp->lcp_echo_timer_running)
         xwarn("[%d], assertion lcp_echo_timer_running==0 failed", f->unit);
-    TIMEOUT (LcpEchoTimeout, f, lcp_echo_interval);
-    lcp_echo_timer_running[f->unit] = 1;
+    LcpEchoArm (f);
+}
+
+/*
+ * ZDY: LcpEchoArm - Start the echo timer, intervals are in milliseconds.
+ */
+
+static void
+LcpEchoArm (f)
+    fsm *f;
+{
+    int ms = ppp_unit (f->unit)->lcp_echo_cur_interval;
+
+    timeout (LcpEchoTimeout, f, ms / 1000, (ms % 1000) * 1000);
+    ppp_unit (f->unit)->lcp_echo_timer_running = 1;
 }
 
 /*
@@ -2142,8 +2213,8 @@ static void
 LcpEchoTimeout (arg)
     void *arg;
 {
-    if (lcp_echo_timer_running[((fsm *) arg)->unit] != 0) {
-        lcp_echo_timer_running[((fsm *) arg)->unit] = 0;
+    if (ppp_unit (((fsm *) arg)->unit)->lcp_echo_timer_running != 0) {
+        ppp_unit (((fsm *) arg)->unit)->lcp_echo_timer_running = 0;
         LcpEchoCheck ((fsm *) arg);
     }
 }
@@ -2167,14 +2238,14 @@ lcp_received_echo_reply (f, id, inp, len)
 	return;
     }
     GETLONG(magic, inp);
-    if (lcp_gotoptions[f->unit].neg_magicnumber
-	&& magic == lcp_gotoptions[f->unit].magicnumber) {
+    if (ppp_unit (f->unit)->lcp_gotoptions.neg_magicnumber
+	&& magic == ppp_unit (f->unit)->lcp_gotoptions.magicnumber) {
         xwarn("[%d], appear to have received our own echo-reply!", f->unit);
 	return;
     }
 
     /* Reset the number of outstanding echo frames */
-    lcp_echos_pending[f->unit] = 0;
+    ppp_unit (f->unit)->lcp_echos_pending = 0;
 }
 
 /*
@@ -2191,10 +2262,10 @@ LcpSendEchoRequest (f)
     /*
      * Detect the failure of the peer at this point.
      */
-    if (lcp_echo_fails != 0) {
-        if (lcp_echos_pending[f->unit] >= lcp_echo_fails) {
+    if (ppp_unit (f->unit)->lcp_echo_fails != 0) {
+        if (ppp_unit (f->unit)->lcp_echos_pending >= ppp_unit (f->unit)->lcp_echo_fails) {
             LcpLinkFailure(f);
-	    lcp_echos_pending[f->unit] = 0;
+	    ppp_unit (f->unit)->lcp_echos_pending = 0;
 	}
     }
 
@@ -2202,11 +2273,11 @@ LcpSendEchoRequest (f)
      * Make and send the echo request frame.
      */
     if (f->state == OPENED) {
-        lcp_magic = lcp_gotoptions[f->unit].magicnumber;
+        lcp_magic = ppp_unit (f->unit)->lcp_gotoptions.magicnumber;
 	pktp = pkt;
 	PUTLONG(lcp_magic, pktp);
-        fsm_sdata(f, ECHOREQ, lcp_echo_number[f->unit]++ & 0xFF, pkt, pktp - pkt);
-	++lcp_echos_pending[f->unit];
+        fsm_sdata(f, ECHOREQ, ppp_unit (f->unit)->lcp_echo_number++ & 0xFF, pkt, pktp - pkt);
+	++ppp_unit (f->unit)->lcp_echos_pending;
     }
 }
 
@@ -2218,15 +2289,20 @@ static void
 lcp_echo_lowerup (unit)
     int unit;
 {
-    fsm *f = &lcp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
 
     /* Clear the parameters for generating echo frames */
-    lcp_echos_pending[f->unit]      = 0;
-    lcp_echo_number[f->unit]        = 0;
-    lcp_echo_timer_running[f->unit] = 0;
+    ppp_unit (f->unit)->lcp_echos_pending      = 0;
+    ppp_unit (f->unit)->lcp_echo_number        = 0;
+    ppp_unit (f->unit)->lcp_echo_timer_running = 0;
+    ppp_unit (f->unit)->lcp_echo_cur_interval  = ppp_unit (unit)->lcp_echo_interval;
+    LcpPeerAlive (f);
+
+    // ZDY: answer Echo-Requests in the data plane from now on.
+    sifechoreply (unit, ppp_unit (unit)->lcp_gotoptions.magicnumber, 1);
 
     /* If a timeout interval is specified then start the timer */
-    if (lcp_echo_interval != 0)
+    if (ppp_unit (unit)->lcp_echo_interval != 0)
         LcpEchoCheck (f);
 }
 
@@ -2238,10 +2314,102 @@ static void
 lcp_echo_lowerdown (unit)
     int unit;
 {
-    fsm *f = &lcp_fsm[unit];
+    fsm *f = &ppp_unit (unit)->lcp_fsm;
+
+    // ZDY: Echo-Requests go to pppd again, which drops them unless opened.
+    sifechoreply (unit, 0, 0);
 
-    if (lcp_echo_timer_running[f->unit] != 0) {
+    UNTIMEOUT (LcpRestoreProbe, f);
+    ppp_unit (unit)->lcp_restore_probes = 0;
+
+    if (ppp_unit (f->unit)->lcp_echo_timer_running != 0) {
         UNTIMEOUT (LcpEchoTimeout, f);
-        lcp_echo_timer_running[f->unit] = 0;
+        ppp_unit (f->unit)->lcp_echo_timer_running = 0;
+    }
+}
+
+/*
+ * ZDY: lcp_restore - Open LCP of a unit restored after restart without
+ * negotiating, the options it had are already in gotoptions and
+ * hisoptions. link_established restores the NCP, then echoes check
+ * that the peer still has the session, it is closed if not.
+ */
+void
+lcp_restore (unit)
+    int unit;
+{
+    ppp_unit_t *ppp = ppp_unit (unit);
+    fsm *f = &ppp->lcp_fsm;
+
+    new_phase(unit, PHASE_ESTABLISH);
+    f->state = OPENED;
+    ppp->restoring = 1;
+    lcp_up(f);
+    ppp->restoring = 0;
+
+    if (f->state != OPENED)
+	return;
+    ppp->lcp_restore_probes = LCP_RESTORE_PROBES;
+    LcpRestoreProbe (f);
+}
+
+/*
+ * ZDY: LcpRestoreProbe - Send the next echo of a restored session, or
+ * close the link when none of them was answered.
+ */
+static void
+LcpRestoreProbe (arg)
+    void *arg;
+{
+    fsm *f = (fsm *) arg;
+    ppp_unit_t *ppp = ppp_unit (f->unit);
+
+    if (f->state != OPENED) {
+	ppp->lcp_restore_probes = 0;
+	return;
+    }
+
+    if (ppp->lcp_restore_probes < LCP_RESTORE_PROBES
+	&& (ppp->lcp_echos_pending == 0 || LcpPeerAlive (f))) {
+	ppp->lcp_restore_probes = 0;
+	ppp->lcp_echos_pending = 0;
+	return;
+    }
+
+    if (ppp->lcp_restore_probes == 0) {
+	LcpLinkFailure (f);
+	return;
+    }
+
+    --ppp->lcp_restore_probes;
+    LcpSendEchoRequest (f);
+    TIMEOUT (LcpRestoreProbe, f, 1);
+}
+
+/*
+ * ZDY: lcp_echo_config - Set the LCP echo parameters of a unit, they
+ * apply right away if LCP is opened. Intervals are in milliseconds,
+ * a max_interval makes echoes adaptive, 0 interval disables them.
+ */
+void
+lcp_echo_config (unit, interval, max_interval, fails)
+    int unit, interval, max_interval, fails;
+{
+    ppp_unit_t *ppp = ppp_unit (unit);
+    fsm *f = &ppp->lcp_fsm;
+
+    ppp->lcp_echo_interval = interval;
+    ppp->lcp_echo_max_interval = max_interval;
+    ppp->lcp_echo_fails = fails;
+
+    if (f->state != OPENED)
+	return;
+
+    if (ppp->lcp_echo_timer_running != 0) {
+	UNTIMEOUT (LcpEchoTimeout, f);
+	ppp->lcp_echo_timer_running = 0;
     }
+    ppp->lcp_echo_cur_interval = interval;
+    if (interval != 0)
+	LcpEchoArm (f);
 }
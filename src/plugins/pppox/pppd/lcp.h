@@ -42,6 +42,9 @@
  * $Id: lcp.h,v 1.20 2004/11/14 22:53:42 carlsonj Exp $
  */
 
+#ifndef __LCP_H__
+#define __LCP_H__
+
 /*
  * Options.
  */
@@ -112,11 +115,6 @@ typedef struct lcp_options {
     struct epdisc endpoint;	/* endpoint discriminator */
 } lcp_options;
 
-extern fsm lcp_fsm[];
-extern lcp_options lcp_wantoptions[];
-extern lcp_options lcp_gotoptions[];
-extern lcp_options lcp_allowoptions[];
-extern lcp_options lcp_hisoptions[];
 
 #define DEFMRU	1500		/* Try for this */
 #define MINMRU	128		/* No MRUs below this */
@@ -129,9 +127,16 @@ void lcp_lowerdown __P((int));
 void lcp_sprotrej __P((int, u_char *, int));	/* send protocol reject */
 
 void lcp_reset_inst_state (int);
+void lcp_echo_config __P((int, int, int, int)); // ZDY: per unit echo
+void lcp_restore __P((int)); // ZDY: opened again after warm restart
+
+extern int lcp_echo_interval;	/* defaults of lcp_echo_config, seconds */
+extern int lcp_echo_fails;
 
 extern struct protent lcp_protent;
 
 /* Default number of times we receive our magic number from the peer
    before deciding the link is looped-back. */
 #define DEFLOOPBACKFAIL	10
+
+#endif /* __LCP_H__ */
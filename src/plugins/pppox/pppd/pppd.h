@@ -71,10 +71,8 @@
  * Limits.
  */
 
-// ZDY: increase this to 128 create each pppox virtual interface a pppd instance.
-// It's indexed by virtual interfaxce vector index.
-// TODO: sync it with pppoeclient/pppox definition...
-#define NUM_PPP		128	/* One PPP interface supported (per process) */
+// ZDY: per pppox virtual interface state is allocated dynamically,
+// see unit.h, so there is no limit of pppd instances here.
 #define MAXWORDLEN	1024	/* max length of word in file (incl null) */
 #define MAXARGS		1	/* max # args to a command */
 #define MAXNAMELEN	256	/* max length of hostname or name for auth */
@@ -211,10 +209,8 @@ struct notifier {
 extern int	hungup;		/* Physical layer has disconnected */
 extern char	hostname[];	/* Our hostname */
 extern u_char	outpacket_buf[]; /* Buffer for outgoing packets */
-extern int	phase[NUM_PPP];	/* Current state of link - see values below */
 extern int	redirect_stderr;/* Connector's stderr should go to file */
 extern char	peer_authname[];/* Authenticated name of peer */
-extern int	auth_done[NUM_PPP]; /* Methods actually used for auth */
 extern int	privileged;	/* We were run by real-uid root */
 extern int	need_holdoff;	/* Need holdoff period after link terminates */
 extern char	**script_env;	/* Environment variables for scripts */
@@ -537,11 +533,14 @@ int  loop_frame __P((unsigned char *, int)); /* should we bring link up? */
 
 /* Procedures exported from sys-*.c */
 // Timeout moved here in order to be driven by vpp.
-void pppd_calltimeout();
+void pppd_timer_init __P((double now)); /* Setup timers, now is vlib time */
+void pppd_calltimeout __P((double now)); /* Call timeouts which are due */
+double pppd_timeleft __P((double now)); /* Time to next timeout, <0 if none */
 void timeout __P((void (*func)(void *), void *arg, int s, int us));
 				/* Call func(arg) after s.us seconds */
 void untimeout __P((void (*func)(void *), void *arg));
 				/* Cancel call to func(arg) */
+void untimeout_unit __P((int unit)); /* Cancel all timeouts of a unit */
 void sys_init __P((void));	/* Do system-dependent initialization */
 void sys_cleanup __P((void));	/* Restore system state before exiting */
 int  sys_check_options __P((void)); /* Check options specified */
@@ -583,6 +582,19 @@ int  get_ppp_stats __P((int, struct pppd_stats *));
 				/* Return link statistics */
 void netif_set_mtu __P((int, int)); /* Set PPP interface MTU */
 int  netif_get_mtu __P((int));      /* Get PPP interface MTU */
+// ZDY: Echo-Requests are answered by the data plane while LCP is opened.
+void sifechoreply __P((int, u_int32_t, int));
+				/* Set magic to answer Echo-Requests with */
+u_int32_t get_echo_replied __P((int));
+				/* Echo-Requests answered by data plane */
+u_int32_t get_rx_packets __P((int));
+				/* Data packets received by data plane */
+// ZDY: session state changes are reported to API subscribers.
+void siflcpupdown __P((int, int));
+				/* LCP opened or left opened */
+// ZDY: multilink links are bundled by the data plane.
+int  sifmpjoin __P((int));	/* Link joins its multilink bundle */
+void sifmpleave __P((int));	/* Link leaves its multilink bundle */
 int  sifvjcomp __P((int, int, int, int));
 				/* Configure VJ TCP header compression */
 int  sifup __P((int));		/* Configure i/f up for one protocol */
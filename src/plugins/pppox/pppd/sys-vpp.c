@@ -5,12 +5,17 @@
  *
  */
 #include "stdlib.h"
+#include <vlib/vlib.h>
+#include <vppinfra/mhash.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
+
 #include "pppd.h"
 #include "fsm.h"
 #include "ipcp.h"
 #include "upap.h"
 #include "chap-new.h"
 #include "lcp.h"
+#include "unit.h"
 
 // NOTE: too keep relative independency, code here are used only to keep pppd compiled.
 // code that iteractivate with vpp should be moved to pppox.c
@@ -51,10 +56,8 @@ int hungup = 0;
 char hostname[] = "oss-pppd-for-vpp";
 // TODO: use vpp buffer instead.
 u_char outpacket_buf[PPP_MRU+PPP_HDRLEN]; /* buffer for outgoing packet */
-int	phase[NUM_PPP]; /* Current state of link - see values below */
 int	redirect_stderr;/* Connector's stderr should go to file */
 char	peer_authname[] = "ppp-server";/* Authenticated name of peer */
-int	auth_done[NUM_PPP]; /* Methods actually used for auth */
 int	privileged;	/* We were run by real-uid root */
 int	need_holdoff;	/* Need holdoff period after link terminates */
 char	**script_env;	/* Environment variables for scripts */
@@ -124,34 +127,78 @@ ppp_recv_config(unit, mru, accm, pcomp, accomp)
 void
 new_phase(int unit, int p)
 {
-  phase[unit] = p;
+  ppp_unit (unit)->phase = p;
   /*  if (new_phase_hook)
     (*new_phase_hook)(p);
     notify(phasechange, p);*/
 }
 
-void netif_set_mtu (int unit, int mtu) /* Set PPP interface MTU */
-{
-  // TODO: set pppox interface mtu??
-  unit = unit;
-  mtu = mtu;
-}
+// ZDY: netif_set_mtu/netif_get_mtu are provided by pppox.c, the
+// MTU is kept in the pppox interface.
 
-int  netif_get_mtu (int unit)     /* Get PPP interface MTU */
+/*
+ * ZDY: pppd timeouts are kept on a vppinfra timer wheel instead of
+ * a malloc'd sorted list. A timeout is identified by its argument,
+ * which always points into the state of a unit, and its routine,
+ * which tells the timer type, so (arg, func) is the key of a callout.
+ * The clock is vlib time, pppox process sleeps until the next expiry
+ * reported by pppd_timeleft and then calls pppd_calltimeout.
+ */
+#define PPPD_TIMER_TICK 0.01	/* seconds, 10ms */
+
+typedef struct {
+  void *c_arg;			/* argument to routine */
+  void (*c_func) __P((void *));	/* routine */
+} callout_key_t;
+
+typedef struct {
+  callout_key_t key;
+  u32 handle;			/* timer wheel handle, ~0 once expired */
+} callout_t;
+
+typedef struct {
+  tw_timer_wheel_1t_3w_1024sl_ov_t wheel;
+  callout_t *callouts;		/* pool of pending timeouts */
+  mhash_t callout_index_by_key;
+  u32 *expired;			/* expired callout indices */
+  f64 next_wakeup;		/* time pppox process will next run timers */
+} callout_main_t;
+
+static callout_main_t callout_main;
+
+/* Wakeup pppox process to rearm its sleep, provided by pppox.c */
+extern void pppox_timer_wakeup (void);
+
+/* Wheel helpers shared with the pppoe client, provided by pppox.c */
+extern u32 pppox_timer_start (tw_timer_wheel_1t_3w_1024sl_ov_t *, u32, f64);
+extern u32 *pppox_timer_expire (tw_timer_wheel_1t_3w_1024sl_ov_t *, f64,
+				u32 *, f64 *);
+extern f64 pppox_timer_timeleft (tw_timer_wheel_1t_3w_1024sl_ov_t *, f64,
+				 f64 *);
+
+static void
+callout_free (callout_main_t *cm, callout_t *c)
 {
-  unit = unit;
-  return 0;
+  if (c->handle != ~0)
+    tw_timer_stop_1t_3w_1024sl_ov (&cm->wheel, c->handle);
+  mhash_unset (&cm->callout_index_by_key, &c->key, 0);
+  pool_put (cm->callouts, c);
 }
 
-struct callout {
-  struct timeval c_time;/* time at which to call routine */
-  void* c_arg;/* argument to routine */
-  void (*c_func) __P((void *)); /* routine */
-  struct callout *c_next;
-};
+/*
+ * pppd_timer_init - Setup the timer wheel, now is the current vlib time.
+ */
+void
+pppd_timer_init(double now)
+{
+  callout_main_t *cm = &callout_main;
 
-static struct callout *callout = NULL;/* Callout list */
-static struct timeval timenow;/* Current time */
+  tw_timer_wheel_init_1t_3w_1024sl_ov (&cm->wheel, 0 /* no callback */,
+				       PPPD_TIMER_TICK, ~0);
+  cm->wheel.last_run_time = now;
+  mhash_init (&cm->callout_index_by_key, sizeof (uword),
+	      sizeof (callout_key_t));
+}
 
 /*
  * timeout - Schedule a timeout.
@@ -162,33 +209,36 @@ timeout(func, arg, secs, usecs)
      void *arg;
      int secs, usecs;
 {
-  struct callout *newp, *p, **pp;
+  callout_main_t *cm = &callout_main;
+  f64 expires;
+  callout_key_t key;
+  callout_t *c;
+  uword *p;
+
+  expires = vlib_time_now (vlib_get_main ()) + secs + usecs * 1e-6;
+
+  memset (&key, 0, sizeof (key));
+  key.c_arg = arg;
+  key.c_func = func;
 
   /*
-   * Allocate timeout.
+   * Rearming a pending timeout restarts it.
    */
-  if ((newp = (struct callout *) malloc(sizeof(struct callout))) == NULL)
-    fatal("Out of memory in timeout()!");
-  newp->c_arg = arg;
-  newp->c_func = func;
-  gettimeofday(&timenow, NULL);
-  newp->c_time.tv_sec = timenow.tv_sec + secs;
-  newp->c_time.tv_usec = timenow.tv_usec + usecs;
-  if (newp->c_time.tv_usec >= 1000000) {
-    newp->c_time.tv_sec += newp->c_time.tv_usec / 1000000;
-    newp->c_time.tv_usec %= 1000000;
+  p = mhash_get (&cm->callout_index_by_key, &key);
+  if (p) {
+    c = pool_elt_at_index (cm->callouts, p[0]);
+    if (c->handle != ~0)
+      tw_timer_stop_1t_3w_1024sl_ov (&cm->wheel, c->handle);
+  } else {
+    pool_get (cm->callouts, c);
+    c->key = key;
+    mhash_set (&cm->callout_index_by_key, &key, c - cm->callouts, 0);
   }
 
-  /*
-   * Find correct place and link it in.
-   */
-  for (pp = &callout; (p = *pp); pp = &p->c_next)
-    if (newp->c_time.tv_sec < p->c_time.tv_sec
-	|| (newp->c_time.tv_sec == p->c_time.tv_sec
-	    && newp->c_time.tv_usec < p->c_time.tv_usec))
-      break;
-  newp->c_next = p;
-  *pp = newp;
+  c->handle = pppox_timer_start (&cm->wheel, c - cm->callouts, expires);
+
+  if (expires < cm->next_wakeup)
+    pppox_timer_wakeup ();
 }
 
 
@@ -200,72 +250,90 @@ untimeout(func, arg)
      void (*func) __P((void *));
      void *arg;
 {
-  struct callout **copp, *freep;
+  callout_main_t *cm = &callout_main;
+  callout_key_t key;
+  uword *p;
 
-  /*
-   * Find first matching timeout and remove it from the list.
-   */
-  for (copp = &callout; (freep = *copp); copp = &freep->c_next)
-    if (freep->c_func == func && freep->c_arg == arg) {
-      *copp = freep->c_next;
-      free((char *) freep);
-      break;
-    }
+  memset (&key, 0, sizeof (key));
+  key.c_arg = arg;
+  key.c_func = func;
+
+  p = mhash_get (&cm->callout_index_by_key, &key);
+  if (p)
+    callout_free (cm, pool_elt_at_index (cm->callouts, p[0]));
 }
 
 
 /*
- * calltimeout - Call any timeout routines which are now due.
+ * untimeout_unit - Unschedule all timeouts of a unit, every pppd
+ * timeout argument points into the unit state.
  */
 void
-pppd_calltimeout()
+untimeout_unit(int unit)
 {
-  struct callout *p;
-
-  while (callout != NULL) {
-    p = callout;
+  callout_main_t *cm = &callout_main;
+  char *lo = (char *) ppp_unit (unit);
+  char *hi = lo + sizeof (ppp_unit_t);
+  u32 *indices = 0, *i;
+  callout_t *c;
 
-    if (gettimeofday(&timenow, NULL) < 0)
-      fatal("Failed to get time of day: %m");
-    if (!(p->c_time.tv_sec < timenow.tv_sec
-	  || (p->c_time.tv_sec == timenow.tv_sec
-	      && p->c_time.tv_usec <= timenow.tv_usec)))
-      break;/* no, it's not time yet */
+  pool_foreach (c, cm->callouts, ({
+    if ((char *) c->key.c_arg >= lo && (char *) c->key.c_arg < hi)
+      vec_add1 (indices, c - cm->callouts);
+  }));
 
-    callout = p->c_next;
-    (*p->c_func)(p->c_arg);
+  vec_foreach (i, indices)
+    callout_free (cm, pool_elt_at_index (cm->callouts, i[0]));
 
-    free((char *) p);
-  }
+  vec_free (indices);
 }
 
-// Not needed now, can be used to optimize tick mechanism.
-#if 0
+
 /*
- * timeleft - return the length of time until the next timeout is due.
+ * calltimeout - Call any timeout routines which are now due.
  */
-static struct timeval *
-timeleft(tvp)
-     struct timeval *tvp;
+void
+pppd_calltimeout(double now)
 {
-  if (callout == NULL)
-    return NULL;
-
-  gettimeofday(&timenow, NULL);
-  tvp->tv_sec = callout->c_time.tv_sec - timenow.tv_sec;
-  tvp->tv_usec = callout->c_time.tv_usec - timenow.tv_usec;
-  if (tvp->tv_usec < 0) {
-    tvp->tv_usec += 1000000;
-    tvp->tv_sec -= 1;
-  }
-  if (tvp->tv_sec < 0)
-    tvp->tv_sec = tvp->tv_usec = 0;
+  callout_main_t *cm = &callout_main;
+  callout_key_t key;
+  callout_t *c;
+  u32 *i;
+
+  cm->expired = pppox_timer_expire (&cm->wheel, now, cm->expired,
+				    &cm->next_wakeup);
 
-  return tvp;
+  /*
+   * Mark all expired first, a routine may cancel or rearm a timeout
+   * which expires in the same run.
+   */
+  vec_foreach (i, cm->expired)
+    pool_elt_at_index (cm->callouts, i[0])->handle = ~0;
+
+  vec_foreach (i, cm->expired) {
+    if (pool_is_free_index (cm->callouts, i[0]))
+      continue;			/* cancelled */
+    c = pool_elt_at_index (cm->callouts, i[0]);
+    if (c->handle != ~0)
+      continue;			/* rearmed, or reused by another timeout */
+
+    key = c->key;
+    callout_free (cm, c);
+    (*key.c_func)(key.c_arg);
+  }
 }
-#endif
 
+/*
+ * timeleft - return the length of time until the next timeout is due,
+ * or a negative value if there is no timeout at all.
+ */
+double
+pppd_timeleft(double now)
+{
+  callout_main_t *cm = &callout_main;
 
+  return pppox_timer_timeleft (&cm->wheel, now, &cm->next_wakeup);
+}
 
 /*
  * script_setenv - set an environment variable value to be used
@@ -279,10 +347,34 @@ script_setenv(var, value, iskey)
   // TODO: adpt ipcp up.
 }
 
+/*
+ * reset_link_stats - remember where the counters of the pppox interface
+ * stand when IPCP comes up, update_link_stats reports from there on.
+ * ZDY: oss pppd keeps one old_link_stats per process, here every unit
+ * has its own.
+ */
 void
 reset_link_stats(int u)
 {
-  // TODO: adapt to vpp pppox virtual interface.
+  get_ppp_stats(u, &ppp_unit (u)->old_link_stats);
+}
+
+void
+update_link_stats(int u)
+{
+  struct pppd_stats *old = &ppp_unit (u)->old_link_stats;
+
+  if (!get_ppp_stats(u, &link_stats))
+    return;
+  link_stats_valid = 1;
+
+  link_stats.bytes_in -= old->bytes_in;
+  link_stats.bytes_out -= old->bytes_out;
+  link_stats.pkts_in -= old->pkts_in;
+  link_stats.pkts_out -= old->pkts_out;
+
+  notice("[%d], sent %u bytes, received %u bytes.", u,
+	 link_stats.bytes_out, link_stats.bytes_in);
 }
 
 /*
@@ -328,29 +420,7 @@ int sifvjcomp (int u, int vjcomp, int cidcomp, int maxcid)
   return 1;
 }
 
-/********************************************************************
- *
- * sifup - Config the interface up and enable IP packets to pass.
- */
-
-int sifup(int u)
-{
-  u = u;
-  return 1;
-}
-
-/********************************************************************
- *
- * sifdown - Disable the indicated protocol and config the interface
- *	     down if there are no remaining protocols.
- */
-
-int sifdown (int u)
-{
-  u = u;
-  return 1;
-}
-
+// ZDY: sifup/sifdown are in pppox.c, they move bundle members.
 
 /********************************************************************
  *
@@ -366,18 +436,7 @@ sifnpmode(int u, int proto, enum NPmode mode)
   return 1;
 }
 
-/********************************************************************
- *
- * sifdefaultroute - assign a default route through the address given.
- */
-
-int sifdefaultroute (int unit, u_int32_t ouraddr, u_int32_t gateway)
-{
-  unit = unit;
-  ouraddr = ouraddr;
-  gateway = gateway;
-  return 1;
-}
+// ZDY: sifdefaultroute/cifdefaultroute are in pppox.c, they program fib.
 
 /********************************************************************
  *
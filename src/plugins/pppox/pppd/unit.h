@@ -0,0 +1,98 @@
+/*
+ * unit.h - per-unit pppd state.
+ *
+ * Copyright (c) 2017 RaydoNetworks.
+ *
+ */
+
+#ifndef __UNIT_H__
+#define __UNIT_H__
+
+#include "pppd.h"
+#include "fsm.h"
+#include "lcp.h"
+#include "ipcp.h"
+#include "upap.h"
+#include "chap-new.h"
+#include "ccp.h"
+#include "ecp.h"
+
+// ZDY: oss-pppd keeps one copy of these per process, earlier port turned
+// them into NUM_PPP sized arrays. Now every pppox virtual interface owns
+// one context allocated on demand, and unit is still the virtual interface
+// pool index used to locate it.
+typedef struct ppp_unit {
+  /* main.c/auth.c */
+  int unit;			/* Interface unit number */
+  int phase;			/* Current state of link */
+  int auth_pending;		/* Auth operations not completed yet */
+  int auth_done;		/* Methods actually used for auth */
+  int num_np_open;		/* Number of network protocols opened */
+  int num_np_up;		/* Number of network protocols up */
+  struct pppd_stats old_link_stats; /* Interface counters when IPCP came up */
+
+  /* fsm.c */
+  int peer_mru;			/* Currently negotiated peer MRU */
+
+  /* lcp.c */
+  fsm lcp_fsm;
+  lcp_options lcp_wantoptions;	/* Options that we want to request */
+  lcp_options lcp_gotoptions;	/* Options that peer ack'd */
+  lcp_options lcp_allowoptions;	/* Options we allow peer to request */
+  lcp_options lcp_hisoptions;	/* Options that we ack'd */
+  int lcp_echos_pending;	/* Number of outstanding echo msgs */
+  int lcp_echo_number;		/* ID number of next echo frame */
+  int lcp_echo_timer_running;	/* set if a timer is running */
+  u_int32_t lcp_echo_replied;	/* data plane replies seen so far */
+  u_int32_t lcp_rx_packets;	/* data plane rx packets seen so far */
+  int lcp_echo_interval;	/* ms between LCP echo-requests, 0 is off */
+  int lcp_echo_max_interval;	/* ms, adaptive echo backs off to, 0 is off */
+  int lcp_echo_fails;		/* Tolerance to unanswered echo-requests */
+  int lcp_echo_cur_interval;	/* ms, current interval */
+  bool multilink;		/* negotiate MRRU, member of a multilink bundle */
+  int mrru;			/* MRRU to ask for */
+  u_int32_t endpoint_magic;	/* endpoint discriminator of the bundle */
+  int restoring;		/* lcp_restore is bringing LCP up */
+  int lcp_restore_probes;	/* echoes left to prove a restored peer */
+
+  /* upap.c */
+  upap_state upap;
+
+  /* chap-new.c */
+  struct chap_client_state chap_client;
+  struct chap_server_state chap_server;
+
+  /* ipcp.c */
+  fsm ipcp_fsm;
+  ipcp_options ipcp_wantoptions;	/* Options that we want to request */
+  ipcp_options ipcp_gotoptions;		/* Options that peer ack'd */
+  ipcp_options ipcp_allowoptions;	/* Options we allow peer to request */
+  ipcp_options ipcp_hisoptions;		/* Options that we ack'd */
+  int default_route_set;	/* Have set up a default route */
+  int proxy_arp_set;		/* Have created proxy arp entry */
+  bool usepeerdns;		/* Ask peer for DNS addrs */
+  int ipcp_is_up;		/* have called np_up() */
+  int ipcp_is_open;		/* haven't called np_finished() */
+  bool ask_for_local;		/* request our address from peer */
+
+  /* ccp.c */
+  fsm ccp_fsm;
+  ccp_options ccp_wantoptions;	/* what to request the peer to use */
+  ccp_options ccp_gotoptions;	/* what the peer agreed to do */
+  ccp_options ccp_allowoptions;	/* what we'll agree to do */
+  ccp_options ccp_hisoptions;	/* what we agreed to do */
+  int ccp_localstate;
+  int all_rejected;		/* we rejected all peer's options */
+
+  /* ecp.c */
+  fsm ecp_fsm;
+  ecp_options ecp_wantoptions;	/* what to request the peer to use */
+  ecp_options ecp_gotoptions;	/* what the peer agreed to do */
+  ecp_options ecp_allowoptions;	/* what we'll agree to do */
+  ecp_options ecp_hisoptions;	/* what we agreed to do */
+} ppp_unit_t;
+
+/* Lookup the context of a unit, provided by pppox.c */
+ppp_unit_t *ppp_unit (int unit);
+
+#endif /* __UNIT_H__ */
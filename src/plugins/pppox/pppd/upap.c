@@ -51,6 +51,7 @@
 
 #include "pppd.h"
 #include "upap.h"
+#include "unit.h"
 
 //static const char rcsid[] = RCSID;
 
@@ -87,8 +88,6 @@ struct protent pap_protent = {
     NULL
 };
 
-upap_state upap[NUM_PPP];		/* UPAP state; one for each unit */
-
 static void upap_timeout __P((void *));
 static void upap_reqtimeout __P((void *));
 static void upap_rauthreq __P((upap_state *, u_char *, int, int));
@@ -105,7 +104,7 @@ static void
 upap_init(unit)
     int unit;
 {
-    upap_state *u = &upap[unit];
+    upap_state *u = &ppp_unit (unit)->upap;
 
     u->us_unit = unit;
     //ZDY: will be set/free by pppox plugin, should not
@@ -135,7 +134,7 @@ upap_authwithpeer(unit/*, user, password*/)
     int unit;
     /*    char *user, *password;*/
 {
-    upap_state *u = &upap[unit];
+    upap_state *u = &ppp_unit (unit)->upap;
 
     /* Save the username and password we're given */
     // ZDY: set by pppox plugin.
@@ -167,7 +166,7 @@ void
 upap_authpeer(unit)
     int unit;
 {
-    upap_state *u = &upap[unit];
+    upap_state *u = &ppp_unit (unit)->upap;
 
     /* Lower layer up yet? */
     if (u->us_serverstate == UPAPSS_INITIAL ||
@@ -232,7 +231,7 @@ static void
 upap_lowerup(unit)
     int unit;
 {
-    upap_state *u = &upap[unit];
+    upap_state *u = &ppp_unit (unit)->upap;
 
     if (u->us_clientstate == UPAPCS_INITIAL)
 	u->us_clientstate = UPAPCS_CLOSED;
@@ -259,7 +258,7 @@ static void
 upap_lowerdown(unit)
     int unit;
 {
-    upap_state *u = &upap[unit];
+    upap_state *u = &ppp_unit (unit)->upap;
 
     if (u->us_clientstate == UPAPCS_AUTHREQ)	/* Timeout pending? */
 	UNTIMEOUT(upap_timeout, u);		/* Cancel timeout */
@@ -280,7 +279,7 @@ static void
 upap_protrej(unit)
     int unit;
 {
-    upap_state *u = &upap[unit];
+    upap_state *u = &ppp_unit (unit)->upap;
 
     if (u->us_clientstate == UPAPCS_AUTHREQ) {
 	xerror("PAP authentication failed due to protocol-reject");
@@ -303,7 +302,7 @@ upap_input(unit, inpacket, l)
     u_char *inpacket;
     int l;
 {
-    upap_state *u = &upap[unit];
+    upap_state *u = &ppp_unit (unit)->upap;
     u_char *inp;
     u_char code, id;
     int len;
@@ -42,6 +42,9 @@
  * $Id: upap.h,v 1.8 2002/12/04 23:03:33 paulus Exp $
  */
 
+#ifndef __UPAP_H__
+#define __UPAP_H__
+
 /*
  * Packet header = Code, id, length.
  */
@@ -102,9 +105,10 @@ typedef struct upap_state {
 #define UPAP_DEFTIMEOUT	3	/* Timeout (seconds) for retransmitting req */
 #define UPAP_DEFREQTIME	30	/* Time to wait for auth-req from peer */
 
-extern upap_state upap[];
 
 void upap_authwithpeer __P((int/*, char *, char **/));
 void upap_authpeer __P((int));
 
 extern struct protent pap_protent;
+
+#endif /* __UPAP_H__ */
@@ -10,6 +10,10 @@
 #include <vlib/unix/unix.h>
 #include <vnet/ethernet/ethernet.h>
 #include <vnet/dpo/interface_tx_dpo.h>
+#include <vnet/adj/adj_midchain.h>
+#include <vnet/adj/adj_mcast.h>
+#include <vnet/adj/adj_nbr.h>
+#include <vnet/mfib/mfib_table.h>
 #include <vnet/plugin/plugin.h>
 #include <vpp/app/version.h>
 #include <vnet/ppp/packet.h>
@@ -21,12 +25,15 @@
 #include <pppox/pppd/upap.h>
 #include <pppox/pppd/chap-new.h>
 #include <pppox/pppd/ipcp.h>
+#include <pppox/pppd/unit.h>
 
 #include <vppinfra/hash.h>
 #include <vppinfra/bihash_template.c>
 
 pppox_main_t pppox_main;
 
+static u32 pppox_ifaddr_apply (vlib_main_t * vm, u32 max);
+
 // This function is adapted to oss pppd main.c:get_input.
 // refer to pppoeclient_session_input to see what packets can
 // be delivered here, if new protocol enabled, should modify
@@ -37,19 +44,21 @@ consume_pppox_ctrl_pkt (u32 bi, vlib_buffer_t * b)
   pppox_main_t * pom = &pppox_main;
   u32 sw_if_index = vnet_buffer(b)->sw_if_index [VLIB_RX];
   pppox_virtual_interface_t *t = 0;
+  ppp_unit_t *ppp;
   u8 *p = 0;
   int i = 0;
   u16 protocol = 0;
   struct protent *protp;
   int len = vnet_buffer(b)->pppox.len;
   // Use virtual interface context index as pppd unit number.
-  u8 unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  u32 unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
 
   // If instance is deleted, simple return.
-  t = pool_elt_at_index (pom->virtual_interfaces, unit);
-  if (t == NULL) {
+  if (unit == ~0 || pool_is_free_index (pom->virtual_interfaces, unit)) {
     return 1;
   }
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  ppp = t->ppp;
 
   p = vlib_buffer_get_current (b);
 
@@ -60,7 +69,7 @@ consume_pppox_ctrl_pkt (u32 bi, vlib_buffer_t * b)
   /*
    * Toss all non-LCP packets unless LCP is OPEN.
    */
-  if (protocol != PPP_LCP && lcp_fsm[unit].state != OPENED) {
+  if (protocol != PPP_LCP && ppp->lcp_fsm.state != OPENED) {
     return 1;
   }
 
@@ -69,7 +78,7 @@ consume_pppox_ctrl_pkt (u32 bi, vlib_buffer_t * b)
    * except LCP authentication packets.
    */
   // ZDY: we only support PAP/CHAP HERE.
-  if (phase[unit] <= PHASE_AUTHENTICATE
+  if (ppp->phase <= PHASE_AUTHENTICATE
       && !(protocol == PPP_LCP || protocol == PPP_PAP || protocol == PPP_CHAP)) {
     return 1;
   }
@@ -96,25 +105,25 @@ consume_pppox_ctrl_pkt (u32 bi, vlib_buffer_t * b)
 
 
 /*
- * restart_dead_client - restart dead pppoe client to reconnec.
+ * restart_dead_client - restart dead pppoe client to reconnect,
+ * scheduled as a pppd timeout after the link is cleaned up.
  */
 static void
-pppox_restart_dead_client()
+pppox_restart_dead_client(void *arg)
 {
   pppox_main_t * pom = &pppox_main;
+  ppp_unit_t *ppp = arg;
   pppox_virtual_interface_t * vif;
 
-  pool_foreach (vif, pom->virtual_interfaces, ({
-    int unit = pom->virtual_interface_index_by_sw_if_index[vif->sw_if_index];
-    if (phase[unit] == PHASE_DEAD && vif->pppoe_session_allocated) {
-      // notify pppoe to open session to start.
-      static void (*pppoe_client_open_session_func) (u32 client_index) = 0;
-      if (pppoe_client_open_session_func ==0 ) {
-	pppoe_client_open_session_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_open_session");
-      }
-      (*pppoe_client_open_session_func) (vif->pppoe_client_index);
-      }
-  }));
+  vif = pool_elt_at_index (pom->virtual_interfaces, ppp->unit);
+  if (ppp->phase == PHASE_DEAD && vif->pppoe_session_allocated) {
+    // notify pppoe to open session to start.
+    static void (*pppoe_client_open_session_func) (u32 client_index) = 0;
+    if (pppoe_client_open_session_func ==0 ) {
+      pppoe_client_open_session_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_open_session");
+    }
+    (*pppoe_client_open_session_func) (vif->pppoe_client_index);
+  }
 }
 
 static uword
@@ -122,28 +131,31 @@ pppox_process (vlib_main_t * vm,
                vlib_node_runtime_t * rt,
                vlib_frame_t * f)
 {
-  uword event_type;
   uword * event_data = 0;
+  f64 timeout;
 
   while (1)
     {
-      // 1 second loop serve as a tick to drive oss-pppd timers.
-      // XXX: actually we can call timeleft(sys-vpp.c) to
-      // figure out what timeout we need here, but current
-      // pppd timer mininum is 1s, so it's enough to do
-      // this in a tick manner.
-      vlib_process_wait_for_event_or_clock (vm, 1); // 1 second.
-
-      event_type = vlib_process_get_events (vm, &event_data);
-
-      switch (event_type)
-        {
-        case ~0:
-          pppd_calltimeout();
-          // We need restart dead client due to various reason.
-          pppox_restart_dead_client();
-          break;
-        }
+      // Sleep until next oss-pppd timer is due, a timer armed
+      // earlier than that wakes us up to recompute.
+      timeout = pppd_timeleft (vlib_time_now (vm));
+      // address changes left over from a full batch go in the next one,
+      // workers forward in between.
+      if (vec_len (pppox_main.ifaddr.pending) &&
+          (timeout < 0 || timeout > PPPOX_IFADDR_BATCH_PAUSE))
+        timeout = PPPOX_IFADDR_BATCH_PAUSE;
+      if (timeout < 0)
+        vlib_process_wait_for_event (vm);
+      else
+        vlib_process_wait_for_event_or_clock (vm, timeout);
+
+      // PPPOX_EVENT_TIMER_UPDATE or PPPOX_EVENT_IFADDR, run timers
+      // then whatever address changes pppd queued.
+      vlib_process_get_events (vm, &event_data);
+
+      pppd_calltimeout (vlib_time_now (vm));
+      pppox_flush_output ();
+      pppox_ifaddr_apply (vm, PPPOX_IFADDR_BATCH_MAX);
 
       vec_reset_length (event_data);
     }
@@ -159,6 +171,78 @@ VLIB_REGISTER_NODE (pppox_process_node,static) = {
     .process_log2_n_stack_bytes = 16,
 };
 
+void
+pppox_timer_wakeup (void)
+{
+  pppox_main_t *pom = &pppox_main;
+
+  vlib_process_signal_event (pom->vlib_main, pppox_process_node.index,
+                             PPPOX_EVENT_TIMER_UPDATE, 0);
+}
+
+/*
+ * Timer wheels of pppd and of the pppoe client are run by a process
+ * which sleeps until the first expiry. The helpers below keep the
+ * wheel and the process wakeup time in step, next_wakeup is the time
+ * the process will next run the wheel.
+ */
+
+/* start a timer expiring at the first tick at or after expires */
+u32
+pppox_timer_start (tw_timer_wheel_1t_3w_1024sl_ov_t * tw, u32 user_handle,
+                   f64 expires)
+{
+  f64 ticks;
+  u64 interval;
+
+  // the wheel runs the slot at interval ticks after the one it's
+  // going to run next, that is (interval + 1) ticks after last run.
+  ticks = (expires - tw->last_run_time) * tw->ticks_per_second;
+  interval = ticks > 0 ? ticks : 0;
+  if (interval < ticks)
+    interval++;
+  interval = interval > 1 ? interval - 1 : 1;
+
+  return tw_timer_start_1t_3w_1024sl_ov (tw, user_handle, 0 /* timer id */,
+                                         interval);
+}
+
+/* expire the timers due at now into expired, returns the vector */
+u32 *
+pppox_timer_expire (tw_timer_wheel_1t_3w_1024sl_ov_t * tw, f64 now,
+                    u32 * expired, f64 * next_wakeup)
+{
+  // timers armed while the process runs are seen when it sleeps again.
+  *next_wakeup = 0;
+
+  vec_reset_length (expired);
+  return tw_timer_expire_timers_vec_1t_3w_1024sl_ov (tw, now, expired);
+}
+
+/* time until the first timer expires, negative if none is running */
+f64
+pppox_timer_timeleft (tw_timer_wheel_1t_3w_1024sl_ov_t * tw, f64 now,
+                      f64 * next_wakeup)
+{
+  u32 ticks, wrap;
+
+  if (pool_elts (tw->timers) == 0)
+    {
+      *next_wakeup = 1e70;      /* never */
+      return -1;
+    }
+
+  // only fast wheel slots are tracked, timers on slower wheels move
+  // onto it when the fast wheel wraps, so don't sleep past that.
+  ticks = tw_timer_first_expires_in_ticks_1t_3w_1024sl_ov (tw);
+  wrap = TW_SLOTS_PER_RING - tw->current_index[TW_TIMER_RING_FAST];
+  ticks = clib_min (ticks, wrap);
+
+  *next_wakeup = tw->last_run_time + (ticks + 1) * tw->timer_interval;
+
+  return clib_max (*next_wakeup - now, 0.0);
+}
+
 static u8 *
 format_pppox_name (u8 * s, va_list * args)
 {
@@ -210,6 +294,143 @@ pppox_build_rewrite (vnet_main_t * vnm,
   return rw;
 }
 
+/*
+ * The midchain rewrite is lower encap (ethernet + pppoe) followed by
+ * the ppp protocol, the pppoe length field ends the lower encap and
+ * counts everything behind it.
+ */
+static void
+pppox_fixup (vlib_main_t * vm, ip_adjacency_t * adj, vlib_buffer_t * b0)
+{
+  u8 *p0 = vlib_buffer_get_current (b0);
+  u16 encap_len = adj->rewrite_header.data_bytes - 2;
+
+  *(u16 *) (p0 + encap_len - 2) =
+    clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b0) - encap_len);
+}
+
+/*
+ * IP packets of pppox interfaces leave through a midchain adjacency
+ * whose rewrite carries the whole encap, stacked on the tx node of the
+ * pppoe client uplink. Without a pppoe session the adjacency is stacked
+ * on drop, rewrite is refreshed once the session comes back.
+ */
+static void
+pppox_update_adj (vnet_main_t * vnm, u32 sw_if_index, adj_index_t ai)
+{
+  pppox_main_t * pom = &pppox_main;
+  vlib_main_t *vm = pom->vlib_main;
+  pppox_virtual_interface_t *t;
+  dpo_id_t dpo = DPO_INVALID;
+  ip_adjacency_t *adj;
+  u32 encap_sw_if_index = ~0;
+  u8 *rewrite = 0, *ppp;
+  int is_up;
+
+  ASSERT (ADJ_INDEX_INVALID != ai);
+
+  adj = adj_get (ai);
+  t = pool_elt_at_index (pom->virtual_interfaces,
+                         pom->virtual_interface_index_by_sw_if_index[sw_if_index]);
+
+  static int (*pppoe_client_get_encap_func) (u32, u32 *, u8 **) = 0;
+  if (pppoe_client_get_encap_func == 0) {
+    pppoe_client_get_encap_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_get_encap");
+  }
+  is_up = (*pppoe_client_get_encap_func) (t->pppoe_client_index,
+                                          &encap_sw_if_index, &rewrite);
+  ppp = pppox_build_rewrite (vnm, sw_if_index, adj->ia_link, NULL);
+  vec_append (rewrite, ppp);
+  vec_free (ppp);
+
+  switch (adj->lookup_next_index)
+    {
+    case IP_LOOKUP_NEXT_ARP:
+    case IP_LOOKUP_NEXT_GLEAN:
+      adj_nbr_midchain_update_rewrite (ai, pppox_fixup,
+                                       ADJ_FLAG_NONE, rewrite);
+      break;
+    case IP_LOOKUP_NEXT_MCAST:
+      adj_mcast_midchain_update_rewrite (ai, pppox_fixup,
+                                         ADJ_FLAG_NONE, rewrite, 0, 0);
+      break;
+    case IP_LOOKUP_NEXT_MIDCHAIN:
+    case IP_LOOKUP_NEXT_MCAST_MIDCHAIN:
+      // session changed, rewrite keeps its length but not the content,
+      // mtu may have been negotiated again.
+      vlib_worker_thread_barrier_sync (vm);
+      vnet_rewrite_set_data_internal (&adj->rewrite_header,
+                                      sizeof (adj->rewrite_data),
+                                      rewrite, vec_len (rewrite));
+      adj->rewrite_header.max_l3_packet_bytes =
+        vnet_get_hw_interface (vnm, t->hw_if_index)->max_l3_packet_bytes[VLIB_TX];
+      vlib_worker_thread_barrier_release (vm);
+      vec_free (rewrite);
+      break;
+    case IP_LOOKUP_NEXT_DROP:
+    case IP_LOOKUP_NEXT_PUNT:
+    case IP_LOOKUP_NEXT_LOCAL:
+    case IP_LOOKUP_NEXT_REWRITE:
+    case IP_LOOKUP_NEXT_ICMP_ERROR:
+    case IP_LOOKUP_N_NEXT:
+      ASSERT (0);
+      vec_free (rewrite);
+      return;
+    }
+
+  if (is_up)
+    {
+      interface_tx_dpo_add_or_lock (vnet_link_to_dpo_proto (adj->ia_link),
+                                    encap_sw_if_index, &dpo);
+      adj_nbr_midchain_stack (ai, &dpo);
+      dpo_reset (&dpo);
+    }
+  else
+    {
+      adj_nbr_midchain_unstack (ai);
+    }
+}
+
+static adj_walk_rc_t
+pppox_update_adj_walk (adj_index_t ai, void *ctx)
+{
+  u32 *sw_if_index = ctx;
+
+  pppox_update_adj (pppox_main.vnet_main, *sw_if_index, ai);
+
+  return (ADJ_WALK_RC_CONTINUE);
+}
+
+static void *
+update_adjacencies_callback (void *arg)
+{
+  pppox_main_t * pom = &pppox_main;
+  u32 sw_if_index = *(u32 *) arg;
+
+  if (sw_if_index >= vec_len (pom->virtual_interface_index_by_sw_if_index)
+      || pom->virtual_interface_index_by_sw_if_index[sw_if_index] == ~0)
+    return 0;
+
+  adj_nbr_walk (sw_if_index, FIB_PROTOCOL_IP4, pppox_update_adj_walk, &sw_if_index);
+  adj_nbr_walk (sw_if_index, FIB_PROTOCOL_IP6, pppox_update_adj_walk, &sw_if_index);
+  adj_mcast_walk (sw_if_index, FIB_PROTOCOL_IP4, pppox_update_adj_walk, &sw_if_index);
+  adj_mcast_walk (sw_if_index, FIB_PROTOCOL_IP6, pppox_update_adj_walk, &sw_if_index);
+
+  return 0;
+}
+
+void vl_api_rpc_call_main_thread (void *fp, u8 * data, u32 data_length);
+
+// Called by pppoe client when its session is allocated or gone,
+// adjacencies of the interface must follow the new encap.
+void
+pppox_update_adjacencies (u32 sw_if_index)
+{
+  // Might be called in worker thread, so use rpc.
+  vl_api_rpc_call_main_thread (update_adjacencies_callback,
+                               (u8 *) & sw_if_index, sizeof (sw_if_index));
+}
+
 /* *INDENT-OFF* */
 VNET_DEVICE_CLASS (pppox_device_class,static) = {
   .name = "PPPPOX",
@@ -222,12 +443,26 @@ VNET_DEVICE_CLASS (pppox_device_class,static) = {
 VNET_HW_INTERFACE_CLASS (pppox_hw_class,static) = {
   .name = "PPPOX",
   .build_rewrite = pppox_build_rewrite,
-  // Do not need leverage adj, use default update adj with
-  // our own rewrite to insert the ppp protocol field.
-  //.update_adjacency = pppox_update_adj,
+  .update_adjacency = pppox_update_adj,
   .flags = VNET_HW_INTERFACE_CLASS_FLAG_P2P,
 };
 
+/*
+ * TCP MSS clamp features of a pppox interface, see node.c.
+ */
+void
+pppox_mss_clamp_enable_disable (u32 sw_if_index, int is_enable)
+{
+  vnet_feature_enable_disable ("ip4-unicast", "pppox-mss-clamp-ip4-in",
+                               sw_if_index, is_enable, 0, 0);
+  vnet_feature_enable_disable ("ip6-unicast", "pppox-mss-clamp-ip6-in",
+                               sw_if_index, is_enable, 0, 0);
+  vnet_feature_enable_disable ("ip4-output", "pppox-mss-clamp-ip4-out",
+                               sw_if_index, is_enable, 0, 0);
+  vnet_feature_enable_disable ("ip6-output", "pppox-mss-clamp-ip6-out",
+                               sw_if_index, is_enable, 0, 0);
+}
+
 u32
 pppox_allocate_interface (u32 pppoe_client_index)
 {
@@ -238,12 +473,16 @@ pppox_allocate_interface (u32 pppoe_client_index)
   vnet_sw_interface_t *si;
   vnet_main_t *vnm = pom->vnet_main;
   pppox_virtual_interface_t *t = 0;
-  int unit;
 
   pool_get_aligned (pom->virtual_interfaces, t, CLIB_CACHE_LINE_BYTES);
   memset (t, 0, sizeof (*t));
 
   t->pppoe_client_index = pppoe_client_index;
+  t->mtu = PPPOX_PPPOE_MAX_MRU;
+  t->bundle_index = ~0;
+  t->bundle_member_index = ~0;
+  t->default_route_fib_index = ~0;
+  t->fib_index = ~0;
   
   if (vec_len (pom->free_pppox_hw_if_indices) > 0)
     {
@@ -291,22 +530,77 @@ pppox_allocate_interface (u32 pppoe_client_index)
   si->flags &= ~VNET_SW_INTERFACE_FLAG_HIDDEN;
   vnet_sw_interface_set_flags (vnm, sw_if_index,
                                VNET_SW_INTERFACE_FLAG_ADMIN_UP);
+  pppox_mss_clamp_enable_disable (sw_if_index, 1);
 
+  // pppd state of this unit, zeroed means no pap/chap credential yet.
+  // Allocated separately since pppd timeouts keep pointers into it.
+  t->ppp = clib_mem_alloc_aligned (sizeof (ppp_unit_t), CLIB_CACHE_LINE_BYTES);
+  memset (t->ppp, 0, sizeof (ppp_unit_t));
+  t->ppp->unit = t - pom->virtual_interfaces;
+  lcp_echo_config (t->ppp->unit, lcp_echo_interval * 1000, 0, lcp_echo_fails);
 
-  unit = t - pom->virtual_interfaces;
-  // pap client.
-  upap[unit].us_user = NULL;
-  upap[unit].us_userlen = 0;
-  upap[unit].us_passwd = NULL;
-  upap[unit].us_passwdlen = 0;
+  return hw_if_index;
+}
 
-  // chap client.
-  chap_client[unit].us_user = NULL;
-  chap_client[unit].us_userlen = 0;
-  chap_client[unit].us_passwd = NULL;
-  chap_client[unit].us_passwdlen = 0;
+/*
+ * Bind the interface to the ip4 tables of table_id, which must exist.
+ * ip_table_bind takes an API lock on the tables for each binding to a
+ * non zero table and releases one binding back to table 0, so going
+ * from one VRF to another passes through table 0. It refuses to move
+ * an interface with addresses, they are taken off while it moves.
+ */
+static int
+pppox_table_bind (pppox_virtual_interface_t * t, u32 table_id)
+{
+  pppox_main_t *pom = &pppox_main;
+  ip_lookup_main_t *lm = &ip4_main.lookup_main;
+  ip_interface_address_t *ia;
+  ip4_address_t *addrs = 0;
+  u32 *lens = 0, fib_index = ~0, i;
+  int rv = 0;
 
-  return hw_if_index;
+  if (table_id)
+    {
+      fib_index = fib_table_find (FIB_PROTOCOL_IP4, table_id);
+      if (~0 == fib_index || ~0 == mfib_table_find (FIB_PROTOCOL_IP4, table_id))
+        return VNET_API_ERROR_NO_SUCH_FIB;
+    }
+  if (fib_index == t->fib_index)
+    return 0;
+
+  /* *INDENT-OFF* */
+  foreach_ip_interface_address (lm, ia, t->sw_if_index,
+                                0 /* own addresses only */,
+  ({
+    vec_add1 (addrs, *(ip4_address_t *) ip_interface_address_get_address (lm, ia));
+    vec_add1 (lens, ia->address_length);
+  }));
+  /* *INDENT-ON* */
+  for (i = 0; i < vec_len (addrs); i++)
+    ip4_add_del_interface_address (pom->vlib_main, t->sw_if_index,
+                                   &addrs[i], lens[i], 1 /* is_del */);
+
+  if (~0 != t->fib_index)
+    {
+      rv = ip_table_bind (FIB_PROTOCOL_IP4, t->sw_if_index, 0, 1 /* is_api */);
+      if (!rv)
+        t->fib_index = ~0;
+    }
+  if (!rv && table_id)
+    {
+      rv = ip_table_bind (FIB_PROTOCOL_IP4, t->sw_if_index, table_id,
+                          1 /* is_api */);
+      if (!rv)
+        t->fib_index = fib_index;
+    }
+
+  for (i = 0; i < vec_len (addrs); i++)
+    ip4_add_del_interface_address (pom->vlib_main, t->sw_if_index,
+                                   &addrs[i], lens[i], 0 /* is_del */);
+  vec_free (addrs);
+  vec_free (lens);
+
+  return rv;
 }
 
 void
@@ -315,6 +609,20 @@ pppox_handle_allocated_address (pppox_virtual_interface_t * t, u8 is_add)
   pppox_main_t * pom = &pppox_main;
   ip4_address_t our_adr_ipv4;
   fib_prefix_t pfx;
+  u32 fib_index;
+  int rv;
+
+  // Move the interface to its VRF while it has no address, the table
+  // may have been changed since the last time IPCP came up. Nothing is
+  // programmed if that fails, it would end up in the wrong table.
+  if (is_add && (rv = pppox_table_bind (t, t->table_id)))
+    {
+      clib_warning ("pppox sw_if_index %d: cannot bind to vrf %d, rv %d",
+                    t->sw_if_index, t->table_id, rv);
+      return;
+    }
+  fib_index = fib_table_get_index_for_sw_if_index (FIB_PROTOCOL_IP4,
+                                                   t->sw_if_index);
 
   // Configure ip4 address.
   our_adr_ipv4.as_u32 = t->our_addr;
@@ -327,13 +635,13 @@ pppox_handle_allocated_address (pppox_virtual_interface_t * t, u8 is_add)
   pfx.fp_len = 32; // always 32
   pfx.fp_proto = FIB_PROTOCOL_IP4;
   if ( is_add ) {
-    fib_table_entry_path_add (0, &pfx,
+    fib_table_entry_path_add (fib_index, &pfx,
 			      FIB_SOURCE_PLUGIN_HI, FIB_ENTRY_FLAG_NONE,
 			      fib_proto_to_dpo (pfx.fp_proto),
 			      &pfx.fp_addr, t->sw_if_index, ~0,
 			      1, NULL, FIB_ROUTE_PATH_FLAG_NONE);
   } else {
-    fib_table_entry_path_remove (0, &pfx,
+    fib_table_entry_path_remove (fib_index, &pfx,
 			      FIB_SOURCE_PLUGIN_HI,
 			      fib_proto_to_dpo (pfx.fp_proto),
 			      &pfx.fp_addr, t->sw_if_index, ~0,
@@ -341,6 +649,55 @@ pppox_handle_allocated_address (pppox_virtual_interface_t * t, u8 is_add)
   }
 }
 
+/*
+ * Default route through the interface in its VRF, the distance is the
+ * path preference so that a session with a lower one is used while it
+ * is up and others back it up.
+ */
+static void
+pppox_handle_default_route (pppox_virtual_interface_t * t, u8 is_add)
+{
+  fib_prefix_t pfx;
+  fib_route_path_t *rpaths = 0, *rpath;
+
+  if (is_add == (t->default_route_fib_index != ~0))
+    return;
+
+  memset (&pfx, 0, sizeof (pfx));
+  pfx.fp_proto = FIB_PROTOCOL_IP4;
+
+  vec_add2 (rpaths, rpath, 1);
+  rpath->frp_proto = DPO_PROTO_IP4;
+  rpath->frp_sw_if_index = t->sw_if_index;
+  rpath->frp_fib_index = ~0;
+  rpath->frp_weight = 1;
+  rpath->frp_preference = t->default_route_distance;
+
+  // not in its VRF, pppox_handle_allocated_address failed to bind it.
+  if (is_add &&
+      fib_table_get_table_id_for_sw_if_index (FIB_PROTOCOL_IP4,
+                                              t->sw_if_index) != t->table_id)
+    return;
+
+  if (is_add)
+    {
+      t->default_route_fib_index =
+        fib_table_get_index_for_sw_if_index (FIB_PROTOCOL_IP4,
+                                             t->sw_if_index);
+      fib_table_entry_path_add2 (t->default_route_fib_index, &pfx,
+                                 FIB_SOURCE_PLUGIN_HI, FIB_ENTRY_FLAG_NONE,
+                                 rpaths);
+    }
+  else
+    {
+      fib_table_entry_path_remove2 (t->default_route_fib_index, &pfx,
+                                    FIB_SOURCE_PLUGIN_HI, rpaths);
+      t->default_route_fib_index = ~0;
+    }
+
+  vec_free (rpaths);
+}
+
 void
 pppox_free_interface(u32 hw_if_index)
 {
@@ -348,11 +705,13 @@ pppox_free_interface(u32 hw_if_index)
   vnet_main_t *vnm = pom->vnet_main;
   vnet_hw_interface_t *hi;
   pppox_virtual_interface_t *t = 0;
+  ppp_unit_t *ppp;
   int unit;
   hi = vnet_get_hw_interface (vnm, hw_if_index);
 
   unit = pom->virtual_interface_index_by_sw_if_index[hi->sw_if_index];
   t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  ppp = t->ppp;
 
   // clean allocated address.
   // lcp_close will trigger the ip freeed if we have allocated one.
@@ -364,8 +723,19 @@ pppox_free_interface(u32 hw_if_index)
 
   // turn down underlying lcp.
   lcp_close (unit, "User request");
+  pppox_flush_output ();
+  // queued address changes point at the unit, apply them before it goes.
+  pppox_ifaddr_apply (pom->vlib_main, ~0);
+  // back to table 0, the sw_if_index is reused by the next interface.
+  pppox_table_bind (t, 0);
+
+  if (t->bundle_index != ~0)
+    pppox_bundle_add_del_member
+      (pool_elt_at_index (pom->bundles, t->bundle_index)->sw_if_index,
+       hi->sw_if_index, 0, 0);
 
   vnet_sw_interface_set_flags (vnm, hi->sw_if_index, 0 /* down */ );
+  pppox_mss_clamp_enable_disable (hi->sw_if_index, 0);
   vnet_sw_interface_t *si = vnet_get_sw_interface (vnm, hi->sw_if_index);
   si->flags |= VNET_SW_INTERFACE_FLAG_HIDDEN;
 
@@ -373,35 +743,66 @@ pppox_free_interface(u32 hw_if_index)
 
   pom->virtual_interface_index_by_sw_if_index[hi->sw_if_index] = ~0;
 
-  pool_put (pom->virtual_interfaces,  t);
-
   // pap client.
-  if (upap[unit].us_user) {
-    vec_free (upap[unit].us_user);
-    upap[unit].us_user = NULL;
-    upap[unit].us_userlen = 0;
-  }
-  if (upap[unit].us_passwd) {
-    vec_free (upap[unit].us_passwd);
-    upap[unit].us_passwd = NULL;
-    upap[unit].us_passwdlen = 0;
-  }
+  vec_free (ppp->upap.us_user);
+  vec_free (ppp->upap.us_passwd);
 
   // chap client.
-  if (chap_client[unit].us_user) {
-    vec_free (chap_client[unit].us_user);
-    chap_client[unit].us_user = NULL;
-    chap_client[unit].us_userlen = 0;
-  }
-  if (chap_client[unit].us_passwd) {
-    vec_free (chap_client[unit].us_passwd);
-    chap_client[unit].us_passwd = NULL;
-    chap_client[unit].us_passwdlen = 0;
-  }
+  vec_free (ppp->chap_client.us_user);
+  vec_free (ppp->chap_client.us_passwd);
+
+  // pending pppd timeouts point into the unit state, drop them
+  // before the state goes away.
+  untimeout_unit (unit);
+  clib_mem_free (ppp);
+  t->ppp = 0;
+
+  pool_put (pom->virtual_interfaces,  t);
+}
+
+/* reset pppd state of a unit for a new pppoe session */
+static void
+pppox_lower_reset (pppox_virtual_interface_t * t, int unit, u16 mru)
+{
+  struct protent *protp;
+
+  new_phase (unit, PHASE_INITIALIZE);
+  // Reset state due to lower reset.
+  for (int i = 0; (protp = protocols[i]) != NULL; ++i)
+    {
+      (*protp->init) (unit);
+    }
+
+  // Init auth context.
+  init_auth_context (unit);
+
+  // IPCP asks sifdefaultroute for one when it comes up.
+  t->ppp->ipcp_wantoptions.default_route = t->default_route;
+
+  // PPPoE leaves 1492 bytes as rp-pppoe plugin does, more when the
+  // AC granted a PPP-Max-Payload (RFC 4638) in discovery.
+  t->ppp->lcp_wantoptions.mru = mru;
+  t->ppp->lcp_allowoptions.mru = mru;
+
+  // Members of a multilink bundle ask for its MRRU, and announce one
+  // endpoint discriminator so the peer bundles them together.
+  if (t->ppp->multilink)
+    {
+      lcp_options *wo = &t->ppp->lcp_wantoptions;
+      lcp_options *ao = &t->ppp->lcp_allowoptions;
+
+      wo->neg_mrru = ao->neg_mrru = 1;
+      wo->mrru = ao->mrru = t->ppp->mrru;
+      wo->neg_endpoint = ao->neg_endpoint = 1;
+      wo->endpoint.class = EPD_MAGIC;
+      wo->endpoint.length = sizeof (t->ppp->endpoint_magic);
+      clib_memcpy (wo->endpoint.value, &t->ppp->endpoint_magic,
+                   sizeof (t->ppp->endpoint_magic));
+    }
 }
 
 void
-pppox_lower_up(u32 sw_if_index)
+pppox_lower_up(u32 sw_if_index, u16 mru)
 {
   pppox_main_t * pom = &pppox_main;
   pppox_virtual_interface_t *t = 0;
@@ -411,21 +812,11 @@ pppox_lower_up(u32 sw_if_index)
   t = pool_elt_at_index (pom->virtual_interfaces, unit);
   t->pppoe_session_allocated = 1;
 
-  new_phase (unit, PHASE_INITIALIZE);
-  // Reset state due to lower reset.
-  {
-    struct protent *protp;
-    for (int i = 0; (protp = protocols[i]) != NULL; ++i)
-      {
-	(*protp->init) (unit);
-      }
-
-    // Init auth context.
-    init_auth_context (unit);
-  }
-  
+  pppox_lower_reset (t, unit, mru);
+
   lcp_open(unit);
   start_link(unit);
+  pppox_flush_output ();
 
   return;
 }
@@ -435,18 +826,48 @@ pppox_lower_down(u32 sw_if_index)
 {
   pppox_main_t * pom = &pppox_main;
   pppox_virtual_interface_t *t = 0;
-  u8 unit;
+  int unit;
 
   unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
   t = pool_elt_at_index (pom->virtual_interfaces, unit);
   
   lcp_close(unit, "lower down (remote close session/underlying physical interface down");
+  pppox_flush_output ();
 
   t->pppoe_session_allocated = 0;
 
   return;
 }
 
+/* username and password pap and chap clients authenticate with */
+static void
+pppox_set_credentials (ppp_unit_t * ppp, u8 * username, u8 * password)
+{
+  // pap client.
+  if (ppp->upap.us_user) {
+    vec_free (ppp->upap.us_user);
+  }
+  ppp->upap.us_user = (char *)vec_dup (username);
+  ppp->upap.us_userlen = strlen (ppp->upap.us_user);
+  if (ppp->upap.us_passwd) {
+    vec_free (ppp->upap.us_passwd);
+  }
+  ppp->upap.us_passwd = (char *) vec_dup(password);
+  ppp->upap.us_passwdlen = strlen (ppp->upap.us_passwd);
+
+  // chap client.
+  if (ppp->chap_client.us_user) {
+    vec_free (ppp->chap_client.us_user);
+  }
+  ppp->chap_client.us_user = (char *) vec_dup(username);
+  ppp->chap_client.us_userlen = strlen (ppp->chap_client.us_user);
+  if (ppp->chap_client.us_passwd) {
+    vec_free (ppp->chap_client.us_passwd);
+  }
+  ppp->chap_client.us_passwd = (char *) vec_dup(password);
+  ppp->chap_client.us_passwdlen = strlen (ppp->chap_client.us_passwd);
+}
+
 int
 pppox_set_auth (u32 sw_if_index, u8 * username, u8 * password)
 {
@@ -456,32 +877,8 @@ pppox_set_auth (u32 sw_if_index, u8 * username, u8 * password)
 
   unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
   t = pool_elt_at_index (pom->virtual_interfaces, unit);
-  
-  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
 
-  // pap client.
-  if (upap[unit].us_user) {
-    vec_free (upap[unit].us_user);
-  }
-  upap[unit].us_user = (char *)vec_dup (username);
-  upap[unit].us_userlen = strlen (upap[unit].us_user);
-  if (upap[unit].us_passwd) {
-    vec_free (upap[unit].us_passwd);
-  }
-  upap[unit].us_passwd = (char *) vec_dup(password);
-  upap[unit].us_passwdlen = strlen (upap[unit].us_passwd);
-
-  // chap client.
-  if (chap_client[unit].us_user) {
-    vec_free (chap_client[unit].us_user);
-  }
-  chap_client[unit].us_user = (char *) vec_dup(username);
-  chap_client[unit].us_userlen = strlen (chap_client[unit].us_user);
-  if (chap_client[unit].us_passwd) {
-    vec_free (chap_client[unit].us_passwd);
-  }
-  chap_client[unit].us_passwd = (char *) vec_dup(password);
-  chap_client[unit].us_passwdlen = strlen (chap_client[unit].us_passwd);
+  pppox_set_credentials (t->ppp, username, password);
 
   // after auth configured, notify pppoe to open session to start.
   static void (*pppoe_client_open_session_func) (u32 client_index) = 0;
@@ -493,6 +890,260 @@ pppox_set_auth (u32 sw_if_index, u8 * username, u8 * password)
   return 0;
 }
 
+int
+pppox_set_lcp_echo (u32 sw_if_index, u32 interval_ms, u32 max_interval_ms,
+                    u32 failures)
+{
+  pppox_main_t * pom = &pppox_main;
+  u32 unit;
+
+  if (sw_if_index >= vec_len (pom->virtual_interface_index_by_sw_if_index))
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  if (unit == ~0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  // pppd timers run in 10ms ticks.
+  if ((interval_ms && interval_ms < 10) || interval_ms > 3600 * 1000 ||
+      max_interval_ms > 3600 * 1000)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  lcp_echo_config (unit, interval_ms, max_interval_ms, failures);
+
+  return 0;
+}
+
+/*
+ * VRF of a pppox interface and the default route IPCP installs through
+ * it there, taken into account the next time IPCP comes up.
+ */
+int
+pppox_set_vrf (u32 sw_if_index, u32 table_id, u8 default_route,
+               u8 distance)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  u32 unit;
+
+  if (sw_if_index >= vec_len (pom->virtual_interface_index_by_sw_if_index))
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  if (unit == ~0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  if (~0 == fib_table_find (FIB_PROTOCOL_IP4, table_id))
+    return VNET_API_ERROR_NO_SUCH_FIB;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  t->table_id = table_id;
+  t->default_route = default_route;
+  t->default_route_distance = distance;
+  t->ppp->ipcp_wantoptions.default_route = default_route;
+
+  return 0;
+}
+
+/* addresses IPCP assigned, in network order, and the LCP mtu */
+int
+pppox_get_session_info (u32 sw_if_index, u32 * our_addr, u32 * his_addr,
+                        u16 * mtu)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  u32 unit;
+
+  if (sw_if_index >= vec_len (pom->virtual_interface_index_by_sw_if_index))
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  if (unit == ~0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  *our_addr = t->our_addr;
+  *his_addr = t->his_addr;
+  *mtu = t->mtu;
+
+  return 0;
+}
+
+/*
+ * A session survives a restart when its LCP and IPCP are both up, bundle
+ * members are left to negotiate again as the bundle is not saved.
+ */
+int
+pppox_session_restorable (u32 sw_if_index)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  u32 unit;
+
+  if (sw_if_index >= vec_len (pom->virtual_interface_index_by_sw_if_index))
+    return 0;
+  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  if (unit == ~0)
+    return 0;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  return (t->ppp->lcp_fsm.state == OPENED && t->ppp->ipcp_is_up &&
+          !t->ppp->multilink && t->bundle_index == ~0);
+}
+
+void
+pppox_serialize_session (serialize_main_t * m, u32 sw_if_index, int is_up)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  ppp_unit_t *ppp;
+  u32 unit;
+
+  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  ppp = t->ppp;
+
+  serialize_cstring (m, ppp->upap.us_user);
+  serialize_cstring (m, ppp->upap.us_passwd);
+  serialize_integer (m, ppp->lcp_echo_interval, sizeof (u32));
+  serialize_integer (m, ppp->lcp_echo_max_interval, sizeof (u32));
+  serialize_integer (m, ppp->lcp_echo_fails, sizeof (u32));
+  serialize_integer (m, t->table_id, sizeof (u32));
+  serialize_integer (m, t->default_route, sizeof (u8));
+  serialize_integer (m, t->default_route_distance, sizeof (u8));
+
+  if (is_up)
+    {
+      lcp_options *lgo = &ppp->lcp_gotoptions;
+      lcp_options *lho = &ppp->lcp_hisoptions;
+      ipcp_options *igo = &ppp->ipcp_gotoptions;
+      ipcp_options *iho = &ppp->ipcp_hisoptions;
+
+      serialize_integer (m, lgo->neg_magicnumber ? lgo->magicnumber : 0,
+                         sizeof (u32));
+      serialize_integer (m, lho->neg_magicnumber ? lho->magicnumber : 0,
+                         sizeof (u32));
+      serialize_integer (m, lgo->neg_mru ? lgo->mru : 0, sizeof (u16));
+      serialize_integer (m, lho->neg_mru ? lho->mru : 0, sizeof (u16));
+      serialize_integer (m, igo->ouraddr, sizeof (u32));
+      serialize_integer (m, iho->hisaddr, sizeof (u32));
+      serialize_integer (m, igo->dnsaddr[0], sizeof (u32));
+      serialize_integer (m, igo->dnsaddr[1], sizeof (u32));
+    }
+}
+
+void *
+pppox_unserialize_session (serialize_main_t * m, int is_up)
+{
+  pppox_saved_session_t _s, *s = &_s;
+
+  memset (s, 0, sizeof (*s));
+
+  unserialize_cstring (m, (char **) &s->username);
+  unserialize_cstring (m, (char **) &s->password);
+  unserialize_integer (m, &s->echo_interval, sizeof (u32));
+  unserialize_integer (m, &s->echo_max_interval, sizeof (u32));
+  unserialize_integer (m, &s->echo_fails, sizeof (u32));
+  unserialize_integer (m, &s->table_id, sizeof (u32));
+  unserialize_integer (m, &s->default_route, sizeof (u8));
+  unserialize_integer (m, &s->default_route_distance, sizeof (u8));
+
+  if (is_up)
+    {
+      unserialize_integer (m, &s->our_magic, sizeof (u32));
+      unserialize_integer (m, &s->his_magic, sizeof (u32));
+      unserialize_integer (m, &s->our_mru, sizeof (u16));
+      unserialize_integer (m, &s->his_mru, sizeof (u16));
+      unserialize_integer (m, &s->our_addr, sizeof (u32));
+      unserialize_integer (m, &s->his_addr, sizeof (u32));
+      unserialize_integer (m, &s->dns_addr[0], sizeof (u32));
+      unserialize_integer (m, &s->dns_addr[1], sizeof (u32));
+    }
+
+  // an empty password reads back as no vector at all.
+  if (s->username && s->password == 0)
+    vec_add1 (s->password, 0);
+
+  // complete now, hand it over.
+  s = clib_mem_alloc (sizeof (*s));
+  clib_memcpy (s, &_s, sizeof (*s));
+
+  return s;
+}
+
+/*
+ * Apply a session read back by pppox_unserialize_session and free it, a
+ * sw_if_index of ~0 only frees it. An up session comes back opened on
+ * its old pppoe session, LCP echoes then check the AC kept it; others
+ * start discovery again.
+ */
+void
+pppox_restore_session (u32 sw_if_index, u16 mru, int is_up, void *saved)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_saved_session_t *s = saved;
+  pppox_virtual_interface_t *t;
+  ppp_unit_t *ppp;
+  u32 unit;
+
+  if (sw_if_index == ~0)
+    goto done;
+
+  unit = pom->virtual_interface_index_by_sw_if_index[sw_if_index];
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  ppp = t->ppp;
+
+  lcp_echo_config (unit, s->echo_interval, s->echo_max_interval,
+                   s->echo_fails);
+  t->table_id = s->table_id;
+  t->default_route = s->default_route;
+  t->default_route_distance = s->default_route_distance;
+
+  if (!is_up)
+    {
+      if (s->username)
+        pppox_set_auth (sw_if_index, s->username, s->password);
+      goto done;
+    }
+
+  if (s->username)
+    pppox_set_credentials (ppp, s->username, s->password);
+
+  t->pppoe_session_allocated = 1;
+  pppox_lower_reset (t, unit, mru);
+
+  ppp->lcp_gotoptions.neg_magicnumber = s->our_magic != 0;
+  ppp->lcp_gotoptions.magicnumber = s->our_magic;
+  ppp->lcp_hisoptions.neg_magicnumber = s->his_magic != 0;
+  ppp->lcp_hisoptions.magicnumber = s->his_magic;
+  ppp->lcp_gotoptions.neg_mru = s->our_mru != 0;
+  ppp->lcp_gotoptions.mru = s->our_mru;
+  ppp->lcp_hisoptions.neg_mru = s->his_mru != 0;
+  ppp->lcp_hisoptions.mru = s->his_mru;
+
+  ppp->ipcp_gotoptions.neg_addr = 1;
+  ppp->ipcp_gotoptions.ouraddr = s->our_addr;
+  ppp->ipcp_gotoptions.req_dns1 = s->dns_addr[0] != 0;
+  ppp->ipcp_gotoptions.dnsaddr[0] = s->dns_addr[0];
+  ppp->ipcp_gotoptions.req_dns2 = s->dns_addr[1] != 0;
+  ppp->ipcp_gotoptions.dnsaddr[1] = s->dns_addr[1];
+  ppp->ipcp_hisoptions.neg_addr = 1;
+  ppp->ipcp_hisoptions.hisaddr = s->his_addr;
+
+  lcp_restore (unit);
+  pppox_flush_output ();
+
+done:
+  vec_free (s->username);
+  vec_free (s->password);
+  clib_mem_free (s);
+}
+
+ppp_unit_t *
+ppp_unit (int unit)
+{
+  pppox_main_t *pom = &pppox_main;
+
+  return pool_elt_at_index (pom->virtual_interfaces, unit)->ppp;
+}
+
 clib_error_t *
 pppox_init (vlib_main_t * vm)
 {
@@ -501,6 +1152,16 @@ pppox_init (vlib_main_t * vm)
   pom->vnet_main = vnet_get_main ();
   pom->vlib_main = vm;
 
+  pppd_timer_init (vlib_time_now (vm));
+
+  vec_validate (pom->per_thread, vlib_get_thread_main ()->n_vlib_mains - 1);
+
+  // frame queues must exist before workers start to poll them.
+  pom->mp_frame_queue_index = ~0;
+  if (vlib_get_thread_main ()->n_vlib_mains > 1)
+    pom->mp_frame_queue_index =
+      vlib_frame_queue_main_init (pppox_mp_input_node.index, 0);
+
   return 0;
 }
 
@@ -515,6 +1176,84 @@ VLIB_PLUGIN_REGISTER () = {
 
 // pppd-->vpp interaction.
 
+/*
+ * Packets built by the main thread, pppd output here and pppoe client
+ * discovery, go out in one frame per output node. Buffers are allocated
+ * PPPOX_TX_BUFFER_BATCH at a time, a frame is sent when full or by
+ * pppox_flush_output at the end of the current batch.
+ */
+u32
+pppox_tx_buffer_get (void)
+{
+  pppox_main_t * pom = &pppox_main;
+  u32 n_buffers = vec_len (pom->tx_buffers);
+  u32 bi;
+
+  if (PREDICT_FALSE (n_buffers == 0))
+    {
+      vec_validate (pom->tx_buffers, PPPOX_TX_BUFFER_BATCH - 1);
+      n_buffers = vlib_buffer_alloc (pom->vlib_main, pom->tx_buffers,
+                                     PPPOX_TX_BUFFER_BATCH);
+      _vec_len (pom->tx_buffers) = n_buffers;
+      if (n_buffers == 0)
+        return ~0;
+    }
+
+  bi = pom->tx_buffers[n_buffers - 1];
+  _vec_len (pom->tx_buffers) = n_buffers - 1;
+  pppox_buffer_init (vlib_get_buffer (pom->vlib_main, bi));
+
+  return bi;
+}
+
+void
+pppox_tx_enqueue (u32 node_index, u32 bi)
+{
+  pppox_main_t * pom = &pppox_main;
+  vlib_main_t * vm = pom->vlib_main;
+  pppox_tx_frame_t * tf;
+  u32 * to_next;
+
+  vec_foreach (tf, pom->tx_frames)
+    if (tf->node_index == node_index)
+      break;
+
+  if (tf == vec_end (pom->tx_frames))
+    {
+      vec_add2 (pom->tx_frames, tf, 1);
+      tf->node_index = node_index;
+      tf->frame = 0;
+    }
+
+  if (tf->frame == 0)
+    tf->frame = vlib_get_frame_to_node (vm, node_index);
+
+  to_next = vlib_frame_vector_args (tf->frame);
+  to_next[tf->frame->n_vectors++] = bi;
+
+  if (tf->frame->n_vectors == VLIB_FRAME_SIZE)
+    {
+      vlib_put_frame_to_node (vm, node_index, tf->frame);
+      tf->frame = 0;
+    }
+}
+
+void
+pppox_flush_output (void)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_tx_frame_t * tf;
+
+  vec_foreach (tf, pom->tx_frames)
+    {
+      if (tf->frame)
+        {
+          vlib_put_frame_to_node (pom->vlib_main, tf->node_index, tf->frame);
+          tf->frame = 0;
+        }
+    }
+}
+
 /********************************************************************
  *
  * output - Output PPP packet through pppox virtual interface node.
@@ -526,8 +1265,6 @@ void output (int unit, u8 *p, int len)
   vnet_main_t * vnm = pom->vnet_main;
   vlib_buffer_t * b;
   u32 bi;
-  u32 * to_next;
-  vlib_frame_t * f;
   pppox_virtual_interface_t *t = 0;
   vnet_hw_interface_t *hw;
 
@@ -537,8 +1274,9 @@ void output (int unit, u8 *p, int len)
     return;
   }
   hw = vnet_get_hw_interface (vnm, t->hw_if_index);
-  // TODO: should we should use packet template to prevent allocate buffer????
-  if (vlib_buffer_alloc (vm, &bi, 1) != 1) {
+
+  bi = pppox_tx_buffer_get ();
+  if (bi == ~0) {
     clib_warning ("buffer allocation failure");
     return;
   }
@@ -546,7 +1284,6 @@ void output (int unit, u8 *p, int len)
 
   ASSERT (b->current_data == 0);
 
-  f = vlib_get_frame_to_node (vm, hw->output_node_index);
   // XXX: if later we suppport other X of PPPoX, we should check
   // remove ppp framing address and control field for PPPoE encap.
   p += 2;
@@ -557,48 +1294,103 @@ void output (int unit, u8 *p, int len)
   // Set tx if index to pppox virtual if index.
   vnet_buffer(b)->sw_if_index[VLIB_TX] = t->sw_if_index;
 
-  /* Enqueue the packet right now */
-  to_next = vlib_frame_vector_args (f);
-  to_next[0] = bi;
-  f->n_vectors = 1;
-
-  vlib_put_frame_to_node (vm, hw->output_node_index, f);
+  pppox_tx_enqueue (hw->output_node_index, bi);
 }
 
-typedef struct
+/* Report a session event to pppoe client, which tells API subscribers */
+static void
+pppox_notify_client (pppox_virtual_interface_t * t, u32 event)
 {
-  int unit;
-  int is_add;
-  u32 our_adr;
-  u32 his_adr;
-  u32 net_mask;
-} ifaddr_arg_t;
+  static void (*pppoe_client_notify_func) (u32, u32) = 0;
+  if (pppoe_client_notify_func == 0) {
+    pppoe_client_notify_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_notify");
+  }
+  (*pppoe_client_notify_func) (t->pppoe_client_index, event);
+}
 
-static void *
-ifaddr_callback (void *arg)
+static void
+pppox_ifaddr_apply_one (pppox_main_t * pom, pppox_ifaddr_op_t * op)
 {
-  pppox_main_t * pom = &pppox_main;
   pppox_virtual_interface_t * t;
-  ifaddr_arg_t *a = arg;
 
-  t = pool_elt_at_index (pom->virtual_interfaces, a->unit);
+  t = pool_elt_at_index (pom->virtual_interfaces, op->unit);
 
-  if (a->is_add)
+  if (op->is_default_route)
+    pppox_handle_default_route (t, op->is_add);
+  else if (op->is_add)
     {
-      t->our_addr = a->our_adr;
-      t->his_addr = a->his_adr;
+      t->our_addr = op->our_adr;
+      t->his_addr = op->his_adr;
       pppox_handle_allocated_address (t, 1);
+      pppox_notify_client (t, PPPOX_SESSION_EVENT_IP_UP);
     }
   else
     {
       pppox_handle_allocated_address (t, 0);
       t->our_addr = t->his_addr = 0;
+      pppox_notify_client (t, PPPOX_SESSION_EVENT_IP_DOWN);
     }
+}
 
-  return 0;
+/*
+ * Apply up to max queued address changes under one worker barrier,
+ * returns how many are left for the next batch.
+ */
+static u32
+pppox_ifaddr_apply (vlib_main_t * vm, u32 max)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_ifaddr_batch_t * ib = &pom->ifaddr;
+  u32 i, n = clib_min (vec_len (ib->pending), max);
+  f64 t0, hold;
+
+  if (n == 0)
+    return 0;
+
+  vlib_worker_thread_barrier_sync (vm);
+  t0 = vlib_time_now (vm);
+
+  for (i = 0; i < n; i++)
+    pppox_ifaddr_apply_one (pom, ib->pending + i);
+
+  hold = vlib_time_now (vm) - t0;
+  vlib_worker_thread_barrier_release (vm);
+
+  vec_delete (ib->pending, n, 0);
+
+  ib->batches++;
+  ib->ops += n;
+  ib->hold_total += hold;
+  ib->hold_max = clib_max (ib->hold_max, hold);
+  ib->batch_histogram[clib_min (min_log2 (n),
+                                PPPOX_IFADDR_N_BUCKETS - 1)]++;
+
+  return vec_len (ib->pending);
 }
 
-void vl_api_rpc_call_main_thread (void *fp, u8 * data, u32 data_length);
+/*
+ * Queue an address change of a unit, pppox process applies it in order
+ * with the others of its next pass. Sessions coming up together after
+ * an outage then stall workers once per batch, not once each.
+ */
+static void
+pppox_ifaddr_queue (int unit, u8 is_add, u8 is_default_route,
+                    u32 our_adr, u32 his_adr)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_ifaddr_op_t * op;
+
+  if (vec_len (pom->ifaddr.pending) == 0)
+    vlib_process_signal_event (pom->vlib_main, pppox_process_node.index,
+                               PPPOX_EVENT_IFADDR, 0);
+
+  vec_add2 (pom->ifaddr.pending, op, 1);
+  op->unit = unit;
+  op->is_add = is_add;
+  op->is_default_route = is_default_route;
+  op->our_adr = our_adr;
+  op->his_adr = his_adr;
+}
 
 /********************************************************************
  *
@@ -607,24 +1399,10 @@ void vl_api_rpc_call_main_thread (void *fp, u8 * data, u32 data_length);
 int sifaddr (int unit, u32 our_adr, u32 his_adr,
              u32 net_mask)
 {
-  ifaddr_arg_t a;
-
-  memset (&a, 0, sizeof (a));
-  a.unit = unit;
   // NB: oss-pppd pass network endian u32 here, and vpp fib
   // parameter require u32 too, so not conversion here.
-  a.our_adr = our_adr;
-  a.his_adr = his_adr;
   // oss-pppd passed net_mask is not used, always treat as host address.
-  net_mask = net_mask;
-  a.net_mask = 32;
-  a.is_add = 1;
-
-  // Add route in main thread, otherwise it will crash when
-  // fib code do barrier check because we will then waiting for
-  // our barrier finished...
-  vl_api_rpc_call_main_thread (ifaddr_callback,
-                               (u8 *) & a, sizeof (a));
+  pppox_ifaddr_queue (unit, 1, 0, our_adr, his_adr);
 
   return 1;
 }
@@ -637,24 +1415,227 @@ int sifaddr (int unit, u32 our_adr, u32 his_adr,
 
 int cifaddr (int unit, u32 our_adr, u32 his_adr)
 {
-  ifaddr_arg_t a;
-
-  memset (&a, 0, sizeof (a));
-  a.unit = unit;
-  // NB: oss-pppd pass network endian u32 here, and vpp fib
-  // parameter require u32 too, so not conversion here.
   // NB: just record them here, we will use the address
   // we recorded on virtual interface to delete.
-  a.our_adr = our_adr;
-  a.his_adr = his_adr;
-  a.net_mask = 32;
-  a.is_add = 0;
-
-  // Add route in main thread, otherwise it will crash when
-  // fib code do barrier check because we will then waiting for
-  // our barrier finished...
-  vl_api_rpc_call_main_thread (ifaddr_callback,
-                               (u8 *) & a, sizeof (a));
+  pppox_ifaddr_queue (unit, 0, 0, our_adr, his_adr);
+
+  return 1;
+}
+
+/********************************************************************
+ *
+ * sifdefaultroute - assign a default route through the interface, in
+ * the VRF of the session. Queued behind the addresses like them.
+ */
+int sifdefaultroute (int unit, u32 ouraddr, u32 gateway)
+{
+  pppox_ifaddr_queue (unit, 1, 1, ouraddr, gateway);
+
+  return 1;
+}
+
+/********************************************************************
+ *
+ * cifdefaultroute - delete the default route through the interface.
+ */
+int cifdefaultroute (int unit, u32 ouraddr, u32 gateway)
+{
+  pppox_ifaddr_queue (unit, 0, 1, ouraddr, gateway);
+
+  return 1;
+}
+
+/********************************************************************
+ *
+ * netif_set_mtu - Set PPP interface MTU, TCP MSS of the interface
+ * is clamped to fit it and adjacencies of the interface follow it.
+ */
+void netif_set_mtu (int unit, int mtu)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+  vnet_hw_interface_t *hi;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  hi = vnet_get_hw_interface (pom->vnet_main, t->hw_if_index);
+  if (t->mtu == mtu && hi->max_l3_packet_bytes[VLIB_TX] == mtu)
+    return;
+
+  t->mtu = mtu;
+  hi->max_l3_packet_bytes[VLIB_RX] = hi->max_l3_packet_bytes[VLIB_TX] = mtu;
+  pppox_update_adjacencies (t->sw_if_index);
+}
+
+/********************************************************************
+ *
+ * netif_get_mtu - Get PPP interface MTU.
+ */
+int netif_get_mtu (int unit)
+{
+  pppox_main_t * pom = &pppox_main;
+
+  return pool_elt_at_index (pom->virtual_interfaces, unit)->mtu;
+}
+
+/********************************************************************
+ *
+ * sifup - Config the interface up and enable IP packets to pass,
+ * a bundle member starts to carry flows of the bundle.
+ */
+int sifup (int unit)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  if (t->bundle_index != ~0 && !t->ppp->multilink)
+    pppox_bundle_member_up_down (t->sw_if_index, 1);
+
+  return 1;
+}
+
+/********************************************************************
+ *
+ * sifdown - Disable the indicated protocol and config the interface
+ * down, IPCP goes down with LCP so flows of a bundle member move to
+ * the other members.
+ */
+int sifdown (int unit)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  if (t->bundle_index != ~0 && !t->ppp->multilink)
+    pppox_bundle_member_up_down (t->sw_if_index, 0);
+
+  return 1;
+}
+
+/********************************************************************
+ *
+ * sifmpjoin - The link negotiated multilink and is authenticated,
+ * it starts to carry fragments of its bundle. Returns 1 if another
+ * link of the bundle is there already, NCPs are not run again then.
+ */
+int sifmpjoin (int unit)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  return pppox_bundle_mp_join (t->sw_if_index);
+}
+
+/********************************************************************
+ *
+ * sifmpleave - LCP of a multilink link went down, fragments of the
+ * bundle go over the other links.
+ */
+void sifmpleave (int unit)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  pppox_bundle_mp_leave (t->sw_if_index);
+}
+
+/********************************************************************
+ *
+ * sifechoreply - Let pppoe client answer LCP Echo-Requests of the
+ * peer with our magic number, or stop to.
+ */
+void sifechoreply (int unit, u_int32_t magic, int on)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+
+  static void (*pppoe_client_set_lcp_echo_func) (u32, u32, int) = 0;
+  if (pppoe_client_set_lcp_echo_func == 0) {
+    pppoe_client_set_lcp_echo_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_set_lcp_echo");
+  }
+  (*pppoe_client_set_lcp_echo_func) (t->pppoe_client_index, magic, on);
+}
+
+/********************************************************************
+ *
+ * siflcpupdown - LCP of the interface opened or left opened.
+ */
+void siflcpupdown (int unit, int up)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+  pppox_notify_client (t, up ? PPPOX_SESSION_EVENT_LCP_UP :
+                       PPPOX_SESSION_EVENT_LCP_DOWN);
+}
+
+/********************************************************************
+ *
+ * get_echo_replied - Number of Echo-Requests pppoe client answered
+ * for the interface so far.
+ */
+u_int32_t get_echo_replied (int unit)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+
+  static u32 (*pppoe_client_lcp_echo_replied_func) (u32) = 0;
+  if (pppoe_client_lcp_echo_replied_func == 0) {
+    pppoe_client_lcp_echo_replied_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_lcp_echo_replied");
+  }
+  return (*pppoe_client_lcp_echo_replied_func) (t->pppoe_client_index);
+}
+
+/********************************************************************
+ *
+ * get_rx_packets - Number of data packets pppoe client received for
+ * the interface so far.
+ */
+u_int32_t get_rx_packets (int unit)
+{
+  pppox_main_t * pom = &pppox_main;
+  pppox_virtual_interface_t *t;
+
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+
+  static u32 (*pppoe_client_rx_packets_func) (u32) = 0;
+  if (pppoe_client_rx_packets_func == 0) {
+    pppoe_client_rx_packets_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_rx_packets");
+  }
+  return (*pppoe_client_rx_packets_func) (t->pppoe_client_index);
+}
+
+/********************************************************************
+ *
+ * get_ppp_stats - Packets and bytes the data plane counted on the
+ * interface so far, summed over all threads.
+ */
+int get_ppp_stats (int unit, struct pppd_stats *stats)
+{
+  pppox_main_t * pom = &pppox_main;
+  vnet_interface_main_t * im = &pom->vnet_main->interface_main;
+  pppox_virtual_interface_t *t;
+  vlib_counter_t rx, tx;
+
+  if (pool_is_free_index (pom->virtual_interfaces, unit))
+    return 0;
+  t = pool_elt_at_index (pom->virtual_interfaces, unit);
+
+  vlib_get_combined_counter (im->combined_sw_if_counters +
+                             VNET_INTERFACE_COUNTER_RX, t->sw_if_index, &rx);
+  vlib_get_combined_counter (im->combined_sw_if_counters +
+                             VNET_INTERFACE_COUNTER_TX, t->sw_if_index, &tx);
+  stats->pkts_in = rx.packets;
+  stats->bytes_in = rx.bytes;
+  stats->pkts_out = tx.packets;
+  stats->bytes_out = tx.bytes;
 
   return 1;
 }
@@ -678,13 +1659,16 @@ cleanup_callback (void *arg)
     pppoe_client_close_session_func = vlib_get_plugin_symbol("pppoeclient_plugin.so", "pppoe_client_close_session");
   }
   (*pppoe_client_close_session_func) (t->pppoe_client_index);  
+
+  // Try to reconnect after a while.
+  TIMEOUT (pppox_restart_dead_client, t->ppp, 1);
   
   return 0;
 }
 
 int channel_cleanup (int unit)
 {
-  ifaddr_arg_t a;
+  cleanup_arg_t a;
 
   memset (&a, 0, sizeof (a));
   a.unit = unit;
@@ -19,6 +19,8 @@
 #include <vnet/fib/fib_table.h>
 #include <vlib/vlib.h>
 #include <vppinfra/bihash_8_8.h>
+#include <vppinfra/serialize.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 
 typedef enum
 {
@@ -28,6 +30,16 @@ typedef enum
   PPPOX_N_ERROR,
 } pppox_error_t;
 
+/* multilink long sequence number header, RFC 1990 */
+#define PPPOX_MP_HDR_LEN	4
+#define PPPOX_MP_FLAG_B		0x80
+#define PPPOX_MP_FLAG_E		0x40
+#define PPPOX_MP_SEQ_MASK	0xffffff
+#define PPPOX_MP_FRAGMENT_MIN	256
+
+/* reorder window of multilink reassembly, a power of 2 */
+#define PPPOX_MP_WINDOW		64
+
 #define foreach_pppox_input_next       \
 _(DROP, "error-drop")
 
@@ -51,6 +63,32 @@ typedef enum
     PPPOX_OUTPUT_N_NEXT,
 } pppox_output_next_t;
 
+#define foreach_pppox_bundle_output_next       \
+_(DROP, "error-drop")
+
+typedef enum
+{
+#define _(s,n) PPPOX_BUNDLE_OUTPUT_NEXT_##s,
+  foreach_pppox_bundle_output_next
+#undef _
+    PPPOX_BUNDLE_OUTPUT_N_NEXT,
+} pppox_bundle_output_next_t;
+
+#define foreach_pppox_mp_input_next       \
+_(DROP, "error-drop")                     \
+_(IP4_INPUT, "ip4-input")                 \
+_(IP6_INPUT, "ip6-input")                 \
+_(PPPOX_INPUT, "pppox-input")             \
+_(CONTROL_HANDOFF, "pppoeclient-control-handoff")
+
+typedef enum
+{
+#define _(s,n) PPPOX_MP_INPUT_NEXT_##s,
+  foreach_pppox_mp_input_next
+#undef _
+    PPPOX_MP_INPUT_N_NEXT,
+} pppox_mp_input_next_t;
+
 typedef struct
 {
   /* vnet intfc index */
@@ -67,8 +105,166 @@ typedef struct
   /* record allocated address. */
   u32 our_addr;
   u32 his_addr;
+
+  /* link mtu LCP settled on, tcp mss is clamped to fit it */
+  u16 mtu;
+
+  /* ip4 table the session lands in when IPCP comes up, and whether a
+     default route goes through it there, see pppox_set_vrf */
+  u32 table_id;
+  u8 default_route;
+  u8 default_route_distance;
+  /* fib holding our default route, ~0 if none is installed */
+  u32 default_route_fib_index;
+  /* fib of the VRF the interface is bound to, ~0 while in table 0 */
+  u32 fib_index;
+
+  /* pppd state of this interface, unit is the pool index */
+  struct ppp_unit *ppp;
+
+  /* bundle this interface is a member of, ~0 if none */
+  u32 bundle_index;
+  u32 bundle_member_index;
 } pppox_virtual_interface_t;
 
+/*
+ * A member of a bundle. While it is up the pppoe encap of its session
+ * is kept here, so the bundle output node forwards without going
+ * through the member.
+ */
+typedef struct
+{
+  /* member pppox interface */
+  u32 sw_if_index;
+  u32 weight;
+
+  /* set from IPCP up to LCP down of the member, from multilink join
+     to LCP down in a multilink bundle */
+  u8 is_up;
+
+  /* multilink negotiated and joined, main thread view of is_up */
+  u8 mp_joined;
+
+  /* encap of the pppoe session, valid while up */
+  u32 encap_sw_if_index;
+  u32 encap_next_index;
+  u8 *rewrite;
+  u16 mtu;
+} pppox_bundle_member_t;
+
+typedef struct
+{
+  /* vnet intfc index */
+  u32 sw_if_index;
+  u32 hw_if_index;
+
+  /* pool of members */
+  pppox_bundle_member_t *members;
+
+  /*
+   * PPPOX_BUNDLE_N_BUCKETS member indices, each up member owns a share
+   * of buckets following its weight. A flow hashes to a bucket, empty
+   * when no member is up.
+   */
+  u32 *buckets;
+
+  /* smallest mtu of the up members, or the mrru with multilink, tcp
+     mss is clamped to fit it */
+  u16 mtu;
+  u32 n_up;
+
+  /*
+   * Multilink (RFC 1990) when mrru is set: members negotiate it, packets
+   * are sent in fragments over all of them and reassembled on receive.
+   * NCPs run on the member that joined first.
+   */
+  u16 mrru;
+  u16 fragment_min;
+  u16 fragment_max;
+  u32 endpoint_magic;
+  u32 ncp_sw_if_index;
+  u32 tx_seq;
+
+  /* thread reassembling the fragments, members received on other
+     threads hand them off to it */
+  u32 thread_index;
+} pppox_bundle_t;
+
+/*
+ * Multilink reassembly of one bundle on one thread. Fragments wait in
+ * a ring of PPPOX_MP_WINDOW slots indexed by sequence number, anything
+ * older than the window start is late, and the window start is pushed
+ * forward by newer fragments or once every member went past a hole.
+ */
+typedef struct
+{
+  u32 bi[PPPOX_MP_WINDOW];
+  u8 flags[PPPOX_MP_WINDOW];
+
+  /* sequence number expected at the window start */
+  u32 next_seq;
+  u8 is_synced;
+
+  /* latest sequence number received per member pool index, ~0 if none */
+  u32 *member_seq;
+
+  u64 reassembled;
+  u64 lost;
+  u64 late;
+} pppox_mp_reasm_t;
+
+typedef struct
+{
+  /* reassembly per bundle index */
+  pppox_mp_reasm_t **reasm;
+
+  /* buffers and next nodes of one frame, enqueued at its end */
+  u32 *to_bis;
+  u16 *to_nexts;
+
+  /* fragments of one frame to hand off, per bundle thread */
+  u32 **handoff_bis;
+} pppox_per_thread_t;
+
+/* address, peer or default route change of a unit asked by IPCP,
+   addresses in network order */
+typedef struct
+{
+  u32 unit;
+  u8 is_add;
+  /* the default route through the unit rather than its addresses */
+  u8 is_default_route;
+  u32 our_adr;
+  u32 his_adr;
+} pppox_ifaddr_op_t;
+
+/* batch sizes are counted in log2 buckets up to PPPOX_IFADDR_BATCH_MAX */
+#define PPPOX_IFADDR_N_BUCKETS	9
+
+/*
+ * sifaddr/cifaddr queue their changes, pppox process applies up to
+ * PPPOX_IFADDR_BATCH_MAX of them under one worker barrier instead of
+ * one barrier per session.
+ */
+typedef struct
+{
+  pppox_ifaddr_op_t *pending;
+
+  /* counters */
+  u64 batches;
+  u64 ops;
+  f64 hold_total;
+  f64 hold_max;
+  u32 batch_histogram[PPPOX_IFADDR_N_BUCKETS];
+} pppox_ifaddr_batch_t;
+
+/* Frame being filled for an output node, see pppox_tx_enqueue */
+typedef struct
+{
+  u32 node_index;
+  vlib_frame_t *frame;
+} pppox_tx_frame_t;
+
 typedef struct
 {
   /* vector of pppox interfaces. */
@@ -80,18 +276,106 @@ typedef struct
   /* Mapping from sw_if_index to session index */
   u32 *virtual_interface_index_by_sw_if_index;
 
+  /* vector of bundle interfaces. */
+  pppox_bundle_t *bundles;
+
+  /* Free vlib hw_if_indices of bundles */
+  u32 *free_bundle_hw_if_indices;
+
+  /* Mapping from sw_if_index to bundle index */
+  u32 *bundle_index_by_sw_if_index;
+
+  pppox_per_thread_t *per_thread;
+
+  /* multilink fragments to the bundle thread, ~0 if no workers */
+  u32 mp_frame_queue_index;
+
   /* API message ID base */
   u16 msg_id_base;
-  
+
+  /*
+   * pppd output of one process wakeup or input frame, and pppoe client
+   * discovery of one wakeup, goes out in one frame per output node,
+   * buffers are allocated PPPOX_TX_BUFFER_BATCH at a time.
+   */
+  u32 *tx_buffers;
+  pppox_tx_frame_t *tx_frames;
+
+  pppox_ifaddr_batch_t ifaddr;
+
   /* convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
 } pppox_main_t;
 
+/*
+ * pppd state of a session read back from a state file, kept apart until
+ * the whole file is read so a truncated one leaves nothing half applied.
+ */
+typedef struct
+{
+  u8 *username;
+  u8 *password;
+  u32 echo_interval;
+  u32 echo_max_interval;
+  u32 echo_fails;
+  u32 table_id;
+  u8 default_route;
+  u8 default_route_distance;
+
+  /* what LCP and IPCP of an up session settled on, 0 if not negotiated */
+  u32 our_magic;
+  u32 his_magic;
+  u16 our_mru;
+  u16 his_mru;
+  u32 our_addr;
+  u32 his_addr;
+  u32 dns_addr[2];
+} pppox_saved_session_t;
+
+#define PPPOX_EVENT_TIMER_UPDATE	1
+#define PPPOX_EVENT_IFADDR	2
+
+/* address changes applied under one barrier, and the pause before the
+   next batch so that workers forward in between */
+#define PPPOX_IFADDR_BATCH_MAX	256
+#define PPPOX_IFADDR_BATCH_PAUSE	100e-6
+
+/* session events passed to pppoe_client_notify, the bits are those of
+   PPPOE_CLIENT_EVENT_* in pppoeclient.h */
+#define PPPOX_SESSION_EVENT_LCP_UP	(1 << 2)
+#define PPPOX_SESSION_EVENT_LCP_DOWN	(1 << 3)
+#define PPPOX_SESSION_EVENT_IP_UP	(1 << 4)
+#define PPPOX_SESSION_EVENT_IP_DOWN	(1 << 5)
+
+#define PPPOX_TX_BUFFER_BATCH	32
+
+/* buckets of a bundle, a power of 2 */
+#define PPPOX_BUNDLE_N_BUCKETS	1024
+
+/* ethernet mtu less pppoe and ppp headers, RFC 2516, unless the AC
+   grants a larger PPP-Max-Payload, RFC 4638 */
+#define PPPOX_PPPOE_MAX_MRU	1492
+
 extern pppox_main_t pppox_main;
 
 extern vlib_node_registration_t pppox_input_node;
 extern vlib_node_registration_t pppox_output_node;
+extern vlib_node_registration_t pppox_bundle_output_node;
+extern vlib_node_registration_t pppox_mp_input_node;
+
+/*
+ * A freshly allocated buffer may still carry the chain flags and
+ * offsets of its previous use, only the free list index is kept.
+ */
+always_inline void
+pppox_buffer_init (vlib_buffer_t * b)
+{
+  b->flags &= VLIB_BUFFER_FREE_LIST_INDEX_MASK;
+  b->current_data = 0;
+  b->current_length = 0;
+  b->total_length_not_including_first_buffer = 0;
+}
 
 int consume_pppox_ctrl_pkt (u32, vlib_buffer_t *);
 
@@ -99,10 +383,55 @@ u32 pppox_allocate_interface(u32);
 
 void pppox_free_interface(u32);
 
-void pppox_lower_up(u32);
+void pppox_lower_up(u32, u16);
+
+void pppox_update_adjacencies (u32);
 
 int pppox_set_auth (u32, u8 *, u8 *);
 
+int pppox_set_lcp_echo (u32, u32, u32, u32);
+
+int pppox_get_session_info (u32, u32 *, u32 *, u16 *);
+
+int pppox_set_vrf (u32, u32, u8, u8);
+
+u32 pppox_tx_buffer_get (void);
+
+void pppox_tx_enqueue (u32, u32);
+
+void pppox_flush_output (void);
+
+u32 pppox_timer_start (tw_timer_wheel_1t_3w_1024sl_ov_t *, u32, f64);
+
+u32 *pppox_timer_expire (tw_timer_wheel_1t_3w_1024sl_ov_t *, f64, u32 *,
+                         f64 *);
+
+f64 pppox_timer_timeleft (tw_timer_wheel_1t_3w_1024sl_ov_t *, f64, f64 *);
+
+int pppox_session_restorable (u32);
+
+void pppox_serialize_session (serialize_main_t *, u32, int);
+
+void *pppox_unserialize_session (serialize_main_t *, int);
+
+void pppox_restore_session (u32, u16, int, void *);
+
+void pppox_mss_clamp_enable_disable (u32, int);
+
+int pppox_bundle_add_del (u32, u8, u32 *);
+
+int pppox_bundle_add_del_member (u32, u32, u32, u8);
+
+void pppox_bundle_member_up_down (u32, u8);
+
+int pppox_bundle_set_multilink (u32, u16, u16);
+
+int pppox_bundle_mp_join (u32);
+
+void pppox_bundle_mp_leave (u32);
+
+u8 *format_pppox_bundle (u8 *, va_list *);
+
 #endif /* _PPPOX_H */
 
 /*
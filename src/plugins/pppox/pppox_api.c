@@ -65,7 +65,12 @@ setup_message_id_table (pppox_main_t * pom, api_main_t * am)
 }
 
 #define foreach_pppox_plugin_api_msg                             \
-_(PPPOX_SET_AUTH, pppox_set_auth)
+_(PPPOX_SET_AUTH, pppox_set_auth)                               \
+_(PPPOX_SET_LCP_ECHO, pppox_set_lcp_echo)                       \
+_(PPPOX_SET_VRF, pppox_set_vrf)                                 \
+_(PPPOX_ADD_DEL_BUNDLE, pppox_add_del_bundle)                   \
+_(PPPOX_BUNDLE_ADD_DEL_MEMBER, pppox_bundle_add_del_member)     \
+_(PPPOX_BUNDLE_SET_MULTILINK, pppox_bundle_set_multilink)
 
 static void vl_api_pppox_set_auth_t_handler
   (vl_api_pppox_set_auth_t * mp)
@@ -88,6 +93,83 @@ static void vl_api_pppox_set_auth_t_handler
   REPLY_MACRO(VL_API_PPPOX_SET_AUTH_REPLY);
 }
 
+static void vl_api_pppox_set_lcp_echo_t_handler
+  (vl_api_pppox_set_lcp_echo_t * mp)
+{
+  vl_api_pppox_set_lcp_echo_reply_t *rmp;
+  int rv = 0;
+  pppox_main_t *pom = &pppox_main;
+
+  rv = pppox_set_lcp_echo (ntohl (mp->sw_if_index), ntohl (mp->interval_ms),
+                           ntohl (mp->max_interval_ms),
+                           ntohl (mp->failures));
+
+  REPLY_MACRO(VL_API_PPPOX_SET_LCP_ECHO_REPLY);
+}
+
+static void vl_api_pppox_set_vrf_t_handler
+  (vl_api_pppox_set_vrf_t * mp)
+{
+  vl_api_pppox_set_vrf_reply_t *rmp;
+  int rv = 0;
+  pppox_main_t *pom = &pppox_main;
+
+  rv = pppox_set_vrf (ntohl (mp->sw_if_index), ntohl (mp->vrf_id),
+                      mp->is_default_route != 0,
+                      mp->default_route_distance);
+
+  REPLY_MACRO(VL_API_PPPOX_SET_VRF_REPLY);
+}
+
+static void vl_api_pppox_add_del_bundle_t_handler
+  (vl_api_pppox_add_del_bundle_t * mp)
+{
+  vl_api_pppox_add_del_bundle_reply_t *rmp;
+  int rv = 0;
+  u32 sw_if_index = ~0;
+  pppox_main_t *pom = &pppox_main;
+
+  if (mp->is_add)
+    rv = pppox_bundle_add_del (~0, 1, &sw_if_index);
+  else
+    rv = pppox_bundle_add_del (ntohl (mp->sw_if_index), 0, 0);
+
+  /* *INDENT-OFF* */
+  REPLY_MACRO2(VL_API_PPPOX_ADD_DEL_BUNDLE_REPLY,
+  ({
+    rmp->sw_if_index = htonl (sw_if_index);
+  }));
+  /* *INDENT-ON* */
+}
+
+static void vl_api_pppox_bundle_add_del_member_t_handler
+  (vl_api_pppox_bundle_add_del_member_t * mp)
+{
+  vl_api_pppox_bundle_add_del_member_reply_t *rmp;
+  int rv = 0;
+  pppox_main_t *pom = &pppox_main;
+
+  rv = pppox_bundle_add_del_member (ntohl (mp->bundle_sw_if_index),
+                                    ntohl (mp->sw_if_index),
+                                    ntohl (mp->weight), mp->is_add);
+
+  REPLY_MACRO(VL_API_PPPOX_BUNDLE_ADD_DEL_MEMBER_REPLY);
+}
+
+static void vl_api_pppox_bundle_set_multilink_t_handler
+  (vl_api_pppox_bundle_set_multilink_t * mp)
+{
+  vl_api_pppox_bundle_set_multilink_reply_t *rmp;
+  int rv = 0;
+  pppox_main_t *pom = &pppox_main;
+
+  rv = pppox_bundle_set_multilink (ntohl (mp->sw_if_index),
+                                   ntohs (mp->mrru),
+                                   ntohs (mp->fragment_min));
+
+  REPLY_MACRO(VL_API_PPPOX_BUNDLE_SET_MULTILINK_REPLY);
+}
+
 static clib_error_t *
 pppox_api_hookup (vlib_main_t * vm)
 {
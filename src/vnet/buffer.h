@@ -295,6 +295,8 @@ typedef struct
     struct
     {
       u16 len;
+      /* session found by pppoe-dispatch, ~0 if none */
+      u32 session_index;
     } pppox;
 
     u32 unused[6];
@@ -0,0 +1,1330 @@
+#!/usr/bin/env python
+""" PPPoE client tests, against a scripted access concentrator on pg """
+
+import hashlib
+import os
+import re
+import socket
+import struct
+import time
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+from vpp_ip_route import VppIpRoute, VppIpTable, VppRoutePath, find_route
+from vpp_pg_interface import CaptureTimeoutError
+from vpp_pppoe_client import VppPppoeClient
+from vpp_pppoe_interface import VppPppoeInterface
+from vpp_sub_interface import VppDot1QSubint
+from util import mactobinary
+
+from scapy.packet import Raw
+from scapy.layers.l2 import Ether, Dot1Q
+from scapy.layers.ppp import PPPoE, PPPoED, PPP
+from scapy.layers.inet import IP, UDP, TCP
+
+PPPOE_PADI = 0x09
+PPPOE_PADO = 0x07
+PPPOE_PADR = 0x19
+PPPOE_PADS = 0x65
+PPPOE_PADT = 0xa7
+
+PPPOE_TAG_SERVICE_NAME = 0x0101
+PPPOE_TAG_AC_NAME = 0x0102
+PPPOE_TAG_HOST_UNIQ = 0x0103
+PPPOE_TAG_AC_COOKIE = 0x0104
+PPPOE_TAG_PPP_MAX_PAYLOAD = 0x0120
+
+PPP_IP = 0x0021
+PPP_IPCP = 0x8021
+PPP_LCP = 0xc021
+PPP_PAP = 0xc023
+PPP_CHAP = 0xc223
+PPP_MP = 0x003d
+
+MP_B = 0x80
+MP_E = 0x40
+
+CONF_REQ = 1
+CONF_ACK = 2
+CONF_NAK = 3
+CONF_REJ = 4
+TERM_REQ = 5
+TERM_ACK = 6
+PROTO_REJ = 8
+ECHO_REQ = 9
+ECHO_REP = 10
+
+LCP_OPT_MRU = 1
+LCP_OPT_AUTH = 3
+LCP_OPT_MAGIC = 5
+LCP_OPT_MRRU = 17
+LCP_OPT_EPDISC = 19
+IPCP_OPT_ADDR = 3
+
+EVENT_SESSION_UP = 1 << 0
+EVENT_PADT = 1 << 1
+EVENT_LCP_UP = 1 << 2
+EVENT_LCP_DOWN = 1 << 3
+EVENT_IP_UP = 1 << 4
+EVENT_IP_DOWN = 1 << 5
+
+
+def pack_tlvs(tlvs, fmt):
+    """ Pack (type, value) pairs, fmt packs type and total length """
+    hdr = struct.calcsize(fmt)
+    data = b""
+    for t, v in tlvs:
+        if fmt == "!HH":
+            data += struct.pack(fmt, t, len(v)) + v
+        else:
+            data += struct.pack(fmt, t, len(v) + hdr) + v
+    return data
+
+
+def unpack_tlvs(data, fmt):
+    """ Unpack what pack_tlvs packed, stops at a truncated tlv """
+    hdr = struct.calcsize(fmt)
+    tlvs = []
+    while len(data) >= hdr:
+        t, l = struct.unpack(fmt, data[:hdr])
+        if fmt == "!HH":
+            v, data = data[hdr:hdr + l], data[hdr + l:]
+        else:
+            if l < hdr:
+                break
+            v, data = data[hdr:l], data[l:]
+        tlvs.append((t, v))
+    return tlvs
+
+
+def pppoe_tags(data):
+    return unpack_tlvs(data, "!HH")
+
+
+def ppp_options(data):
+    return unpack_tlvs(data, "!BB")
+
+
+def ppp_control(code, ident, data=b""):
+    return struct.pack("!BBH", code, ident, len(data) + 4) + data
+
+
+class AcSession(object):
+    """ State of one session at the access concentrator """
+
+    def __init__(self, session_id, client_mac, host_uniq, client_ip):
+        self.session_id = session_id
+        self.client_mac = client_mac
+        self.host_uniq = host_uniq
+        self.client_ip = client_ip
+        self.magic = 0x5a5a0000 | session_id
+        self.client_magic = None
+        self.ident = 0
+        self.lcp_req_sent = False
+        self.lcp_acked_ours = False
+        self.lcp_acked_theirs = False
+        self.challenge = None
+        self.max_payload = None
+        self.endpoint = None
+        self.auth_done = False
+        self.ipcp_req_sent = False
+        self.ipcp_acked_ours = False
+        self.ipcp_acked_theirs = False
+        self.start = time.time()
+        self.up_time = None
+        self.echo_requests = 0
+
+    def next_ident(self):
+        self.ident = (self.ident + 1) & 0xff
+        return self.ident
+
+    @property
+    def lcp_open(self):
+        return self.lcp_acked_ours and self.lcp_acked_theirs
+
+    @property
+    def is_up(self):
+        return self.auth_done and \
+            self.ipcp_acked_ours and self.ipcp_acked_theirs
+
+
+class PppoeAc(object):
+    """
+    Scripted PPPoE access concentrator on a pg interface
+
+    Answers discovery, LCP, PAP or CHAP and IPCP sent by the clients on
+    the interface, handing out addresses from a /16 pool. With a vlan
+    only frames carrying that dot1q tag are answered, and tagged.
+    """
+
+    def __init__(self, test, intf, auth="pap", ac_ip="100.64.0.1",
+                 pool="100.64", username="vpp", password="vpp", mrru=None,
+                 max_payload=None, vlan=None):
+        self.test = test
+        self.intf = intf
+        self.vlan = vlan
+        self.auth = auth
+        self.ac_ip = ac_ip
+        self.pool = pool
+        self.username = username
+        self.password = password
+        self.mrru = mrru
+        self.max_payload = max_payload
+        self.sessions = {}
+        self.next_session_id = 1
+        self.padi_seen = 0
+
+    def session_by_host_uniq(self, host_uniq):
+        for s in self.sessions.values():
+            if s.host_uniq == host_uniq:
+                return s
+        return None
+
+    def ether(self, dst):
+        e = Ether(src=self.intf.remote_mac, dst=dst)
+        if self.vlan is not None:
+            e = e / Dot1Q(vlan=self.vlan)
+        return e
+
+    def discovery(self, code, session_id, dst, tags):
+        return (self.ether(dst) /
+                PPPoED(code=code, sessionid=session_id) /
+                Raw(pack_tlvs(tags, "!HH")))
+
+    def ppp(self, s, proto, payload):
+        return (self.ether(s.client_mac) /
+                PPPoE(sessionid=s.session_id) /
+                PPP(proto=proto) /
+                Raw(payload))
+
+    def lcp_request(self, s):
+        if self.auth == "chap":
+            auth = struct.pack("!HB", PPP_CHAP, 5)  # MD5
+        else:
+            auth = struct.pack("!H", PPP_PAP)
+        opts = [(LCP_OPT_AUTH, auth),
+                (LCP_OPT_MAGIC, struct.pack("!I", s.magic))]
+        if self.mrru:
+            # one endpoint for all sessions, class 1 is locally assigned
+            opts += [(LCP_OPT_MRRU, struct.pack("!H", self.mrru)),
+                     (LCP_OPT_EPDISC, struct.pack("!BI", 1, 0x5a5a5a5a))]
+        s.lcp_req_sent = True
+        return self.ppp(s, PPP_LCP, ppp_control(CONF_REQ, s.next_ident(),
+                                                pack_tlvs(opts, "!BB")))
+
+    def ipcp_request(self, s):
+        opts = [(IPCP_OPT_ADDR, socket.inet_aton(self.ac_ip))]
+        s.ipcp_req_sent = True
+        return self.ppp(s, PPP_IPCP, ppp_control(CONF_REQ, s.next_ident(),
+                                                 pack_tlvs(opts, "!BB")))
+
+    def chap_challenge(self, s):
+        s.challenge = os.urandom(16)
+        data = struct.pack("!B", len(s.challenge)) + s.challenge + b"ac"
+        return self.ppp(s, PPP_CHAP, ppp_control(1, s.next_ident(), data))
+
+    def mp_bundle_head(self, s):
+        """ Session of the multilink bundle s joins, None if s is first """
+        if not self.mrru or s.endpoint is None:
+            return None
+        for o in self.sessions.values():
+            if o is not s and o.auth_done and o.endpoint == s.endpoint:
+                return o
+        return None
+
+    def auth_up(self, s):
+        """ Authentication passed, the AC starts IPCP """
+        s.auth_done = True
+        # a link joining a multilink bundle runs no NCP of its own
+        if self.mp_bundle_head(s) is not None:
+            return []
+        return [self.ipcp_request(s)]
+
+    def lcp_opened(self, s):
+        if self.auth == "chap" and s.challenge is None:
+            return [self.chap_challenge(s)]
+        return []
+
+    def handle_discovery(self, p):
+        code = p[PPPoED].code
+        data = bytes(p[PPPoED].payload)[:p[PPPoED].len]
+        tags = pppoe_tags(data)
+        host_uniq = [v for t, v in tags if t == PPPOE_TAG_HOST_UNIQ]
+        host_uniq = host_uniq[0] if host_uniq else b""
+        reply_tags = [(PPPOE_TAG_SERVICE_NAME, b""),
+                      (PPPOE_TAG_AC_NAME, b"vpp-test-ac"),
+                      (PPPOE_TAG_HOST_UNIQ, host_uniq)]
+        # RFC 4638, echo PPP-Max-Payload capped to what the AC takes
+        asked = [struct.unpack("!H", v)[0] for t, v in tags
+                 if t == PPPOE_TAG_PPP_MAX_PAYLOAD and len(v) == 2]
+        granted = None
+        if asked and self.max_payload:
+            granted = min(asked[0], self.max_payload)
+            reply_tags.append((PPPOE_TAG_PPP_MAX_PAYLOAD,
+                               struct.pack("!H", granted)))
+
+        if code == PPPOE_PADI:
+            self.padi_seen += 1
+            reply_tags.append((PPPOE_TAG_AC_COOKIE, b"cookie"))
+            return [self.discovery(PPPOE_PADO, 0, p[Ether].src, reply_tags)]
+
+        if code == PPPOE_PADR:
+            # a retransmitted PADR gets the session it was given before
+            s = self.session_by_host_uniq(host_uniq)
+            if s is None or s.client_mac != p[Ether].src:
+                sid = self.next_session_id
+                self.next_session_id += 1
+                ip = "%s.%d.%d" % (self.pool, 1 + (sid >> 8), sid & 0xff)
+                s = AcSession(sid, p[Ether].src, host_uniq, ip)
+                self.sessions[sid] = s
+            s.max_payload = granted
+            return [self.discovery(PPPOE_PADS, s.session_id, p[Ether].src,
+                                   reply_tags)]
+
+        if code == PPPOE_PADT:
+            self.sessions.pop(p[PPPoED].sessionid, None)
+        return []
+
+    def handle_lcp(self, s, code, ident, data):
+        replies = []
+        if code == CONF_REQ:
+            for t, v in ppp_options(data):
+                if t == LCP_OPT_MAGIC:
+                    s.client_magic = struct.unpack("!I", v)[0]
+                if t == LCP_OPT_EPDISC:
+                    s.endpoint = v
+            if not s.lcp_req_sent:
+                replies.append(self.lcp_request(s))
+            replies.append(self.ppp(s, PPP_LCP,
+                                    ppp_control(CONF_ACK, ident, data)))
+            s.lcp_acked_theirs = True
+            if s.lcp_open:
+                replies += self.lcp_opened(s)
+        elif code == CONF_ACK:
+            s.lcp_acked_ours = True
+            if s.lcp_open:
+                replies += self.lcp_opened(s)
+        elif code in (CONF_NAK, CONF_REJ):
+            self.test.logger.error("client refused LCP options %s" %
+                                   ppp_options(data))
+        elif code == ECHO_REQ:
+            s.echo_requests += 1
+            replies.append(self.ppp(s, PPP_LCP, ppp_control(
+                ECHO_REP, ident, struct.pack("!I", s.magic) + data[4:])))
+        elif code == TERM_REQ:
+            replies.append(self.ppp(s, PPP_LCP, ppp_control(TERM_ACK, ident)))
+            self.sessions.pop(s.session_id, None)
+        return replies
+
+    def handle_pap(self, s, code, ident, data):
+        if code != 1:
+            return []
+        ulen = struct.unpack("!B", data[:1])[0]
+        user = data[1:1 + ulen]
+        plen = struct.unpack("!B", data[1 + ulen:2 + ulen])[0]
+        passwd = data[2 + ulen:2 + ulen + plen]
+        ok = user == self.username.encode() and \
+            passwd == self.password.encode()
+        replies = [self.ppp(s, PPP_PAP, ppp_control(
+            2 if ok else 3, ident, struct.pack("!B", 0)))]
+        if ok and not s.auth_done:
+            replies += self.auth_up(s)
+        return replies
+
+    def handle_chap(self, s, code, ident, data):
+        if code != 2 or s.challenge is None:
+            return []
+        vlen = struct.unpack("!B", data[:1])[0]
+        value = data[1:1 + vlen]
+        expected = hashlib.md5(struct.pack("!B", ident) +
+                               self.password.encode() +
+                               s.challenge).digest()
+        ok = value == expected
+        replies = [self.ppp(s, PPP_CHAP, ppp_control(
+            3 if ok else 4, ident, b"ok" if ok else b"bad"))]
+        if ok and not s.auth_done:
+            replies += self.auth_up(s)
+        return replies
+
+    def handle_ipcp(self, s, code, ident, data):
+        replies = []
+        if code == CONF_REQ:
+            opts = ppp_options(data)
+            rej = [(t, v) for t, v in opts if t != IPCP_OPT_ADDR]
+            want = socket.inet_aton(s.client_ip)
+            if rej:
+                replies.append(self.ppp(s, PPP_IPCP, ppp_control(
+                    CONF_REJ, ident, pack_tlvs(rej, "!BB"))))
+            elif [v for t, v in opts if v != want]:
+                replies.append(self.ppp(s, PPP_IPCP, ppp_control(
+                    CONF_NAK, ident,
+                    pack_tlvs([(IPCP_OPT_ADDR, want)], "!BB"))))
+            else:
+                replies.append(self.ppp(s, PPP_IPCP, ppp_control(
+                    CONF_ACK, ident, data)))
+                s.ipcp_acked_theirs = True
+        elif code == CONF_ACK:
+            s.ipcp_acked_ours = True
+        elif code == TERM_REQ:
+            replies.append(self.ppp(s, PPP_IPCP,
+                                    ppp_control(TERM_ACK, ident)))
+        if s.is_up and s.up_time is None:
+            s.up_time = time.time()
+        return replies
+
+    def handle_session(self, p):
+        s = self.sessions.get(p[PPPoE].sessionid)
+        if s is None or PPP not in p:
+            return []
+        raw = bytes(p[PPP])
+        proto = struct.unpack("!H", raw[:2])[0]
+        if proto in (PPP_IP, PPP_MP):
+            return []
+        code, ident, length = struct.unpack("!BBH", raw[2:6])
+        data = raw[6:2 + length]
+        if proto == PPP_LCP:
+            return self.handle_lcp(s, code, ident, data)
+        if proto == PPP_PAP:
+            return self.handle_pap(s, code, ident, data)
+        if proto == PPP_CHAP:
+            return self.handle_chap(s, code, ident, data)
+        if proto == PPP_IPCP:
+            return self.handle_ipcp(s, code, ident, data)
+        # CCP, IPV6CP and whatever else the client tries
+        return [self.ppp(s, PPP_LCP, ppp_control(
+            PROTO_REJ, s.next_ident(), raw[:2] + raw[2:2 + length]))]
+
+    def handle(self, p):
+        if self.vlan is not None and \
+           (Dot1Q not in p or p[Dot1Q].vlan != self.vlan):
+            return []
+        if PPPoED in p:
+            return self.handle_discovery(p)
+        if PPPoE in p:
+            return self.handle_session(p)
+        return []
+
+    def padt(self, s):
+        self.sessions.pop(s.session_id, None)
+        return self.discovery(PPPOE_PADT, s.session_id, s.client_mac, [])
+
+    def send(self, pkts):
+        self.intf.add_stream(pkts)
+        self.test.pg_start()
+
+    def run(self, done, timeout=30, poll=0.2):
+        """
+        Answer the clients until done() holds or timeout expires,
+        capture on the interface must be enabled before.
+
+        :returns: True if done() held
+        """
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            replies = []
+            try:
+                while True:
+                    p = self.intf.wait_for_packet(poll)
+                    replies += self.handle(p)
+            except CaptureTimeoutError:
+                pass
+            if replies:
+                self.send(replies)
+            if done():
+                return True
+        return done()
+
+
+class TestPPPoEClientBase(VppTestCase):
+    """ PPPoE client against a scripted AC on pg0 """
+
+    ac_auth = "pap"
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestPPPoEClientBase, cls).setUpClass()
+
+        cls.dst_ip = "198.51.100.1"
+
+    def setUp(self):
+        super(TestPPPoEClientBase, self).setUp()
+
+        # pg0 faces the AC, pg1 the subscriber side hosts
+        self.create_pg_interfaces(range(2))
+        for i in self.pg_interfaces:
+            i.admin_up()
+        self.pg1.config_ip4()
+        self.pg1.resolve_arp()
+
+        self.uplink = self.pg0
+        self.ac = PppoeAc(self, self.pg0, auth=self.ac_auth)
+        self.pg_enable_capture(self.pg_interfaces)
+
+    def tearDown(self):
+        super(TestPPPoEClientBase, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show pppoe client"))
+            self.logger.info(self.vapi.cli("show pppoe client discovery"))
+            self.logger.info(self.vapi.cli("show int"))
+            self.logger.info(self.vapi.cli("show ip fib"))
+            self.logger.info(self.vapi.cli("show trace"))
+        self.pg1.unconfig_ip4()
+        for i in self.pg_interfaces:
+            i.admin_down()
+
+    def create_client(self, host_uniq):
+        c = VppPppoeClient(self, self.uplink.sw_if_index, host_uniq,
+                           username=self.ac.username,
+                           password=self.ac.password)
+        c.add_vpp_config()
+        return c
+
+    def ac_session(self, client):
+        return self.ac.session_by_host_uniq(
+            struct.pack("=I", client.host_uniq))
+
+    def session_up(self, client):
+        s = self.ac_session(client)
+        return s is not None and s.is_up
+
+    def bring_up(self, clients, timeout=30, table_id=0):
+        for c in clients:
+            c.start()
+        self.assertTrue(self.ac.run(
+            lambda: all(self.session_up(c) for c in clients),
+            timeout=timeout))
+        for c in clients:
+            self.assertTrue(find_route(self, self.ac_session(c).client_ip,
+                                       32, table_id=table_id))
+
+    def add_route_via(self, client, prefix, plen):
+        r = VppIpRoute(self, prefix, plen,
+                       [VppRoutePath("0.0.0.0", client.pppox_sw_if_index)])
+        r.add_vpp_config()
+        return r
+
+    def pppox_counters(self, client):
+        """ rx/tx packets and bytes of the client's pppox interface """
+        name = [i.interface_name.split(b'\0', 1)[0].decode()
+                for i in self.vapi.sw_interface_dump()
+                if i.sw_if_index == client.pppox_sw_if_index][0]
+        out = self.vapi.cli("show interface %s" % name)
+        counters = {}
+        for k in ("rx packets", "rx bytes", "tx packets", "tx bytes"):
+            m = re.search(k + r"\s+(\d+)", out)
+            counters[k] = int(m.group(1)) if m else 0
+        return counters
+
+    def create_stream_encap(self, count, dst_ip, size=64):
+        return [(Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=dst_ip) /
+                 UDP(sport=1234, dport=1234) /
+                 Raw(b"\xa5" * size)) for i in range(count)]
+
+    def create_stream_decap(self, s, count, size=64):
+        return [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 PPPoE(sessionid=s.session_id) /
+                 PPP(proto=PPP_IP) /
+                 IP(src=self.dst_ip, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234, dport=1234) /
+                 Raw(b"\xa5" * size)) for i in range(count)]
+
+    def data_capture(self, intf, count):
+        """ Capture count data packets, answering control on the way """
+        rx = []
+        deadline = time.time() + 5
+        replies = []
+        while len(rx) < count and time.time() < deadline:
+            try:
+                p = intf.wait_for_packet(1)
+            except CaptureTimeoutError:
+                break
+            if intf == self.pg0 and \
+               (PPPoED in p or
+                (PPP in p and p[PPP].proto not in (PPP_IP, PPP_MP))):
+                replies += self.ac.handle(p)
+                continue
+            rx.append(p)
+        if replies:
+            self.ac.send(replies)
+        self.assertEqual(len(rx), count)
+        return rx
+
+
+class TestPPPoEClient(TestPPPoEClientBase):
+    """ PPPoE client with PAP """
+
+    def test_session(self):
+        """ PPPoE client session setup, encap and decap """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+        self.assertIn("SESSION", self.vapi.cli("show pppoe client"))
+
+        # subscriber to network
+        self.add_route_via(c, self.dst_ip, 32)
+        self.pg1.add_stream(self.create_stream_encap(17, self.dst_ip))
+        self.pg_start()
+        for p in self.data_capture(self.pg0, 17):
+            self.assertEqual(p[Ether].dst, self.pg0.remote_mac)
+            self.assertEqual(p[Ether].src, self.pg0.local_mac)
+            self.assertEqual(p[PPPoE].sessionid, s.session_id)
+            self.assertEqual(p[PPP].proto, PPP_IP)
+            self.assertEqual(p[IP].src, self.pg1.remote_ip4)
+            self.assertEqual(p[IP].dst, self.dst_ip)
+            self.assertEqual(p[IP].ttl, 63)
+
+        # network to subscriber
+        self.pg0.add_stream(self.create_stream_decap(s, 17))
+        self.pg_start()
+        for p in self.data_capture(self.pg1, 17):
+            self.assertEqual(p[Ether].dst, self.pg1.remote_mac)
+            self.assertEqual(p[IP].src, self.dst_ip)
+            self.assertEqual(p[IP].dst, self.pg1.remote_ip4)
+            self.assertEqual(p[IP].ttl, 63)
+
+        # data frames count on the pppox interface, tx has control too
+        counters = self.pppox_counters(c)
+        self.assertEqual(counters["rx packets"], 17)
+        self.assertEqual(counters["rx bytes"], 17 * len(p[IP]))
+        self.assertGreaterEqual(counters["tx packets"], 17)
+
+        # and in the client details, read from the same counters
+        d = self.vapi.pppoe_client_dump(self.pg0.sw_if_index)[0]
+        self.assertEqual(d.rx_packets, counters["rx packets"])
+        self.assertEqual(d.rx_bytes, counters["rx bytes"])
+        self.assertGreaterEqual(d.tx_packets, counters["tx packets"])
+
+    def test_vrf(self):
+        """ PPPoE client sessions in a VRF with default routes """
+        c = self.create_client(3)
+        with self.vapi.expect_negative_api_retval():
+            self.vapi.pppox_set_vrf(c.pppox_sw_if_index, 10)
+        c.remove_vpp_config()
+
+        VppIpTable(self, 10).add_vpp_config()
+        clients = [self.create_client(1), self.create_client(2)]
+        for c, distance in zip(clients, (5, 10)):
+            self.vapi.pppox_set_vrf(c.pppox_sw_if_index, 10,
+                                    is_default_route=1,
+                                    default_route_distance=distance)
+        self.bring_up(clients, table_id=10)
+
+        for c in clients:
+            s = self.ac_session(c)
+            self.assertFalse(find_route(self, s.client_ip, 32))
+            self.assertTrue(find_route(self, self.ac.ac_ip, 32,
+                                       table_id=10))
+
+        # one default route, the session with the lower distance wins
+        paths = []
+        for e in self.vapi.ip_fib_dump():
+            if e.table_id == 10 and e.address_length == 0:
+                paths = sorted((p.preference, p.sw_if_index)
+                               for p in e.path)
+        self.assertEqual(paths, [(5, clients[0].pppox_sw_if_index),
+                                 (10, clients[1].pppox_sw_if_index)])
+
+    def test_bulk_clients(self):
+        """ PPPoE client bulk add, details and bulk delete """
+        clients = [{'sw_if_index': self.pg0.sw_if_index,
+                    'host_uniq': i + 1,
+                    'username': self.ac.username,
+                    'password': self.ac.password} for i in range(4)]
+
+        # a count beyond the clients in the message is refused
+        with self.vapi.expect_negative_api_retval():
+            self.vapi.pppoe_add_del_clients(clients[:1], count=1000)
+        self.assertEqual(len(self.vapi.pppoe_client_dump()), 0)
+
+        r = self.vapi.pppoe_add_del_clients(clients)
+        self.assertEqual(r.count, 4)
+        self.assertEqual(len(set(r.pppox_sw_if_index)), 4)
+
+        # credentials given along start the clients
+        def ac_session(host_uniq):
+            return self.ac.session_by_host_uniq(struct.pack("=I", host_uniq))
+
+        self.assertTrue(self.ac.run(
+            lambda: all(ac_session(c['host_uniq']) is not None and
+                        ac_session(c['host_uniq']).is_up for c in clients)))
+
+        details = self.vapi.pppoe_client_dump(self.pg0.sw_if_index)
+        self.assertEqual(len(details), 4)
+        for d in details:
+            s = ac_session(d.host_uniq)
+            self.assertIn(d.pppox_sw_if_index, r.pppox_sw_if_index)
+            self.assertEqual(d.state, 2)
+            self.assertEqual(d.session_id, s.session_id)
+            self.assertEqual(d.ac_mac_address,
+                             mactobinary(self.pg0.remote_mac))
+            self.assertEqual(d.local_ip, socket.inet_aton(s.client_ip))
+            self.assertEqual(d.remote_ip, socket.inet_aton(self.ac.ac_ip))
+            self.assertEqual(d.mru, 1492)
+            self.assertEqual(d.mtu, 1492)
+        self.assertEqual(len(self.vapi.pppoe_client_dump(
+            self.pg1.sw_if_index)), 0)
+
+        # IPCP addresses went in through the batched queue
+        ifaddr = self.vapi.cli("show pppox ifaddr").split()
+        self.assertEqual(ifaddr[ifaddr.index("pending") + 1], "0")
+        self.assertGreaterEqual(int(ifaddr[ifaddr.index("changes") + 1]), 4)
+
+        # a batch stops at the first client which fails, one without
+        # credentials is not started
+        idle = {'sw_if_index': self.pg0.sw_if_index, 'host_uniq': 5,
+                'username': '', 'password': ''}
+        with self.vapi.expect_negative_api_retval():
+            r = self.vapi.pppoe_add_del_clients([idle, clients[0]])
+        self.assertEqual(r.count, 1)
+        clients.append(idle)
+
+        r = self.vapi.pppoe_add_del_clients(clients, is_add=0)
+        self.assertEqual(r.count, 5)
+        self.assertEqual(len(self.vapi.pppoe_client_dump()), 0)
+
+    def verify_mss(self, p, mss):
+        self.assertEqual(dict(p[TCP].options)["MSS"], mss)
+        csum = p[TCP].chksum
+        p[TCP].chksum = None
+        self.assertEqual(TCP(bytes(p[TCP])).chksum, csum)
+
+    def test_mss_clamp(self):
+        """ PPPoE client clamps TCP MSS of SYNs to the LCP MTU """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+        self.add_route_via(c, self.dst_ip, 32)
+
+        # 1492 bytes MTU as the AC did not ask for an MRU
+        mss = 1492 - 40
+        # a NOP before MSS puts it at an odd offset
+        options = [[("MSS", 1460), ("SACKOK", b"")],
+                   [("NOP", None), ("MSS", 1460), ("WScale", 7)],
+                   [("NOP", None), ("NOP", None), ("MSS", 1460)]]
+
+        pkts = [(Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=self.dst_ip) /
+                 TCP(sport=1234, dport=80, flags="S", options=o))
+                for o in options]
+        self.pg1.add_stream(pkts)
+        self.pg_start()
+        for p in self.data_capture(self.pg0, len(pkts)):
+            self.verify_mss(p, mss)
+
+        pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 PPPoE(sessionid=s.session_id) /
+                 PPP(proto=PPP_IP) /
+                 IP(src=self.dst_ip, dst=self.pg1.remote_ip4) /
+                 TCP(sport=80, dport=1234, flags="SA", options=o))
+                for o in options]
+        self.pg0.add_stream(pkts)
+        self.pg_start()
+        for p in self.data_capture(self.pg1, len(pkts)):
+            self.verify_mss(p, mss)
+
+        # smaller MSS and non SYN pass as they are
+        pkts = [(Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=self.dst_ip) /
+                 TCP(sport=1234, dport=80, flags=f, options=[("MSS", m)]))
+                for f, m in (("S", 1200), ("A", 1460))]
+        self.pg1.add_stream(pkts)
+        self.pg_start()
+        rx = self.data_capture(self.pg0, len(pkts))
+        self.verify_mss(rx[0], 1200)
+        self.verify_mss(rx[1], 1460)
+
+    def test_max_payload(self):
+        """ PPPoE client PPP-Max-Payload carries 1500 byte IP, RFC 4638 """
+        self.ac.max_payload = 1500
+        c = self.create_client(1)
+        self.bring_up([c])
+        self.assertEqual(self.ac_session(c).max_payload, 1500)
+        self.assertIn("granted 1500", self.vapi.cli("show pppoe client"))
+
+        # a full size packet goes whole, not cut to 1492
+        self.add_route_via(c, self.dst_ip, 32)
+        self.pg1.add_stream(self.create_stream_encap(1, self.dst_ip,
+                                                     size=1500 - 28))
+        self.pg_start()
+        p = self.data_capture(self.pg0, 1)[0]
+        self.assertEqual(len(p[IP]), 1500)
+        self.assertEqual(p[PPPoE].len, 1502)
+
+    def test_session_unknown(self):
+        """ PPPoE client drops data of an unknown session """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+
+        stale = AcSession(s.session_id + 1000, s.client_mac, s.host_uniq,
+                          s.client_ip)
+        self.pg0.add_stream(self.create_stream_decap(stale, 5))
+        self.pg_start()
+        self.pg1.assert_nothing_captured()
+
+    def test_lcp_echo(self):
+        """ PPPoE client answers LCP Echo-Request in the data plane """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+
+        n = 3
+        self.ac.send([self.ac.ppp(s, PPP_LCP, ppp_control(
+            ECHO_REQ, 0x40 + i, struct.pack("!I", s.magic) + b"ping"))
+            for i in range(n)])
+
+        replies = []
+        deadline = time.time() + 5
+        while len(replies) < n and time.time() < deadline:
+            try:
+                p = self.pg0.wait_for_packet(1)
+            except CaptureTimeoutError:
+                break
+            raw = bytes(p[PPP]) if PPP in p else b""
+            if raw[:3] == struct.pack("!HB", PPP_LCP, ECHO_REP):
+                replies.append((p, raw))
+            else:
+                answers = self.ac.handle(p)
+                if answers:
+                    self.ac.send(answers)
+        self.assertEqual(len(replies), n)
+
+        for i, (p, raw) in enumerate(replies):
+            self.assertEqual(p[Ether].dst, self.pg0.remote_mac)
+            self.assertEqual(p[Ether].src, self.pg0.local_mac)
+            self.assertEqual(p[PPPoE].sessionid, s.session_id)
+            code, ident, length, magic = struct.unpack("!BBHI", raw[2:10])
+            self.assertEqual(ident, 0x40 + i)
+            self.assertEqual(length, 12)
+            self.assertEqual(magic, s.client_magic)
+            self.assertEqual(raw[10:14], b"ping")
+
+        errors = self.vapi.cli("show errors")
+        self.assertIn("lcp echo requests answered in data plane", errors)
+
+    def test_lcp_echo_looped(self):
+        """ PPPoE client does not answer its own LCP Echo-Request """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+
+        # our magic number coming back means the link is looped, the
+        # data plane leaves it to pppd which does not answer either
+        self.ac.send([self.ac.ppp(s, PPP_LCP, ppp_control(
+            ECHO_REQ, 0x40, struct.pack("!I", s.client_magic) + b"ping"))])
+        self.assertEqual(self.lcp_capture(ECHO_REP, 1, 1), [])
+
+    def lcp_capture(self, code, count, timeout):
+        """ Capture count LCP packets of code sent by the client """
+        rx = []
+        deadline = time.time() + timeout
+        while len(rx) < count:
+            try:
+                p = self.pg0.wait_for_packet(0.1)
+            except CaptureTimeoutError:
+                if time.time() > deadline:
+                    break
+                continue
+            if PPP in p and p[PPP].proto == PPP_LCP and \
+               struct.unpack("!B", bytes(p[PPP])[2:3])[0] == code:
+                rx.append((time.time(), p))
+        return rx
+
+    def test_lcp_echo_dead_peer(self):
+        """ PPPoE client detects a dead AC by sub-second LCP echo """
+        c = self.create_client(1)
+        self.bring_up([c])
+        self.vapi.pppox_set_lcp_echo(c.pppox_sw_if_index, 100, failures=3)
+
+        # the AC is silent from now on
+        start = time.time()
+        echoes = self.lcp_capture(ECHO_REQ, 3, 2)
+        self.assertEqual(len(echoes), 3)
+        term = self.lcp_capture(TERM_REQ, 1, 2)
+        self.assertEqual(len(term), 1)
+        self.logger.info("dead AC detected after %.3fs" %
+                         (term[0][0] - start))
+        self.assertLess(term[0][0] - start, 1.5)
+
+    def test_lcp_echo_adaptive(self):
+        """ PPPoE client adaptive LCP echo keeps quiet on a busy link """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+        self.vapi.pppox_set_lcp_echo(c.pppox_sw_if_index, 100,
+                                     max_interval_ms=800, failures=3)
+
+        # data from the AC stands in for echo replies
+        self.pg_enable_capture([self.pg0])
+        for i in range(10):
+            self.pg0.add_stream(self.create_stream_decap(s, 1))
+            self.pg_start()
+            self.sleep(0.1)
+        echoes = self.lcp_capture(ECHO_REQ, 5, 0.1)
+        self.assertLess(len(echoes), 5)
+        self.assertTrue(s.is_up)
+
+    def test_padt_reconnect(self):
+        """ PPPoE client reconnects after PADT """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+
+        start = time.time()
+        self.ac.send(self.ac.padt(s))
+        self.assertTrue(self.ac.run(lambda: self.session_up(c)))
+        self.logger.info("reconnect after PADT took %.3fs" %
+                         (time.time() - start))
+        self.assertNotEqual(self.ac_session(c).session_id, s.session_id)
+        self.assertTrue(find_route(self, self.ac_session(c).client_ip, 32))
+
+        stats = self.vapi.pppoe_client_discovery_stats()
+        self.assertEqual(stats.in_flight, 0)
+        self.assertEqual(sum(stats.reconnect_histogram), 2)
+
+    def client_events(self, client):
+        """ Events of the client so far, or'ed, and the last one """
+        events = [e for e in self.vapi.collect_events()
+                  if type(e).__name__ == "pppoe_client_event" and
+                  e.host_uniq == client.host_uniq]
+        bits = 0
+        for e in events:
+            bits |= e.events
+        return bits, events[-1] if events else None
+
+    def test_events(self):
+        """ PPPoE client session events """
+        self.vapi.want_pppoe_client_events()
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+        self.sleep(0.1)
+
+        bits, last = self.client_events(c)
+        self.assertEqual(bits, EVENT_SESSION_UP | EVENT_LCP_UP |
+                         EVENT_IP_UP)
+        self.assertEqual(last.pppox_sw_if_index, c.pppox_sw_if_index)
+        self.assertEqual(last.state, 2)
+        self.assertEqual(last.session_id, s.session_id)
+        self.assertEqual(last.local_ip, socket.inet_aton(s.client_ip))
+
+        self.ac.send(self.ac.padt(s))
+        self.assertTrue(self.ac.run(lambda: self.session_up(c)))
+        self.sleep(0.1)
+        bits, last = self.client_events(c)
+        self.assertEqual(bits, EVENT_PADT | EVENT_LCP_DOWN | EVENT_IP_DOWN |
+                         EVENT_SESSION_UP | EVENT_LCP_UP | EVENT_IP_UP)
+        self.assertEqual(last.session_id, self.ac_session(c).session_id)
+
+        self.vapi.want_pppoe_client_events(enable_disable=0)
+        self.ac.send(self.ac.padt(self.ac_session(c)))
+        self.assertTrue(self.ac.run(lambda: self.session_up(c)))
+        self.sleep(0.1)
+        self.assertEqual(self.client_events(c), (0, None))
+
+    def save_restore(self, client):
+        """ Save the client, delete it unseen by the AC and restore it """
+        path = os.path.join(self.tempdir, "pppoeclient.state")
+        self.vapi.cli("save pppoe client state %s" % path)
+        # credentials are in there
+        self.assertEqual(os.stat(path).st_mode & 0o777, 0o600)
+        client.remove_vpp_config()
+        # TermReq and PADT of the delete never reach the AC
+        self.sleep(0.2)
+        self.pg_enable_capture([self.pg0])
+        self.vapi.cli("restore pppoe client state %s" % path)
+        client.pppox_sw_if_index = client.get_details().pppox_sw_if_index
+
+    def test_warm_restart(self):
+        """ PPPoE client takes its session over after restore """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+        padi_seen = self.ac.padi_seen
+
+        self.save_restore(c)
+        d = c.get_details()
+        self.assertEqual(d.state, 2)
+        self.assertEqual(d.session_id, s.session_id)
+        self.assertEqual(d.local_ip, socket.inet_aton(s.client_ip))
+
+        # echoes prove the session, no discovery or negotiation
+        self.ac.run(lambda: False, timeout=2)
+        self.assertGreater(s.echo_requests, 0)
+        self.assertEqual(self.ac.padi_seen, padi_seen)
+        self.assertIs(self.ac_session(c), s)
+        self.assertTrue(find_route(self, s.client_ip, 32))
+
+        self.add_route_via(c, self.dst_ip, 32)
+        self.pg1.add_stream(self.create_stream_encap(5, self.dst_ip))
+        self.pg_start()
+        for p in self.data_capture(self.pg0, 5):
+            self.assertEqual(p[PPPoE].sessionid, s.session_id)
+            self.assertEqual(p[IP].dst, self.dst_ip)
+
+    def test_warm_restart_stale(self):
+        """ PPPoE client rediscovers a restored session the AC lost """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+
+        self.save_restore(c)
+        # the AC dropped the session while vpp was away
+        self.ac.sessions.pop(s.session_id)
+        self.assertTrue(self.ac.run(lambda: self.session_up(c), timeout=20))
+        self.assertNotEqual(self.ac_session(c).session_id, s.session_id)
+        self.assertTrue(find_route(self, self.ac_session(c).client_ip, 32))
+
+    def test_bundle(self):
+        """ PPPoE client bundle spreads flows over its sessions """
+        clients = [self.create_client(1), self.create_client(2)]
+        self.bring_up(clients)
+        sessions = [self.ac_session(c) for c in clients]
+
+        bundle = self.vapi.pppox_add_del_bundle().sw_if_index
+        for c in clients:
+            self.vapi.pppox_bundle_add_del_member(bundle,
+                                                  c.pppox_sw_if_index)
+        self.assertEqual(self.vapi.cli("show pppox bundle").count(" up "), 2)
+        r = VppIpRoute(self, self.dst_ip, 32,
+                       [VppRoutePath("0.0.0.0", bundle)])
+        r.add_vpp_config()
+
+        # each flow twice, it must stick to one session
+        flows = 64
+        pkts = [(Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=self.dst_ip) /
+                 UDP(sport=1024 + i % flows, dport=1234) /
+                 Raw(b"\xa5" * 64)) for i in range(2 * flows)]
+        self.pg1.add_stream(pkts)
+        self.pg_start()
+        by_flow = {}
+        for p in self.data_capture(self.pg0, len(pkts)):
+            by_flow.setdefault(p[UDP].sport, set()).add(p[PPPoE].sessionid)
+            self.assertEqual(p[PPPoE].len, len(p[PPP]))
+        self.assertEqual(len(by_flow), flows)
+        for ids in by_flow.values():
+            self.assertEqual(len(ids), 1)
+        used = set().union(*by_flow.values())
+        self.assertEqual(used, set(s.session_id for s in sessions))
+
+        # flows of a session going down move to the other one
+        self.ac.send(self.ac.padt(sessions[0]))
+        deadline = time.time() + 5
+        while time.time() < deadline and \
+                " down " not in self.vapi.cli("show pppox bundle"):
+            time.sleep(0.1)
+        self.pg1.add_stream(pkts)
+        self.pg_start()
+        for p in self.data_capture(self.pg0, len(pkts)):
+            self.assertEqual(p[PPPoE].sessionid, sessions[1].session_id)
+
+        r.remove_vpp_config()
+        self.vapi.pppox_add_del_bundle(is_add=0, sw_if_index=bundle)
+
+
+    def mp_fragment(self, s, seq, flags, data):
+        return self.ac.ppp(s, PPP_MP,
+                           struct.pack("!I", (flags << 24) | seq) + data)
+
+    def test_multilink(self):
+        """ PPPoE client multilink bundle fragments and reassembles """
+        self.ac.mrru = 1600
+        bundle = self.vapi.pppox_add_del_bundle().sw_if_index
+        self.vapi.pppox_bundle_set_multilink(bundle, 1600, fragment_min=256)
+        clients = [self.create_client(1), self.create_client(2)]
+        for c in clients:
+            self.vapi.pppox_bundle_add_del_member(bundle,
+                                                  c.pppox_sw_if_index)
+            c.start()
+
+        # NCPs run on the link that joined first only
+        def sessions():
+            return [self.ac_session(c) for c in clients]
+
+        self.assertTrue(self.ac.run(
+            lambda: None not in sessions() and
+            all(s.auth_done for s in sessions()) and
+            len([s for s in sessions() if s.is_up]) == 1))
+        head = [s for s in sessions() if s.is_up][0]
+        tail = [s for s in sessions() if not s.is_up][0]
+        deadline = time.time() + 5
+        while time.time() < deadline and \
+                self.vapi.cli("show pppox bundle").count(" up ") != 2:
+            time.sleep(0.1)
+        self.assertEqual(self.vapi.cli("show pppox bundle").count(" up "), 2)
+
+        # a packet is cut in one fragment per link
+        r = VppIpRoute(self, self.dst_ip, 32,
+                       [VppRoutePath("0.0.0.0", bundle)])
+        r.add_vpp_config()
+        self.pg1.add_stream(self.create_stream_encap(1, self.dst_ip,
+                                                     size=1000))
+        self.pg_start()
+        rx = self.data_capture(self.pg0, 2)
+        hdrs = [struct.unpack("!I", bytes(p[PPP].payload)[:4])[0]
+                for p in rx]
+        hdrs.sort(key=lambda h: h & 0xffffff)
+        self.assertEqual(hdrs[0] >> 24, MP_B)
+        self.assertEqual(hdrs[1] >> 24, MP_E)
+        self.assertEqual((hdrs[0] + 1) & 0xffffff, hdrs[1] & 0xffffff)
+        self.assertEqual(set(p[PPPoE].sessionid for p in rx),
+                         set([head.session_id, tail.session_id]))
+        for p in rx:
+            self.assertEqual(p[PPP].proto, PPP_MP)
+            self.assertEqual(p[PPPoE].len, len(p[PPP]))
+
+        # fragments out of order over both links come out whole
+        pkt = self.create_stream_decap(head, 1, size=1000)[0]
+        data = bytes(pkt[PPP])
+        cut = [data[:400], data[400:800], data[800:]]
+        self.ac.send([
+            # a whole packet syncs the receiver
+            self.mp_fragment(head, 0, MP_B | MP_E, data),
+            self.mp_fragment(tail, 3, MP_E, cut[2]),
+            self.mp_fragment(head, 1, MP_B, cut[0]),
+            self.mp_fragment(tail, 2, 0, cut[1])])
+        rx = self.data_capture(self.pg1, 2)
+        for p in rx:
+            self.assertEqual(bytes(p[IP].payload),
+                             bytes(pkt[IP].payload))
+
+        # a fragment behind the window is late
+        self.ac.send([self.mp_fragment(head, 1, MP_B, cut[0])])
+        self.pg1.assert_nothing_captured(remark="late fragment")
+        self.assertIn("reassembled 2 lost 0 late 1",
+                      self.vapi.cli("show pppox bundle"))
+
+        r.remove_vpp_config()
+        self.vapi.pppox_add_del_bundle(is_add=0, sw_if_index=bundle)
+
+class TestPPPoEClientChap(TestPPPoEClientBase):
+    """ PPPoE client with CHAP """
+
+    ac_auth = "chap"
+
+    def test_session(self):
+        """ PPPoE client session setup with CHAP """
+        c = self.create_client(1)
+        self.bring_up([c])
+        self.assertIsNotNone(self.ac_session(c).challenge)
+
+
+class TestPPPoEClientDot1Q(TestPPPoEClientBase):
+    """ PPPoE client over a dot1q sub-interface """
+
+    def setUp(self):
+        super(TestPPPoEClientDot1Q, self).setUp()
+        self.uplink = VppDot1QSubint(self, self.pg0, 100)
+        self.uplink.admin_up()
+        self.ac = PppoeAc(self, self.pg0, auth=self.ac_auth, vlan=100)
+
+    def tearDown(self):
+        super(TestPPPoEClientDot1Q, self).tearDown()
+        self.uplink.remove_vpp_config()
+
+    def test_session(self):
+        """ PPPoE client session setup, encap and decap tagged """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+
+        # subscriber to network, tagged by the client rewrite
+        self.add_route_via(c, self.dst_ip, 32)
+        self.pg1.add_stream(self.create_stream_encap(17, self.dst_ip))
+        self.pg_start()
+        for p in self.data_capture(self.pg0, 17):
+            self.assertEqual(p[Ether].dst, self.pg0.remote_mac)
+            self.assertEqual(p[Ether].src, self.pg0.local_mac)
+            self.assertEqual(p[Dot1Q].vlan, 100)
+            self.assertEqual(p[PPPoE].sessionid, s.session_id)
+            self.assertEqual(p[PPPoE].len, len(p[PPP]))
+            self.assertEqual(p[IP].dst, self.dst_ip)
+
+        # network to subscriber, classified on the sub-interface
+        pkts = [(self.ac.ether(self.pg0.local_mac) /
+                 PPPoE(sessionid=s.session_id) /
+                 PPP(proto=PPP_IP) /
+                 IP(src=self.dst_ip, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234, dport=1234) /
+                 Raw(b"\xa5" * 64)) for i in range(17)]
+        self.pg0.add_stream(pkts)
+        self.pg_start()
+        for p in self.data_capture(self.pg1, 17):
+            self.assertNotIn(Dot1Q, p)
+            self.assertEqual(p[IP].src, self.dst_ip)
+            self.assertEqual(p[IP].dst, self.pg1.remote_ip4)
+
+        # echo replies go back with the tag they came in with
+        self.ac.send([self.ac.ppp(s, PPP_LCP, ppp_control(
+            ECHO_REQ, 0x40, struct.pack("!I", s.magic) + b"ping"))])
+        p = self.pg0.wait_for_packet(
+            2, filter_out_fn=lambda p: PPP not in p or
+            bytes(p[PPP])[:3] != struct.pack("!HB", PPP_LCP, ECHO_REP))
+        self.assertEqual(p[Dot1Q].vlan, 100)
+        self.assertEqual(p[PPPoE].sessionid, s.session_id)
+
+    def test_restore_before_uplink(self):
+        """ PPPoE client restored once its uplink is created """
+        uplink = VppDot1QSubint(self, self.pg0, 200)
+        c = VppPppoeClient(self, uplink.sw_if_index, 1)
+        c.add_vpp_config()
+        path = os.path.join(self.tempdir, "pppoeclient.state")
+        self.vapi.cli("save pppoe client state %s" % path)
+        c.remove_vpp_config()
+        uplink.remove_vpp_config()
+
+        # kept aside until the startup script creates the uplink
+        self.vapi.cli("restore pppoe client state %s" % path)
+        self.assertEqual(len(self.vapi.pppoe_client_dump()), 0)
+        uplink = VppDot1QSubint(self, self.pg0, 200)
+        self.sleep(0.2)
+        c.sw_if_index = uplink.sw_if_index
+        self.assertIsNotNone(c.get_details())
+        c.remove_vpp_config()
+        uplink.remove_vpp_config()
+
+
+class TestPPPoEClientServer(TestPPPoEClientBase):
+    """ PPPoE client next to the pppoe server plugin """
+
+    server_mac = "00:00:5e:00:53:01"
+    server_client_ip = "192.0.2.2"
+
+    def test_dispatch(self):
+        """ PPPoE frames reach the client or the server they belong to """
+        # PADO and PADS go to the client
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+
+        # PADI and LCP of a session nobody owns go to the server, which
+        # learns where its client is and only then accepts the session
+        self.pg0.add_stream([Ether(dst="ff:ff:ff:ff:ff:ff",
+                                   src=self.server_mac) /
+                             PPPoED(sessionid=0),
+                             Ether(dst=self.pg0.local_mac,
+                                   src=self.server_mac) /
+                             PPPoE(sessionid=s.session_id) /
+                             PPP(proto=PPP_LCP) /
+                             ppp_control(CONF_REQ, 1, b"")])
+        self.pg_start()
+        server = VppPppoeInterface(self, self.server_client_ip,
+                                   self.server_mac, s.session_id)
+        server.add_vpp_config()
+
+        # same session id, told apart by the peer mac
+        pkts = [(Ether(dst=self.pg0.local_mac, src=self.server_mac) /
+                 PPPoE(sessionid=s.session_id) /
+                 PPP(proto=PPP_IP) /
+                 IP(src=self.server_client_ip, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1234, dport=1234) /
+                 Raw(b"\xa5" * 64)) for i in range(5)]
+        pkts += self.create_stream_decap(s, 7)
+        self.pg_enable_capture([self.pg1])
+        self.pg0.add_stream(pkts)
+        self.pg_start()
+        rx = self.pg1.get_capture(12)
+        self.assertEqual(
+            len([p for p in rx if p[IP].src == self.server_client_ip]), 5)
+        self.assertEqual(len([p for p in rx if p[IP].src == self.dst_ip]), 7)
+        self.assertEqual(self.pppox_counters(c)["rx packets"], 7)
+
+        server.remove_vpp_config()
+
+
+@unittest.skipUnless(os.getenv("PPPOE_CLIENT_BENCH"),
+                     "set PPPOE_CLIENT_BENCH to run the benchmark")
+class TestPPPoEClientBench(TestPPPoEClientBase):
+    """
+    PPPoE client benchmark
+
+    PPPOE_CLIENT_BENCH_SESSIONS clients are brought up at once for the
+    setup rate, the encap and decap rates are per core and derived from
+    the clocks per packet of the nodes on the path.
+    """
+
+    # IP goes out on the pppox midchain adjacency, stacked on the tx
+    # node of the uplink, pppox-output only carries pppd frames.
+    encap_nodes = ["ip4-midchain", "adj-midchain-tx"]
+    decap_nodes = ["pppoe-dispatch", "pppoeclient-session-input"]
+
+    def setUp(self):
+        super(TestPPPoEClientBench, self).setUp()
+        self.n_sessions = int(os.getenv("PPPOE_CLIENT_BENCH_SESSIONS", 100))
+        self.n_packets = int(os.getenv("PPPOE_CLIENT_BENCH_PACKETS", 100000))
+        self.vapi.pppoe_client_set_discovery_params(rate=0, burst=0)
+
+    def cpu_hz(self):
+        for line in self.vapi.cli("show cpu").splitlines():
+            if "frequency" in line:
+                return float(line.split()[-2]) * 1e9
+        return 0
+
+    def runtime(self, nodes):
+        """ (vectors, clocks per vector) of nodes in show runtime """
+        stats = {}
+        for line in self.vapi.cli("show runtime").splitlines():
+            f = line.split()
+            # Name State Calls Vectors Suspends Clocks Vectors/Call
+            if len(f) == 7 and f[0] in nodes and int(f[3]):
+                stats[f[0]] = (int(f[3]), float(f[5]))
+        return stats
+
+    def report(self, what, value, unit):
+        self.logger.info("BENCH %s: %.3f %s" % (what, value, unit))
+
+    def throughput(self, what, intf, pkts, nodes):
+        self.vapi.cli("clear runtime")
+        intf.add_stream(pkts)
+        self.pg_start()
+        # the stream runs in the background, wait for it to pass
+        deadline = time.time() + 60
+        while time.time() < deadline:
+            stats = self.runtime(nodes)
+            if stats and min(v for v, c in stats.values()) >= len(pkts):
+                break
+            self.sleep(0.5, "waiting for the stream")
+        clocks = sum(c for v, c in self.runtime(nodes).values())
+        self.assertNotEqual(clocks, 0)
+        self.report("%s clocks/pkt" % what, clocks, "")
+        hz = self.cpu_hz()
+        if hz:
+            self.report("%s rate" % what, hz / clocks / 1e6, "Mpps/core")
+
+    def test_session_setup_rate(self):
+        """ PPPoE client session setup rate """
+        clients = [self.create_client(i + 1)
+                   for i in range(self.n_sessions)]
+        start = time.time()
+        self.bring_up(clients, timeout=60 + self.n_sessions / 10)
+        elapsed = time.time() - start
+        self.report("session setup", len(clients) / elapsed, "sessions/s")
+
+        start = time.time()
+        self.ac.send([self.ac.padt(self.ac_session(c)) for c in clients])
+        self.assertTrue(self.ac.run(
+            lambda: all(self.session_up(c) for c in clients),
+            timeout=60 + self.n_sessions / 10))
+        self.report("reconnect after PADT", time.time() - start, "s")
+
+    def test_throughput(self):
+        """ PPPoE client encap and decap throughput """
+        c = self.create_client(1)
+        self.bring_up([c])
+        s = self.ac_session(c)
+        self.add_route_via(c, self.dst_ip, 32)
+
+        # a single packet repeated keeps the stream small
+        self.vapi.cli("trace clear")
+        self.throughput("encap", self.pg1,
+                        self.create_stream_encap(1, self.dst_ip) *
+                        self.n_packets, self.encap_nodes)
+        self.throughput("decap", self.pg0,
+                        self.create_stream_decap(s, 1) * self.n_packets,
+                        self.decap_nodes)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -2169,6 +2169,151 @@ class VppPapiProvider(object):
                          'decap_vrf_id': decap_vrf_id,
                          'client_mac': client_mac})
 
+    def pppoe_add_del_client(self, sw_if_index, host_uniq, is_add=1):
+        """
+
+        :param sw_if_index: ethernet interface the client runs on
+        :param host_uniq: host-uniq tag of the client
+        :param is_add:  (Default value = 1)
+
+        """
+        return self.api(self.papi.pppoe_add_del_client,
+                        {'is_add': is_add,
+                         'sw_if_index': sw_if_index,
+                         'host_uniq': host_uniq})
+
+    def pppoe_add_del_clients(self, clients, is_add=1, count=None):
+        """ Add or delete PPPoE clients in one message
+
+        :param clients: list of dicts with sw_if_index, host_uniq and,
+            to start the clients, username and password
+        :param is_add:  (Default value = 1)
+        :param count: clients in the message (Default value = len(clients))
+
+        """
+        return self.api(self.papi.pppoe_add_del_clients,
+                        {'is_add': is_add,
+                         'count': len(clients) if count is None else count,
+                         'clients': clients})
+
+    def pppoe_client_dump(self, sw_if_index=0xffffffff):
+        return self.api(self.papi.pppoe_client_dump,
+                        {'sw_if_index': sw_if_index})
+
+    def pppoe_client_set_discovery_params(self, rate=100, burst=100,
+                                          max_in_flight=0,
+                                          backoff_min_ms=1000,
+                                          backoff_max_ms=32000):
+        """ Configure pacing of PPPoE client discovery
+
+        :param rate: PADI per second per uplink, 0 is unlimited
+        :param burst: PADI burst per uplink
+        :param max_in_flight: clients in discovery at once, 0 is unlimited
+        :param backoff_min_ms: first PADI retry interval
+        :param backoff_max_ms: PADI retry interval upper bound
+
+        """
+        return self.api(self.papi.pppoe_client_set_discovery_params,
+                        {'rate': rate,
+                         'burst': burst,
+                         'max_in_flight': max_in_flight,
+                         'backoff_min_ms': backoff_min_ms,
+                         'backoff_max_ms': backoff_max_ms})
+
+    def want_pppoe_client_events(self, enable_disable=1):
+        return self.api(self.papi.want_pppoe_client_events,
+                        {'enable_disable': enable_disable,
+                         'pid': os.getpid()})
+
+    def pppoe_client_discovery_stats(self):
+        return self.api(self.papi.pppoe_client_discovery_stats, {})
+
+    def pppox_set_auth(self, sw_if_index, username, password):
+        """
+
+        :param sw_if_index: pppox interface
+        :param username: ppp username
+        :param password: ppp password
+
+        """
+        return self.api(self.papi.pppox_set_auth,
+                        {'sw_if_index': sw_if_index,
+                         'username': username,
+                         'password': password})
+
+    def pppox_set_lcp_echo(self, sw_if_index, interval_ms,
+                           max_interval_ms=0, failures=5):
+        """
+
+        :param sw_if_index: pppox interface
+        :param interval_ms: milliseconds between echo requests
+        :param max_interval_ms: adaptive echo backs off up to this
+        :param failures: unanswered echo requests to close the link
+
+        """
+        return self.api(self.papi.pppox_set_lcp_echo,
+                        {'sw_if_index': sw_if_index,
+                         'interval_ms': interval_ms,
+                         'max_interval_ms': max_interval_ms,
+                         'failures': failures})
+
+    def pppox_set_vrf(self, sw_if_index, vrf_id, is_default_route=0,
+                      default_route_distance=0):
+        """
+
+        :param sw_if_index: pppox interface
+        :param vrf_id: ip4 table the session goes in
+        :param is_default_route: default route through the session
+        :param default_route_distance: lowest distance up is used
+
+        """
+        return self.api(self.papi.pppox_set_vrf,
+                        {'sw_if_index': sw_if_index,
+                         'vrf_id': vrf_id,
+                         'is_default_route': is_default_route,
+                         'default_route_distance': default_route_distance})
+
+    def pppox_add_del_bundle(self, is_add=1, sw_if_index=0xFFFFFFFF):
+        """
+
+        :param is_add: add if non-zero, else delete
+        :param sw_if_index: bundle interface, for delete
+
+        """
+        return self.api(self.papi.pppox_add_del_bundle,
+                        {'is_add': is_add,
+                         'sw_if_index': sw_if_index})
+
+    def pppox_bundle_add_del_member(self, bundle_sw_if_index, sw_if_index,
+                                    weight=1, is_add=1):
+        """
+
+        :param bundle_sw_if_index: bundle interface
+        :param sw_if_index: member pppox interface
+        :param weight: share of flows against the other members
+        :param is_add: add if non-zero, else delete
+
+        """
+        return self.api(self.papi.pppox_bundle_add_del_member,
+                        {'is_add': is_add,
+                         'bundle_sw_if_index': bundle_sw_if_index,
+                         'sw_if_index': sw_if_index,
+                         'weight': weight})
+
+    def pppox_bundle_set_multilink(self, sw_if_index, mrru,
+                                   fragment_min=0):
+        """
+
+        :param sw_if_index: bundle interface
+        :param mrru: MRRU the members ask for, 0 turns multilink off
+        :param fragment_min: smallest fragment, 0 for the default
+
+        """
+        return self.api(self.papi.pppox_bundle_set_multilink,
+                        {'sw_if_index': sw_if_index,
+                         'mrru': mrru,
+                         'fragment_min': fragment_min})
+
     def sr_localsid_add_del(self,
                             localsid_addr,
                             behavior,
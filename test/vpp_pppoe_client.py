@@ -0,0 +1,46 @@
+from vpp_object import VppObject
+
+
+class VppPppoeClient(VppObject):
+    """
+    VPP PPPoE client, with the pppox interface carrying its session
+    """
+
+    def __init__(self, test, sw_if_index, host_uniq,
+                 username="vpp", password="vpp"):
+        self._test = test
+        self.sw_if_index = sw_if_index
+        self.host_uniq = host_uniq
+        self.username = username
+        self.password = password
+        self.pppox_sw_if_index = None
+
+    def add_vpp_config(self):
+        r = self._test.vapi.pppoe_add_del_client(self.sw_if_index,
+                                                 self.host_uniq)
+        self.pppox_sw_if_index = r.pppox_sw_if_index
+        self._test.registry.register(self, self._test.logger)
+
+    def start(self):
+        """ Configure the credentials, which starts discovery """
+        self._test.vapi.pppox_set_auth(self.pppox_sw_if_index,
+                                       self.username, self.password)
+
+    def remove_vpp_config(self):
+        self._test.vapi.pppoe_add_del_client(self.sw_if_index,
+                                             self.host_uniq, is_add=0)
+
+    def get_details(self):
+        for d in self._test.vapi.pppoe_client_dump(self.sw_if_index):
+            if d.host_uniq == self.host_uniq:
+                return d
+        return None
+
+    def query_vpp_config(self):
+        return self.get_details() is not None
+
+    def __str__(self):
+        return self.object_id()
+
+    def object_id(self):
+        return "pppoe-client-%d-%d" % (self.sw_if_index, self.host_uniq)